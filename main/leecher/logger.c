@@ -0,0 +1,382 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+#include "logger.h"
+
+#define LOG_LINE_MAX 1024
+#define LOG_OUT_MAX (64 * 1024) // bytes formatted before one fwrite()
+
+typedef struct LogRecord
+{
+    uint64_t time_ns; // CLOCK_REALTIME
+    const char *format;
+    uint8_t level;
+    uint8_t count;
+    LogArg args[LOG_ARGS_MAX]; // a string argument's value.u is its offset in text
+    char text[LOG_TEXT_MAX];
+} LogRecord;
+
+/* One producer (the owning thread), one consumer (the drainer, under drain_lock) */
+typedef struct LogRing
+{
+    uint64_t head; // next record written, atomic
+    char pad1[56];
+    uint64_t tail; // next record drained, atomic
+    char pad2[56];
+    uint64_t dropped;  // atomic, records lost to a full ring
+    uint64_t reported; // drops already reported, drainer only
+    struct LogRing *next_free;
+    LogRecord records[LOG_RING_RECORDS];
+} LogRing;
+
+int logger_level = LOG_LEVEL_INFO;
+
+static FILE *log_out;
+static int logger_running; // atomic, records go through the rings once set
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static LogRing *rings[LOG_THREADS_MAX];
+static size_t ring_count; // atomic, rings[0..ring_count) are published
+static LogRing *free_rings;
+static pthread_key_t thread_key; // its destructor parks the ring of an exiting thread
+static __thread LogRing *local_ring;
+static __thread int no_ring; // LOG_THREADS_MAX reached, this thread writes synchronously
+
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static char out_buffer[LOG_OUT_MAX]; // under drain_lock
+static size_t out_len;
+
+static const char *const level_names[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static void ring_park(void *arg)
+{
+    LogRing *ring = arg;
+    pthread_mutex_lock(&registry_lock);
+    ring->next_free = free_rings;
+    free_rings = ring;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+/* Records already in a parked ring are still drained, the next thread appends after them */
+static LogRing *ring_get(void)
+{
+    if (local_ring || no_ring)
+        return local_ring;
+
+    pthread_mutex_lock(&registry_lock);
+    LogRing *ring = free_rings;
+    if (ring)
+        free_rings = ring->next_free;
+    else if (ring_count < LOG_THREADS_MAX && (ring = calloc(1, sizeof(LogRing))) != NULL)
+    {
+        rings[ring_count] = ring;
+        __atomic_store_n(&ring_count, ring_count + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (ring)
+        pthread_setspecific(thread_key, ring);
+    else
+        no_ring = 1;
+    local_ring = ring;
+    return ring;
+}
+
+static void record_fill(LogRecord *record, int level, const char *format, const LogArg *args, size_t count)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    record->time_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    record->format = format;
+    record->level = (uint8_t)level;
+    record->count = (uint8_t)(count < LOG_ARGS_MAX ? count : LOG_ARGS_MAX);
+
+    size_t used = 0;
+    for (size_t i = 0; i < record->count; i++)
+    {
+        record->args[i] = args[i];
+        if (args[i].type != LOG_ARG_STRING)
+            continue;
+
+        // The caller's buffer may be gone by the time the record is drained
+        const char *s = args[i].value.s ? args[i].value.s : "(null)";
+        if (used == LOG_TEXT_MAX)
+        {
+            record->args[i].value.u = LOG_TEXT_MAX - 1; // out of room: the '\0' ending the previous string
+            continue;
+        }
+        size_t len = strnlen(s, LOG_TEXT_MAX - used - 1);
+        memcpy(record->text + used, s, len);
+        record->text[used + len] = '\0';
+        record->args[i].value.u = used;
+        used += len + 1;
+    }
+}
+
+static int64_t sign_extend(uint64_t v, unsigned bits)
+{
+    if (bits >= 64)
+        return (int64_t)v;
+    uint64_t sign = 1ull << (bits - 1);
+    v &= (sign << 1) - 1;
+    return (int64_t)((v ^ sign) - sign);
+}
+
+/* The argument converted the way printf would have read it with this length modifier */
+static uint64_t integer_value(const LogArg *arg, const char *modifier, size_t modifier_len, int is_signed)
+{
+    uint64_t v = arg->type == LOG_ARG_DOUBLE ? (uint64_t)(int64_t)arg->value.d : arg->value.u;
+    unsigned bits = 32;
+    if (modifier_len == 2 && modifier[0] == 'h')
+        bits = 8;
+    else if (modifier_len == 1 && modifier[0] == 'h')
+        bits = 16;
+    else if (modifier_len > 0)
+        bits = 64; // l, ll, j, z, t
+    if (is_signed)
+        return (uint64_t)sign_extend(v, bits);
+    return bits >= 64 ? v : v & ((1ull << bits) - 1);
+}
+
+/* Formats one record as "HH:MM:SS.uuuuuu LEVEL message\n", returns its length */
+static size_t record_format(const LogRecord *record, char *line, size_t size)
+{
+    time_t seconds = (time_t)(record->time_ns / 1000000000ull);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    int n = snprintf(line, size, "%02d:%02d:%02d.%06u %s ", tm.tm_hour, tm.tm_min, tm.tm_sec,
+                     (unsigned)(record->time_ns % 1000000000ull / 1000), level_names[record->level & 3]);
+    size_t len = n > 0 ? (size_t)n : 0;
+    size_t next = 0;
+
+    for (const char *p = record->format; *p && len < size - 2;)
+    {
+        if (*p != '%' || p[1] == '%')
+        {
+            line[len++] = *p;
+            p += *p == '%' ? 2 : 1;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion
+        const char *spec = p++;
+        p += strspn(p, "-+ #0123456789.");
+        const char *modifier = p;
+        p += strspn(p, "hljztL");
+        size_t modifier_len = (size_t)(p - modifier);
+        char conversion = *p;
+        if (!conversion)
+            break;
+        p++;
+
+        char out_spec[32];
+        size_t prefix = (size_t)(modifier - spec);
+        if (prefix + 4 > sizeof(out_spec) || memchr(spec, '*', prefix) || next >= record->count)
+        {
+            // not something we can replay, keep it as written
+            size_t raw = (size_t)(p - spec);
+            if (raw > size - 2 - len)
+                raw = size - 2 - len;
+            memcpy(line + len, spec, raw);
+            len += raw;
+            continue;
+        }
+        memcpy(out_spec, spec, prefix);
+
+        const LogArg *arg = &record->args[next++];
+        char *dst = line + len;
+        size_t room = size - 1 - len;
+        n = 0;
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+            memcpy(out_spec + prefix, "lld", 4);
+            n = snprintf(dst, room, out_spec, (long long)integer_value(arg, modifier, modifier_len, 1));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            out_spec[prefix] = 'l';
+            out_spec[prefix + 1] = 'l';
+            out_spec[prefix + 2] = conversion;
+            out_spec[prefix + 3] = '\0';
+            n = snprintf(dst, room, out_spec, (unsigned long long)integer_value(arg, modifier, modifier_len, 0));
+            break;
+        case 'c':
+            out_spec[prefix] = 'c';
+            out_spec[prefix + 1] = '\0';
+            n = snprintf(dst, room, out_spec, (int)(arg->value.u & 0xff));
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            out_spec[prefix] = conversion;
+            out_spec[prefix + 1] = '\0';
+            n = snprintf(dst, room, out_spec, arg->type == LOG_ARG_DOUBLE ? arg->value.d
+                                              : arg->type == LOG_ARG_INT  ? (double)arg->value.i
+                                                                          : (double)arg->value.u);
+            break;
+        case 's':
+            out_spec[prefix] = 's';
+            out_spec[prefix + 1] = '\0';
+            n = snprintf(dst, room, out_spec, arg->type == LOG_ARG_STRING ? record->text + arg->value.u : "(?)");
+            break;
+        case 'p':
+            out_spec[prefix] = 'p';
+            out_spec[prefix + 1] = '\0';
+            n = snprintf(dst, room, out_spec, arg->type == LOG_ARG_POINTER ? arg->value.p : (const void *)(uintptr_t)arg->value.u);
+            break;
+        default:
+            next--; // %n and unknown conversions take no argument here
+            break;
+        }
+        if (n > 0)
+            len += (size_t)n < room ? (size_t)n : room - 1;
+    }
+
+    // One line per record, the message's own trailing newline included
+    while (len > 0 && line[len - 1] == '\n')
+        len--;
+    line[len++] = '\n';
+    line[len] = '\0';
+    return len;
+}
+
+/* Caller holds drain_lock */
+static void out_append(const char *data, size_t len)
+{
+    if (out_len + len > sizeof(out_buffer))
+    {
+        fwrite(out_buffer, 1, out_len, log_out);
+        out_len = 0;
+    }
+    memcpy(out_buffer + out_len, data, len);
+    out_len += len;
+}
+
+static void *drain_main(void *arg)
+{
+    (void)arg;
+    struct timespec pause = {0, LOG_DRAIN_MS * 1000000L};
+    for (;;)
+    {
+        if (logger_flush() == 0)
+            nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+static void flush_at_exit(void)
+{
+    logger_flush();
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int logger_init(FILE *out, int level)
+{
+    log_out = out ? out : stdout;
+    logger_set_level(level);
+    if (pthread_key_create(&thread_key, ring_park) != 0)
+        return -1;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, drain_main, NULL) != 0)
+        return -1; // records keep being written on the spot
+    pthread_detach(thread);
+    atexit(flush_at_exit);
+    __atomic_store_n(&logger_running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void logger_set_level(int level)
+{
+    if (level < LOG_LEVEL_DEBUG)
+        level = LOG_LEVEL_DEBUG;
+    if (level > LOG_LEVEL_ERROR)
+        level = LOG_LEVEL_ERROR;
+    logger_level = level;
+}
+
+int logger_parse_level(const char *name)
+{
+    static const char *const names[] = {"debug", "info", "warn", "error"};
+    for (int i = 0; i < 4; i++)
+        if (strcasecmp(name, names[i]) == 0)
+            return i;
+    return -1;
+}
+
+void logger_write(int level, const char *format, const LogArg *args, size_t count)
+{
+    LogRing *ring = __atomic_load_n(&logger_running, __ATOMIC_ACQUIRE) ? ring_get() : NULL;
+    if (!ring)
+    {
+        LogRecord record;
+        char line[LOG_LINE_MAX];
+        record_fill(&record, level, format, args, count);
+        size_t len = record_format(&record, line, sizeof(line));
+        fwrite(line, 1, len, log_out ? log_out : stdout);
+        return;
+    }
+
+    uint64_t head = ring->head; // we are the only writer
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_RECORDS)
+    {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    record_fill(&ring->records[head & (LOG_RING_RECORDS - 1)], level, format, args, count);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+size_t logger_flush(void)
+{
+    char line[LOG_LINE_MAX];
+    size_t written = 0;
+
+    pthread_mutex_lock(&drain_lock);
+    size_t live = __atomic_load_n(&ring_count, __ATOMIC_ACQUIRE);
+    for (size_t r = 0; r < live; r++)
+    {
+        LogRing *ring = rings[r];
+        uint64_t tail = ring->tail;
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        for (; tail != head; tail++)
+        {
+            out_append(line, record_format(&ring->records[tail & (LOG_RING_RECORDS - 1)], line, sizeof(line)));
+            written++;
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+        uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reported)
+        {
+            int n = snprintf(line, sizeof(line), "WARN  logger: %llu record(s) dropped, ring full\n",
+                             (unsigned long long)(dropped - ring->reported));
+            out_append(line, (size_t)n);
+            ring->reported = dropped;
+        }
+    }
+    if (out_len > 0)
+    {
+        fwrite(out_buffer, 1, out_len, log_out);
+        fflush(log_out);
+        out_len = 0;
+    }
+    pthread_mutex_unlock(&drain_lock);
+    return written;
+}
@@ -0,0 +1,44 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "histogram.h"
+
+/*
+@brief Counters and latency histograms cheap enough for the hot paths
+
+Every thread records into its own shard, created on its first record and handed to the next new
+thread when it exits. Recording never takes a lock or shares a cache line with another core:
+a counter is one add, a latency one bucket increment (histogram.h, nanoseconds).
+A snapshot sums the shards while they keep recording, it is exact for everything recorded before it.
+Beyond METRICS_THREADS_MAX live threads the rest share one locked shard.
+
+The program names its counters and histograms once with metrics_init(), ids index those tables.
+A NULL name leaves that id out of the snapshots. Before metrics_init() recording is a no-op.
+*/
+
+#define METRICS_THREADS_MAX 128
+
+/* The tables are kept, not copied. Returns 0, -1 when out of memory */
+int metrics_init(const char *const *counter_names, size_t counters,
+                 const char *const *histogram_names, size_t histograms);
+
+void metrics_add(size_t counter, uint64_t n);
+void metrics_record(size_t histogram, uint64_t ns);
+/* Monotonic clock for the latencies */
+uint64_t metrics_now_ns(void);
+
+/* Snapshots, malloc'd text the caller frees. NULL when out of memory. Histograms without a value are skipped.
+   JSON: {"uptime_s":N,"counters":{name:N,...},"latency_ns":{name:{"count","mean","p50","p90","p99","p999","max"},...}}
+   Text: one line per counter, then one table row per histogram in microseconds */
+char *metrics_json(void);
+char *metrics_text(void);
+
+/* Writes a snapshot to path through a temporary file and a rename, readers never see half of one.
+   JSON when path ends in ".json", text otherwise. Returns 0, -1 on error */
+int metrics_dump(const char *path);
+/* Starts a thread calling metrics_dump(path) every interval seconds */
+int metrics_start_dump(const char *path, int interval);
+
+#endif // METRICS_H
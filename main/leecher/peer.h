@@ -22,6 +22,7 @@
 #include "database.h" // FileEntry
 #include "leech.h"    // leeching()
 #include "peer.h"     // setup_seeder_socket(), handle_peer_connection()
+#include "shard_map.h" // ShardMap, shard_for_file()
 
 // Constants
 #define STORAGE_DIR "./storage_downloads/"
@@ -30,6 +31,13 @@
 #define TRACKER_PORT 5555
 #define PEER_1_IP "127.0.0.1"
 #define PEER_1_PORT "6000"
+#define SEEDERS_WANTED 256 // how many seeders we ask the tracker for before leeching
+#define MAX_ANNOUNCED_FILES 256 // files we keep re-announcing to the tracker
+#define CATALOG_CACHE_FILE STORAGE_DIR "catalog.cache" // local copy of the tracker catalog
+#define TRACKER_SHARDS_FILE "trackers.conf" // optional, the trackers that split the fileIDs between them
+#define CATALOG_PAGE_WANTED 512 // catalog entries per MSG_ACK_CATALOG_PAGE
+#define SEARCH_QUERY_MAX 128 // same as FileMetadata.filename
+#define SEARCH_RESULTS_WANTED 16
 
 // Enums
 typedef enum
@@ -47,7 +55,24 @@ typedef enum
     MSG_ACK_SEEDER_BY_FILEID,
     MSG_RESPOND_ERROR,
     MSG_ACK_FILEHASH_BLOCKED,
-    MSG_ACK_IP_BLOCKED
+    MSG_ACK_IP_BLOCKED,
+    MSG_ACK_SEEDER_BY_FILEID_COMPACT,
+    MSG_ACK_UNPARTICIPATE_SEED,
+    MSG_ACK_DELETE_SEEDER,
+    MSG_ACK_CATALOG_PAGE,
+    MSG_REQUEST_SEARCH,
+    MSG_ACK_SEARCH,
+    MSG_REQUEST_PARTICIPATE_BATCH,
+    MSG_ACK_PARTICIPATE_BATCH,
+    MSG_REQUEST_SEEDER_BATCH,
+    MSG_ACK_SEEDER_BATCH,
+    MSG_REQUEST_SCRAPE,
+    MSG_ACK_SCRAPE,
+    MSG_REQUEST_ANNOUNCE,
+    MSG_ACK_ANNOUNCE,
+    MSG_ACK_WRONG_SHARD,
+    MSG_REQUEST_STATS,
+    MSG_ACK_STATS
 } TrackerMessageType;
 
 
@@ -94,6 +119,124 @@ typedef struct {
     ssize_t fileID;
 } PeerWithFileID;
 
+/*
+* Several trackers can split the fileIDs between them (tracker -s). TRACKER_SHARDS_FILE lists them, one
+* ip:port per line, in the same format and ideally with the same content as the trackers' shard file.
+* Requests about a fileID go to the tracker shard_for_file() names, a new file to the one its hash names.
+* Registration, catalog listings and searches go to every tracker.
+* A tracker that does not own the fileID answers MSG_ACK_WRONG_SHARD with a PeerWithFileID: the owner's address.
+*/
+
+/*
+* MSG_REQUEST_SEEDER_BY_FILEID body: ask for up to maxPeers seeders of fileID.
+* The MSG_ACK_SEEDER_BY_FILEID reply is variable length: ssize_t count, then count PeerInfo.
+* With SEEDER_REQUEST_COMPACT the tracker answers MSG_ACK_SEEDER_BY_FILEID_COMPACT instead:
+* CompactPeerListHeader, count_v4 * (4 byte IPv4 + 2 byte port), count_v6 * (16 byte IPv6 + 2 byte port),
+* all in network byte order.
+*/
+#define SEEDER_REQUEST_COMPACT 0x1
+#define PEER_COMPACT_V4_SIZE 6
+#define PEER_COMPACT_V6_SIZE 18
+
+typedef struct {
+    ssize_t fileID;
+    ssize_t maxPeers;
+    ssize_t flags;
+} SeederListRequest;
+
+/*
+* MSG_REQUEST_ALL_AVAILABLE_SEED body: the catalog entries added after version cursor, at most maxEntries.
+* The MSG_ACK_CATALOG_PAGE reply is CatalogPageHeader, then count FileEntry.
+* We keep the catalog cached in CATALOG_CACHE_FILE and only pull what is new (sync_catalog()).
+*/
+typedef struct {
+    ssize_t cursor;
+    ssize_t maxEntries;
+} CatalogPageRequest;
+
+typedef struct {
+    ssize_t count;
+    ssize_t nextCursor;
+    ssize_t catalogVersion;
+} CatalogPageHeader;
+
+/*
+* MSG_REQUEST_SEARCH body: files whose name contains query (case insensitive, 1-2 characters match prefixes).
+* The MSG_ACK_SEARCH reply is ssize_t count, then count fileIDs, best match first.
+*/
+typedef struct {
+    char query[SEARCH_QUERY_MAX];
+    ssize_t maxResults;
+} SearchRequest;
+
+typedef struct {
+    uint32_t count_v4;
+    uint32_t count_v6;
+} CompactPeerListHeader;
+
+/*
+* MSG_ACK_PARTICIPATE_SEED_BY_FILEID body. We must participate again every announceInterval seconds,
+* the tracker drops seeders that stop announcing. announce_main() does this in the background.
+*/
+typedef struct {
+    ssize_t announceInterval;
+} ParticipateAck;
+
+/*
+* MSG_REQUEST_PARTICIPATE_BATCH body: BatchParticipateRequest, then count ssize_t fileIDs (at most BATCH_FILES_MAX).
+* The MSG_ACK_PARTICIPATE_BATCH reply is BatchParticipateAck, then one int32_t status per fileID (0 = OK).
+* The tracker also takes MSG_REQUEST_SEEDER_BATCH and MSG_REQUEST_SCRAPE, see tracker.h.
+*/
+#define BATCH_FILES_MAX 1024
+
+typedef struct {
+    PeerInfo seeder;
+    ssize_t count;
+} BatchParticipateRequest;
+
+typedef struct {
+    ssize_t count;
+    ssize_t announceInterval;
+} BatchParticipateAck;
+
+/*
+* MSG_REQUEST_ANNOUNCE body: where we stand in a file's swarm. left > 0 while leeching,
+* ANNOUNCE_EVENT_COMPLETED once the download finished. The reply MSG_ACK_ANNOUNCE is AnnounceAck.
+* The tracker counts seeders, leechers and completions per file from these.
+*/
+typedef enum {
+    ANNOUNCE_EVENT_NONE = 0,
+    ANNOUNCE_EVENT_COMPLETED,
+    ANNOUNCE_EVENT_STARTED,
+    ANNOUNCE_EVENT_STOPPED
+} AnnounceEvent;
+
+typedef struct {
+    PeerInfo peer;
+    ssize_t fileID;
+    ssize_t event; // AnnounceEvent
+    ssize_t uploaded;
+    ssize_t downloaded;
+    ssize_t left;
+} AnnounceRequest;
+
+typedef struct {
+    ssize_t announceInterval;
+    ssize_t seeders;
+    ssize_t leechers;
+} AnnounceAck;
+
+/*
+* UDP announce protocol of the tracker (tracker/udp_tracker.h), same port as TCP, big endian fields.
+* announce_main() uses it for re-announces and falls back to TCP when the tracker does not answer.
+*/
+#define UDP_PROTOCOL_ID 0x41727101980ULL
+#define UDP_ACTION_CONNECT 0
+#define UDP_ACTION_ANNOUNCE 1
+#define UDP_ACTION_ERROR 3
+#define UDP_TIMEOUT_MS 1000
+#define UDP_RETRIES 2
+
 /*
 * @union TrackerMessageBody
 * Perfectly appropriate to use a union here. The message body can only be one type at a time.
@@ -101,10 +244,12 @@ typedef struct {
 */
 typedef union {
     PeerInfo singleSeeder;
-    PeerInfo seederList[64];
     FileMetadata fileMetadata;
     ssize_t fileID;
     PeerWithFileID peerWithFileID;
+    SeederListRequest seederRequest;
+    CatalogPageRequest catalogPage;
+    SearchRequest search;
     char raw[512];
     RequestMetadataBody requestMetaData;
 } TrackerMessageBody;
@@ -120,12 +265,17 @@ void disconnect_from_tracker(int tracker_socket);
 void request_metadata_by_filename(int tracker_socket, const char *metaFilename, FileMetadata *fileMetaData);
 void request_participate_seed_by_fileID(int tracker_socket, const char *myIP, const char *myPort, ssize_t fileID);
 void request_create_seeder(int tracker_socket, const char *myIP, const char *myPort);
+void request_unparticipate_seed_by_fileID(int tracker_socket, const char *myIP, const char *myPort, ssize_t fileID);
+void request_delete_seeder(int tracker_socket, const char *myIP, const char *myPort);
 void request_create_new_seed(int tracker_socket, const char *binary_file_path);
-PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t *num_seeders_out);
+void request_announce(int tracker_socket, const char *myIP, const char *myPort, ssize_t fileID, AnnounceEvent event,
+                      ssize_t downloaded, ssize_t left);
+PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t maxPeers, size_t *num_seeders_out);
 char *get_metadata_via_cli(int tracker_socket, ssize_t *selectedFileID);
 char *generate_binary_filepath(char *metaFilePath);
 void tracker_cli_loop(int tracker_socket, char *ip_address, char *port);
 void get_all_available_files(int tracker_socket);
+void search_files(int tracker_socket, const char *query);
 
 // Main entry point
 int main();
@@ -0,0 +1,37 @@
+#ifndef PEER_METRICS_H
+#define PEER_METRICS_H
+
+#include "metrics.h"
+
+/*
+@brief What a peer counts and times (metrics.h)
+
+The snapshot is rewritten to PEER_METRICS_FILE every PEER_METRICS_INTERVAL seconds, printed by the
+"Show metrics" CLI option and sent to anyone asking the seeding port with MSG_REQUEST_PEER_STATS.
+*/
+typedef enum
+{
+    PEER_METRIC_LEECHERS_ACCEPTED = 0,
+    PEER_METRIC_CHUNKS_SERVED,
+    PEER_METRIC_BYTES_SERVED,
+    PEER_METRIC_BITFIELDS_SERVED,
+    PEER_METRIC_CHUNKS_RECEIVED,
+    PEER_METRIC_BYTES_RECEIVED,
+    PEER_METRIC_CHUNK_FAILURES, // request_chunk() or the write of the received chunk failed
+    PEER_COUNTER_COUNT
+} PeerCounter;
+
+typedef enum
+{
+    PEER_TIMER_CHUNK_SERVE = 0, // chunk request read to chunk sent
+    PEER_TIMER_CHUNK_RECEIVE,   // chunk request sent to chunk read
+    PEER_TIMER_DISK_READ,       // seek + read of one served chunk
+    PEER_TIMER_DISK_WRITE,      // write of one received chunk and of its bitfield bit
+    PEER_TIMER_BITFIELD_SERVE,
+    PEER_TIMER_COUNT
+} PeerTimer;
+
+#define PEER_METRICS_FILE "peer.metrics.json"
+#define PEER_METRICS_INTERVAL 10 // seconds
+
+#endif // PEER_METRICS_H
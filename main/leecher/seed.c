@@ -44,10 +44,11 @@ int handle_peer_connection(int listen_fd)
         int peer_fd = accept(listen_fd, (struct sockaddr *)&peer_addr, &addr_len);
         if (peer_fd < 0)
         {
-            perror("ERROR accepting peer");
+            LOG_ERROR("accepting peer: %s", strerror(errno));
             continue;
         }
-        printf("New peer connected.\n");
+        LOG_DEBUG("New peer connected on socket %d", peer_fd);
+        metrics_add(PEER_METRIC_LEECHERS_ACCEPTED, 1);
 
         return_status = handle_peer_request(peer_fd);
     }
@@ -140,7 +141,7 @@ char *find_binary_file_path(ssize_t fileID)
                 break; // will return NULL
             }
             snprintf(binary_path, fullpath_len + 1, "%s%s", STORAGE_DIR, bin_fname);
-            printf("binary_path: %s\n",binary_path);
+            LOG_DEBUG("binary_path: %s", binary_path);
             free(bin_fname);
 
             // Check if that file exists and is a regular file
@@ -298,17 +299,19 @@ int send_chunk(int sockfd, FILE *data_file_fp, ssize_t fileID, ssize_t chunkInde
     TransferChunk *chunk = malloc(sizeof(TransferChunk));
     if (!chunk)
     {
-        perror("ERROR allocating TransferChunk");
+        LOG_ERROR("allocating TransferChunk: %s", strerror(errno));
         return 1;
     }
     memset(chunk, 0, sizeof(TransferChunk));
 
     /* Move the file pointer to the correct chunk index. */
+    uint64_t started = metrics_now_ns();
     fseek(data_file_fp, chunkIndex * CHUNK_DATA_SIZE, SEEK_SET);
 
     chunk->fileID = fileID;
     chunk->chunkIndex = chunkIndex;
     chunk->totalByte = fread(chunk->chunkData, 1, CHUNK_DATA_SIZE, data_file_fp);
+    metrics_record(PEER_TIMER_DISK_READ, metrics_now_ns() - started);
 
     /*
         ssize_t fileID;
@@ -325,11 +328,13 @@ int send_chunk(int sockfd, FILE *data_file_fp, ssize_t fileID, ssize_t chunkInde
     ssize_t sent_bytes = write(sockfd, chunk, sizeof(TransferChunk));
     if (sent_bytes < 0)
     {
-        perror("ERROR writing TransferChunk to socket");
+        LOG_ERROR("writing TransferChunk to socket: %s", strerror(errno));
         free(chunk);
         return 1;
     }
 
+    metrics_add(PEER_METRIC_CHUNKS_SERVED, 1);
+    metrics_add(PEER_METRIC_BYTES_SERVED, (uint64_t)chunk->totalByte);
     free(chunk);
     return 0;
 }
@@ -340,16 +345,16 @@ int send_bitfield(int sockfd, uint8_t *bitfield, size_t size)
     ssize_t sent_bytes = write(sockfd, bitfield, size);
     if (sent_bytes < 0)
     {
-        perror("ERROR sending bitfield data");
+        LOG_ERROR("sending bitfield data: %s", strerror(errno));
         return 1;
     }
-    printf("📤 Sent %zd bytes of bitfield data\n", sent_bytes);
+    LOG_DEBUG("Sent %zd bytes of bitfield data", sent_bytes);
     return 0;
 }
 
 int handle_peer_request(int client_socketfd)
 {
-    printf("\n🔄 Starting to handle peer requests on socket %d\n", client_socketfd);
+    LOG_DEBUG("Starting to handle peer requests on socket %d", client_socketfd);
 
     /* This is cached so that we don't have to keep opening and closing the SAME file when we are seeding*/
     FILE *current_binary_file_fp = NULL;
@@ -357,8 +362,6 @@ int handle_peer_request(int client_socketfd)
 
     while (1)
     {
-        printf("\n📥 Waiting for next peer message...\n");
-
         // 1. First read just the header
         PeerMessageHeader header;
         memset(&header, 0, sizeof(header));
@@ -366,51 +369,53 @@ int handle_peer_request(int client_socketfd)
         ssize_t nbytes = read(client_socketfd, &header, sizeof(PeerMessageHeader));
         if (nbytes <= 0)
         {
-            perror("ERROR reading message header from peer");
+            if (nbytes < 0)
+                LOG_ERROR("reading message header from peer: %s", strerror(errno));
+            else
+                LOG_DEBUG("Peer on socket %d closed the connection", client_socketfd);
             return 1;
         }
-        printf("✅ Received message header - Type: %d, Body size: %zu\n", header.type, header.bodySize);
+        LOG_DEBUG("Received message header - Type: %d, Body size: %zu", header.type, header.bodySize);
 
         // 2. Now read the body based on bodySize from header
-        char *body_buffer = malloc(header.bodySize);
+        char *body_buffer = malloc(header.bodySize > 0 ? header.bodySize : 1);
         if (!body_buffer)
         {
-            perror("ERROR allocating body buffer");
+            LOG_ERROR("allocating body buffer: %s", strerror(errno));
             break;
         }
 
-        nbytes = read(client_socketfd, body_buffer, header.bodySize);
-        if (nbytes <= 0)
+        // Stats requests have no body
+        nbytes = header.bodySize > 0 ? read(client_socketfd, body_buffer, header.bodySize) : 0;
+        if (nbytes < 0 || (nbytes == 0 && header.bodySize > 0))
         {
             free(body_buffer);
-            perror("ERROR reading message body from peer");
+            LOG_ERROR("reading message body from peer: %s", nbytes < 0 ? strerror(errno) : "connection closed");
             break;
         }
-        printf("✅ Received message body of %zd bytes\n", nbytes);
+        uint64_t started = metrics_now_ns();
 
         // 3. Handle different message types
         switch (header.type)
         {
         case MSG_REQUEST_BITFIELD:
         {
-            printf("\n📋 Processing BITFIELD REQUEST\n");
             BitfieldRequest *req = (BitfieldRequest *)body_buffer;
             ssize_t fileID = req->fileID;
-            printf("🔍 Looking for bitfield file with FileID: %zd\n", fileID);
 
             char *bitfield_path = find_bitfield_file_path(fileID);
             if (!bitfield_path)
             {
-                printf("❌ Could not find bitfield file for FileID %zd\n", fileID);
+                LOG_WARN("Could not find bitfield file for FileID %zd", fileID);
                 break;
             }
-            printf("✅ Found bitfield file: %s\n", bitfield_path);
+            LOG_DEBUG("Bitfield request for FileID %zd: %s", fileID, bitfield_path);
 
             // Read bitfield file into buffer and determine size
             FILE *bitfield_fp = fopen(bitfield_path, "rb");
             if (!bitfield_fp)
             {
-                perror("ERROR opening bitfield file");
+                LOG_ERROR("opening bitfield file %s: %s", bitfield_path, strerror(errno));
                 free(bitfield_path);
                 break;
             }
@@ -424,7 +429,7 @@ int handle_peer_request(int client_socketfd)
             uint8_t *bitfield_buffer = malloc(bitfield_size);
             if (!bitfield_buffer)
             {
-                perror("ERROR allocating bitfield buffer");
+                LOG_ERROR("allocating bitfield buffer: %s", strerror(errno));
                 fclose(bitfield_fp);
                 free(bitfield_path);
                 break;
@@ -433,22 +438,9 @@ int handle_peer_request(int client_socketfd)
             size_t bytes_read = fread(bitfield_buffer, 1, bitfield_size, bitfield_fp);
             fclose(bitfield_fp);
 
-            printf("📊 Bitfield contents:\n");
-            for (size_t i = 0; i < bitfield_size; i++)
-            {
-                for (int j = 7; j >= 0; j--)
-                {
-                    printf("%d", (bitfield_buffer[i] >> j) & 1);
-                }
-                printf(" ");
-                if ((i + 1) % 8 == 0)
-                    printf("\n");
-            }
-
-            printf("\n");
             if (bytes_read != bitfield_size)
             {
-                perror("ERROR reading bitfield file");
+                LOG_ERROR("reading bitfield file %s: read %zu of %zu bytes", bitfield_path, bytes_read, bitfield_size);
                 free(bitfield_buffer);
                 free(bitfield_path);
                 break;
@@ -460,33 +452,28 @@ int handle_peer_request(int client_socketfd)
             resp_header.type = MSG_ACK_REQUEST_BITFIELD;
             resp_header.bodySize = bitfield_size;
 
-            printf("📤 Sending bitfield response header (type=%d, size=%zu)\n",
-                   resp_header.type, resp_header.bodySize);
-
             // Send header and then bitfield
             if (write(client_socketfd, &resp_header, sizeof(resp_header)) < 0)
             {
-                perror("ERROR sending bitfield response header");
+                LOG_ERROR("sending bitfield response header: %s", strerror(errno));
                 free(bitfield_buffer);
                 free(bitfield_path);
                 break;
             }
 
-            printf("🔄 Preparing to send bitfield data of size %zu bytes...\n", bitfield_size);
             send_bitfield(client_socketfd, bitfield_buffer, bitfield_size);
 
             free(bitfield_buffer);
             free(bitfield_path);
-            printf("✅ Bitfield request handled successfully\n");
+            metrics_add(PEER_METRIC_BITFIELDS_SERVED, 1);
+            metrics_record(PEER_TIMER_BITFIELD_SERVE, metrics_now_ns() - started);
         }
         break;
 
         case MSG_REQUEST_CHUNK:
         {
-            printf("\n📦 Processing CHUNK REQUEST\n");
             ChunkRequest *chunk_req = (ChunkRequest *)body_buffer;
-            printf("🔍 Request for chunk %zd of file %zd\n",
-                   chunk_req->chunkIndex, chunk_req->fileID);
+            LOG_DEBUG("Request for chunk %zd of file %zd", chunk_req->chunkIndex, chunk_req->fileID);
 
             if (chunk_req->fileID != current_fileID)
             {
@@ -512,27 +499,38 @@ int handle_peer_request(int client_socketfd)
             resp_header.type = MSG_ACK_REQUEST_CHUNK;
             resp_header.bodySize = sizeof(TransferChunk);
 
-            printf("📤 Sending chunk response header (type=%d, size=%zu)\n",
-                   resp_header.type, resp_header.bodySize);
-
             // Send header and then chunk
             if (write(client_socketfd, &resp_header, sizeof(resp_header)) < 0)
             {
-                perror("ERROR sending chunk response header");
+                LOG_ERROR("sending chunk response header: %s", strerror(errno));
                 break;
             }
             send_chunk(client_socketfd, current_binary_file_fp, current_fileID, chunk_req->chunkIndex);
-            printf("✅ Chunk request handled successfully\n");
+            metrics_record(PEER_TIMER_CHUNK_SERVE, metrics_now_ns() - started);
+        }
+        break;
+
+        case MSG_REQUEST_PEER_STATS:
+        {
+            char *json = metrics_json();
+            PeerMessageHeader resp_header;
+            memset(&resp_header, 0, sizeof(resp_header));
+            resp_header.type = MSG_ACK_PEER_STATS;
+            resp_header.bodySize = json ? strlen(json) : 0;
+            if (write(client_socketfd, &resp_header, sizeof(resp_header)) < 0 ||
+                (json && write(client_socketfd, json, strlen(json)) < 0))
+                LOG_ERROR("sending peer stats: %s", strerror(errno));
+            free(json);
         }
         break;
 
         default:
-            fprintf(stderr, "❌ Unknown message type: %d\n", header.type);
+            LOG_WARN("Unknown message type: %d", header.type);
             break;
         }
 
         free(body_buffer);
     }
 
-    printf("👋 Closing peer connection on socket %d\n", client_socketfd);
+    LOG_DEBUG("Closing peer connection on socket %d", client_socketfd);
 }
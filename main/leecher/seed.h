@@ -14,9 +14,12 @@
 #include <unistd.h>
 
 #include <dirent.h>
+#include <errno.h>
 #include "peerCommunication.h"
 #include "meta.h"
 #include "bitfield.h"
+#include "peer_metrics.h"
+#include "logger.h"
 
 #define STORAGE_DIR "./storage_downloads/"
 
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "shard_map.h"
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint64_t mix64(uint64_t x)
+{
+    // splitmix64 finalizer, fileIDs are sequential so every bit needs spreading
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hash_text(const char *s)
+{
+    uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+    while (*s)
+        h = (h ^ (uint8_t)*s++) * 0x100000001b3ull;
+    return mix64(h);
+}
+
+static int line_compare(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int point_compare(const void *a, const void *b)
+{
+    const ShardPoint *x = a, *y = b;
+    if (x->hash != y->hash)
+        return x->hash < y->hash ? -1 : 1;
+    return x->shard < y->shard ? -1 : x->shard > y->shard; // ties broken the same way everywhere
+}
+
+int shard_parse_address(const char *text, char *ip, size_t ip_size, int *port)
+{
+    const char *colon;
+    const char *host = text;
+    size_t host_len;
+    if (text[0] == '[')
+    {
+        const char *close = strchr(text, ']');
+        if (!close || close[1] != ':')
+            return -1;
+        host = text + 1;
+        host_len = (size_t)(close - host);
+        colon = close + 1;
+    }
+    else
+    {
+        colon = strrchr(text, ':');
+        if (!colon)
+            return -1;
+        host_len = (size_t)(colon - text);
+    }
+    if (host_len == 0 || host_len >= ip_size)
+        return -1;
+
+    char *end;
+    long value = strtol(colon + 1, &end, 10);
+    if (end == colon + 1 || *end != '\0' || value <= 0 || value > 65535)
+        return -1;
+
+    memcpy(ip, host, host_len);
+    ip[host_len] = '\0';
+    *port = (int)value;
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int shard_map_load(ShardMap *map, const char *path)
+{
+    memset(map, 0, sizeof(*map));
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+
+    char line[256];
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        lineNo++;
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        char *start = line;
+        while (isspace((unsigned char)*start))
+            start++;
+        char *end = start + strlen(start);
+        while (end > start && isspace((unsigned char)end[-1]))
+            *--end = '\0';
+        if (*start == '\0')
+            continue;
+
+        TrackerShard shard;
+        if (map->count == SHARD_MAX || shard_parse_address(start, shard.ip, sizeof(shard.ip), &shard.port) < 0)
+        {
+            fprintf(stderr, "%s:%d: expected ip:port (at most %d trackers)\n", path, lineNo, SHARD_MAX);
+            fclose(fp);
+            map->count = 0;
+            return -1;
+        }
+        if (shard_find(map, shard.ip, shard.port) < 0)
+            map->shards[map->count++] = shard;
+    }
+    fclose(fp);
+
+    if (map->count == 0)
+        return 0;
+    map->ring = malloc(map->count * SHARD_VNODES * sizeof(ShardPoint));
+    if (!map->ring)
+    {
+        map->count = 0;
+        return -1;
+    }
+    for (size_t i = 0; i < map->count; i++)
+    {
+        for (int v = 0; v < SHARD_VNODES; v++)
+        {
+            char name[SHARD_ADDR_MAX + 32];
+            snprintf(name, sizeof(name), "%s:%d#%d", map->shards[i].ip, map->shards[i].port, v);
+            map->ring[map->points].hash = hash_text(name);
+            map->ring[map->points].shard = (uint32_t)i;
+            map->points++;
+        }
+    }
+    qsort(map->ring, map->points, sizeof(ShardPoint), point_compare);
+    return (int)map->count;
+}
+
+void shard_map_free(ShardMap *map)
+{
+    free(map->ring);
+    memset(map, 0, sizeof(*map));
+}
+
+size_t shard_for_key(const ShardMap *map, uint64_t key)
+{
+    if (map->points == 0)
+        return 0;
+
+    // First point at or after the key, wrapping around to the first point of the ring
+    uint64_t h = mix64(key);
+    size_t lo = 0, hi = map->points;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (map->ring[mid].hash < h)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return map->ring[lo == map->points ? 0 : lo].shard;
+}
+
+size_t shard_for_file(const ShardMap *map, ssize_t fileID)
+{
+    return shard_for_key(map, (uint64_t)fileID);
+}
+
+int shard_map_describe(const ShardMap *map, char *out, size_t size)
+{
+    char lines[SHARD_MAX][SHARD_ADDR_MAX + 16];
+    const char *sorted[SHARD_MAX];
+    for (size_t i = 0; i < map->count; i++)
+    {
+        snprintf(lines[i], sizeof(lines[i]), "%s:%d\n", map->shards[i].ip, map->shards[i].port);
+        sorted[i] = lines[i];
+    }
+    qsort(sorted, map->count, sizeof(sorted[0]), line_compare);
+
+    size_t len = 0;
+    if (size == 0)
+        return -1;
+    out[0] = '\0';
+    for (size_t i = 0; i < map->count; i++)
+    {
+        size_t n = strlen(sorted[i]);
+        if (len + n >= size)
+            return -1;
+        memcpy(out + len, sorted[i], n + 1);
+        len += n;
+    }
+    return (int)len;
+}
+
+int shard_find(const ShardMap *map, const char *ip, int port)
+{
+    for (size_t i = 0; i < map->count; i++)
+        if (map->shards[i].port == port && strcmp(map->shards[i].ip, ip) == 0)
+            return (int)i;
+    return -1;
+}
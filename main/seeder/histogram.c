@@ -0,0 +1,101 @@
+#include <string.h>
+#include "histogram.h"
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static size_t bucket_of(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_COUNT)
+        return (size_t)value;
+
+    // value = 1mmmmmm... : the position of the top bit picks the row, the next SUB_BITS bits the column
+    unsigned top = 63u - (unsigned)__builtin_clzll(value);
+    unsigned shift = top - HISTOGRAM_SUB_BITS;
+    size_t column = (size_t)(value >> shift) - HISTOGRAM_SUB_COUNT;
+    return (size_t)(shift + 1) * HISTOGRAM_SUB_COUNT + column;
+}
+
+/* Largest value that falls in bucket, so a quantile never reads lower than the truth */
+static uint64_t bucket_upper(size_t bucket)
+{
+    if (bucket < HISTOGRAM_SUB_COUNT)
+        return bucket;
+
+    unsigned shift = (unsigned)(bucket / HISTOGRAM_SUB_COUNT) - 1;
+    uint64_t column = bucket % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT;
+    return ((column + 1) << shift) - 1;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+void histogram_init(Histogram *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+/* Single writer: the stores are relaxed atomics so histogram_merge() may read a live histogram */
+void histogram_record(Histogram *h, uint64_t value)
+{
+    size_t bucket = bucket_of(value);
+    __atomic_store_n(&h->counts[bucket], h->counts[bucket] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->total, h->total + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sum, h->sum + value, __ATOMIC_RELAXED);
+    if (value < h->min)
+        __atomic_store_n(&h->min, value, __ATOMIC_RELAXED);
+    if (value > h->max)
+        __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+}
+
+void histogram_merge(Histogram *into, const Histogram *from)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        uint64_t count = __atomic_load_n(&from->counts[i], __ATOMIC_RELAXED);
+        into->counts[i] += count;
+        total += count;
+    }
+    // The buckets are the truth while from is being recorded into, total may already be ahead of them
+    into->total += total;
+    into->sum += __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+    uint64_t min = __atomic_load_n(&from->min, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+    if (min < into->min)
+        into->min = min;
+    if (max > into->max)
+        into->max = max;
+}
+
+uint64_t histogram_quantile(const Histogram *h, double q)
+{
+    if (h->total == 0)
+        return 0;
+    if (q <= 0)
+        return h->min;
+
+    uint64_t rank = (uint64_t)(q * (double)h->total + 0.5);
+    if (rank == 0)
+        rank = 1;
+    if (rank >= h->total)
+        return h->max;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = bucket_upper(i);
+            return upper > h->max ? h->max : upper;
+        }
+    }
+    return h->max;
+}
+
+double histogram_mean(const Histogram *h)
+{
+    return h->total ? (double)h->sum / (double)h->total : 0.0;
+}
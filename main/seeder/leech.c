@@ -1,9 +1,12 @@
 #include <stdio.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include "peerCommunication.h"
 #include "leech.h"
 #include "meta.h"
+#include "peer_metrics.h"
+#include "logger.h"
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #define STORAGE_DIR "./storage_downloads/"
@@ -34,7 +37,7 @@ uint8_t *request_bitfield(int sockfd, ssize_t fileID)
      */
     // 1) Send the header for "request bitfield"
     PeerMessageHeader header;
-    printf("📋 Requesting bitfield for fileID: %zd\n", fileID);
+    LOG_DEBUG("Requesting bitfield for fileID: %zd", fileID);
     memset(&header, 0, sizeof(header));
     header.type = MSG_REQUEST_BITFIELD;
     header.bodySize = sizeof(BitfieldRequest);
@@ -42,10 +45,9 @@ uint8_t *request_bitfield(int sockfd, ssize_t fileID)
     // Write the complete header in one go
     if (write(sockfd, &header, sizeof(PeerMessageHeader)) != sizeof(PeerMessageHeader))
     {
-        perror("ERROR writing bitfield request header to server");
+        LOG_ERROR("writing bitfield request header to server: %s", strerror(errno));
         return NULL;
     }
-    printf("✅ Sent bitfield request header to server\n");
 
     // Create and send the body
     PeerMessageBody body;
@@ -55,7 +57,7 @@ uint8_t *request_bitfield(int sockfd, ssize_t fileID)
     // Write the BitfieldRequest portion of the body
     if (write(sockfd, &body.bitfieldRequest, sizeof(BitfieldRequest)) != sizeof(BitfieldRequest))
     {
-        perror("ERROR writing bitfield request body to server");
+        LOG_ERROR("writing bitfield request body to server: %s", strerror(errno));
         return NULL;
     }
 
@@ -65,13 +67,13 @@ uint8_t *request_bitfield(int sockfd, ssize_t fileID)
     ssize_t nbytes = read(sockfd, &responseHeader, sizeof(PeerMessageHeader));
     if (nbytes <= 0)
     {
-        perror("ERROR reading bitfield response header from server");
+        LOG_ERROR("reading bitfield response header from server: %s", strerror(errno));
         return NULL;
     }
 
     if (responseHeader.type != MSG_ACK_REQUEST_BITFIELD)
     {
-        fprintf(stderr, "Expected MSG_ACK_REQUEST_BITFIELD, got %d\n", responseHeader.type);
+        LOG_ERROR("Expected MSG_ACK_REQUEST_BITFIELD, got %d", responseHeader.type);
         return NULL;
     }
 
@@ -80,14 +82,14 @@ uint8_t *request_bitfield(int sockfd, ssize_t fileID)
     uint8_t *bitfield = malloc(responseHeader.bodySize); /* bodySize should indicate the total bytes representation of the bitfield. Not the number of bits. We just want the bitfield*/
     if (!bitfield)
     {
-        perror("ERROR allocating bitfield memory");
+        LOG_ERROR("allocating bitfield memory: %s", strerror(errno));
         return NULL;
     }
 
     nbytes = read(sockfd, bitfield, responseHeader.bodySize);
     if (nbytes <= 0)
     {
-        perror("ERROR reading bitfield response body from server");
+        LOG_ERROR("reading bitfield response body from server: %s", strerror(errno));
         free(bitfield);
         return NULL;
     }
@@ -97,6 +99,8 @@ uint8_t *request_bitfield(int sockfd, ssize_t fileID)
 
 int request_chunk(int sockfd, ssize_t fileID, ssize_t chunkIndex, TransferChunk *outChunk)
 {
+    uint64_t started = metrics_now_ns();
+
     // 1) Create and send the header.
     PeerMessageHeader header;
     memset(&header, 0, sizeof(header));
@@ -105,7 +109,7 @@ int request_chunk(int sockfd, ssize_t fileID, ssize_t chunkIndex, TransferChunk
 
     if (write(sockfd, &header, sizeof(header)) < 0)
     {
-        perror("ERROR writing chunk request header to server");
+        LOG_ERROR("writing chunk request header to server: %s", strerror(errno));
         return -1;
     }
 
@@ -117,7 +121,7 @@ int request_chunk(int sockfd, ssize_t fileID, ssize_t chunkIndex, TransferChunk
 
     if (write(sockfd, &body.chunkRequest, sizeof(ChunkRequest)) < 0)
     {
-        perror("ERROR writing chunk request body to server");
+        LOG_ERROR("writing chunk request body to server: %s", strerror(errno));
         return -1;
     }
 
@@ -128,13 +132,13 @@ int request_chunk(int sockfd, ssize_t fileID, ssize_t chunkIndex, TransferChunk
     ssize_t nbytes = read(sockfd, &responseHeader, sizeof(PeerMessageHeader));
     if (nbytes <= 0)
     {
-        perror("ERROR reading chunk response header from server");
+        LOG_ERROR("reading chunk response header from server: %s", strerror(errno));
         return -1;
     }
 
     if (responseHeader.type != MSG_ACK_REQUEST_CHUNK)
     {
-        fprintf(stderr, "Expected MSG_ACK_REQUEST_CHUNK, got %d\n", responseHeader.type);
+        LOG_ERROR("Expected MSG_ACK_REQUEST_CHUNK, got %d", responseHeader.type);
         return -1;
     }
     /* Write the body */
@@ -143,12 +147,15 @@ int request_chunk(int sockfd, ssize_t fileID, ssize_t chunkIndex, TransferChunk
     nbytes = read(sockfd, &responseBody, sizeof(PeerMessageBody));
     if (nbytes <= 0)
     {
-        perror("ERROR reading chunk response body from server");
+        LOG_ERROR("reading chunk response body from server: %s", strerror(errno));
         return -1;
     }
 
     // Copy the chunk data to output parameter
     memcpy(outChunk, &responseBody.transferChunk, sizeof(TransferChunk));
+    metrics_record(PEER_TIMER_CHUNK_RECEIVE, metrics_now_ns() - started);
+    metrics_add(PEER_METRIC_CHUNKS_RECEIVED, 1);
+    metrics_add(PEER_METRIC_BYTES_RECEIVED, (uint64_t)outChunk->totalByte);
 
     // (Optional) Validate the chunk hash or do any checks here.
 
@@ -157,12 +164,12 @@ int request_chunk(int sockfd, ssize_t fileID, ssize_t chunkIndex, TransferChunk
 
 static int connect_to_seeder(PeerInfo *seeder)
 {
-    printf("Connecting to Seeder at %s:%s...\n", seeder->ip_address, seeder->port);
+    LOG_DEBUG("Connecting to Seeder at %s:%s", seeder->ip_address, seeder->port);
 
     int sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0)
     {
-        perror("ERROR opening socket to Seeder");
+        LOG_ERROR("opening socket to Seeder: %s", strerror(errno));
         return -1;
     }
 
@@ -173,22 +180,19 @@ static int connect_to_seeder(PeerInfo *seeder)
 
     if (inet_pton(AF_INET, seeder->ip_address, &serv_addr.sin_addr) <= 0)
     {
-        perror("ERROR invalid tracker IP");
+        LOG_ERROR("invalid seeder IP %s", seeder->ip_address);
         close(sockfd);
         return -1;
     }
 
     if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
     {
-        perror("ERROR connecting to tracker");
-        printf("❌ Connection to Tracker failed. Is it running at %s:%s?\n",
-               seeder->ip_address, seeder->port);
+        LOG_ERROR("connecting to seeder %s:%s: %s", seeder->ip_address, seeder->port, strerror(errno));
         close(sockfd);
         return -1;
     }
 
-    printf("✅ Seeder successfully connected to Tracker at %s:%s\n",
-           seeder->ip_address, seeder->port);
+    LOG_DEBUG("Connected to Seeder at %s:%s", seeder->ip_address, seeder->port);
     return sockfd;
 }
 
@@ -197,14 +201,14 @@ int write_chunk_to_file(const char *binary_filepath, const TransferChunk *chunk)
     FILE *fp = fopen(binary_filepath, "r+b"); // Open for reading and writing
     if (!fp)
     {
-        perror("ERROR opening binary file for chunk writing");
+        LOG_ERROR("opening binary file for chunk writing: %s", strerror(errno));
         return -1;
     }
 
     // Seek to correct position based on chunk index
     if (fseek(fp, chunk->chunkIndex * CHUNK_DATA_SIZE, SEEK_SET) != 0)
     {
-        perror("ERROR seeking in binary file");
+        LOG_ERROR("seeking in binary file: %s", strerror(errno));
         fclose(fp);
         return -1;
     }
@@ -213,7 +217,7 @@ int write_chunk_to_file(const char *binary_filepath, const TransferChunk *chunk)
     ssize_t written = fwrite(chunk->chunkData, 1, chunk->totalByte, fp);
     if (written != chunk->totalByte)
     {
-        perror("ERROR writing chunk data");
+        LOG_ERROR("writing chunk data: %s", strerror(errno));
         fclose(fp);
         return -1;
     }
@@ -241,7 +245,7 @@ int update_bitfield(const char *bitfield_filepath, ssize_t chunkIndex)
     FILE *fp = fopen(bitfield_filepath, "r+b"); // Open for reading and writing
     if (!fp)
     {
-        perror("ERROR opening bitfield file");
+        LOG_ERROR("opening bitfield file: %s", strerror(errno));
         return -1;
     }
 
@@ -254,7 +258,7 @@ int update_bitfield(const char *bitfield_filepath, ssize_t chunkIndex)
     if (fseek(fp, byte_offset, SEEK_SET) != 0 ||
         fread(&current_byte, 1, 1, fp) != 1)
     {
-        perror("ERROR reading bitfield");
+        LOG_ERROR("reading bitfield: %s", strerror(errno));
         fclose(fp);
         return -1;
     }
@@ -266,7 +270,7 @@ int update_bitfield(const char *bitfield_filepath, ssize_t chunkIndex)
     if (fseek(fp, byte_offset, SEEK_SET) != 0 ||
         fwrite(&current_byte, 1, 1, fp) != 1)
     {
-        perror("ERROR writing bitfield");
+        LOG_ERROR("writing bitfield: %s", strerror(errno));
         fclose(fp);
         return -1;
     }
@@ -275,21 +279,25 @@ int update_bitfield(const char *bitfield_filepath, ssize_t chunkIndex)
     return 0;
 }
 
+/* Logs the first 32 bits at DEBUG, the bits are only rendered when DEBUG is on */
 void print_bitfield(const uint8_t *bitfield, size_t bitfield_size, const char *label)
 {
-    printf("\n%s (showing first 32 bits):\n", label);
-    printf("Bits: ");
-    // Print first 32 bits for visualization
+    if (!LOG_ENABLED(LOG_LEVEL_DEBUG) || !bitfield)
+        return;
+
+    char bits[4 * 10 + 1]; // 4 bytes = 32 bits, a space every 4 bits for readability
+    size_t len = 0;
     for (size_t i = 0; i < 4 && i < bitfield_size; i++)
-    { // 4 bytes = 32 bits
+    {
         for (int bit = 7; bit >= 0; bit--)
         {
-            printf("%d", (bitfield[i] >> bit) & 1);
+            bits[len++] = '0' + ((bitfield[i] >> bit) & 1);
             if (bit % 4 == 0)
-                printf(" "); // Add space every 4 bits for readability
+                bits[len++] = ' ';
         }
     }
-    printf("\n");
+    bits[len] = '\0';
+    LOG_DEBUG("%s (first 32 bits): %s", label, bits);
 }
 
 /**
@@ -311,22 +319,22 @@ void print_bitfield(const uint8_t *bitfield, size_t bitfield_size, const char *l
  */
 void leech_from_seeder(PeerInfo seeder, char *bitfield_filepath, char *binary_filepath, ssize_t totalChunk, ssize_t fileID)
 {
-    printf("\n🔄 Starting to leech from seeder %s:%s\n", seeder.ip_address, seeder.port);
+    LOG_INFO("Starting to leech from seeder %s:%s", seeder.ip_address, seeder.port);
 
     int seeder_fd = connect_to_seeder(&seeder);
     // Calculate proper bitfield size in bytes
     size_t bitfield_size = (totalChunk + 7) / 8;
     if (seeder_fd < 0)
     {
-        perror("ERROR connecting to seeder");
+        LOG_WARN("Skipping seeder %s:%s, not reachable", seeder.ip_address, seeder.port);
         return;
     }
 
-    printf("📖 Reading local bitfield from: %s\n", bitfield_filepath);
+    LOG_DEBUG("Reading local bitfield from: %s", bitfield_filepath);
     FILE *local_bitfield_fp = fopen(bitfield_filepath, "rb");
     if (!local_bitfield_fp)
     {
-        perror("ERROR opening bitfield file");
+        LOG_ERROR("opening bitfield file: %s", strerror(errno));
         close(seeder_fd);
         return;
     }
@@ -335,7 +343,7 @@ void leech_from_seeder(PeerInfo seeder, char *bitfield_filepath, char *binary_fi
     uint8_t *local_bitfield = malloc(bitfield_size);
     if (!local_bitfield)
     {
-        perror("ERROR allocating memory for local bitfield");
+        LOG_ERROR("allocating memory for local bitfield: %s", strerror(errno));
         fclose(local_bitfield_fp);
         close(seeder_fd);
         return;
@@ -344,18 +352,17 @@ void leech_from_seeder(PeerInfo seeder, char *bitfield_filepath, char *binary_fi
     memset(local_bitfield, 0, bitfield_size);
     if (fread(local_bitfield, 1, bitfield_size, local_bitfield_fp) <= 0)
     {
-        perror("ERROR reading local bitfield");
+        LOG_ERROR("reading local bitfield: %s", strerror(errno));
         fclose(local_bitfield_fp);
         free(local_bitfield);
         close(seeder_fd);
         return;
     }
     fclose(local_bitfield_fp);
-    print_bitfield(local_bitfield, bitfield_size, "💾 Local bitfield");
+    print_bitfield(local_bitfield, bitfield_size, "Local bitfield");
 
-    printf("🔍 Analyzing which chunks to request...\n");
     uint8_t *seeder_bitfield = request_bitfield(seeder_fd, fileID);
-    print_bitfield(seeder_bitfield, bitfield_size, " Seeder's bitfield");
+    print_bitfield(seeder_bitfield, bitfield_size, "Seeder's bitfield");
     // Loop through each chunk index
 
     TransferChunk *outChunk = malloc(sizeof(TransferChunk));
@@ -366,47 +373,54 @@ void leech_from_seeder(PeerInfo seeder, char *bitfield_filepath, char *binary_fi
 
         if (!seeder_bitfield)
         {
-            perror("ERROR getting seeder bitfield");
+            LOG_ERROR("getting seeder bitfield from %s:%s", seeder.ip_address, seeder.port);
             close(seeder_fd);
             return;
         }
-        printf("✅ Successfully received seeder's bitfield\n");
 
         // Check if local bit is 0 (don't have chunk) and seeder bit is 1 (has chunk)
         if (!has_chunk(local_bitfield, chunkIndex) &&
             has_chunk(seeder_bitfield, chunkIndex))
         {
-            printf("📥 Requesting chunk %zd from seeder\n", chunkIndex);
+            LOG_DEBUG("Requesting chunk %zd from seeder", chunkIndex);
 
             // Request the chunk from the seeder
             int result = request_chunk(seeder_fd, fileID, chunkIndex, outChunk);
             if (result == 0)
             {
                 // Write chunk to file
+                uint64_t started = metrics_now_ns();
                 if (write_chunk_to_file(binary_filepath, outChunk) == 0)
                 {
                     // Update bitfield
                     if (update_bitfield(bitfield_filepath, chunkIndex) == 0)
                     {
-                        printf("✅ Successfully wrote chunk %zd and updated bitfield\n", chunkIndex);
+                        metrics_record(PEER_TIMER_DISK_WRITE, metrics_now_ns() - started);
+                        LOG_DEBUG("Wrote chunk %zd and updated bitfield", chunkIndex);
                     }
                     else
                     {
-                        fprintf(stderr, "❌ Failed to update bitfield for chunk %zd\n", chunkIndex);
+                        metrics_add(PEER_METRIC_CHUNK_FAILURES, 1);
+                        LOG_ERROR("Failed to update bitfield for chunk %zd", chunkIndex);
                     }
                 }
                 else
                 {
-                    fprintf(stderr, "❌ Failed to write chunk %zd to file\n", chunkIndex);
+                    metrics_add(PEER_METRIC_CHUNK_FAILURES, 1);
+                    LOG_ERROR("Failed to write chunk %zd to file", chunkIndex);
                 }
             }
+            else
+            {
+                metrics_add(PEER_METRIC_CHUNK_FAILURES, 1);
+            }
         }
         else
         {
-            fprintf(stderr, "❌ Failed to get chunk %zd from seeder\n", chunkIndex);
+            LOG_DEBUG("Skipping chunk %zd, held locally or missing at the seeder", chunkIndex);
         }
     }
-    printf("🏁 Finished leeching session with seeder %s:%s\n", seeder.ip_address, seeder.port);
+    LOG_INFO("Finished leeching session with seeder %s:%s", seeder.ip_address, seeder.port);
     free(local_bitfield);
     free(seeder_bitfield);
     close(seeder_fd);
@@ -434,18 +448,14 @@ void leech_from_seeder(PeerInfo seeder, char *bitfield_filepath, char *binary_fi
  */
 int leeching(PeerInfo *seeder_list, size_t num_seeders, char *metadata_filepath, char *bitfield_filepath, char *binary_filepath)
 {
-    printf("\n📦 Starting leeching process\n");
-    printf("📄 Metadata file: %s\n", metadata_filepath);
-    printf("🔑 Bitfield file: %s\n", bitfield_filepath);
-    printf("💾 Binary file: %s\n", binary_filepath);
-    printf("👥 Number of seeders: %zu\n\n", num_seeders);
+    LOG_INFO("Starting leeching process, %zu seeder(s)", num_seeders);
+    LOG_DEBUG("Metadata file: %s, bitfield file: %s, binary file: %s", metadata_filepath, bitfield_filepath, binary_filepath);
 
     size_t index = 0;
     FileMetadata *fileMetaData = malloc(sizeof(FileMetadata));
 
     read_metadata(metadata_filepath, fileMetaData);
-    printf("📊 File metadata loaded - Total chunks: %zd, FileID: %zd\n",
-           fileMetaData->totalChunk, fileMetaData->fileID);
+    LOG_DEBUG("File metadata loaded - Total chunks: %zd, FileID: %zd", fileMetaData->totalChunk, fileMetaData->fileID);
 
     // Read bitfield from the bitfield_filepath
 
@@ -453,13 +463,13 @@ int leeching(PeerInfo *seeder_list, size_t num_seeders, char *metadata_filepath,
     FILE *metadata_fp = fopen(metadata_filepath, "rb");
     if (!metadata_fp)
     {
-        perror("ERROR opening metadata file");
+        LOG_ERROR("opening metadata file: %s", strerror(errno));
         return 1;
     }
 
     for (index = 0; index < num_seeders; index++)
     {
-        printf("\n🔄 Attempting to leech from seeder %ld of %zu\n", index + 1, num_seeders);
+        LOG_DEBUG("Attempting to leech from seeder %zu of %zu", index + 1, num_seeders);
         leech_from_seeder(seeder_list[index], bitfield_filepath, binary_filepath, fileMetaData->totalChunk, fileMetaData->fileID);
         // if all chunks are downloaded then we break
         // else we continue
@@ -470,7 +480,7 @@ int leeching(PeerInfo *seeder_list, size_t num_seeders, char *metadata_filepath,
 
     // We will run hash check on the binary file and see if it matches
 
-    printf("\n✨ Leeching process completed\n");
+    LOG_INFO("Leeching process completed");
     free(fileMetaData);
 
     return 0;
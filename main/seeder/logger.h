@@ -0,0 +1,153 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+@brief Leveled logger that keeps formatting off the hot paths
+
+LOG_INFO("fileID=%zd from %s", fileID, ip) formats nothing. It copies the format pointer, the raw values
+of the arguments and the bytes of the string arguments into a ring owned by the calling thread
+(one producer, one consumer, no lock, no syscall). A background thread drains every ring every
+LOG_DRAIN_MS, formats the records and writes them out with one fwrite() per pass.
+- The format must be a string literal, it is only read when the record is drained.
+- At most LOG_ARGS_MAX arguments: integers, floating point, strings (copied, LOG_TEXT_MAX bytes
+  per record in total) and pointers. No '*' width or precision.
+- A full ring drops the record and counts it, the drainer reports the drops. Callers never wait.
+- Levels below LOG_COMPILE_LEVEL compile out, arguments included: DEBUG is gone unless the build
+  passes -DLOG_COMPILE_LEVEL=0. logger_set_level() filters the rest at runtime.
+- Lines are in order per thread, threads are interleaved by drain pass.
+Before logger_init() (or past LOG_THREADS_MAX threads) a record is formatted and written on the spot.
+*/
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_ARGS_MAX 8
+#define LOG_TEXT_MAX 160      // bytes of string arguments in one record, longer ones are cut
+#define LOG_RING_RECORDS 1024 // per thread, a power of two
+#define LOG_THREADS_MAX 128
+#define LOG_DRAIN_MS 10
+
+typedef enum
+{
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,
+    LOG_ARG_POINTER
+} LogArgType;
+
+typedef struct LogArg
+{
+    LogArgType type;
+    union
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *s; // copied into the record by logger_write()
+        const void *p;
+    } value;
+} LogArg;
+
+extern int logger_level; // runtime threshold, see logger_set_level()
+
+/* Starts the drain thread writing to out (stdout when NULL). The rings are flushed at exit() */
+int logger_init(FILE *out, int level);
+void logger_set_level(int level);
+/* "debug", "info", "warn" or "error" to a LOG_LEVEL_*, -1 when unknown */
+int logger_parse_level(const char *name);
+/* Formats and writes everything logged so far, returns the records written */
+size_t logger_flush(void);
+void logger_write(int level, const char *format, const LogArg *args, size_t count);
+
+/* --------------------------------------------------------------------------
+   🔹 Macros
+   -------------------------------------------------------------------------- */
+#define LOG_ENABLED(level) ((level) >= LOG_COMPILE_LEVEL && (level) >= logger_level)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// A disabled level still type checks its format and arguments, without evaluating them
+#define LOG_AT(level, ...)                       \
+    do                                           \
+    {                                            \
+        if (LOG_ENABLED(level))                  \
+            LOG_EMIT_(level, __VA_ARGS__);       \
+        else if (0)                              \
+            logger_format_check(__VA_ARGS__);    \
+    } while (0)
+
+#define LOG_EMIT_(level, format, ...)                                                          \
+    logger_write(level, format, (const LogArg[]){{0} LOG_MAP_(LOG_COUNT_(__VA_ARGS__), __VA_ARGS__)} + 1, \
+                 LOG_COUNT_(__VA_ARGS__))
+
+static inline void logger_format_check(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void logger_format_check(const char *format, ...)
+{
+    (void)format;
+}
+
+static inline LogArg log_arg_int(long long v)
+{
+    LogArg arg = {LOG_ARG_INT, {.i = v}};
+    return arg;
+}
+static inline LogArg log_arg_uint(unsigned long long v)
+{
+    LogArg arg = {LOG_ARG_UINT, {.u = v}};
+    return arg;
+}
+static inline LogArg log_arg_double(double v)
+{
+    LogArg arg = {LOG_ARG_DOUBLE, {.d = v}};
+    return arg;
+}
+static inline LogArg log_arg_string(const char *v)
+{
+    LogArg arg = {LOG_ARG_STRING, {.s = v}};
+    return arg;
+}
+static inline LogArg log_arg_pointer(const void *v)
+{
+    LogArg arg = {LOG_ARG_POINTER, {.p = v}};
+    return arg;
+}
+
+#define LOG_ARG_(x) _Generic((x),                                                                     \
+    char: log_arg_int, signed char: log_arg_int, short: log_arg_int, int: log_arg_int,                \
+    long: log_arg_int, long long: log_arg_int,                                                        \
+    _Bool: log_arg_uint, unsigned char: log_arg_uint, unsigned short: log_arg_uint,                   \
+    unsigned int: log_arg_uint, unsigned long: log_arg_uint, unsigned long long: log_arg_uint,        \
+    float: log_arg_double, double: log_arg_double, long double: log_arg_double,                       \
+    char *: log_arg_string, const char *: log_arg_string,                                             \
+    default: log_arg_pointer)(x)
+
+// Number of arguments after the format (0..8), then ", LOG_ARG_(a), LOG_ARG_(b)..."
+#define LOG_COUNT_(...) LOG_COUNT_PICK_(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_COUNT_PICK_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define LOG_MAP_(n, ...) LOG_MAP_N_(n, __VA_ARGS__)
+#define LOG_MAP_N_(n, ...) LOG_MAP_##n(__VA_ARGS__)
+#define LOG_MAP_0(...)
+#define LOG_MAP_1(x) , LOG_ARG_(x)
+#define LOG_MAP_2(x, ...) , LOG_ARG_(x) LOG_MAP_1(__VA_ARGS__)
+#define LOG_MAP_3(x, ...) , LOG_ARG_(x) LOG_MAP_2(__VA_ARGS__)
+#define LOG_MAP_4(x, ...) , LOG_ARG_(x) LOG_MAP_3(__VA_ARGS__)
+#define LOG_MAP_5(x, ...) , LOG_ARG_(x) LOG_MAP_4(__VA_ARGS__)
+#define LOG_MAP_6(x, ...) , LOG_ARG_(x) LOG_MAP_5(__VA_ARGS__)
+#define LOG_MAP_7(x, ...) , LOG_ARG_(x) LOG_MAP_6(__VA_ARGS__)
+#define LOG_MAP_8(x, ...) , LOG_ARG_(x) LOG_MAP_7(__VA_ARGS__)
+
+#endif // LOGGER_H
@@ -29,7 +29,12 @@ GENERAL NOTES:
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <endian.h>
+#include <sys/time.h>
 #include <arpa/inet.h> 
+#include <netdb.h>
 #include "meta.h"   
 #include "seed.h"
 #include "database.h"
@@ -37,6 +42,7 @@ GENERAL NOTES:
 #include "leech.h"
 #include "peer.h"
 #include "peerCommunication.h"
+#include "peer_metrics.h"
 
 
 
@@ -72,7 +78,81 @@ GENERAL NOTES:
 
 PeerContext *peer_ctx;
 
+static const char *const peer_counter_names[PEER_COUNTER_COUNT] = {
+    [PEER_METRIC_LEECHERS_ACCEPTED] = "leechers_accepted",
+    [PEER_METRIC_CHUNKS_SERVED] = "chunks_served",
+    [PEER_METRIC_BYTES_SERVED] = "bytes_served",
+    [PEER_METRIC_BITFIELDS_SERVED] = "bitfields_served",
+    [PEER_METRIC_CHUNKS_RECEIVED] = "chunks_received",
+    [PEER_METRIC_BYTES_RECEIVED] = "bytes_received",
+    [PEER_METRIC_CHUNK_FAILURES] = "chunk_failures",
+};
+
+static const char *const peer_timer_names[PEER_TIMER_COUNT] = {
+    [PEER_TIMER_CHUNK_SERVE] = "chunk_serve",
+    [PEER_TIMER_CHUNK_RECEIVE] = "chunk_receive",
+    [PEER_TIMER_DISK_READ] = "disk_read",
+    [PEER_TIMER_DISK_WRITE] = "disk_write",
+    [PEER_TIMER_BITFIELD_SERVE] = "bitfield_serve",
+};
+
+/*
+Files we participate in, re-announced by announce_main() every announce_interval seconds.
+The tracker tells us the interval in every participate ACK.
+*/
+static pthread_mutex_t announce_lock = PTHREAD_MUTEX_INITIALIZER;
+static ssize_t announced_files[MAX_ANNOUNCED_FILES];
+static size_t announced_count;
+static ssize_t announce_interval;
+static char announce_ip[64];
+static char announce_port[16];
+static int announce_thread_started;
+
+/*
+Trackers of a sharded deployment, read from TRACKER_SHARDS_FILE by connect_to_tracker(). Without the file
+there is one tracker (TRACKER_IP:TRACKER_PORT) owning every fileID. The first tracker of the file is the
+home tracker the CLI connects to, the CLI keeps one more connection per other tracker in shard_sockets.
+The map is not changed after the first connect, the announce thread reads it without a lock.
+*/
+static ShardMap tracker_shards;
+static int shard_sockets[SHARD_MAX];
+static int tracker_shards_loaded;
+
+/*
+Local copy of the tracker catalog, refreshed with delta listings (sync_catalog).
+Every tracker numbers its own catalog versions, so each one gets its own cache and cursor.
+*/
+typedef struct CatalogCache
+{
+    FileEntry *entries;
+    size_t count;
+    size_t cap;
+    ssize_t cursor; // catalog version we are up to date with
+    int loaded;
+} CatalogCache;
+
+static CatalogCache catalog_caches[SHARD_MAX];
+
 /* Helper/Utility Functions */
+
+/*
+@brief read() until len bytes arrived. Large tracker replies span several TCP segments.
+@return 0 on success, -1 on error or if the tracker closed the connection early
+*/
+static int read_exact(int fd, void *buf, size_t len)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = read(fd, (char *)buf + done, len - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
 void request_metadata_by_filename(int tracker_socket, const char *metaFilename, FileMetadata *fileMetaData)
 {
     TrackerMessage msg;
@@ -144,39 +224,124 @@ char *generate_binary_filepath(char *metaFilePath)
 }
 
 /* Tracker communication functions*/
-int connect_to_tracker()
+
+/* Number of trackers we talk to, 1 when TRACKER_SHARDS_FILE is missing */
+static size_t tracker_count(void)
 {
+    return tracker_shards.count ? tracker_shards.count : 1;
+}
 
-    printf("Connecting to Tracker at %s:%d...\n", TRACKER_IP, TRACKER_PORT);
+static TrackerShard tracker_at(size_t shard)
+{
+    if (tracker_shards.count)
+        return tracker_shards.shards[shard];
+
+    TrackerShard tracker;
+    memset(&tracker, 0, sizeof(tracker));
+    strncpy(tracker.ip, TRACKER_IP, sizeof(tracker.ip) - 1);
+    tracker.port = TRACKER_PORT;
+    return tracker;
+}
 
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0)
+static void load_tracker_shards(void)
+{
+    if (tracker_shards_loaded)
+        return;
+    tracker_shards_loaded = 1;
+    for (size_t i = 0; i < SHARD_MAX; i++)
+        shard_sockets[i] = -1;
+
+    if (shard_map_load(&tracker_shards, TRACKER_SHARDS_FILE) > 0)
+        printf("%zu trackers in %s, fileIDs are split between them\n", tracker_shards.count, TRACKER_SHARDS_FILE);
+}
+
+/* Plain TCP connection to a tracker (IPv4 or IPv6), shared by the CLI and the announce thread */
+static int open_tracker_socket_at(const TrackerShard *tracker)
+{
+    struct addrinfo hints, *addr;
+    char port[16];
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    snprintf(port, sizeof(port), "%d", tracker->port);
+
+    if (getaddrinfo(tracker->ip, port, &hints, &addr) != 0)
     {
-        perror("ERROR opening socket to tracker");
+        fprintf(stderr, "ERROR invalid tracker IP %s\n", tracker->ip);
         return -1;
     }
 
-    struct sockaddr_in serv_addr;
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(TRACKER_PORT);
-
-    if (inet_pton(AF_INET, TRACKER_IP, &serv_addr.sin_addr) <= 0)
+    int sockfd = socket(addr->ai_family, SOCK_STREAM, 0);
+    if (sockfd < 0)
     {
-        perror("ERROR invalid tracker IP");
-        close(sockfd);
+        perror("ERROR opening socket to tracker");
+        freeaddrinfo(addr);
         return -1;
     }
 
-    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
+    if (connect(sockfd, addr->ai_addr, addr->ai_addrlen) < 0)
     {
         perror("ERROR connecting to tracker");
-        printf("❌ Connection to Tracker failed. Is it running at %s:%d?\n", TRACKER_IP, TRACKER_PORT);
+        printf("❌ Connection to Tracker failed. Is it running at %s:%d?\n", tracker->ip, tracker->port);
         close(sockfd);
-        return -1;
+        sockfd = -1;
     }
+    freeaddrinfo(addr);
+    return sockfd;
+}
 
-    printf("✅ Seeder successfully connected to Tracker at %s:%d\n", TRACKER_IP, TRACKER_PORT);
+/* Connection to the home tracker */
+static int open_tracker_socket(void)
+{
+    TrackerShard home = tracker_at(0);
+    return open_tracker_socket_at(&home);
+}
+
+/* CLI connection to tracker `shard`: the home tracker is tracker_socket itself, the others are opened once and kept */
+static int tracker_socket_for_shard(int tracker_socket, size_t shard)
+{
+    if (shard == 0)
+        return tracker_socket;
+    if (shard_sockets[shard] < 0)
+    {
+        TrackerShard tracker = tracker_at(shard);
+        shard_sockets[shard] = open_tracker_socket_at(&tracker);
+    }
+    return shard_sockets[shard];
+}
+
+/* CLI connection to the tracker owning fileID */
+static int tracker_for_file(int tracker_socket, ssize_t fileID)
+{
+    return tracker_socket_for_shard(tracker_socket, shard_for_file(&tracker_shards, fileID));
+}
+
+/*
+@brief Prints where a MSG_ACK_WRONG_SHARD reply sends us: our TRACKER_SHARDS_FILE does not match the trackers'
+@return 1 when header is such a reply, 0 otherwise
+*/
+static int report_wrong_shard(const TrackerMessageHeader *header, const TrackerMessageBody *body)
+{
+    if (header->type != MSG_ACK_WRONG_SHARD || header->bodySize != sizeof(PeerWithFileID))
+        return 0;
+    fprintf(stderr, "fileID %zd is served by tracker %s:%s, check %s\n", body->peerWithFileID.fileID,
+            body->peerWithFileID.singleSeeder.ip_address, body->peerWithFileID.singleSeeder.port, TRACKER_SHARDS_FILE);
+    return 1;
+}
+
+int connect_to_tracker()
+{
+    load_tracker_shards();
+    TrackerShard home = tracker_at(0);
+
+    printf("Connecting to Tracker at %s:%d...\n", home.ip, home.port);
+
+    int sockfd = open_tracker_socket();
+    if (sockfd < 0)
+        return -1;
+
+    printf("✅ Seeder successfully connected to Tracker at %s:%d\n", home.ip, home.port);
     peer_ctx->tracker_fd = sockfd;
     peer_ctx->current_state = Peer_FSM_TRACKER_CONNECTED;
     return sockfd;
@@ -223,6 +388,13 @@ void request_create_new_seed(int tracker_socket, const char *binary_file_path)
     msg.header.bodySize = sizeof(FileMetadata);
     msg.body.fileMetadata = fileMeta;
 
+    // The file has no fileID yet, its hash picks the tracker, which then hands out a fileID it owns
+    uint64_t hashKey;
+    memcpy(&hashKey, fileMeta.fileHash, sizeof(hashKey));
+    tracker_socket = tracker_socket_for_shard(tracker_socket, shard_for_key(&tracker_shards, hashKey));
+    if (tracker_socket < 0)
+        return;
+
     ssize_t bytes_written = write(tracker_socket, &msg.header, sizeof(msg.header));
     if (bytes_written != sizeof(msg.header))
     {
@@ -300,6 +472,74 @@ void request_create_new_seed(int tracker_socket, const char *binary_file_path)
     free(bitfieldPath);
 }
 
+/*
+@brief Reads the body of a MSG_ACK_SEEDER_BY_FILEID_COMPACT reply and expands it to PeerInfo,
+       the format leeching() works with.
+@return Dynamically allocated array of PeerInfo, NULL if there are no seeders or on error
+*/
+static PeerInfo *read_compact_seeder_list(int tracker_socket, const TrackerMessageHeader *ack_header, ssize_t fileID, size_t *num_seeders_out)
+{
+    CompactPeerListHeader list;
+    if (ack_header->bodySize < (ssize_t)sizeof(list) ||
+        read_exact(tracker_socket, &list, sizeof(list)) < 0)
+    {
+        perror("ERROR reading compact seeder list");
+        return NULL;
+    }
+
+    size_t peers_size = (size_t)list.count_v4 * PEER_COMPACT_V4_SIZE + (size_t)list.count_v6 * PEER_COMPACT_V6_SIZE;
+    if (ack_header->bodySize != (ssize_t)(sizeof(list) + peers_size))
+    {
+        fprintf(stderr, "Malformed compact seeder list for fileID=%zd\n", fileID);
+        return NULL;
+    }
+
+    size_t num_seeders = (size_t)list.count_v4 + list.count_v6;
+    if (num_seeders == 0)
+    {
+        printf("No seeders for fileID=%zd.\n", fileID);
+        return NULL;
+    }
+
+    uint8_t *peers = malloc(peers_size);
+    PeerInfo *seederList = calloc(num_seeders, sizeof(PeerInfo));
+    if (!peers || !seederList || read_exact(tracker_socket, peers, peers_size) < 0)
+    {
+        perror("ERROR reading compact seeder list");
+        free(peers);
+        free(seederList);
+        return NULL;
+    }
+
+    // IPv4 section first, then IPv6
+    const uint8_t *entry = peers;
+    for (size_t i = 0; i < num_seeders; i++)
+    {
+        int v6 = i >= list.count_v4;
+        size_t addr_len = v6 ? 16 : 4;
+        uint16_t port;
+        memcpy(&port, entry + addr_len, sizeof(port));
+
+        inet_ntop(v6 ? AF_INET6 : AF_INET, entry, seederList[i].ip_address, sizeof(seederList[i].ip_address));
+        snprintf(seederList[i].port, sizeof(seederList[i].port), "%u", ntohs(port));
+        entry += addr_len + sizeof(port);
+    }
+    free(peers);
+
+    printf("Received %zu seeders for fileID=%zd (%zu bytes compact):\n", num_seeders, fileID, peers_size);
+    for (size_t i = 0; i < num_seeders; i++)
+    {
+        printf("  -> %s:%s\n", seederList[i].ip_address, seederList[i].port);
+    }
+
+    if (num_seeders_out)
+    {
+        *num_seeders_out = num_seeders;
+    }
+
+    return seederList;
+}
+
 /**
  * request_seeder_by_fileID
  * @brief Requests a list of peers seeding a specific file from the tracker
@@ -310,6 +550,7 @@ void request_create_new_seed(int tracker_socket, const char *binary_file_path)
  *
  * @param tracker_socket Socket descriptor for tracker server connection
  * @param fileID The unique identifier of the file to find seeders for
+ * @param maxPeers Upper bound on how many seeders the tracker should return (it may cap it further)
  * @param num_seeders_out We use this to determine the number of seeders, so that we iterate later. it is useful!!
  *
  * @return PeerInfo* Dynamically allocated array of PeerInfo structures containing
@@ -317,28 +558,30 @@ void request_create_new_seed(int tracker_socket, const char *binary_file_path)
  *         no seeders are available or in case of errors.
  *         
  */
-PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t *num_seeders_out)
+static PeerInfo *seeder_lookup(int tracker_socket, ssize_t fileID, size_t maxPeers, size_t *num_seeders_out, int redirects)
 {
     // 1) Build the request
     TrackerMessage msg;
     memset(&msg, 0, sizeof(msg));
     msg.header.type = MSG_REQUEST_SEEDER_BY_FILEID;
-    msg.header.bodySize = sizeof(ssize_t);
-    msg.body.fileID = fileID;
+    msg.header.bodySize = sizeof(SeederListRequest);
+    msg.body.seederRequest.fileID = fileID;
+    msg.body.seederRequest.maxPeers = (ssize_t)maxPeers;
+    msg.body.seederRequest.flags = SEEDER_REQUEST_COMPACT;
 
     if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0)
     {
         perror("ERROR writing header (REQUEST_SEEDER_BY_FILEID)");
         return NULL;
     }
-    if (write(tracker_socket, &msg.body.fileID, msg.header.bodySize) < 0)
+    if (write(tracker_socket, &msg.body.seederRequest, msg.header.bodySize) < 0)
     {
-        perror("ERROR writing fileID body");
+        perror("ERROR writing seeder request body");
         return NULL;
     }
 
     TrackerMessageHeader ack_header;
-    if (read(tracker_socket, &ack_header, sizeof(ack_header)) <= 0)
+    if (read_exact(tracker_socket, &ack_header, sizeof(ack_header)) < 0)
     {
         perror("ERROR reading ack header (REQUEST_SEEDER_BY_FILEID)");
         return NULL;
@@ -354,6 +597,31 @@ PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t *n
         printf("Your IP is blocked. Tracker refused your ip\n");
         return NULL;
     }
+    else if (ack_header.type == MSG_ACK_WRONG_SHARD)
+    {
+        // Our shard file is out of date, ask the tracker we were pointed to (once, two of them could disagree)
+        TrackerMessageBody body;
+        if (ack_header.bodySize != sizeof(PeerWithFileID) ||
+            read_exact(tracker_socket, &body.peerWithFileID, sizeof(PeerWithFileID)) < 0)
+            return NULL;
+        report_wrong_shard(&ack_header, &body);
+
+        TrackerShard owner;
+        memset(&owner, 0, sizeof(owner));
+        strncpy(owner.ip, body.peerWithFileID.singleSeeder.ip_address, sizeof(owner.ip) - 1);
+        owner.port = atoi(body.peerWithFileID.singleSeeder.port);
+        int owner_socket = redirects > 0 ? open_tracker_socket_at(&owner) : -1;
+        if (owner_socket < 0)
+            return NULL;
+        PeerInfo *seederList = seeder_lookup(owner_socket, fileID, maxPeers, num_seeders_out, redirects - 1);
+        close(owner_socket);
+        return seederList;
+    }
+
+    if (ack_header.type == MSG_ACK_SEEDER_BY_FILEID_COMPACT)
+    {
+        return read_compact_seeder_list(tracker_socket, &ack_header, fileID, num_seeders_out);
+    }
 
     if (ack_header.type != MSG_ACK_SEEDER_BY_FILEID)
     {
@@ -361,13 +629,22 @@ PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t *n
         return NULL;
     }
 
-    if (ack_header.bodySize == 0)
+    // 2) Length-prefixed body: ssize_t count, then count PeerInfo
+    ssize_t count = 0;
+    if (ack_header.bodySize < (ssize_t)sizeof(count) ||
+        read_exact(tracker_socket, &count, sizeof(count)) < 0)
+    {
+        perror("ERROR reading seeder count");
+        return NULL;
+    }
+
+    if (count <= 0 || ack_header.bodySize != (ssize_t)(sizeof(count) + count * sizeof(PeerInfo)))
     {
         printf("No seeders for fileID=%zd.\n", fileID);
         return NULL;
     }
 
-    size_t num_seeders = ack_header.bodySize / sizeof(PeerInfo);
+    size_t num_seeders = (size_t)count;
     PeerInfo *seederList = calloc(num_seeders, sizeof(PeerInfo));
     if (!seederList)
     {
@@ -375,7 +652,7 @@ PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t *n
         return NULL;
     }
 
-    if (read(tracker_socket, seederList, ack_header.bodySize) < 0)
+    if (read_exact(tracker_socket, seederList, num_seeders * sizeof(PeerInfo)) < 0)
     {
         perror("ERROR reading seeder list");
         free(seederList);
@@ -396,6 +673,323 @@ PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t *n
     return seederList;
 }
 
+PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t maxPeers, size_t *num_seeders_out)
+{
+    tracker_socket = tracker_for_file(tracker_socket, fileID);
+    if (tracker_socket < 0)
+        return NULL;
+    return seeder_lookup(tracker_socket, fileID, maxPeers, num_seeders_out, 1);
+}
+
+/*
+@brief Reads one tracker reply: the header and, when it fits, the body.
+A larger body is drained so the next reply still starts on a header.
+@return 0 on success, -1 if the connection failed
+*/
+static int read_tracker_reply(int tracker_socket, TrackerMessageHeader *header, TrackerMessageBody *body)
+{
+    memset(body, 0, sizeof(*body));
+    if (read_exact(tracker_socket, header, sizeof(*header)) < 0 || header->bodySize < 0)
+        return -1;
+
+    size_t remaining = (size_t)header->bodySize;
+    size_t keep = remaining < sizeof(*body) ? remaining : sizeof(*body);
+    if (read_exact(tracker_socket, body, keep) < 0)
+        return -1;
+    remaining -= keep;
+
+    char discard[512];
+    while (remaining > 0)
+    {
+        size_t chunk = remaining < sizeof(discard) ? remaining : sizeof(discard);
+        if (read_exact(tracker_socket, discard, chunk) < 0)
+            return -1;
+        remaining -= chunk;
+    }
+    return 0;
+}
+
+/* Sends a PeerWithFileID request (participate / unparticipate) and reads the reply */
+static int send_peer_file_request(int tracker_socket, TrackerMessageType type, const char *myIP, const char *myPort, ssize_t fileID,
+                                  TrackerMessageHeader *ack_header, TrackerMessageBody *ack_body)
+{
+    TrackerMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.header.type = type;
+    msg.header.bodySize = sizeof(PeerWithFileID);
+
+    strncpy(msg.body.peerWithFileID.singleSeeder.ip_address, myIP,
+            sizeof(msg.body.peerWithFileID.singleSeeder.ip_address) - 1);
+    strncpy(msg.body.peerWithFileID.singleSeeder.port, myPort,
+            sizeof(msg.body.peerWithFileID.singleSeeder.port) - 1);
+    msg.body.peerWithFileID.fileID = fileID;
+
+    if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0 ||
+        write(tracker_socket, &msg.body.peerWithFileID, msg.header.bodySize) < 0)
+        return -1;
+    return read_tracker_reply(tracker_socket, ack_header, ack_body);
+}
+
+/*
+@brief Sends one UDP request and waits for the reply carrying the same transaction ID, resending on timeout
+@return reply length, -1 when the tracker never answered
+*/
+static ssize_t udp_transact(int udp_socket, const uint8_t *req, size_t len, uint32_t transactionId, uint8_t *reply, size_t max)
+{
+    for (int attempt = 0; attempt <= UDP_RETRIES; attempt++)
+    {
+        if (send(udp_socket, req, len, 0) < 0)
+            return -1;
+        ssize_t n;
+        while ((n = recv(udp_socket, reply, max, 0)) >= 8)
+        {
+            uint32_t tx;
+            memcpy(&tx, reply + 4, sizeof(tx));
+            if (ntohl(tx) == transactionId)
+                return n;
+            // a late reply to an earlier attempt, keep waiting
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            return -1;
+    }
+    return -1;
+}
+
+/*
+@brief Re-announces every file over UDP: one connect exchange, then one datagram per file.
+The tracker takes our address from the packets, so this is only used when ip is the address
+our UDP socket sends from. Returns 0 when the tracker answered, -1 to fall back to TCP
+*/
+static int udp_announce_files(const TrackerShard *tracker, const char *ip, const char *port, const ssize_t *files, size_t count)
+{
+    int udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_socket < 0)
+        return -1;
+
+    struct sockaddr_in serv_addr, local;
+    socklen_t local_len = sizeof(local);
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons((uint16_t)tracker->port);
+    struct timeval timeout = {UDP_TIMEOUT_MS / 1000, (UDP_TIMEOUT_MS % 1000) * 1000};
+    char local_ip[INET_ADDRSTRLEN];
+    if (inet_pton(AF_INET, tracker->ip, &serv_addr.sin_addr) <= 0 ||
+        connect(udp_socket, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0 ||
+        getsockname(udp_socket, (struct sockaddr *)&local, &local_len) < 0 ||
+        !inet_ntop(AF_INET, &local.sin_addr, local_ip, sizeof(local_ip)) ||
+        strcmp(local_ip, ip) != 0 ||
+        setsockopt(udp_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+    {
+        close(udp_socket);
+        return -1;
+    }
+
+    uint32_t transactionId = (uint32_t)rand();
+    uint8_t req[28], reply[64];
+
+    // connect: u64 protocol ID, u32 action, u32 transaction ID -> u32 action, u32 transaction ID, u64 connection ID
+    uint64_t protocolId = htobe64(UDP_PROTOCOL_ID);
+    uint32_t action = htonl(UDP_ACTION_CONNECT), tx = htonl(transactionId);
+    memcpy(req, &protocolId, 8);
+    memcpy(req + 8, &action, 4);
+    memcpy(req + 12, &tx, 4);
+    if (udp_transact(udp_socket, req, 16, transactionId, reply, sizeof(reply)) < 16)
+    {
+        close(udp_socket);
+        return -1;
+    }
+    memcpy(&action, reply, 4);
+    if (ntohl(action) != UDP_ACTION_CONNECT)
+    {
+        close(udp_socket);
+        return -1;
+    }
+    uint64_t connectionId;
+    memcpy(&connectionId, reply + 8, 8); // sent back as is
+
+    // announce: u64 connection ID, u32 action, u32 transaction ID, i64 fileID, u16 port, u16 event
+    uint16_t listenPort = htons((uint16_t)atoi(port)), event = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        transactionId++;
+        uint64_t fileID = htobe64((uint64_t)files[i]);
+        action = htonl(UDP_ACTION_ANNOUNCE);
+        tx = htonl(transactionId);
+        memcpy(req, &connectionId, 8);
+        memcpy(req + 8, &action, 4);
+        memcpy(req + 12, &tx, 4);
+        memcpy(req + 16, &fileID, 8);
+        memcpy(req + 24, &listenPort, 2);
+        memcpy(req + 26, &event, 2);
+
+        ssize_t n = udp_transact(udp_socket, req, sizeof(req), transactionId, reply, sizeof(reply) - 1);
+        if (n < 8)
+        {
+            close(udp_socket);
+            return -1;
+        }
+        memcpy(&action, reply, 4);
+        if (ntohl(action) != UDP_ACTION_ANNOUNCE || n < 16)
+        {
+            reply[n] = '\0';
+            LOG_WARN("Re-announce of fileID %zd rejected: %s", files[i], (const char *)reply + 8);
+            continue;
+        }
+        uint32_t interval;
+        memcpy(&interval, reply + 8, 4);
+        pthread_mutex_lock(&announce_lock);
+        announce_interval = ntohl(interval);
+        pthread_mutex_unlock(&announce_lock);
+    }
+    close(udp_socket);
+    return 0;
+}
+
+/*
+@brief Re-announces every file with MSG_REQUEST_PARTICIPATE_BATCH, one round trip per BATCH_FILES_MAX files
+@return 0 when the tracker answered every batch, -1 on a connection error
+*/
+static int tcp_announce_files(int tracker_socket, const char *ip, const char *port, const ssize_t *files, size_t count)
+{
+    for (size_t first = 0; first < count; first += BATCH_FILES_MAX)
+    {
+        size_t n = count - first < BATCH_FILES_MAX ? count - first : BATCH_FILES_MAX;
+
+        TrackerMessageHeader header;
+        BatchParticipateRequest req;
+        memset(&header, 0, sizeof(header));
+        memset(&req, 0, sizeof(req));
+        header.type = MSG_REQUEST_PARTICIPATE_BATCH;
+        header.bodySize = sizeof(req) + n * sizeof(ssize_t);
+        strncpy(req.seeder.ip_address, ip, sizeof(req.seeder.ip_address) - 1);
+        strncpy(req.seeder.port, port, sizeof(req.seeder.port) - 1);
+        req.count = (ssize_t)n;
+
+        if (write(tracker_socket, &header, sizeof(header)) < 0 ||
+            write(tracker_socket, &req, sizeof(req)) < 0 ||
+            write(tracker_socket, files + first, n * sizeof(ssize_t)) < 0)
+            return -1;
+
+        // BatchParticipateAck, then one int32_t status per file
+        TrackerMessageHeader ack_header;
+        BatchParticipateAck ack;
+        int32_t status[BATCH_FILES_MAX];
+        if (read_exact(tracker_socket, &ack_header, sizeof(ack_header)) < 0)
+            return -1;
+        if (ack_header.type != MSG_ACK_PARTICIPATE_BATCH ||
+            ack_header.bodySize != (ssize_t)(sizeof(ack) + n * sizeof(int32_t)))
+        {
+            LOG_WARN("Re-announce rejected (type=%d)", ack_header.type);
+            return -1; // the rest of the reply is not ours to parse, drop the connection
+        }
+        if (read_exact(tracker_socket, &ack, sizeof(ack)) < 0 ||
+            read_exact(tracker_socket, status, n * sizeof(int32_t)) < 0)
+            return -1;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            if (status[i] != 0)
+                LOG_WARN("Re-announce of fileID %zd rejected (status=%d)", files[first + i], status[i]);
+        }
+        pthread_mutex_lock(&announce_lock);
+        announce_interval = ack.announceInterval;
+        pthread_mutex_unlock(&announce_lock);
+    }
+    return 0;
+}
+
+/*
+@brief Background thread: every announce_interval seconds, participate again in every file we seed.
+Every tracker gets the files it owns. Over UDP when the tracker serves it (one small datagram per file),
+otherwise over a fresh TCP connection: the CLI closes its tracker connection while seeding, so this thread keeps its own.
+*/
+static void *announce_main(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&announce_lock);
+        ssize_t interval = announce_interval;
+        pthread_mutex_unlock(&announce_lock);
+        sleep(interval > 0 ? (unsigned int)interval : 1);
+
+        ssize_t files[MAX_ANNOUNCED_FILES];
+        char ip[sizeof(announce_ip)];
+        char port[sizeof(announce_port)];
+        pthread_mutex_lock(&announce_lock);
+        size_t count = announced_count;
+        memcpy(files, announced_files, count * sizeof(ssize_t));
+        memcpy(ip, announce_ip, sizeof(ip));
+        memcpy(port, announce_port, sizeof(port));
+        pthread_mutex_unlock(&announce_lock);
+
+        for (size_t shard = 0; shard < tracker_count(); shard++)
+        {
+            ssize_t owned[MAX_ANNOUNCED_FILES];
+            size_t owned_count = 0;
+            for (size_t i = 0; i < count; i++)
+                if (shard_for_file(&tracker_shards, files[i]) == shard)
+                    owned[owned_count++] = files[i];
+
+            TrackerShard tracker = tracker_at(shard);
+            if (owned_count == 0 || udp_announce_files(&tracker, ip, port, owned, owned_count) == 0)
+                continue;
+
+            int tracker_socket = open_tracker_socket_at(&tracker);
+            if (tracker_socket < 0)
+                continue; // tracker down, try again next interval
+
+            tcp_announce_files(tracker_socket, ip, port, owned, owned_count);
+            close(tracker_socket);
+        }
+    }
+    return NULL;
+}
+
+/* Adds fileID to the re-announce list and starts announce_main() the first time */
+static void remember_announce(const char *myIP, const char *myPort, ssize_t fileID, ssize_t interval)
+{
+    pthread_mutex_lock(&announce_lock);
+    announce_interval = interval;
+    strncpy(announce_ip, myIP, sizeof(announce_ip) - 1);
+    strncpy(announce_port, myPort, sizeof(announce_port) - 1);
+
+    size_t i = 0;
+    while (i < announced_count && announced_files[i] != fileID)
+        i++;
+    if (i == announced_count && announced_count < MAX_ANNOUNCED_FILES)
+        announced_files[announced_count++] = fileID;
+
+    int start = !announce_thread_started;
+    announce_thread_started = 1;
+    pthread_mutex_unlock(&announce_lock);
+
+    if (start)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, announce_main, NULL) != 0)
+        {
+            perror("ERROR starting announce thread");
+            return;
+        }
+        pthread_detach(thread);
+    }
+}
+
+static void forget_announce(ssize_t fileID)
+{
+    pthread_mutex_lock(&announce_lock);
+    for (size_t i = 0; i < announced_count; i++)
+    {
+        if (announced_files[i] == fileID)
+        {
+            announced_files[i] = announced_files[--announced_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&announce_lock);
+}
+
 /**
  * @brief Registers the current peer as a seeder for a specific file
  *
@@ -415,48 +1009,25 @@ PeerInfo *request_seeder_by_fileID(int tracker_socket, ssize_t fileID, size_t *n
 
 void request_participate_seed_by_fileID(int tracker_socket, const char *myIP, const char *myPort, ssize_t fileID)
 {
-    // 1) Build the message
-    TrackerMessage msg;
-    memset(&msg, 0, sizeof(msg));
-    msg.header.type = MSG_REQUEST_PARTICIPATE_SEED_BY_FILEID;
-    msg.header.bodySize = sizeof(PeerWithFileID);
-
-    strncpy(msg.body.peerWithFileID.singleSeeder.ip_address, myIP,
-            sizeof(msg.body.peerWithFileID.singleSeeder.ip_address) - 1);
-    strncpy(msg.body.peerWithFileID.singleSeeder.port, myPort,
-            sizeof(msg.body.peerWithFileID.singleSeeder.port) - 1);
-    msg.body.peerWithFileID.fileID = fileID;
-
-    if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0)
-    {
-        perror("ERROR writing header (PARTICIPATE_SEED_BY_FILEID)");
-        return;
-    }
-    if (write(tracker_socket, &msg.body.peerWithFileID, msg.header.bodySize) < 0)
-    {
-        perror("ERROR writing PeerWithFileID body");
-        return;
-    }
-
     TrackerMessageHeader ack_header;
-    if (read(tracker_socket, &ack_header, sizeof(ack_header)) <= 0)
+    TrackerMessageBody ack_body;
+    tracker_socket = tracker_for_file(tracker_socket, fileID);
+    if (tracker_socket < 0 ||
+        send_peer_file_request(tracker_socket, MSG_REQUEST_PARTICIPATE_SEED_BY_FILEID, myIP, myPort, fileID, &ack_header, &ack_body) < 0)
     {
-        perror("ERROR reading ack header (PARTICIPATE_SEED_BY_FILEID)");
+        perror("ERROR sending PARTICIPATE_SEED_BY_FILEID");
         return;
     }
 
     if (ack_header.type == MSG_ACK_PARTICIPATE_SEED_BY_FILEID)
     {
         printf("Successfully registered as a seeder for fileID %zd.\n", fileID);
-        if (ack_header.bodySize > 0)
+        if (ack_header.bodySize == sizeof(ParticipateAck))
         {
-            char buffer[256];
-            ssize_t n = read(tracker_socket, buffer, ack_header.bodySize < 256 ? ack_header.bodySize : 255);
-            if (n > 0)
-            {
-                buffer[n] = '\0';
-                printf("Tracker says: %s\n", buffer);
-            }
+            ParticipateAck ack;
+            memcpy(&ack, ack_body.raw, sizeof(ack));
+            printf("Tracker expects a re-announce every %zd seconds.\n", ack.announceInterval);
+            remember_announce(myIP, myPort, fileID, ack.announceInterval);
         }
     }
     else if (ack_header.type == MSG_ACK_FILEHASH_BLOCKED)
@@ -467,26 +1038,127 @@ void request_participate_seed_by_fileID(int tracker_socket, const char *myIP, co
     {
         printf("Your IP is blocked. Tracker refused your ip\n");
     }
-
+    else if (report_wrong_shard(&ack_header, &ack_body))
+    {
+        return;
+    }
     else
     {
         fprintf(stderr, "Tracker did not ACK participation. Type=%d\n", ack_header.type);
         if (ack_header.bodySize > 0)
         {
-            char buffer[512];
-            ssize_t n = read(tracker_socket, buffer, ack_header.bodySize < 512 ? ack_header.bodySize : 512);
-            if (n > 0)
-            {
-                buffer[n] = '\0';
-                fprintf(stderr, "Tracker error: %s\n", buffer);
-            }
+            ack_body.raw[sizeof(ack_body.raw) - 1] = '\0';
+            fprintf(stderr, "Tracker error: %s\n", ack_body.raw);
         }
     }
 }
 
-void request_create_seeder(int tracker_socket, const char *myIP, const char *myPort)
+/**
+ * @brief Stops seeding a file: the tracker drops us from its swarm and we stop re-announcing it
+ */
+void request_unparticipate_seed_by_fileID(int tracker_socket, const char *myIP, const char *myPort, ssize_t fileID)
 {
+    forget_announce(fileID);
 
+    TrackerMessageHeader ack_header;
+    TrackerMessageBody ack_body;
+    tracker_socket = tracker_for_file(tracker_socket, fileID);
+    if (tracker_socket < 0 ||
+        send_peer_file_request(tracker_socket, MSG_REQUEST_UNPARTICIPATE_SEED, myIP, myPort, fileID, &ack_header, &ack_body) < 0)
+    {
+        perror("ERROR sending UNPARTICIPATE_SEED");
+        return;
+    }
+
+    if (ack_header.type == MSG_ACK_UNPARTICIPATE_SEED)
+    {
+        printf("Stopped seeding fileID %zd.\n", fileID);
+    }
+    else if (!report_wrong_shard(&ack_header, &ack_body))
+    {
+        ack_body.raw[sizeof(ack_body.raw) - 1] = '\0';
+        fprintf(stderr, "Tracker error: %s\n", ack_header.bodySize > 0 ? ack_body.raw : "unknown");
+    }
+}
+
+/**
+ * @brief Tells the tracker we started or finished leeching fileID, so its leecher and completion counts stay right
+ */
+void request_announce(int tracker_socket, const char *myIP, const char *myPort, ssize_t fileID, AnnounceEvent event,
+                      ssize_t downloaded, ssize_t left)
+{
+    TrackerMessageHeader header;
+    AnnounceRequest req;
+    memset(&header, 0, sizeof(header));
+    memset(&req, 0, sizeof(req));
+    header.type = MSG_REQUEST_ANNOUNCE;
+    header.bodySize = sizeof(req);
+    strncpy(req.peer.ip_address, myIP, sizeof(req.peer.ip_address) - 1);
+    strncpy(req.peer.port, myPort, sizeof(req.peer.port) - 1);
+    req.fileID = fileID;
+    req.event = event;
+    req.downloaded = downloaded;
+    req.left = left;
+
+    TrackerMessageHeader ack_header;
+    TrackerMessageBody ack_body;
+    tracker_socket = tracker_for_file(tracker_socket, fileID);
+    if (tracker_socket < 0 ||
+        write(tracker_socket, &header, sizeof(header)) < 0 ||
+        write(tracker_socket, &req, sizeof(req)) < 0 ||
+        read_tracker_reply(tracker_socket, &ack_header, &ack_body) < 0)
+    {
+        perror("ERROR sending ANNOUNCE");
+        return;
+    }
+
+    if (ack_header.type == MSG_ACK_ANNOUNCE && ack_header.bodySize == sizeof(AnnounceAck))
+    {
+        AnnounceAck ack;
+        memcpy(&ack, ack_body.raw, sizeof(ack));
+        printf("fileID %zd: %zd seeders, %zd leechers\n", fileID, ack.seeders, ack.leechers);
+    }
+    else if (!report_wrong_shard(&ack_header, &ack_body))
+    {
+        ack_body.raw[sizeof(ack_body.raw) - 1] = '\0';
+        fprintf(stderr, "Tracker error: %s\n", ack_header.bodySize > 0 ? ack_body.raw : "unknown");
+    }
+}
+
+/* MSG_REQUEST_DELETE_SEEDER to one tracker */
+static void delete_seeder_at(int tracker_socket, const char *myIP, const char *myPort)
+{
+    TrackerMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.header.type = MSG_REQUEST_DELETE_SEEDER;
+    msg.header.bodySize = sizeof(PeerInfo);
+    strncpy(msg.body.singleSeeder.ip_address, myIP, sizeof(msg.body.singleSeeder.ip_address) - 1);
+    strncpy(msg.body.singleSeeder.port, myPort, sizeof(msg.body.singleSeeder.port) - 1);
+
+    TrackerMessageHeader ack_header;
+    TrackerMessageBody ack_body;
+    if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0 ||
+        write(tracker_socket, &msg.body.singleSeeder, msg.header.bodySize) < 0 ||
+        read_tracker_reply(tracker_socket, &ack_header, &ack_body) < 0)
+    {
+        perror("ERROR sending DELETE_SEEDER");
+        return;
+    }
+
+    if (ack_header.type == MSG_ACK_DELETE_SEEDER)
+    {
+        printf("Unregistered from the tracker.\n");
+    }
+    else
+    {
+        ack_body.raw[sizeof(ack_body.raw) - 1] = '\0';
+        fprintf(stderr, "Tracker error: %s\n", ack_header.bodySize > 0 ? ack_body.raw : "unknown");
+    }
+}
+
+/* MSG_REQUEST_CREATE_SEEDER to one tracker */
+static void create_seeder_at(int tracker_socket, const char *myIP, const char *myPort)
+{
     TrackerMessage msg;
     memset(&msg, 0, sizeof(msg));
 
@@ -517,6 +1189,36 @@ void request_create_seeder(int tracker_socket, const char *myIP, const char *myP
         perror("ERROR reading tracker response (CREATE_SEEDER)");
 }
 
+/**
+ * @brief Unregisters this peer from every tracker, every file it seeded is dropped with it
+ */
+void request_delete_seeder(int tracker_socket, const char *myIP, const char *myPort)
+{
+    pthread_mutex_lock(&announce_lock);
+    announced_count = 0;
+    pthread_mutex_unlock(&announce_lock);
+
+    for (size_t shard = 0; shard < tracker_count(); shard++)
+    {
+        int shard_socket = tracker_socket_for_shard(tracker_socket, shard);
+        if (shard_socket >= 0)
+            delete_seeder_at(shard_socket, myIP, myPort);
+    }
+}
+
+/**
+ * @brief Registers this peer with every tracker, each one keeps its own peer list
+ */
+void request_create_seeder(int tracker_socket, const char *myIP, const char *myPort)
+{
+    for (size_t shard = 0; shard < tracker_count(); shard++)
+    {
+        int shard_socket = tracker_socket_for_shard(tracker_socket, shard);
+        if (shard_socket >= 0)
+            create_seeder_at(shard_socket, myIP, myPort);
+    }
+}
+
 /**
  * @brief tracker_cli_loop - this is only triggered when the FSM changes to peer_ctx->current_state = Peer_FSM_TRACKER_CLI;
  * 
@@ -564,6 +1266,10 @@ void tracker_cli_loop(int tracker_socket, char *ip_address, char *port)
         printf("4) Leech file by fileID\n");
         printf("5) Participate seeding by fileID\n");
         printf("6) Start Seeding\n");
+        printf("7) Stop seeding fileID\n");
+        printf("8) Unregister seeder\n");
+        printf("9) Search files by name\n");
+        printf("10) Show metrics\n");
         printf("0) Exit Tracker\n");
         printf("Choose an option: ");
 
@@ -722,7 +1428,7 @@ void tracker_cli_loop(int tracker_socket, char *ip_address, char *port)
             printf("Created empty binary file of size %zd bytes\n", fileMetadata->totalByte);
 
             size_t num_seeders = 0;
-            PeerInfo *seederList = request_seeder_by_fileID(tracker_socket, selectedFileID, &num_seeders);
+            PeerInfo *seederList = request_seeder_by_fileID(tracker_socket, selectedFileID, SEEDERS_WANTED, &num_seeders);
 
             if (seederList && num_seeders > 0)
             {
@@ -736,6 +1442,7 @@ void tracker_cli_loop(int tracker_socket, char *ip_address, char *port)
 
                 printf("\nWill connect to first seeder: %s:%s\n", firstSeeder.ip_address, firstSeeder.port);
 
+                request_announce(tracker_socket, ip_address, port, selectedFileID, ANNOUNCE_EVENT_STARTED, 0, fileMetadata->totalByte);
                 disconnect_from_tracker(tracker_socket);
                 int result = leeching(seederList, num_seeders, metaFilePath, bitfieldPath, binary_filepath);
                 if (result == 1) {
@@ -744,6 +1451,7 @@ void tracker_cli_loop(int tracker_socket, char *ip_address, char *port)
                 }
                 tracker_socket = connect_to_tracker();
                 printf("Reconnected to tracker\n");
+                request_announce(tracker_socket, ip_address, port, selectedFileID, ANNOUNCE_EVENT_COMPLETED, fileMetadata->totalByte, 0);
                 free(seederList);
             }
             else
@@ -772,6 +1480,41 @@ void tracker_cli_loop(int tracker_socket, char *ip_address, char *port)
             request_participate_seed_by_fileID(tracker_socket, ip_address, port, input_fileID);
             break;
 
+        case 7:
+            printf("\nEnter fileID:\n");
+            if (!fgets(input, 250, stdin))
+            {
+                printf("Error reading fileID\n");
+                break;
+            }
+            input[strcspn(input, "\n")] = 0;
+            request_unparticipate_seed_by_fileID(tracker_socket, ip_address, port, (ssize_t)atoi(input));
+            break;
+
+        case 8:
+            request_delete_seeder(tracker_socket, ip_address, port);
+            break;
+
+        case 9:
+            printf("\nSearch for:\n");
+            if (!fgets(input, 250, stdin))
+            {
+                printf("Error reading search\n");
+                break;
+            }
+            input[strcspn(input, "\n")] = 0;
+            search_files(tracker_socket, input);
+            break;
+
+        case 10:
+        {
+            char *stats = metrics_text();
+            if (stats)
+                printf("\n%s", stats);
+            free(stats);
+            break;
+        }
+
         case 6:
             disconnect_from_tracker(tracker_socket);
             int listen_fd = setup_seeder_socket(atoi(PEER_1_PORT));
@@ -798,51 +1541,277 @@ void tracker_cli_loop(int tracker_socket, char *ip_address, char *port)
     }
 }
 
-void get_all_available_files(int tracker_socket)
+static int catalog_cache_reserve(CatalogCache *cache, size_t count)
 {
+    if (count <= cache->cap)
+        return 0;
+    size_t cap = cache->cap ? cache->cap : 256;
+    while (cap < count)
+        cap *= 2;
+    FileEntry *grown = realloc(cache->entries, cap * sizeof(FileEntry));
+    if (!grown)
+        return -1;
+    cache->entries = grown;
+    cache->cap = cap;
+    return 0;
+}
 
-    TrackerMessage msg;
-    memset(&msg, 0, sizeof(msg));
+/* CATALOG_CACHE_FILE, or one file per tracker when the catalog is split: catalog.cache.<ip>_<port> */
+static void catalog_cache_path(size_t shard, char *path, size_t size)
+{
+    if (tracker_shards.count == 0)
+    {
+        snprintf(path, size, "%s", CATALOG_CACHE_FILE);
+        return;
+    }
+    TrackerShard tracker = tracker_at(shard);
+    snprintf(path, size, "%s.%s_%d", CATALOG_CACHE_FILE, tracker.ip, tracker.port);
+}
 
-    msg.header.type = MSG_REQUEST_ALL_AVAILABLE_SEED;
-    msg.header.bodySize = 0;
+/*
+@brief Loads the cache file of tracker `shard` once: ssize_t cursor, then every cached FileEntry
+A missing or unreadable cache just means we start from cursor 0.
+*/
+static void catalog_cache_load(size_t shard)
+{
+    CatalogCache *cache = &catalog_caches[shard];
+    if (cache->loaded)
+        return;
+    cache->loaded = 1;
 
-    if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0)
-    {
-        perror("ERROR writing header (ALL_AVAILABLE_SEED)");
+    char path[256];
+    catalog_cache_path(shard, path, sizeof(path));
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
         return;
+
+    ssize_t cursor = 0;
+    FileEntry entry;
+    if (fread(&cursor, sizeof(cursor), 1, fp) == 1)
+    {
+        while (fread(&entry, sizeof(entry), 1, fp) == 1)
+        {
+            if (catalog_cache_reserve(cache, cache->count + 1) < 0)
+                break;
+            cache->entries[cache->count++] = entry;
+        }
+        cache->cursor = (ssize_t)cache->count == cursor ? cursor : 0;
+        if (cache->cursor == 0)
+            cache->count = 0; // cache does not match its cursor, pull everything again
     }
+    fclose(fp);
+}
 
-    size_t fileCount = 0;
-    ssize_t rc = read(tracker_socket, &fileCount, sizeof(fileCount));
-    if (rc <= 0)
+/* Appends the entries from index `from` on to the cache file, then updates the cursor in front */
+static void catalog_cache_save(size_t shard, size_t from)
+{
+    const CatalogCache *cache = &catalog_caches[shard];
+    char path[256];
+    catalog_cache_path(shard, path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0)
+        return; // the cache only saves traffic, running without it is fine
+    if (from == 0)
+        ftruncate(fd, 0);
+
+    off_t offset = (off_t)(sizeof(ssize_t) + from * sizeof(FileEntry));
+    size_t bytes = (cache->count - from) * sizeof(FileEntry);
+    if (pwrite(fd, cache->entries + from, bytes, offset) == (ssize_t)bytes)
+        pwrite(fd, &cache->cursor, sizeof(cache->cursor), 0);
+    close(fd);
+}
+
+/*
+@brief Brings the cached catalog of tracker `shard` up to date: asks for the entries after our cursor, page by page.
+A first sync pulls the whole catalog, later ones only the files added since.
+@return number of new entries, -1 on error
+*/
+static ssize_t sync_catalog_shard(int tracker_socket, size_t shard)
+{
+    CatalogCache *cache = &catalog_caches[shard];
+    catalog_cache_load(shard);
+    size_t before = cache->count;
+
+    for (;;)
     {
-        char textBuf[256];
-        memset(textBuf, 0, sizeof(textBuf));
-        rc = read(tracker_socket, textBuf, sizeof(textBuf) - 1);
-        if (rc > 0)
+        TrackerMessage msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.header.type = MSG_REQUEST_ALL_AVAILABLE_SEED;
+        msg.header.bodySize = sizeof(CatalogPageRequest);
+        msg.body.catalogPage.cursor = cache->cursor;
+        msg.body.catalogPage.maxEntries = CATALOG_PAGE_WANTED;
+
+        if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0 ||
+            write(tracker_socket, &msg.body.catalogPage, sizeof(CatalogPageRequest)) < 0)
         {
-            printf("Tracker says: %s\n", textBuf);
+            perror("ERROR writing catalog request");
+            return -1;
         }
-        else
+
+        TrackerMessageHeader header;
+        CatalogPageHeader page;
+        if (read_exact(tracker_socket, &header, sizeof(header)) < 0 || header.type != MSG_ACK_CATALOG_PAGE ||
+            header.bodySize < (ssize_t)sizeof(page) || read_exact(tracker_socket, &page, sizeof(page)) < 0 ||
+            page.count < 0 || header.bodySize != (ssize_t)(sizeof(page) + page.count * sizeof(FileEntry)))
         {
-            perror("ERROR reading from tracker (ALL_AVAILABLE_SEED)");
+            fprintf(stderr, "ERROR reading catalog page from tracker\n");
+            return -1;
         }
-        return;
+
+        if (page.catalogVersion < cache->cursor)
+        {
+            // the tracker catalog is older than our cache (it was reset), start over
+            FileEntry discard;
+            for (ssize_t i = 0; i < page.count; i++)
+                if (read_exact(tracker_socket, &discard, sizeof(discard)) < 0)
+                    return -1;
+            cache->count = 0;
+            cache->cursor = 0;
+            before = 0;
+            continue;
+        }
+
+        if (catalog_cache_reserve(cache, cache->count + (size_t)page.count) < 0 ||
+            read_exact(tracker_socket, cache->entries + cache->count, (size_t)page.count * sizeof(FileEntry)) < 0)
+        {
+            fprintf(stderr, "ERROR reading catalog entries from tracker\n");
+            return -1;
+        }
+        cache->count += (size_t)page.count;
+        cache->cursor = page.nextCursor;
+
+        if (page.count == 0 || cache->cursor >= page.catalogVersion)
+            break;
     }
 
-    printf("Tracker says there are %zu files.\n", fileCount);
-    for (size_t i = 0; i < fileCount; i++)
+    if (cache->count != before || before == 0)
+        catalog_cache_save(shard, before);
+    return (ssize_t)(cache->count - before);
+}
+
+/*
+@brief Syncs the catalog of every tracker, each one lists the files it owns
+@return 0 on success, -1 when a tracker could not be reached
+*/
+static int sync_catalog(int tracker_socket)
+{
+    size_t total = 0, added = 0;
+    for (size_t shard = 0; shard < tracker_count(); shard++)
     {
-        FileEntry entry;
-        rc = read(tracker_socket, &entry, sizeof(entry));
-        if (rc <= 0)
+        int shard_socket = tracker_socket_for_shard(tracker_socket, shard);
+        ssize_t n = shard_socket < 0 ? -1 : sync_catalog_shard(shard_socket, shard);
+        if (n < 0)
+            return -1;
+        added += (size_t)n;
+        total += catalog_caches[shard].count;
+    }
+    printf("Catalog: %zu files (%zu new since last sync).\n", total, added);
+    return 0;
+}
+
+static size_t catalog_total(void)
+{
+    size_t total = 0;
+    for (size_t shard = 0; shard < tracker_count(); shard++)
+        total += catalog_caches[shard].count;
+    return total;
+}
+
+static void print_catalog(void)
+{
+    printf("Tracker says there are %zu files.\n", catalog_total());
+    for (size_t shard = 0; shard < tracker_count(); shard++)
+    {
+        const CatalogCache *cache = &catalog_caches[shard];
+        for (size_t i = 0; i < cache->count; i++)
         {
-            perror("ERROR reading file entry from tracker");
-            return;
+            printf(" -> FileID: %04zd TotalByte: %zd MetaFile: %s\n",
+                   cache->entries[i].fileID, cache->entries[i].totalBytes, cache->entries[i].metaFilename);
         }
-        printf(" -> FileID: %04zd TotalByte: %zd MetaFile: %s\n",
-               entry.fileID, entry.totalBytes, entry.metaFilename);
+    }
+}
+
+/* Cached catalog entry of fileID, looked up in the catalog of the tracker owning it */
+static const FileEntry *catalog_lookup(ssize_t fileID)
+{
+    const CatalogCache *cache = &catalog_caches[shard_for_file(&tracker_shards, fileID)];
+    for (size_t i = 0; i < cache->count; i++)
+        if (cache->entries[i].fileID == fileID)
+            return &cache->entries[i];
+    return NULL;
+}
+
+void get_all_available_files(int tracker_socket)
+{
+    if (sync_catalog(tracker_socket) < 0)
+        return;
+    print_catalog();
+}
+
+/* MSG_REQUEST_SEARCH to one tracker. Returns how many fileIDs were stored (at most max), -1 on error */
+static ssize_t search_shard(int tracker_socket, const char *query, ssize_t *fileIDs, ssize_t max)
+{
+    TrackerMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.header.type = MSG_REQUEST_SEARCH;
+    msg.header.bodySize = sizeof(SearchRequest);
+    strncpy(msg.body.search.query, query, sizeof(msg.body.search.query) - 1);
+    msg.body.search.maxResults = max;
+
+    if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0 ||
+        write(tracker_socket, &msg.body.search, sizeof(SearchRequest)) < 0)
+    {
+        perror("ERROR writing search request");
+        return -1;
+    }
+
+    TrackerMessageHeader header;
+    ssize_t count = 0;
+    if (read_exact(tracker_socket, &header, sizeof(header)) < 0 || header.type != MSG_ACK_SEARCH ||
+        read_exact(tracker_socket, &count, sizeof(count)) < 0 || count < 0 || count > max ||
+        header.bodySize != (ssize_t)(sizeof(count) + count * sizeof(ssize_t)) ||
+        read_exact(tracker_socket, fileIDs, count * sizeof(ssize_t)) < 0)
+    {
+        fprintf(stderr, "ERROR reading search reply from tracker\n");
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * @brief Asks every tracker for the files whose name contains query and prints them
+ *
+ * The trackers only return fileIDs, names and sizes come from our catalog cache.
+ */
+void search_files(int tracker_socket, const char *query)
+{
+    ssize_t count = 0;
+    ssize_t fileIDs[SEARCH_RESULTS_WANTED];
+    for (size_t shard = 0; shard < tracker_count() && count < SEARCH_RESULTS_WANTED; shard++)
+    {
+        int shard_socket = tracker_socket_for_shard(tracker_socket, shard);
+        ssize_t n = shard_socket < 0 ? -1 : search_shard(shard_socket, query, fileIDs + count, SEARCH_RESULTS_WANTED - count);
+        if (n < 0)
+            return;
+        count += n;
+    }
+
+    if (count == 0)
+    {
+        printf("No file matches \"%s\".\n", query);
+        return;
+    }
+    if (sync_catalog(tracker_socket) < 0)
+        return;
+
+    printf("%zd file(s) match \"%s\":\n", count, query);
+    for (ssize_t i = 0; i < count; i++)
+    {
+        const FileEntry *entry = catalog_lookup(fileIDs[i]);
+        if (entry)
+            printf(" -> FileID: %04zd TotalByte: %zd MetaFile: %s\n", entry->fileID, entry->totalBytes, entry->metaFilename);
+        else
+            printf(" -> FileID: %04zd\n", fileIDs[i]);
     }
 }
 
@@ -868,55 +1837,13 @@ void get_all_available_files(int tracker_socket)
 
 char *get_metadata_via_cli(int tracker_socket, ssize_t *selectedFileID)
 {
-    TrackerMessage msg;
-    memset(&msg, 0, sizeof(msg));
-
-    msg.header.type = MSG_REQUEST_ALL_AVAILABLE_SEED;
-    msg.header.bodySize = 0;
-
-    FileEntry *entries = NULL;
     char *metafile_directory = NULL;
     FILE *metafile_fp = NULL;
 
-    if (write(tracker_socket, &msg.header, sizeof(msg.header)) < 0)
-    {
-        perror("ERROR writing header (ALL_AVAILABLE_SEED)");
+    // Only the files added since our last sync cross the network
+    if (sync_catalog(tracker_socket) < 0)
         goto cleanup;
-    }
-
-    size_t fileCount = 0;
-    ssize_t rc = read(tracker_socket, &fileCount, sizeof(fileCount));
-    if (rc <= 0)
-    {
-        char textBuf[256] = {0};
-        rc = read(tracker_socket, textBuf, sizeof(textBuf) - 1);
-        if (rc > 0)
-            printf("Tracker says: %s\n", textBuf);
-        else
-            perror("ERROR reading from tracker (ALL_AVAILABLE_SEED)");
-        goto cleanup;
-    }
-
-    entries = malloc(fileCount * sizeof(FileEntry));
-    if (!entries)
-    {
-        fprintf(stderr, "Memory allocation failed\n");
-        goto cleanup;
-    }
-
-    printf("Tracker says there are %zu files.\n", fileCount);
-    for (size_t i = 0; i < fileCount; i++)
-    {
-        rc = read(tracker_socket, &entries[i], sizeof(FileEntry));
-        if (rc <= 0)
-        {
-            perror("ERROR reading file entry from tracker");
-            goto cleanup;
-        }
-
-        printf(" -> FileID: %04zd TotalByte: %zd MetaFile: %s\n",
-               entries[i].fileID, entries[i].totalBytes, entries[i].metaFilename);
-    }
+    print_catalog();
 
     printf("\nEnter fileID to print its metaFilename:\n");
     char input[256];
@@ -928,15 +1855,8 @@ char *get_metadata_via_cli(int tracker_socket, ssize_t *selectedFileID)
     input[strcspn(input, "\n")] = 0;
     *selectedFileID = atoi(input);
 
-    const char *metaFilename = NULL;
-    for (size_t i = 0; i < fileCount; i++)
-    {
-        if (entries[i].fileID == *selectedFileID)
-        {
-            metaFilename = entries[i].metaFilename;
-            break;
-        }
-    }
+    const FileEntry *entry = catalog_lookup(*selectedFileID);
+    const char *metaFilename = entry ? entry->metaFilename : NULL;
 
     if (!metaFilename)
     {
@@ -946,8 +1866,12 @@ char *get_metadata_via_cli(int tracker_socket, ssize_t *selectedFileID)
 
     printf("📄 metaFilename for fileID %zd: %s\n", *selectedFileID, metaFilename);
 
+    // The metadata lives with the tracker that owns the file
     FileMetadata fileMetaData;
-    request_metadata_by_filename(tracker_socket, metaFilename, &fileMetaData);
+    int owner_socket = tracker_for_file(tracker_socket, *selectedFileID);
+    if (owner_socket < 0)
+        goto cleanup;
+    request_metadata_by_filename(owner_socket, metaFilename, &fileMetaData);
 
     metafile_directory = malloc(256);
     if (!metafile_directory)
@@ -971,14 +1895,11 @@ char *get_metadata_via_cli(int tracker_socket, ssize_t *selectedFileID)
     }
 
     fclose(metafile_fp);
-    free(entries);
 
     *selectedFileID = fileMetaData.fileID;
     return metafile_directory;
 
 cleanup:
-    if (entries)
-        free(entries);
     if (metafile_fp)
         fclose(metafile_fp);
     if (metafile_directory)
@@ -1185,6 +2106,14 @@ int main()
     memset(peer_ctx, 0, sizeof(PeerContext));
     peer_ctx->current_state = Peer_FSM_INIT;
 
+    // Log lines go through the drain thread, PEER_LOG_LEVEL=debug|info|warn|error picks the level
+    const char *log_level = getenv("PEER_LOG_LEVEL");
+    int level = log_level ? logger_parse_level(log_level) : -1;
+    logger_init(NULL, level < 0 ? LOG_LEVEL_INFO : level);
+
+    if (metrics_init(peer_counter_names, PEER_COUNTER_COUNT, peer_timer_names, PEER_TIMER_COUNT) == 0)
+        metrics_start_dump(PEER_METRICS_FILE, PEER_METRICS_INTERVAL);
+
     peer_fsm_handler();
 
     while (peer_ctx->current_state != Peer_FSM_CLOSING)
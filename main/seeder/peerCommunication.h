@@ -36,6 +36,8 @@ typedef enum PeerMessageType
     MSG_ACK_REQUEST_CHUNK,
     MSG_SEND_CHUNK,
     MSG_ACK_SEND_CHUNK,
+    MSG_REQUEST_PEER_STATS, // no body, answered by MSG_ACK_PEER_STATS with bodySize bytes of JSON (metrics.h)
+    MSG_ACK_PEER_STATS,
 } PeerMessageType;
 
 // Define the simple structures first
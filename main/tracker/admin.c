@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "admin.h"
+#include "parser.h"
+
+static int admin_socket = -1;
+static pthread_t admin_thread;
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static int send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void run_command(int fd, char *line)
+{
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[strspn(line, " \t")] == '\0')
+        return; // blank line
+
+    ASTNode *ast = parse_command(line);
+    if (!ast)
+    {
+        send_all(fd, "ERR invalid command syntax\n", 27);
+        return;
+    }
+    printf("[admin] %s\n", line);
+    const char *error = execute_ast(ast, fd, NULL);
+    free_ast(ast);
+    if (!error)
+    {
+        send_all(fd, "OK\n", 3);
+        return;
+    }
+    char reply[128];
+    int len = snprintf(reply, sizeof(reply), "ERR %s\n", error);
+    send_all(fd, reply, (size_t)len);
+}
+
+/* Reads commands off one admin connection until it closes */
+static void serve_client(int fd)
+{
+    char buf[ADMIN_LINE_MAX];
+    size_t len = 0;
+
+    for (;;)
+    {
+        ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += (size_t)n;
+        buf[len] = '\0';
+
+        char *line = buf, *nl;
+        while ((nl = strchr(line, '\n')))
+        {
+            *nl = '\0';
+            run_command(fd, line);
+            line = nl + 1;
+        }
+
+        len -= (size_t)(line - buf);
+        memmove(buf, line, len);
+        if (len == sizeof(buf) - 1)
+        {
+            send_all(fd, "ERR line too long\n", 18);
+            len = 0;
+        }
+    }
+
+    if (len > 0) // last command without a newline
+    {
+        buf[len] = '\0';
+        run_command(fd, buf);
+    }
+}
+
+static void *admin_main(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        int fd = accept(admin_socket, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("admin: accept");
+            return NULL;
+        }
+        serve_client(fd);
+        close(fd);
+    }
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int admin_start(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "admin: socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    admin_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (admin_socket < 0)
+    {
+        perror("admin: socket");
+        return -1;
+    }
+
+    // Command output is written through stdio, a client hanging up must not SIGPIPE the tracker
+    signal(SIGPIPE, SIG_IGN);
+
+    unlink(path); // left over from a previous run
+    mode_t old_mask = umask(0177);
+    int rc = bind(admin_socket, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (rc < 0 || listen(admin_socket, 8) < 0)
+    {
+        perror("admin: bind/listen");
+        close(admin_socket);
+        admin_socket = -1;
+        return -1;
+    }
+
+    if (pthread_create(&admin_thread, NULL, admin_main, NULL) != 0)
+    {
+        perror("admin: pthread_create");
+        close(admin_socket);
+        admin_socket = -1;
+        return -1;
+    }
+    pthread_detach(admin_thread);
+
+    printf("Admin commands on %s\n", path);
+    return 0;
+}
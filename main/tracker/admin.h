@@ -0,0 +1,24 @@
+#ifndef ADMIN_H
+#define ADMIN_H
+
+/*
+@brief Live admin channel: policy commands while the tracker serves peers
+
+A local Unix stream socket that takes the same grammar as the command mode, one command per line:
+    $ socat - UNIX-CONNECT:tracker.admin.sock
+    BLOCK IP 10.0.0.7
+    GET BLOCKED PEER
+    STATS
+Each command's output is sent back, followed by a line "OK", or "ERR <reason>" when it does not parse
+or fails (bad IP address or filehash, unknown region, unreadable rules file, out of memory).
+Rule changes are published as a new policy snapshot (policy.h), the workers never wait for them.
+The socket is created mode 0600, only the tracker's user can connect.
+*/
+
+#define ADMIN_SOCKET_FILE "tracker.admin.sock"
+#define ADMIN_LINE_MAX 4096
+
+/* Binds path and starts the admin thread. Returns 0, or -1 when the socket could not be set up */
+int admin_start(const char *path);
+
+#endif // ADMIN_H
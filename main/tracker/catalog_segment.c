@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "catalog_segment.h"
+
+#define CATALOG_SEGMENT_RESERVE ((size_t)1 << 38) // address space reserved up front, only the file size is backed
+#define CATALOG_SEGMENT_MIN_RESERVE ((size_t)64 << 20)
+#define CATALOG_SEGMENT_GROW ((size_t)1 << 20) // the file grows in 1 MB steps
+
+static int segment_fd = -1;
+static uint8_t *segment_base;
+static size_t segment_reserved; // bytes mapped
+static size_t segment_bytes;    // current file size
+static size_t segment_records;  // atomic, fileIDs below this are backed by the file
+static size_t segment_count;    // atomic, present records
+static CatalogSegmentHeader segment_header; // last header written, writers only
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint32_t crc32_bytes(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    uint32_t crc = 0xffffffffu;
+    while (len--)
+    {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static uint32_t header_crc(const CatalogSegmentHeader *header)
+{
+    return crc32_bytes(header, offsetof(CatalogSegmentHeader, crc));
+}
+
+static int header_valid(const CatalogSegmentHeader *header)
+{
+    return memcmp(header->magic, CATALOG_SEGMENT_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == CATALOG_SEGMENT_VERSION &&
+           header->recordSize == sizeof(CatalogEntry) &&
+           header->crc == header_crc(header);
+}
+
+static CatalogEntry *record_at(size_t fileID)
+{
+    return (CatalogEntry *)(segment_base + CATALOG_SEGMENT_HEADER_SIZE + fileID * sizeof(CatalogEntry));
+}
+
+/* msync wants a page aligned start */
+static int sync_range(const void *addr, size_t len)
+{
+    static size_t page_size;
+    if (!page_size)
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    uintptr_t start = (uintptr_t)addr & ~(page_size - 1);
+    return msync((void *)start, (uintptr_t)addr + len - start, MS_SYNC);
+}
+
+/* Writes the header over the older of the two copies */
+static int write_header(int sync)
+{
+    segment_header.sequence++;
+    segment_header.count = __atomic_load_n(&segment_count, __ATOMIC_RELAXED);
+    segment_header.crc = header_crc(&segment_header);
+
+    uint8_t *slot = segment_base + (segment_header.sequence & 1) * CATALOG_SEGMENT_HEADER_SLOT;
+    memcpy(slot, &segment_header, sizeof(segment_header));
+    return sync ? sync_range(slot, sizeof(segment_header)) : 0;
+}
+
+/* Extends the file so that fileID has backing storage */
+static int segment_grow(size_t fileID)
+{
+    size_t need = CATALOG_SEGMENT_HEADER_SIZE + (fileID + 1) * sizeof(CatalogEntry);
+    if (need <= segment_bytes)
+        return 0;
+    if (need > segment_reserved)
+    {
+        fprintf(stderr, "catalog segment: fileID %zu is beyond the reserved mapping\n", fileID);
+        return -1;
+    }
+
+    size_t bytes = (need + CATALOG_SEGMENT_GROW - 1) / CATALOG_SEGMENT_GROW * CATALOG_SEGMENT_GROW;
+    if (bytes > segment_reserved)
+        bytes = segment_reserved;
+    if (ftruncate(segment_fd, (off_t)bytes) < 0)
+    {
+        perror("catalog segment: ftruncate");
+        return -1;
+    }
+    segment_bytes = bytes;
+    __atomic_store_n(&segment_records, (bytes - CATALOG_SEGMENT_HEADER_SIZE) / sizeof(CatalogEntry), __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Both header copies are unreadable: rebuild the counters from the records themselves */
+static void recover_header(size_t records)
+{
+    fprintf(stderr, "catalog segment: no valid header, rebuilding it from %zu record slot(s)\n", records);
+    memset(&segment_header, 0, sizeof(segment_header));
+    memcpy(segment_header.magic, CATALOG_SEGMENT_MAGIC, sizeof(segment_header.magic));
+    segment_header.version = CATALOG_SEGMENT_VERSION;
+    segment_header.recordSize = sizeof(CatalogEntry);
+    segment_header.nextFileID = 1;
+
+    size_t count = 0;
+    for (size_t id = 0; id < records; id++)
+    {
+        if (record_at(id)->present)
+        {
+            count++;
+            segment_header.nextFileID = (int64_t)id + 1;
+        }
+    }
+    segment_count = count;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int catalog_segment_open(const char *path)
+{
+    segment_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (segment_fd < 0)
+    {
+        perror("catalog segment: open");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(segment_fd, &st) < 0)
+    {
+        perror("catalog segment: fstat");
+        return -1;
+    }
+    int created = st.st_size == 0;
+    if (!created && st.st_size < CATALOG_SEGMENT_HEADER_SIZE)
+    {
+        fprintf(stderr, "catalog segment: %s is truncated\n", path);
+        return -1;
+    }
+
+    // Reserve the address range once so records never move, fall back to less where VA space is scarce
+    for (segment_reserved = CATALOG_SEGMENT_RESERVE; segment_reserved >= CATALOG_SEGMENT_MIN_RESERVE; segment_reserved >>= 1)
+    {
+        void *base = mmap(NULL, segment_reserved, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, segment_fd, 0);
+        if (base != MAP_FAILED)
+        {
+            segment_base = base;
+            break;
+        }
+    }
+    if (!segment_base)
+    {
+        perror("catalog segment: mmap");
+        return -1;
+    }
+
+    if (created)
+    {
+        if (ftruncate(segment_fd, CATALOG_SEGMENT_HEADER_SIZE) < 0)
+        {
+            perror("catalog segment: ftruncate");
+            return -1;
+        }
+        segment_bytes = CATALOG_SEGMENT_HEADER_SIZE;
+        memcpy(segment_header.magic, CATALOG_SEGMENT_MAGIC, sizeof(segment_header.magic));
+        segment_header.version = CATALOG_SEGMENT_VERSION;
+        segment_header.recordSize = sizeof(CatalogEntry);
+        segment_header.nextFileID = 1;
+        return write_header(1) < 0 ? -1 : 1;
+    }
+
+    if ((size_t)st.st_size > segment_reserved)
+    {
+        fprintf(stderr, "catalog segment: %s is larger than the mapping\n", path);
+        return -1;
+    }
+    segment_bytes = (size_t)st.st_size;
+    size_t records = (segment_bytes - CATALOG_SEGMENT_HEADER_SIZE) / sizeof(CatalogEntry);
+
+    const CatalogSegmentHeader *a = (const CatalogSegmentHeader *)segment_base;
+    const CatalogSegmentHeader *b = (const CatalogSegmentHeader *)(segment_base + CATALOG_SEGMENT_HEADER_SLOT);
+    int a_ok = header_valid(a), b_ok = header_valid(b);
+    if (a_ok && (!b_ok || a->sequence > b->sequence))
+        segment_header = *a;
+    else if (b_ok)
+        segment_header = *b;
+    else
+        recover_header(records);
+    if (a_ok || b_ok)
+        segment_count = segment_header.count;
+
+    // Records committed after the last header write can only sit in the tail the file grew for them
+    for (size_t id = (size_t)segment_header.nextFileID; id < records; id++)
+    {
+        if (record_at(id)->present)
+        {
+            segment_count++;
+            segment_header.nextFileID = (int64_t)id + 1;
+        }
+    }
+
+    segment_records = records;
+    return 0;
+}
+
+const CatalogEntry *catalog_segment_get(ssize_t fileID)
+{
+    if (fileID < 0 || (size_t)fileID >= __atomic_load_n(&segment_records, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    const CatalogEntry *record = record_at((size_t)fileID);
+    if (!__atomic_load_n(&record->present, __ATOMIC_ACQUIRE))
+        return NULL;
+    return record;
+}
+
+int catalog_segment_put(const FileEntry *entry, const FileMetadata *meta, int sync)
+{
+    if (entry->fileID < 0 || segment_grow((size_t)entry->fileID) < 0)
+        return -1;
+
+    CatalogEntry *record = record_at((size_t)entry->fileID);
+    if (record->present)
+        return -1; // records are immutable once written
+
+    // 1) the record body reaches the disk first
+    memset(record, 0, sizeof(*record));
+    record->version = (uint32_t)(__atomic_load_n(&segment_count, __ATOMIC_RELAXED) + 1);
+    record->entry = *entry;
+    record->meta = *meta;
+    if (sync && sync_range(record, sizeof(*record)) < 0)
+    {
+        perror("catalog segment: msync record");
+        return -1;
+    }
+
+    // 2) then the flag that makes it visible, readers and recovery only trust present records
+    __atomic_store_n(&record->present, 1, __ATOMIC_RELEASE);
+    if (sync && sync_range(&record->present, sizeof(record->present)) < 0)
+    {
+        perror("catalog segment: msync record");
+        return -1;
+    }
+    __atomic_add_fetch(&segment_count, 1, __ATOMIC_RELAXED);
+
+    if (entry->fileID >= segment_header.nextFileID)
+        segment_header.nextFileID = entry->fileID + 1;
+    if (write_header(sync) < 0)
+    {
+        perror("catalog segment: msync header");
+        return -1;
+    }
+    return 0;
+}
+
+int catalog_segment_sync(void)
+{
+    if (msync(segment_base, segment_bytes, MS_SYNC) < 0 || write_header(1) < 0)
+    {
+        perror("catalog segment: msync");
+        return -1;
+    }
+    return 0;
+}
+
+ssize_t catalog_segment_next_id(void)
+{
+    return (ssize_t)segment_header.nextFileID;
+}
+
+size_t catalog_segment_count(void)
+{
+    return __atomic_load_n(&segment_count, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,64 @@
+#ifndef CATALOG_SEGMENT_H
+#define CATALOG_SEGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "database.h" // CatalogEntry
+
+/*
+@brief Packed, memory-mapped catalog: every registered file in one segment file
+
+Layout of the segment
+    [0, 4096)              header page, two CatalogSegmentHeader copies (offset 0 and 512)
+    4096 + fileID * record  one fixed size CatalogEntry per fileID
+
+The fileID is the offset index: the record of a file sits at a position computed from its ID,
+unused IDs are holes in a sparse file. Opening a segment maps it and reads the header,
+nothing is scanned, so a cold start costs the same for 10 files or 10 million.
+
+Crash safety
+    - a record is written and synced before its present flag is set and synced,
+      so a present record is always complete
+    - records are numbered in commit order (CatalogEntry.version), the catalog version is the header count
+    - the header is written to the older of its two copies, each copy carries a crc,
+      a torn header write leaves the other copy intact
+    - IDs committed after the last header write are found by probing forward from the header
+
+The whole reserved range is mapped once, records never move: catalog_segment_get() is lock free.
+Writers (catalog_segment_put) must be serialized by the caller.
+*/
+
+#define CATALOG_SEGMENT_MAGIC "BMCATSEG"
+#define CATALOG_SEGMENT_VERSION 1
+#define CATALOG_SEGMENT_HEADER_SIZE 4096
+#define CATALOG_SEGMENT_HEADER_SLOT 512 // distance between the two header copies
+
+typedef struct CatalogSegmentHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize; // sizeof(CatalogEntry) when the segment was created
+    uint64_t sequence;   // bumped on every header write, the valid copy with the highest one wins
+    int64_t nextFileID;  // next fileID to hand out
+    uint64_t count;      // present records
+    uint32_t crc;        // crc32 of everything above
+    uint32_t reserved;
+} CatalogSegmentHeader;
+
+/* Maps the segment at path, creating an empty one if needed. Returns 1 when created, 0 when opened, -1 on error */
+int catalog_segment_open(const char *path);
+/* Lock free. NULL when fileID has no record */
+const CatalogEntry *catalog_segment_get(ssize_t fileID);
+/*
+Writes the record of entry->fileID. With sync set the record and the header are on disk when it returns,
+bulk loaders pass 0 and call catalog_segment_sync() once at the end.
+Returns 0, or -1 on error / when the fileID is taken
+*/
+int catalog_segment_put(const FileEntry *entry, const FileMetadata *meta, int sync);
+/* Flushes every record and the header */
+int catalog_segment_sync(void);
+ssize_t catalog_segment_next_id(void);
+size_t catalog_segment_count(void);
+
+#endif // CATALOG_SEGMENT_H
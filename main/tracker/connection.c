@@ -0,0 +1,207 @@
+#include "tracker.h"
+
+/*
+Buffered, non-blocking I/O for a single peer connection.
+
+The event loop calls conn_fill() when the socket is readable and then peels complete
+messages off conn->rbuf. Handlers never call write() directly anymore, they queue
+bytes with conn_write() and the loop pushes them out with conn_flush().
+This is what lets one thread keep thousands of peers in flight.
+Both buffers are bounded: a wakeup reads at most CONN_READ_BUDGET bytes (CONN_RBUF_MAX buffered),
+and a peer that queues more than CONN_WBUF_MAX bytes of replies without reading them is dropped.
+*/
+
+int conn_set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0)
+        return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+TrackerConnection *conn_create(int fd, TrackerWorker *worker, const PeerInfo *peer)
+{
+    TrackerConnection *conn = calloc(1, sizeof(TrackerConnection));
+    if (!conn)
+        return NULL;
+
+    conn->fd = fd;
+    conn->worker = worker;
+    conn->client_peer = *peer;
+    conn->state = Conn_FSM_READ_HEADER;
+    conn->want_read = 1;
+    return conn;
+}
+
+void conn_destroy(TrackerConnection *conn)
+{
+    if (!conn)
+        return;
+    free(conn->rbuf);
+    free(conn->wbuf);
+    free(conn);
+}
+
+/* Grow a buffer so that it can hold at least `need` bytes */
+static int conn_reserve(char **buf, size_t *cap, size_t need)
+{
+    if (*cap >= need)
+        return 0;
+
+    size_t new_cap = *cap ? *cap : CONN_READ_CHUNK;
+    while (new_cap < need)
+        new_cap *= 2;
+
+    char *grown = realloc(*buf, new_cap);
+    if (!grown)
+        return -1;
+    *buf = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+/**
+ * @brief Reads up to CONN_READ_BUDGET bytes of the socket into the read buffer.
+ *        What is left stays in the socket, epoll reports it again on the next round.
+ *
+ * @return  1 when new bytes were appended
+ *          0 when the peer closed the connection
+ *         -1 on a socket error (ECONNRESET etc.), or a full read buffer
+ *          2 when there was nothing to read (EAGAIN)
+ */
+int conn_fill(TrackerConnection *conn)
+{
+    size_t got = 0;
+    int rc = 1;
+
+    if (conn->rlen >= CONN_RBUF_MAX)
+    {
+        // Only reachable while requests wait on a backed up write buffer and the peer keeps sending
+        LOG_WARN("Peer %s:%s filled its read buffer, closing connection", conn->client_peer.ip_address, conn->client_peer.port);
+        return -1;
+    }
+
+    while (got < CONN_READ_BUDGET && conn->rlen < CONN_RBUF_MAX)
+    {
+        if (conn_reserve(&conn->rbuf, &conn->rcap, conn->rlen + CONN_READ_CHUNK) < 0)
+        {
+            rc = -1;
+            break;
+        }
+
+        size_t room = conn->rcap - conn->rlen;
+        if (room > CONN_READ_BUDGET - got)
+            room = CONN_READ_BUDGET - got;
+        if (room > CONN_RBUF_MAX - conn->rlen)
+            room = CONN_RBUF_MAX - conn->rlen;
+        ssize_t n = read(conn->fd, conn->rbuf + conn->rlen, room);
+        if (n > 0)
+        {
+            conn->rlen += n;
+            got += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            rc = 0;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            rc = got ? 1 : 2;
+        else
+            rc = -1;
+        break;
+    }
+
+    if (got)
+        metrics_add(METRIC_BYTES_IN, got);
+    return rc;
+}
+
+/* Drop the first nbytes of the read buffer once they have been handled */
+void conn_consume(TrackerConnection *conn, size_t nbytes)
+{
+    if (nbytes >= conn->rlen)
+    {
+        conn->rlen = 0;
+        // idle connections should not pin big buffers
+        if (conn->rcap > CONN_READ_CHUNK * 4)
+        {
+            free(conn->rbuf);
+            conn->rbuf = NULL;
+            conn->rcap = 0;
+        }
+        return;
+    }
+    memmove(conn->rbuf, conn->rbuf + nbytes, conn->rlen - nbytes);
+    conn->rlen -= nbytes;
+}
+
+/* Queue bytes for the peer. Returns 0 on success, -1 if we ran out of memory or the peer
+   stopped reading (past CONN_WBUF_MAX, the connection is then closed) */
+int conn_write(TrackerConnection *conn, const void *data, size_t len)
+{
+    if (len == 0)
+        return 0;
+    if (conn->wlen - conn->wpos + len > CONN_WBUF_MAX)
+    {
+        if (conn->state != Conn_FSM_CLOSING)
+            LOG_WARN("Peer %s:%s is not reading its replies, closing connection", conn->client_peer.ip_address, conn->client_peer.port);
+        conn->state = Conn_FSM_CLOSING;
+        return -1;
+    }
+
+    // Compact before growing, most of the time the buffer is already flushed.
+    // A slow reader that never drains it fully must not grow it either
+    if (conn->wpos > 0 && (conn->wpos == conn->wlen || conn->wlen + len > conn->wcap))
+    {
+        memmove(conn->wbuf, conn->wbuf + conn->wpos, conn->wlen - conn->wpos);
+        conn->wlen -= conn->wpos;
+        conn->wpos = 0;
+    }
+
+    if (conn_reserve(&conn->wbuf, &conn->wcap, conn->wlen + len) < 0)
+        return -1;
+
+    memcpy(conn->wbuf + conn->wlen, data, len);
+    conn->wlen += len;
+    return 0;
+}
+
+/**
+ * @brief Pushes as much of the write buffer as the socket accepts
+ *
+ * @return 1 when everything was written, 0 when the socket is full (wait for EPOLLOUT),
+ *         -1 when the peer is gone
+ */
+int conn_flush(TrackerConnection *conn)
+{
+    size_t sent = 0;
+    while (conn->wpos < conn->wlen)
+    {
+        // MSG_NOSIGNAL - a peer hanging up must not SIGPIPE the whole tracker
+        ssize_t n = send(conn->fd, conn->wbuf + conn->wpos, conn->wlen - conn->wpos, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            conn->wpos += n;
+            sent += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        metrics_add(METRIC_BYTES_OUT, sent);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        return -1;
+    }
+    metrics_add(METRIC_BYTES_OUT, sent);
+
+    conn->wpos = 0;
+    conn->wlen = 0;
+    if (conn->wcap > CONN_READ_CHUNK * 4)
+    {
+        free(conn->wbuf);
+        conn->wbuf = NULL;
+        conn->wcap = 0;
+    }
+    return 1;
+}
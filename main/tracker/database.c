@@ -4,8 +4,13 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/types.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include "database.h"
+#include "tracker.h" // metric ids, logger
 #include "meta.h" // For FileMetadata struct and reading
+#include "catalog_segment.h"
+#include "search_index.h"
 
 // Directory and file definitions
 #define RECORDS_FOLDER "records" 
@@ -15,87 +20,114 @@
 // Forward Declarations
 // --------------------------------------------------------
 static ssize_t get_next_available_fileID(void);
+static void catalog_init_once(void);
+static int catalog_append(const FileEntry *entry, const FileMetadata *meta);
+static int catalog_append_locked(const FileEntry *entry, const FileMetadata *meta);
+static ssize_t catalog_hash_find_locked(const uint8_t *fileHash);
+
+// --------------------------------------------------------
+// Catalog
+//     Every registered file is one fixed size record in the packed segment
+//     CATALOG_SEGMENT_FILE (see catalog_segment.h), mapped once at startup.
+//     Lookups are served from the mapping without a lock or a file open.
+//     Writers (add_new_file / add_file_entry) are serialized by catalog_lock,
+//     a record is on disk before it is visible.
+//     meta.log + records/ are only read once, to import them into a new segment.
+// --------------------------------------------------------
+static ssize_t next_file_id = 1; // atomic, the next fileID handed out by add_new_file()
+static int (*catalog_owns)(ssize_t fileID); // sharded trackers only hold the fileIDs they own, NULL = all
+
+static pthread_once_t catalog_once = PTHREAD_ONCE_INIT;
+// Serializes segment writes, fileID allocation itself is a lock-free counter
+static pthread_mutex_t catalog_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Version index for paginated / delta listings: catalog_order[v - 1] = fileID of version v.
+// Built on the first listing (the segment itself is not scanned at startup), extended on every write.
+static ssize_t *catalog_order;
+static size_t catalog_order_len;
+static size_t catalog_order_cap;
+static int catalog_order_built;
+static pthread_rwlock_t catalog_order_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Dedup index fileHash -> fileID, so the same content always gets the same fileID (one swarm).
+// Open addressing keyed by the first 8 bytes of the hash, the full hash is compared on the record.
+// Built on the first add_new_file(), only used under catalog_lock.
+typedef struct
+{
+    uint64_t key;
+    ssize_t slot; // fileID + 1, 0 = empty bucket
+} CatalogHashSlot;
+
+static CatalogHashSlot *catalog_hashes;
+static size_t catalog_hashes_mask; // size - 1, size is a power of two
+static size_t catalog_hashes_used;
+static int catalog_hashes_built;
 
 // --------------------------------------------------------
 //  1) add_new_file() 
-//     Creates a new fileID, writes the .meta to "records/", 
-//     and appends an entry to meta.log. Returns the fileID.
+//     Creates a new fileID and writes its record (metadata included)
+//     to the catalog segment. Returns the fileID, or the existing fileID
+//     when a file with the same fileHash is already registered.
 //     On error, returns -1.
 // --------------------------------------------------------
 ssize_t add_new_file(const FileMetadata *meta)
 {
+    pthread_once(&catalog_once, catalog_init_once);
+
+    // 0) Same content registered before? Hand out its fileID so every seeder joins one swarm.
+    //    Checked and inserted under catalog_lock, two peers racing with one file still get one ID
+    pthread_mutex_lock(&catalog_lock);
+    ssize_t existingID = catalog_hash_find_locked(meta->fileHash);
+    if (existingID >= 0)
+    {
+        pthread_mutex_unlock(&catalog_lock);
+        LOG_DEBUG("fileHash already registered, reusing fileID %04zd", existingID);
+        return existingID;
+    }
+
     // 1) Figure out the next available fileID
     ssize_t newID = get_next_available_fileID();
     if (newID < 1) {
-        fprintf(stderr, "Failed to get a valid fileID.\n");
+        pthread_mutex_unlock(&catalog_lock);
+        LOG_ERROR("Failed to get a valid fileID");
         return -1;
     }
 
-    // 2) Construct a filename like "0005_originalname.meta"
-    //    or "0005_filename.png.meta" – your choice. 
-    //    Below we show:  0005_<meta->filename>.meta
-    char newFilename[512];
-    snprintf(newFilename, sizeof(newFilename), 
+    // 2) Construct a name like "0005_filename.png.meta", peers still ask
+    //    for metadata by this name, no file with it is written anymore
+    FileEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.fileID = newID;
+    entry.totalBytes = meta->totalByte;
+    snprintf(entry.metaFilename, sizeof(entry.metaFilename),
              "%04zd_%s.meta", newID, meta->filename);
 
-    // 3) Full path in the records folder
-    char fullPath[512];
-    int written = snprintf(fullPath, sizeof(fullPath),
-                           "%s/%s", RECORDS_FOLDER, newFilename);
-    if (written < 0 || written >= (int)sizeof(fullPath)) {
-        fprintf(stderr, "Path truncated or error in snprintf!\n");
-        return -1;
-    }
-
-    // 4) Write the FileMetadata to "records/0005_filename.meta"
-    FILE *fp = fopen(fullPath, "wb");
-    if (!fp) {
-        perror("Error opening new .meta file in records/");
-        return -1;
-    }
-
-    // We'll make a temp copy so we can assign the newID in the struct
+    // 3) Store the FileMetadata with the newID assigned
     FileMetadata temp = *meta;
     temp.fileID = newID;
-
-    if (fwrite(&temp, sizeof(FileMetadata), 1, fp) != 1) {
-        perror("Error writing FileMetadata to file");
-        fclose(fp);
+    uint64_t started = metrics_now_ns();
+    int rc = catalog_append_locked(&entry, &temp);
+    metrics_record(TIMER_CATALOG_APPEND, metrics_now_ns() - started);
+    pthread_mutex_unlock(&catalog_lock);
+    if (rc < 0)
         return -1;
-    }
-    fclose(fp);
-
-    // 5) Append an entry to meta.log
-    //    (This function is from your existing code below.)
-    add_file_entry(newID, temp.totalByte, newFilename);
+    search_index_refresh(); // searchable as soon as the seed is acknowledged
 
-    // 6) Return the newly assigned fileID
+    // 4) Return the newly assigned fileID
     return newID;
 }
 
 // --------------------------------------------------------
 //  2) get_next_available_fileID() 
-//     Scans meta.log for the largest fileID in use, returns maxID+1
+//     Seeded from the segment header at load time, IDs are handed out
+//     by an atomic counter from there on
 // --------------------------------------------------------
 static ssize_t get_next_available_fileID(void)
 {
-    FILE *dbFile = fopen(META_LOG_FILE, "rb");
-    if (!dbFile) {
-        // If meta.log doesn't exist, start at 1
-        return 1;
-    }
-
-    ssize_t maxID = 0;
-    FileEntry entry;
-    while (fread(&entry, sizeof(FileEntry), 1, dbFile) == 1)
-    {
-        if (entry.fileID > maxID) {
-            maxID = entry.fileID;
-        }
-    }
-
-    fclose(dbFile);
-    return maxID + 1;  // Next unused
+    ssize_t id = __atomic_fetch_add(&next_file_id, 1, __ATOMIC_RELAXED);
+    while (catalog_owns && !catalog_owns(id))
+        id = __atomic_fetch_add(&next_file_id, 1, __ATOMIC_RELAXED); // another tracker hands this one out
+    return id;
 }
 
 // --------------------------------------------------------
@@ -122,144 +154,445 @@ int load_single_metadata(const char *filepath, FileMetadata *out)
 
 // --------------------------------------------------------
 //  4) add_file_entry()
-//     Appends an entry to meta.log
+//     Adds an existing records/ .meta file to the catalog
 // --------------------------------------------------------
 void add_file_entry(ssize_t fileID, ssize_t totalBytes,
                     const char *existingMetaFilename)
 {
-    FILE *dbFile = fopen(META_LOG_FILE, "ab"); // Append in binary mode
-    if (!dbFile)
-    {
-        perror("Error opening meta.log for writing");
-        exit(EXIT_FAILURE);
-    }
+    pthread_once(&catalog_once, catalog_init_once);
 
     FileEntry entry;
+    memset(&entry, 0, sizeof(entry));
     entry.fileID = fileID;
     strncpy(entry.metaFilename, existingMetaFilename,
             sizeof(entry.metaFilename));
     entry.metaFilename[sizeof(entry.metaFilename) - 1] = '\0';
     entry.totalBytes = totalBytes;
 
-    fwrite(&entry, sizeof(FileEntry), 1, dbFile);
-    fclose(dbFile);
+    // Cold path (records/ rescan), read the .meta once so the hash is cached too
+    FileMetadata meta;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", RECORDS_FOLDER, entry.metaFilename);
+    if (load_single_metadata(path, &meta) != 0)
+    {
+        memset(&meta, 0, sizeof(meta));
+        meta.fileID = fileID;
+        meta.totalByte = totalBytes;
+    }
 
-    printf("Added fileID: %04zd -> %s to meta.log\n",
-           fileID, entry.metaFilename);
+    if (catalog_append(&entry, &meta) < 0)
+    {
+        LOG_WARN("Could not add fileID %04zd to the catalog", fileID);
+        return;
+    }
+
+    search_index_refresh();
+
+    LOG_DEBUG("Added fileID: %04zd -> %s to the catalog", fileID, entry.metaFilename);
 }
 
 // --------------------------------------------------------
 //  5) list_file_entries()
-//     Reads meta.log and prints all FileEntries
+//     Prints every catalog entry
 // --------------------------------------------------------
 void list_file_entries()
 {
-    FILE *dbFile = fopen(META_LOG_FILE, "rb");
-    if (!dbFile)
-    {
-        perror("Error opening meta.log for reading");
-        exit(EXIT_FAILURE);
-    }
-
-    FileEntry entry;
-    memset(&entry, 0, sizeof(FileEntry));
+    size_t count = 0;
+    FileEntry *entries = load_file_entries(&count);
 
     printf("\nCurrent Database Entries:\n");
     printf("---------------------------\n");
 
-    while (fread(&entry, sizeof(FileEntry), 1, dbFile))
+    for (size_t i = 0; i < count; i++)
     {
         printf("File ID: %04zd, Total Bytes: %zd, Meta File: %s\n",
-               entry.fileID, entry.totalBytes, entry.metaFilename);
+               entries[i].fileID, entries[i].totalBytes, entries[i].metaFilename);
     }
 
-    fclose(dbFile);
+    free(entries);
 }
 
 // --------------------------------------------------------
 //  6) get_meta_filename()
-//     Looks up meta.log for a matching fileID, returns a malloc'ed 
+//     Looks up the catalog for a matching fileID, returns a malloc'ed 
 //     copy of the metaFilename, or NULL if not found
 // --------------------------------------------------------
 char *get_meta_filename(ssize_t fileID)
 {
-    FILE *dbFile = fopen(META_LOG_FILE, "rb");
-    if (!dbFile)
+    const CatalogEntry *entry = catalog_lookup(fileID);
+    if (!entry)
+        return NULL; // Not found
+
+    // Allocate space for the filename
+    char *filename = malloc(strlen(entry->entry.metaFilename) + 1);
+    if (filename)
     {
-        perror("Error opening meta.log for lookup");
+        strcpy(filename, entry->entry.metaFilename);
+    }
+    return filename;
+}
+
+// --------------------------------------------------------
+//  7) load_file_entries()
+//     Copies every catalog entry, in fileID order, into 
+//     a dynamically allocated array + the count
+// --------------------------------------------------------
+FileEntry *load_file_entries(size_t *outCount)
+{
+    pthread_once(&catalog_once, catalog_init_once);
+    *outCount = 0;
+
+    size_t limit = __atomic_load_n(&next_file_id, __ATOMIC_ACQUIRE);
+    size_t capacity = catalog_segment_count();
+    if (capacity == 0)
+        return NULL; // No entries found
+
+    FileEntry *entries = malloc(capacity * sizeof(FileEntry));
+    if (!entries)
+    {
+        perror("Memory allocation failed");
         return NULL;
     }
 
-    FileEntry entry;
-    while (fread(&entry, sizeof(FileEntry), 1, dbFile))
+    size_t count = 0;
+    for (size_t id = 1; id < limit && count < capacity; id++)
     {
-        if (entry.fileID == fileID)
+        const CatalogEntry *entry = catalog_lookup((ssize_t)id);
+        if (entry)
+            entries[count++] = entry->entry;
+    }
+
+    *outCount = count;
+    return entries;
+}
+
+// --------------------------------------------------------
+//  8) Catalog
+// --------------------------------------------------------
+
+static int catalog_order_push(ssize_t fileID)
+{
+    if (catalog_order_len == catalog_order_cap)
+    {
+        size_t cap = catalog_order_cap ? catalog_order_cap * 2 : 1024;
+        ssize_t *order = realloc(catalog_order, cap * sizeof(*order));
+        if (!order)
+            return -1;
+        catalog_order = order;
+        catalog_order_cap = cap;
+    }
+    catalog_order[catalog_order_len++] = fileID;
+    return 0;
+}
+
+/* One pass over the segment, placing each record by its version. Caller holds catalog_lock.
+   Also the rebuild after a failed catalog_order_push(), which leaves the previous index behind */
+static void catalog_order_build_locked(void)
+{
+    size_t count = catalog_segment_count();
+    ssize_t *order = calloc(count ? count : 1, sizeof(*order));
+    if (!order)
+        return;
+
+    size_t placed = 0;
+    ssize_t limit = __atomic_load_n(&next_file_id, __ATOMIC_ACQUIRE);
+    for (ssize_t id = 0; id < limit && placed < count; id++)
+    {
+        const CatalogEntry *entry = catalog_segment_get(id);
+        if (entry && entry->version >= 1 && entry->version <= count)
         {
-            fclose(dbFile);
-            // Allocate space for the filename
-            char *filename = malloc(strlen(entry.metaFilename) + 1);
-            if (filename)
+            order[entry->version - 1] = id;
+            placed++;
+        }
+    }
+
+    pthread_rwlock_wrlock(&catalog_order_lock);
+    free(catalog_order);
+    catalog_order = order;
+    catalog_order_len = placed;
+    catalog_order_cap = count ? count : 1;
+    __atomic_store_n(&catalog_order_built, 1, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&catalog_order_lock);
+}
+
+static int hash_is_zero(const uint8_t *fileHash)
+{
+    for (int i = 0; i < 32; i++)
+        if (fileHash[i])
+            return 0;
+    return 1;
+}
+
+static uint64_t hash_key(const uint8_t *fileHash)
+{
+    uint64_t key;
+    memcpy(&key, fileHash, sizeof(key)); // already a SHA-256, no need to mix it again
+    return key;
+}
+
+static int catalog_hash_grow_locked(void)
+{
+    size_t old_size = catalog_hashes ? catalog_hashes_mask + 1 : 0;
+    size_t size = old_size ? old_size * 2 : 1024;
+    CatalogHashSlot *grown = calloc(size, sizeof(CatalogHashSlot));
+    if (!grown)
+        return -1;
+
+    for (size_t i = 0; i < old_size; i++)
+    {
+        if (!catalog_hashes[i].slot)
+            continue;
+        size_t b = catalog_hashes[i].key & (size - 1);
+        while (grown[b].slot)
+            b = (b + 1) & (size - 1);
+        grown[b] = catalog_hashes[i];
+    }
+    free(catalog_hashes);
+    catalog_hashes = grown;
+    catalog_hashes_mask = size - 1;
+    return 0;
+}
+
+/* Remembers fileHash -> fileID unless the hash is unknown (all zero) or already taken. Caller holds catalog_lock */
+static void catalog_hash_insert_locked(const uint8_t *fileHash, ssize_t fileID)
+{
+    if (hash_is_zero(fileHash) || catalog_hash_find_locked(fileHash) >= 0)
+        return; // the first fileID of some content stays its fileID
+    if ((catalog_hashes_used + 1) * 10 > (catalog_hashes ? catalog_hashes_mask + 1 : 0) * 7 &&
+        catalog_hash_grow_locked() < 0)
+        return;
+
+    uint64_t key = hash_key(fileHash);
+    size_t b = key & catalog_hashes_mask;
+    while (catalog_hashes[b].slot)
+        b = (b + 1) & catalog_hashes_mask;
+    catalog_hashes[b].key = key;
+    catalog_hashes[b].slot = fileID + 1;
+    catalog_hashes_used++;
+}
+
+/* One pass over the segment, the first time a seed is created. Caller holds catalog_lock */
+static void catalog_hash_build_locked(void)
+{
+    catalog_hashes_built = 1; // set first, catalog_hash_insert_locked() looks entries up while building
+    ssize_t limit = __atomic_load_n(&next_file_id, __ATOMIC_ACQUIRE);
+    for (ssize_t id = 0; id < limit; id++)
+    {
+        const CatalogEntry *entry = catalog_segment_get(id);
+        if (entry)
+            catalog_hash_insert_locked(entry->meta.fileHash, id);
+    }
+}
+
+/* fileID registered with this exact fileHash, or -1. O(1). Caller holds catalog_lock */
+static ssize_t catalog_hash_find_locked(const uint8_t *fileHash)
+{
+    if (!catalog_hashes_built)
+        catalog_hash_build_locked();
+    if (!catalog_hashes || hash_is_zero(fileHash))
+        return -1;
+
+    uint64_t key = hash_key(fileHash);
+    for (size_t b = key & catalog_hashes_mask; catalog_hashes[b].slot; b = (b + 1) & catalog_hashes_mask)
+    {
+        if (catalog_hashes[b].key != key)
+            continue;
+        const CatalogEntry *entry = catalog_segment_get(catalog_hashes[b].slot - 1);
+        if (entry && memcmp(entry->meta.fileHash, fileHash, 32) == 0)
+            return catalog_hashes[b].slot - 1;
+    }
+    return -1;
+}
+
+/* Durable write: the record is on disk before anyone can look it up. Caller holds catalog_lock */
+static int catalog_append_locked(const FileEntry *entry, const FileMetadata *meta)
+{
+    int rc = catalog_segment_put(entry, meta, 1);
+    if (rc == 0 && catalog_order_built)
+    {
+        // still under catalog_lock, so the index stays in version order
+        pthread_rwlock_wrlock(&catalog_order_lock);
+        if (catalog_order_push(entry->fileID) < 0)
+            catalog_order_built = 0; // out of memory, rebuilt on the next listing
+        pthread_rwlock_unlock(&catalog_order_lock);
+    }
+    if (rc == 0 && catalog_hashes_built)
+        catalog_hash_insert_locked(meta->fileHash, entry->fileID);
+    return rc;
+}
+
+static int catalog_append(const FileEntry *entry, const FileMetadata *meta)
+{
+    pthread_mutex_lock(&catalog_lock);
+    int rc = catalog_append_locked(entry, meta);
+    pthread_mutex_unlock(&catalog_lock);
+    if (rc < 0)
+        return -1;
+
+    // keep the counter ahead of IDs that were added by hand (scan_and_add_files)
+    ssize_t next = __atomic_load_n(&next_file_id, __ATOMIC_RELAXED);
+    while (entry->fileID >= next &&
+           !__atomic_compare_exchange_n(&next_file_id, &next, entry->fileID + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    return 0;
+}
+
+/*
+First start only: builds the segment from meta.log + records/ under a temporary name
+and renames it into place, an interrupted import is simply redone on the next start
+*/
+static int catalog_import_legacy(void)
+{
+    char tmpPath[] = CATALOG_SEGMENT_FILE ".import";
+    unlink(tmpPath);
+    if (catalog_segment_open(tmpPath) != 1)
+        return -1;
+
+    size_t imported = 0;
+    FILE *dbFile = fopen(META_LOG_FILE, "rb");
+    if (dbFile)
+    {
+        FileEntry entry;
+        while (fread(&entry, sizeof(FileEntry), 1, dbFile) == 1)
+        {
+            entry.metaFilename[sizeof(entry.metaFilename) - 1] = '\0';
+            if (catalog_owns && !catalog_owns(entry.fileID))
+                continue; // listed by the tracker that owns it
+
+            FileMetadata meta;
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", RECORDS_FOLDER, entry.metaFilename);
+            if (load_single_metadata(path, &meta) != 0)
             {
-                strcpy(filename, entry.metaFilename);
+                // keep listing the file, only its hash is unknown
+                memset(&meta, 0, sizeof(meta));
+                meta.fileID = entry.fileID;
+                meta.totalByte = entry.totalBytes;
             }
-            return filename;
+            if (catalog_segment_put(&entry, &meta, 0) == 0)
+                imported++; // the first record of a fileID wins, like the old meta.log scan
         }
+        fclose(dbFile);
+    }
+
+    if (catalog_segment_sync() < 0 || rename(tmpPath, CATALOG_SEGMENT_FILE) < 0)
+    {
+        perror("Error importing meta.log into the catalog segment");
+        return -1;
+    }
+    int dirFd = open(".", O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0)
+    {
+        fsync(dirFd); // make the rename durable
+        close(dirFd);
     }
 
-    fclose(dbFile);
-    return NULL; // Not found
+    printf("Imported %zu file(s) from meta.log into %s\n", imported, CATALOG_SEGMENT_FILE);
+    return 0;
 }
 
-// --------------------------------------------------------
-//  7) load_file_entries()
-//     Reads all FileEntry records from meta.log, returns 
-//     a dynamically allocated array of them + the count
-// --------------------------------------------------------
-FileEntry *load_file_entries(size_t *outCount)
+/* Maps the segment, O(1) whatever the catalog size. Imports meta.log when there is no segment yet */
+static void catalog_init_once(void)
 {
-    FILE *dbFile = fopen(META_LOG_FILE, "rb");
-    if (!dbFile)
+    int rc;
+    if (access(CATALOG_SEGMENT_FILE, F_OK) == 0)
+        rc = catalog_segment_open(CATALOG_SEGMENT_FILE);
+    else
+        rc = catalog_import_legacy();
+    if (rc < 0)
     {
-        perror("Error opening meta.log for loading entries");
-        return NULL;
+        fprintf(stderr, "Failed to open the catalog segment %s\n", CATALOG_SEGMENT_FILE);
+        exit(EXIT_FAILURE);
     }
 
-    // Determine how many entries are in the file
-    fseek(dbFile, 0, SEEK_END);
-    size_t file_size = ftell(dbFile);
-    size_t num_entries = file_size / sizeof(FileEntry);
-    fseek(dbFile, 0, SEEK_SET);
+    next_file_id = catalog_segment_next_id();
+    printf("Catalog loaded: %zu file(s), next fileID %zd\n", catalog_segment_count(), next_file_id);
+}
 
-    if (num_entries == 0)
+void catalog_set_owner(int (*owns)(ssize_t fileID))
+{
+    catalog_owns = owns;
+}
+
+int catalog_check_shards(const char *shards)
+{
+    size_t len = strlen(shards);
+    FILE *fp = NULL;
+    if (access(CATALOG_SEGMENT_FILE, F_OK) == 0)
+        fp = fopen(CATALOG_SHARDS_FILE, "r"); // no segment yet: whatever was recorded belonged to another catalog
+    if (fp)
     {
-        fclose(dbFile);
-        *outCount = 0;
-        return NULL; // No entries found
+        char *recorded = malloc(len + 2);
+        size_t n = recorded ? fread(recorded, 1, len + 1, fp) : 0;
+        int same = recorded && n == len && memcmp(recorded, shards, len) == 0;
+        free(recorded);
+        fclose(fp);
+        return same ? 0 : -1;
     }
 
-    // Allocate memory for the array
-    FileEntry *entries = malloc(num_entries * sizeof(FileEntry));
-    if (!entries)
+    // New catalog (or one from before the list was recorded): the current list is its list from now on
+    char tmp[] = CATALOG_SHARDS_FILE ".tmp";
+    fp = fopen(tmp, "w");
+    if (!fp)
+        return -1;
+    int ok = fwrite(shards, 1, len, fp) == len;
+    ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0 && ok;
+    if (fclose(fp) != 0 || !ok || rename(tmp, CATALOG_SHARDS_FILE) < 0)
     {
-        perror("Memory allocation failed");
-        fclose(dbFile);
-        return NULL;
+        unlink(tmp);
+        return -1;
     }
+    return 0;
+}
+
+void catalog_load(void)
+{
+    pthread_once(&catalog_once, catalog_init_once);
+}
+
+const CatalogEntry *catalog_lookup(ssize_t fileID)
+{
+    pthread_once(&catalog_once, catalog_init_once);
+    return catalog_segment_get(fileID);
+}
 
-    // Read them all into the array
-    if (fread(entries, sizeof(FileEntry), num_entries, dbFile) != num_entries)
+size_t catalog_changes_since(size_t since, FileEntry *out, size_t max, size_t *catalogVersion)
+{
+    pthread_once(&catalog_once, catalog_init_once);
+    if (!__atomic_load_n(&catalog_order_built, __ATOMIC_ACQUIRE))
     {
-        perror("Error reading file entries from meta.log");
-        free(entries);
-        fclose(dbFile);
-        return NULL;
+        pthread_mutex_lock(&catalog_lock);
+        if (!catalog_order_built)
+            catalog_order_build_locked();
+        pthread_mutex_unlock(&catalog_lock);
     }
 
-    fclose(dbFile);
-    *outCount = num_entries;
-    return entries;
+    size_t count = 0;
+    pthread_rwlock_rdlock(&catalog_order_lock);
+    *catalogVersion = catalog_order_len;
+    for (size_t v = since; v < catalog_order_len && count < max; v++)
+    {
+        const CatalogEntry *entry = catalog_segment_get(catalog_order[v]);
+        if (entry)
+            out[count++] = entry->entry;
+    }
+    pthread_rwlock_unlock(&catalog_order_lock);
+    return count;
 }
 
+const CatalogEntry *catalog_lookup_by_metafilename(const char *metaFilename)
+{
+    // Names are "%04zd_<name>.meta", the prefix is the fileID
+    char *end = NULL;
+    long long fileID = strtoll(metaFilename, &end, 10);
+    if (end == metaFilename || *end != '_')
+        return NULL;
+
+    const CatalogEntry *entry = catalog_lookup((ssize_t)fileID);
+    if (!entry || strcmp(entry->entry.metaFilename, metaFilename) != 0)
+        return NULL;
+    return entry;
+}
 
 void scan_and_add_files()
 {
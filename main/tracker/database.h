@@ -9,7 +9,9 @@
 #include <sys/types.h>
 #include "meta.h"
 #define RECORDS_FOLDER "records" // Directory containing .meta files
-#define META_LOG_FILE "meta.log" // The meta log file
+#define META_LOG_FILE "meta.log" // The meta log file, only read to build the first catalog segment
+#define CATALOG_SEGMENT_FILE "catalog.seg" // Packed catalog, one record per fileID
+#define CATALOG_SHARDS_FILE "catalog.shards" // Shard list the catalog was built under, empty when not sharded
 
 /* Define a struct to store file mappings */
 typedef struct
@@ -18,8 +20,46 @@ typedef struct
     ssize_t totalBytes;
     char metaFilename[256]; // Store the filename relative to records/
 } FileEntry;
+
+/*
+@brief One catalog record: the file entry plus the file's metadata (fileHash included).
+This is the on-disk record of the catalog segment (catalog_segment.h), lookups point straight
+into the mapping. Records never change or move once present.
+*/
+typedef struct CatalogEntry
+{
+    uint32_t present; // set last, a record is only valid once it is 1
+    uint32_t version; // catalog version that added the record: the n-th record written has version n
+    FileEntry entry;
+    FileMetadata meta;
+} CatalogEntry;
+
 ssize_t add_new_file(const FileMetadata *meta);
 
+/* Maps the catalog segment (importing meta.log on first start). Called at startup, every catalog function also does it on first use */
+void catalog_load(void);
+/*
+Sharded trackers (shard_map.h): owns(fileID) tells whether this tracker owns a fileID. New fileIDs are only
+taken from owned ones and the meta.log import keeps the owned files. Must be called before catalog_load()
+*/
+void catalog_set_owner(int (*owns)(ssize_t fileID));
+/*
+Catalog entries never move between trackers, so a catalog stays with the shard list it was built under
+(shard_map_describe() text, "" when not sharded). Records it in CATALOG_SHARDS_FILE for a new catalog.
+Returns 0 when shards is the recorded list, -1 when it differs or cannot be recorded
+*/
+int catalog_check_shards(const char *shards);
+/* O(1), no lock, no file access. NULL when the fileID is unknown */
+const CatalogEntry *catalog_lookup(ssize_t fileID);
+/* "0005_name.meta" -> its entry, NULL when unknown */
+const CatalogEntry *catalog_lookup_by_metafilename(const char *metaFilename);
+/*
+Copies up to max entries added after catalog version `since`, oldest first.
+Entry i of out has version since + 1 + i, *catalogVersion receives the current version.
+since = 0 walks the whole catalog page by page, a cached copy passes its last version to get only the new entries.
+*/
+size_t catalog_changes_since(size_t since, FileEntry *out, size_t max, size_t *catalogVersion);
+
 /* Function to add a new file mapping to meta.log */
 void add_file_entry(ssize_t fileID, ssize_t totalBytes, const char *metaFilename);
 
@@ -30,7 +70,7 @@ void list_file_entries();
 char *get_meta_filename(ssize_t fileID);
 
 /* Function to load all file entries into a dynamically allocated array */
-FileEntry *load_file_entries();
+FileEntry *load_file_entries(size_t *outCount);
 
 /* Function to scan the `records/` folder and add all .meta files */
 void scan_and_add_files();
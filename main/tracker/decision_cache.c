@@ -0,0 +1,73 @@
+#include <stdlib.h>
+#include <string.h>
+#include "decision_cache.h"
+
+typedef struct
+{
+    uint64_t generation; // 0 = empty, published generations start at 1
+    ssize_t fileID;
+    int decision;
+    char ip[DECISION_CACHE_IP_MAX];
+    char clientIp[DECISION_CACHE_IP_MAX];
+} DecisionCacheEntry;
+
+static __thread DecisionCacheEntry *cache; // allocated on the first put of each thread
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint64_t hash_string(uint64_t h, const char *s)
+{
+    while (*s)
+        h = (h ^ (uint8_t)*s++) * 0x100000001b3ull; // FNV-1a
+    return (h ^ 0xff) * 0x100000001b3ull;           // separator, "1.2" + "3" != "1." + "23"
+}
+
+/* Slot of the key, *ok is 0 when the addresses are too long to be cached */
+static size_t slot_of(const char *ip, const char *clientIp, ssize_t fileID, int *ok)
+{
+    *ok = strnlen(ip, DECISION_CACHE_IP_MAX) < DECISION_CACHE_IP_MAX &&
+          strnlen(clientIp, DECISION_CACHE_IP_MAX) < DECISION_CACHE_IP_MAX;
+    if (!*ok)
+        return 0;
+
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = hash_string(h, ip);
+    h = hash_string(h, clientIp);
+    h = (h ^ (uint64_t)fileID) * 0x9e3779b97f4a7c15ull;
+    return (size_t)(h >> 32) & (DECISION_CACHE_SLOTS - 1);
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int decision_cache_get(const char *ip, const char *clientIp, ssize_t fileID, uint64_t generation)
+{
+    if (!cache || generation == 0)
+        return -1;
+
+    int ok;
+    const DecisionCacheEntry *entry = &cache[slot_of(ip, clientIp, fileID, &ok)];
+    if (!ok || entry->generation != generation || entry->fileID != fileID ||
+        strcmp(entry->ip, ip) != 0 || strcmp(entry->clientIp, clientIp) != 0)
+        return -1;
+    return entry->decision;
+}
+
+void decision_cache_put(const char *ip, const char *clientIp, ssize_t fileID, uint64_t generation, int decision)
+{
+    if (generation == 0)
+        return;
+    if (!cache && !(cache = calloc(DECISION_CACHE_SLOTS, sizeof(DecisionCacheEntry))))
+        return;
+
+    int ok;
+    DecisionCacheEntry *entry = &cache[slot_of(ip, clientIp, fileID, &ok)];
+    if (!ok)
+        return;
+    entry->generation = generation;
+    entry->fileID = fileID;
+    entry->decision = decision;
+    strcpy(entry->ip, ip);
+    strcpy(entry->clientIp, clientIp);
+}
@@ -0,0 +1,27 @@
+#ifndef DECISION_CACHE_H
+#define DECISION_CACHE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+@brief Remembers policy decisions per (peer address, fileID)
+
+Seeders re-announce the same files every interval and leechers ask for the same swarms again,
+the answer of the policy checks only changes when the rules do.
+A decision is stored with the policy generation it was computed under (policy_generation()),
+every command that changes the rules publishes a new generation and so invalidates the whole cache at once.
+
+Each worker thread has its own direct mapped table of DECISION_CACHE_SLOTS entries:
+no lock, no sharing, a colliding entry simply replaces the older one.
+Addresses longer than an IPv6 address are never cached.
+*/
+
+#define DECISION_CACHE_SLOTS 2048 // per thread, power of two
+#define DECISION_CACHE_IP_MAX 46  // INET6_ADDRSTRLEN
+
+/* The decision cached for this key under generation, -1 on a miss */
+int decision_cache_get(const char *ip, const char *clientIp, ssize_t fileID, uint64_t generation);
+void decision_cache_put(const char *ip, const char *clientIp, ssize_t fileID, uint64_t generation, int decision);
+
+#endif // DECISION_CACHE_H
@@ -0,0 +1,38 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+@brief Latency histogram with a fixed relative error, for loadgen's percentiles and the metrics (metrics.h)
+
+Log-linear buckets: values below 2^HISTOGRAM_SUB_BITS get one bucket each, every power of two above
+is split into 2^HISTOGRAM_SUB_BITS equal buckets. With 6 bits a percentile is off by at most 1/64 (1.6%)
+whatever the magnitude, and the whole uint64_t range fits in ~3800 counters (30 KB).
+Recording is one count increment, no allocation. One writer per histogram, merged by the readers:
+histogram_merge() may run while its source is being recorded into.
+*/
+
+#define HISTOGRAM_SUB_BITS 6
+#define HISTOGRAM_SUB_COUNT (1u << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+typedef struct Histogram
+{
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum; // for the mean
+} Histogram;
+
+void histogram_init(Histogram *h);
+void histogram_record(Histogram *h, uint64_t value);
+/* Adds every count of from into into */
+void histogram_merge(Histogram *into, const Histogram *from);
+/* Smallest recorded value v such that a fraction q (0..1) of the values are <= v, within the bucket error. 0 when empty */
+uint64_t histogram_quantile(const Histogram *h, double q);
+double histogram_mean(const Histogram *h);
+
+#endif // HISTOGRAM_H
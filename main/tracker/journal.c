@@ -0,0 +1,602 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "journal.h"
+#include "tracker.h" // metric ids
+
+#define JOURNAL_BUFFER_MIN (1u << 20)
+#define JOURNAL_READ_BATCH 4096 // records per fread() while replaying
+
+static int journal_active; // atomic, hooks are no-ops while 0
+static int commit_interval_ms;
+
+// Records waiting for the next group commit, guarded by journal_lock
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t *pending;
+static size_t pending_len;
+static size_t pending_cap;
+
+// Owned by whoever holds commit_lock (the commit thread, or journal_flush() on shutdown)
+static pthread_mutex_t commit_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t *spare; // the buffer being written, swapped with pending on every commit
+static size_t spare_cap;
+static int wal_fd = -1;
+static uint64_t wal_bytes;
+static uint64_t sequence;
+static time_t last_snapshot;
+
+/* --------------------------------------------------------------------------
+   🔹 Records
+   -------------------------------------------------------------------------- */
+static uint32_t record_checksum(const JournalRecord *record)
+{
+    JournalRecord copy = *record;
+    copy.checksum = 0;
+    const uint8_t *p = (const uint8_t *)&copy;
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < sizeof(copy); i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static void record_seal(JournalRecord *record)
+{
+    record->checksum = record_checksum(record);
+}
+
+static int journal_on(void)
+{
+    return __atomic_load_n(&journal_active, __ATOMIC_ACQUIRE);
+}
+
+static void journal_fail(const char *what, int err)
+{
+    fprintf(stderr, "%s: %s\n", what, strerror(err));
+    fprintf(stderr, "journal: persistence stopped, swarms are only kept in memory from now on\n");
+    // Under journal_lock: an appender that saw the journal on finds it off before touching the buffer
+    pthread_mutex_lock(&journal_lock);
+    __atomic_store_n(&journal_active, 0, __ATOMIC_RELEASE);
+    pending_len = 0;
+    pthread_mutex_unlock(&journal_lock);
+}
+
+/*
+@brief Never waits: the callers hold the registry / swarm locks a running snapshot needs.
+       Past JOURNAL_BUFFER_MAX the disk is not keeping up, the record is dropped and persistence stops,
+       a log missing a record in the middle would replay a wrong state.
+*/
+static void journal_append(JournalRecord *record)
+{
+    record_seal(record);
+    pthread_mutex_lock(&journal_lock);
+    if (!journal_on())
+    {
+        pthread_mutex_unlock(&journal_lock);
+        return;
+    }
+    if (pending_len + sizeof(*record) > pending_cap)
+    {
+        uint8_t *grown = pending_cap < JOURNAL_BUFFER_MAX ? realloc(pending, pending_cap * 2) : NULL;
+        if (!grown)
+        {
+            pthread_mutex_unlock(&journal_lock);
+            journal_fail("journal: append", pending_cap < JOURNAL_BUFFER_MAX ? ENOMEM : ENOBUFS);
+            return;
+        }
+        pending = grown;
+        pending_cap *= 2;
+    }
+    memcpy(pending + pending_len, record, sizeof(*record));
+    pending_len += sizeof(*record);
+    pthread_mutex_unlock(&journal_lock);
+}
+
+void journal_register(PeerHandle peer, const PeerKey *key)
+{
+    if (!journal_on())
+        return;
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_REGISTER;
+    record.peer = peer;
+    record.key = *key;
+    journal_append(&record);
+}
+
+void journal_unregister(PeerHandle peer)
+{
+    if (!journal_on())
+        return;
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_UNREGISTER;
+    record.peer = peer;
+    journal_append(&record);
+}
+
+void journal_join(ssize_t fileID, PeerHandle peer, SwarmRole role, uint64_t ttl)
+{
+    if (!journal_on())
+        return;
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_JOIN;
+    record.role = (uint16_t)role;
+    record.peer = peer;
+    record.member.fileID = fileID;
+    record.member.expires = (int64_t)time(NULL) + (int64_t)ttl;
+    journal_append(&record);
+}
+
+void journal_leave(ssize_t fileID, PeerHandle peer, SwarmRole role)
+{
+    if (!journal_on())
+        return;
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_LEAVE;
+    record.role = (uint16_t)role;
+    record.peer = peer;
+    record.member.fileID = fileID;
+    journal_append(&record);
+}
+
+void journal_counters(ssize_t fileID, const SwarmCounters *counters)
+{
+    if (!journal_on())
+        return;
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_COUNTERS;
+    record.counters.fileID = fileID;
+    record.counters.completed = __atomic_load_n(&counters->completed, __ATOMIC_RELAXED);
+    record.counters.uploaded = __atomic_load_n(&counters->uploaded, __ATOMIC_RELAXED);
+    record.counters.downloaded = __atomic_load_n(&counters->downloaded, __ATOMIC_RELAXED);
+    journal_append(&record);
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Replay
+   -------------------------------------------------------------------------- */
+/* Handles of the run that wrote the files -> handles of this run. Open addressing, 0 = empty key */
+typedef struct HandleMap
+{
+    PeerHandle *keys;
+    PeerHandle *values; // PEER_HANDLE_NONE once the peer unregistered
+    size_t mask;
+    size_t count;
+} HandleMap;
+
+static size_t handle_slot(const HandleMap *map, PeerHandle key)
+{
+    uint64_t h = key * 0x9e3779b97f4a7c15ull;
+    size_t i = (size_t)(h >> 32) & map->mask;
+    while (map->keys[i] != 0 && map->keys[i] != key)
+        i = (i + 1) & map->mask;
+    return i;
+}
+
+static int handle_map_put(HandleMap *map, PeerHandle key, PeerHandle value)
+{
+    if (!map->keys || (map->count + 1) * 10 > (map->mask + 1) * 7)
+    {
+        size_t size = map->keys ? (map->mask + 1) * 2 : 1024;
+        HandleMap grown = {calloc(size, sizeof(PeerHandle)), calloc(size, sizeof(PeerHandle)), size - 1, 0};
+        if (!grown.keys || !grown.values)
+        {
+            free(grown.keys);
+            free(grown.values);
+            return -1;
+        }
+        for (size_t i = 0; map->keys && i <= map->mask; i++)
+        {
+            if (map->keys[i] == 0)
+                continue;
+            size_t j = handle_slot(&grown, map->keys[i]);
+            grown.keys[j] = map->keys[i];
+            grown.values[j] = map->values[i];
+            grown.count++;
+        }
+        free(map->keys);
+        free(map->values);
+        *map = grown;
+    }
+
+    size_t i = handle_slot(map, key);
+    if (map->keys[i] == 0)
+        map->count++;
+    map->keys[i] = key;
+    map->values[i] = value;
+    return 0;
+}
+
+static PeerHandle handle_map_get(const HandleMap *map, PeerHandle key)
+{
+    if (!map->keys || key == 0)
+        return PEER_HANDLE_NONE;
+    size_t i = handle_slot(map, key);
+    return map->keys[i] == key ? map->values[i] : PEER_HANDLE_NONE;
+}
+
+static void apply_record(const JournalRecord *record, HandleMap *map, int64_t now)
+{
+    PeerHandle peer = handle_map_get(map, record->peer);
+    SwarmRole role = record->role == SWARM_LEECHER ? SWARM_LEECHER : SWARM_SEEDER;
+
+    switch (record->type)
+    {
+    case JOURNAL_REGISTER:
+        peer = peer_registry_insert(&record->key, NULL);
+        if (peer != PEER_HANDLE_NONE)
+            handle_map_put(map, record->peer, peer);
+        break;
+    case JOURNAL_UNREGISTER:
+        if (peer != PEER_HANDLE_NONE)
+        {
+            peer_registry_remove(peer);
+            handle_map_put(map, record->peer, PEER_HANDLE_NONE);
+        }
+        break;
+    case JOURNAL_JOIN:
+        if (peer == PEER_HANDLE_NONE)
+            break;
+        if (record->member.expires <= now)
+        {
+            // expired while we were down: the join had already ended the other role
+            swarm_remove(record->member.fileID, peer);
+            swarm_remove_leecher(record->member.fileID, peer);
+        }
+        else if (role == SWARM_LEECHER)
+            swarm_add_leecher(record->member.fileID, peer, (uint64_t)(record->member.expires - now));
+        else
+            swarm_add(record->member.fileID, peer, (uint64_t)(record->member.expires - now));
+        break;
+    case JOURNAL_LEAVE:
+        if (peer == PEER_HANDLE_NONE)
+            break;
+        if (role == SWARM_LEECHER)
+            swarm_remove_leecher(record->member.fileID, peer);
+        else
+            swarm_remove(record->member.fileID, peer);
+        break;
+    case JOURNAL_COUNTERS:
+    {
+        SwarmCounters counters = {record->counters.completed, record->counters.uploaded, record->counters.downloaded};
+        swarm_restore_counters(record->counters.fileID, &counters);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/*
+@brief Applies every record of path. A snapshot sets *seq, a log is only applied when its sequence is *seq.
+@return records applied, 0 when the file is missing or belongs to another snapshot, -1 when the header is bad
+*/
+static long replay_file(const char *path, uint64_t *seq, int is_log, HandleMap *map)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+
+    JournalFileHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != JOURNAL_VERSION)
+    {
+        fclose(fp);
+        return -1;
+    }
+    if (is_log && header.sequence != *seq)
+    {
+        fclose(fp);
+        return 0; // written before the snapshot we loaded, everything in it is already there
+    }
+    *seq = header.sequence;
+
+    JournalRecord *records = malloc(JOURNAL_READ_BATCH * sizeof(JournalRecord));
+    if (!records)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    int64_t now = (int64_t)time(NULL);
+    long applied = 0;
+    size_t n;
+    int torn = 0;
+    while (!torn && (n = fread(records, sizeof(JournalRecord), JOURNAL_READ_BATCH, fp)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (records[i].checksum != record_checksum(&records[i]))
+            {
+                torn = 1; // the tail of a commit cut short by a crash, nothing after it was acknowledged
+                break;
+            }
+            apply_record(&records[i], map, now);
+            applied++;
+        }
+    }
+    if (torn)
+        fprintf(stderr, "journal: %s ends with a damaged record, replayed the %ld before it\n", path, applied);
+
+    free(records);
+    fclose(fp);
+    return applied;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Writing
+   -------------------------------------------------------------------------- */
+static int write_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Caller holds commit_lock. One write + one fdatasync for every record appended since the last commit */
+static int journal_commit_locked(void)
+{
+    pthread_mutex_lock(&journal_lock);
+    uint8_t *batch = pending;
+    size_t batch_len = pending_len;
+    size_t batch_cap = pending_cap;
+    if (batch_len > 0)
+    {
+        pending = spare;
+        pending_cap = spare_cap;
+        pending_len = 0;
+    }
+    pthread_mutex_unlock(&journal_lock);
+    if (batch_len == 0)
+        return 0;
+
+    spare = batch;
+    spare_cap = batch_cap;
+    if (wal_fd < 0)
+        return 0;
+    uint64_t started = metrics_now_ns();
+    if (write_all(wal_fd, batch, batch_len) < 0 || fdatasync(wal_fd) < 0)
+    {
+        journal_fail("journal: commit", errno);
+        return -1;
+    }
+    metrics_record(TIMER_JOURNAL_COMMIT, metrics_now_ns() - started);
+    metrics_add(METRIC_JOURNAL_BYTES, batch_len);
+    wal_bytes += batch_len;
+    return 0;
+}
+
+static void sync_directory(void)
+{
+    int dirFd = open(".", O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0)
+    {
+        fsync(dirFd); // make the renames durable
+        close(dirFd);
+    }
+}
+
+typedef struct SnapshotWriter
+{
+    FILE *fp;
+    int64_t now;
+    size_t members;
+    int failed;
+} SnapshotWriter;
+
+static void snapshot_put(SnapshotWriter *writer, JournalRecord *record)
+{
+    record_seal(record);
+    if (fwrite(record, sizeof(*record), 1, writer->fp) != 1)
+        writer->failed = 1;
+}
+
+static void snapshot_peer(PeerHandle handle, const PeerKey *key, void *arg)
+{
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_REGISTER;
+    record.peer = handle;
+    record.key = *key;
+    snapshot_put(arg, &record);
+}
+
+static void snapshot_member(ssize_t fileID, PeerHandle peer, SwarmRole role, uint64_t ttl, void *arg)
+{
+    SnapshotWriter *writer = arg;
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_JOIN;
+    record.role = (uint16_t)role;
+    record.peer = peer;
+    record.member.fileID = fileID;
+    record.member.expires = writer->now + (int64_t)ttl;
+    snapshot_put(writer, &record);
+    writer->members++;
+}
+
+static void snapshot_counters(ssize_t fileID, const SwarmCounters *counters, void *arg)
+{
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_COUNTERS;
+    record.counters.fileID = fileID;
+    record.counters.completed = counters->completed;
+    record.counters.uploaded = counters->uploaded;
+    record.counters.downloaded = counters->downloaded;
+    snapshot_put(arg, &record);
+}
+
+static int write_header(int fd, uint64_t seq)
+{
+    JournalFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.sequence = seq;
+    return write_all(fd, &header, sizeof(header));
+}
+
+/*
+@brief Caller holds commit_lock. Cuts the log, writes the live state as the snapshot of the next sequence,
+       then starts a new log for it. Returns the memberships written, -1 on error (the old files stay valid)
+*/
+static long journal_snapshot_locked(void)
+{
+    // 1) Everything appended before this point goes to the old log
+    if (journal_commit_locked() < 0)
+        return -1;
+
+    uint64_t started = metrics_now_ns();
+    uint64_t next = sequence + 1;
+    char walTmp[] = JOURNAL_WAL_FILE ".tmp";
+    char snapTmp[] = JOURNAL_SNAPSHOT_FILE ".tmp";
+
+    // 2) The next log, empty. Records appended from now on are written to it
+    int new_wal = open(walTmp, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (new_wal < 0 || write_header(new_wal, next) < 0 || fsync(new_wal) < 0)
+        goto fail;
+
+    // 3) The live state, readers and writers keep going while it is copied out
+    SnapshotWriter writer = {fopen(snapTmp, "wb"), (int64_t)time(NULL), 0, 0};
+    if (!writer.fp)
+        goto fail;
+    JournalFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.sequence = next;
+    writer.failed = fwrite(&header, sizeof(header), 1, writer.fp) != 1;
+    peer_registry_for_each(snapshot_peer, &writer);
+    swarm_for_each(snapshot_member, snapshot_counters, &writer);
+    if (fflush(writer.fp) != 0 || fsync(fileno(writer.fp)) < 0)
+        writer.failed = 1;
+    if (fclose(writer.fp) != 0)
+        writer.failed = 1;
+
+    // 4) Snapshot first: a crash before the log rename leaves the old log, whose sequence no longer matches
+    if (writer.failed || rename(snapTmp, JOURNAL_SNAPSHOT_FILE) < 0 || rename(walTmp, JOURNAL_WAL_FILE) < 0)
+        goto fail;
+    sync_directory();
+
+    if (wal_fd >= 0)
+        close(wal_fd);
+    wal_fd = new_wal;
+    wal_bytes = 0;
+    sequence = next;
+    last_snapshot = time(NULL);
+    metrics_record(TIMER_JOURNAL_SNAPSHOT, metrics_now_ns() - started);
+    return (long)writer.members;
+
+fail:
+    perror("journal: snapshot");
+    if (new_wal >= 0)
+        close(new_wal);
+    unlink(walTmp);
+    unlink(snapTmp);
+    return -1;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Commit thread
+   -------------------------------------------------------------------------- */
+static void *journal_main(void *arg)
+{
+    (void)arg;
+    while (journal_on())
+    {
+        usleep((useconds_t)commit_interval_ms * 1000);
+
+        pthread_mutex_lock(&commit_lock);
+        if (journal_commit_locked() == 0 &&
+            (wal_bytes >= JOURNAL_WAL_MAX ||
+             (wal_bytes > 0 && time(NULL) - last_snapshot >= JOURNAL_SNAPSHOT_INTERVAL)))
+            journal_snapshot_locked();
+        pthread_mutex_unlock(&commit_lock);
+    }
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+long journal_open(int commit_ms)
+{
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    // 1) Snapshot, then the log written after it
+    HandleMap map = {0};
+    uint64_t seq = 0;
+    long snapRecords = replay_file(JOURNAL_SNAPSHOT_FILE, &seq, 0, &map);
+    long walRecords = snapRecords < 0 ? 0 : replay_file(JOURNAL_WAL_FILE, &seq, 1, &map);
+    free(map.keys);
+    free(map.values);
+    if (snapRecords < 0 || walRecords < 0)
+        fprintf(stderr, "journal: %s is damaged, restored what could be read\n",
+                snapRecords < 0 ? JOURNAL_SNAPSHOT_FILE : JOURNAL_WAL_FILE);
+
+    // 2) Compact right away, the next log starts from this state
+    commit_interval_ms = commit_ms > 0 ? commit_ms : JOURNAL_COMMIT_MS_DEFAULT;
+    pending = malloc(JOURNAL_BUFFER_MIN);
+    spare = malloc(JOURNAL_BUFFER_MIN);
+    if (!pending || !spare)
+    {
+        perror("journal: open");
+        return -1;
+    }
+    pending_cap = spare_cap = JOURNAL_BUFFER_MIN;
+
+    pthread_mutex_lock(&commit_lock);
+    sequence = seq;
+    long members = journal_snapshot_locked();
+    pthread_mutex_unlock(&commit_lock);
+    if (members < 0)
+        return -1;
+
+    // 3) Start logging
+    __atomic_store_n(&journal_active, 1, __ATOMIC_RELEASE);
+    pthread_t thread;
+    int rc = pthread_create(&thread, NULL, journal_main, NULL);
+    if (rc != 0)
+    {
+        journal_fail("journal: commit thread", rc);
+        return -1;
+    }
+    pthread_detach(thread);
+
+    struct timespec done;
+    clock_gettime(CLOCK_MONOTONIC, &done);
+    long ms = (done.tv_sec - started.tv_sec) * 1000 + (done.tv_nsec - started.tv_nsec) / 1000000;
+    if (snapRecords + walRecords > 0)
+        printf("Restored %ld swarm membership(s) of %zu peer(s) from %s + %s in %ld ms\n",
+               members, peer_registry_count(), JOURNAL_SNAPSHOT_FILE, JOURNAL_WAL_FILE, ms);
+    return members;
+}
+
+void journal_flush(void)
+{
+    if (!journal_on())
+        return;
+    pthread_mutex_lock(&commit_lock);
+    journal_commit_locked();
+    pthread_mutex_unlock(&commit_lock);
+}
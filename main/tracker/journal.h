@@ -0,0 +1,100 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "peer_registry.h" // PeerHandle, PeerKey
+#include "swarm.h"         // SwarmRole
+
+/*
+@brief Swarm state on disk: a compact snapshot plus a write ahead log, so a restart keeps every swarm
+
+The peer registry and swarm.c log each change while they still hold the lock that ordered it:
+    REGISTER / UNREGISTER  a peer entered / left the registry (with the handle it had in this run)
+    JOIN                   a peer seeds or leeches a file until a deadline (unix time)
+    LEAVE                  a peer stopped seeding or leeching a file
+    COUNTERS               the file's completed / uploaded / downloaded totals after the change
+Expiries are not logged, a replayed membership whose deadline passed is simply skipped.
+Replaying a record does not depend on the state it finds (COUNTERS keeps the larger value), so
+a record applied twice changes nothing.
+
+Group commit: records are copied into an in-memory buffer, one thread writes and fdatasync()s the buffer
+every commit window (-j, JOURNAL_COMMIT_MS_DEFAULT). Announcing threads never wait for the disk, a crash
+loses at most the last window, which peers redo with their next announce.
+
+Snapshot: every JOURNAL_SNAPSHOT_INTERVAL seconds (or once the log passes JOURNAL_WAL_MAX bytes) the log is
+cut, the live state is written as JOIN / REGISTER / COUNTERS records into JOURNAL_SNAPSHOT_FILE and the log
+starts over. Snapshot and log carry a sequence number, a log is only replayed on top of the snapshot
+with the same sequence, so a crash between the two renames is harmless.
+At start up journal_open() loads snapshot + log, then writes a fresh snapshot right away.
+Policy rules are saved on their own (policy.h, POLICY_SNAPSHOT_FILE).
+*/
+
+#define JOURNAL_SNAPSHOT_FILE "swarm.snap"
+#define JOURNAL_WAL_FILE "swarm.wal"
+#define JOURNAL_MAGIC "BMSWARM1"
+#define JOURNAL_VERSION 1
+#define JOURNAL_COMMIT_MS_DEFAULT 10
+#define JOURNAL_SNAPSHOT_INTERVAL 300          // seconds
+#define JOURNAL_WAL_MAX (64u * 1024 * 1024)    // bytes of log that trigger an early snapshot
+#define JOURNAL_BUFFER_MAX (32u * 1024 * 1024) // pending records, past it persistence stops (appenders never wait)
+
+typedef enum
+{
+    JOURNAL_REGISTER = 1,
+    JOURNAL_UNREGISTER,
+    JOURNAL_JOIN,
+    JOURNAL_LEAVE,
+    JOURNAL_COUNTERS
+} JournalRecordType;
+
+typedef struct JournalFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sequence; // the log replayed after a snapshot has the same sequence
+} JournalFileHeader;
+
+typedef struct JournalRecord
+{
+    uint16_t type;     // JournalRecordType
+    uint16_t role;     // SwarmRole of JOIN / LEAVE
+    uint32_t checksum; // FNV-1a of the record with this field zeroed, a torn tail fails it
+    PeerHandle peer;   // REGISTER / UNREGISTER / JOIN / LEAVE, as handed out by the run that wrote it
+    union
+    {
+        PeerKey key; // REGISTER
+        struct
+        {
+            int64_t fileID;
+            int64_t expires; // unix time, JOIN only
+        } member;
+        struct
+        {
+            int64_t fileID;
+            uint64_t completed;
+            uint64_t uploaded;
+            uint64_t downloaded;
+        } counters;
+    };
+} JournalRecord;
+
+/*
+Loads snapshot + log into the (empty) registry and swarms, writes a fresh snapshot and starts the
+commit thread. commit_ms is the group commit window. Returns how many memberships were restored, -1 on error
+(the tracker then runs without persistence)
+*/
+long journal_open(int commit_ms);
+/* Writes out every pending record, called on shutdown */
+void journal_flush(void);
+
+/* Logging hooks, no-ops until journal_open() succeeded */
+void journal_register(PeerHandle peer, const PeerKey *key);
+void journal_unregister(PeerHandle peer);
+void journal_join(ssize_t fileID, PeerHandle peer, SwarmRole role, uint64_t ttl);
+void journal_leave(ssize_t fileID, PeerHandle peer, SwarmRole role);
+void journal_counters(ssize_t fileID, const SwarmCounters *counters);
+
+#endif // JOURNAL_H
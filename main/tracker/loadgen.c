@@ -0,0 +1,791 @@
+#include <time.h>
+#include <signal.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include "tracker.h"
+#include "histogram.h"
+
+/*
+@brief Load generator: thousands of simulated peers speaking the tracker protocol, to size tracker hardware
+and catch throughput / latency regressions.
+
+    ./loadgen [-h ip:port] [-c peers] [-t threads] [-d seconds] [-r requests_per_second] [-f files] [-m mix]
+
+Every simulated peer has its own TCP connection and its own identity (127.0.0.1, port LOADGEN_PEER_PORT_BASE + n).
+It registers first (MSG_REQUEST_CREATE_SEEDER), then sends one request at a time, picked by the mix:
+    register     MSG_REQUEST_CREATE_SEEDER
+    participate  MSG_REQUEST_PARTICIPATE_SEED_BY_FILEID
+    lookup       MSG_REQUEST_SEEDER_BY_FILEID (compact, up to LOADGEN_LOOKUP_PEERS seeders)
+    catalog      MSG_REQUEST_ALL_AVAILABLE_SEED, the first page of LOADGEN_CATALOG_PAGE entries
+    announce     MSG_REQUEST_ANNOUNCE as a leecher
+The mix is a list of weights, e.g. -m lookup=8,participate=2,catalog=1 (the others are then 0).
+fileIDs are drawn from the first -f files of the tracker catalog, missing ones are created (loadgen_<n>).
+
+Closed loop by default: every peer sends its next request as soon as the reply arrived, which measures
+the tracker's capacity. With -r the requests are sent on a fixed schedule instead, and a request's latency
+counts from the time it was due: a tracker that falls behind shows it in the percentiles rather than
+slowing the generator down with it (no coordinated omission).
+Per request type the report gives requests/s, errors and p50 / p99 / p99.9 / max latency.
+*/
+
+#define LOADGEN_PEERS_DEFAULT 1000
+#define LOADGEN_THREADS_DEFAULT 4
+#define LOADGEN_SECONDS_DEFAULT 10
+#define LOADGEN_FILES_DEFAULT 64
+#define LOADGEN_MIX_DEFAULT "register=1,participate=3,lookup=10,catalog=1,announce=5"
+#define LOADGEN_PEER_PORT_BASE 20000
+#define LOADGEN_LOOKUP_PEERS 50
+#define LOADGEN_CATALOG_PAGE 64
+#define LOADGEN_DRAIN_MS 2000 // how long the last replies are waited for once the run is over
+#define LOADGEN_BODY_MAX (64 * 1024 * 1024) // a larger bodySize means we lost the framing
+
+typedef enum
+{
+    OP_REGISTER = 0,
+    OP_PARTICIPATE,
+    OP_LOOKUP,
+    OP_CATALOG,
+    OP_ANNOUNCE,
+    OP_COUNT
+} LoadOp;
+
+static const char *op_names[OP_COUNT] = {"register", "participate", "lookup", "catalog", "announce"};
+
+typedef enum
+{
+    REPLY_HEADER, // collecting the TrackerMessageHeader
+    REPLY_BODY,   // discarding bodySize bytes
+    REPLY_TEXT    // plain text answer, ends with '\n' (create seeder and some failures)
+} ReplyState;
+
+typedef struct LoadPeer
+{
+    int fd;
+    int busy; // a request is in flight
+    int registered;
+    LoadOp op;
+    uint64_t due_ns; // when the request was due, latency counts from here
+    ReplyState state;
+    TrackerMessageHeader header;
+    size_t have; // header bytes collected
+    size_t body_left;
+    char port[16];
+} LoadPeer;
+
+typedef struct OpStats
+{
+    Histogram latency; // nanoseconds
+    uint64_t errors;
+} OpStats;
+
+typedef struct LoadThread
+{
+    pthread_t thread;
+    LoadPeer *peers;
+    size_t count;
+    int epoll_fd;
+    uint64_t rng;
+    size_t *idle; // FIFO of the peers without a request in flight (open loop), every peer gets its turn
+    size_t idle_head;
+    size_t idle_count;
+    uint64_t next_due_ns;
+    uint64_t interval_ns; // 0 = closed loop
+    uint64_t connect_errors;
+    OpStats stats[OP_COUNT];
+} LoadThread;
+
+static struct sockaddr_storage target;
+static socklen_t target_len;
+static unsigned mix[OP_COUNT];
+static unsigned mix_total;
+static ssize_t *file_ids;
+static size_t file_count;
+static volatile sig_atomic_t stopping;
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t next_random(uint64_t *state)
+{
+    // xorshift64*, one per thread
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dull;
+}
+
+static int parse_mix(const char *text)
+{
+    memset(mix, 0, sizeof(mix));
+    mix_total = 0;
+    char *copy = strdup(text);
+    if (!copy)
+        return -1;
+
+    int rc = 0;
+    for (char *save = NULL, *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save))
+    {
+        char *eq = strchr(item, '=');
+        int op = -1;
+        if (eq)
+        {
+            *eq = '\0';
+            for (int i = 0; i < OP_COUNT; i++)
+                if (strcmp(item, op_names[i]) == 0)
+                    op = i;
+        }
+        if (op < 0)
+        {
+            fprintf(stderr, "Unknown mix entry %s, expected name=weight with name in register, participate, lookup, catalog, announce\n", item);
+            rc = -1;
+            break;
+        }
+        mix[op] = (unsigned)atoi(eq + 1);
+        mix_total += mix[op];
+    }
+    free(copy);
+    return rc == 0 && mix_total > 0 ? 0 : -1;
+}
+
+static LoadOp pick_op(LoadThread *t)
+{
+    unsigned r = (unsigned)(next_random(&t->rng) % mix_total);
+    for (int i = 0; i < OP_COUNT; i++)
+    {
+        if (r < mix[i])
+            return (LoadOp)i;
+        r -= mix[i];
+    }
+    return OP_LOOKUP;
+}
+
+/* TCP connection to the tracker, blocking for the set up, non blocking for the worker threads */
+static int connect_target(int nonblocking)
+{
+    int fd = socket(target.ss_family, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr *)&target, target_len) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if (nonblocking)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len)
+{
+    char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Set up: the fileIDs requests are spread over
+   -------------------------------------------------------------------------- */
+static int load_file_ids(size_t wanted)
+{
+    int fd = connect_target(0);
+    if (fd < 0)
+    {
+        perror("loadgen: connect");
+        return -1;
+    }
+    file_ids = calloc(wanted, sizeof(ssize_t));
+    if (!file_ids)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Existing files first
+    TrackerMessageHeader header = {0};
+    CatalogPageRequest page = {0, (ssize_t)wanted};
+    CatalogPageHeader reply;
+    header.type = MSG_REQUEST_ALL_AVAILABLE_SEED;
+    header.bodySize = sizeof(page);
+    if (write_all(fd, &header, sizeof(header)) < 0 || write_all(fd, &page, sizeof(page)) < 0 ||
+        read_all(fd, &header, sizeof(header)) < 0 || header.type != MSG_ACK_CATALOG_PAGE ||
+        read_all(fd, &reply, sizeof(reply)) < 0)
+    {
+        fprintf(stderr, "loadgen: catalog listing failed\n");
+        close(fd);
+        return -1;
+    }
+    for (ssize_t i = 0; i < reply.count; i++)
+    {
+        FileEntry entry;
+        if (read_all(fd, &entry, sizeof(entry)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        if (file_count < wanted)
+            file_ids[file_count++] = entry.fileID;
+    }
+
+    // Then our own, with a fixed hash per index so a second run finds them again
+    for (size_t n = 0; file_count < wanted; n++)
+    {
+        FileMetadata meta;
+        memset(&meta, 0, sizeof(meta));
+        snprintf(meta.filename, sizeof(meta.filename), "loadgen_%zu", n);
+        meta.fileID = -1;
+        meta.totalByte = 1024 * 1024;
+        meta.totalChunk = meta.totalByte / 1024;
+        memcpy(meta.fileHash, "loadgen-", 8);
+        memcpy(meta.fileHash + 8, &n, sizeof(n));
+
+        ssize_t fileID;
+        header.type = MSG_REQUEST_CREATE_NEW_SEED;
+        header.bodySize = sizeof(meta);
+        if (write_all(fd, &header, sizeof(header)) < 0 || write_all(fd, &meta, sizeof(meta)) < 0 ||
+            read_all(fd, &header, sizeof(header)) < 0 || header.type != MSG_ACK_CREATE_NEW_SEED ||
+            header.bodySize != sizeof(fileID) || read_all(fd, &fileID, sizeof(fileID)) < 0)
+        {
+            fprintf(stderr, "loadgen: creating %s failed\n", meta.filename);
+            close(fd);
+            return -1;
+        }
+
+        size_t i = 0;
+        while (i < file_count && file_ids[i] != fileID)
+            i++;
+        if (i == file_count)
+            file_ids[file_count++] = fileID; // an existing file with our hash is already in the list
+    }
+    close(fd);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Requests and replies
+   -------------------------------------------------------------------------- */
+static void peer_info(const LoadPeer *peer, PeerInfo *info)
+{
+    memset(info, 0, sizeof(*info));
+    strcpy(info->ip_address, "127.0.0.1");
+    strncpy(info->port, peer->port, sizeof(info->port) - 1);
+}
+
+static int send_request(LoadThread *t, LoadPeer *peer, uint64_t due_ns)
+{
+    LoadOp op = peer->registered ? pick_op(t) : OP_REGISTER;
+    ssize_t fileID = file_ids[next_random(&t->rng) % file_count];
+
+    // Header and body go out in one write, requests are a few hundred bytes
+    char buf[sizeof(TrackerMessageHeader) + sizeof(AnnounceRequest) + sizeof(FileMetadata)];
+    TrackerMessageHeader *header = (TrackerMessageHeader *)buf;
+    void *body = buf + sizeof(TrackerMessageHeader);
+    memset(buf, 0, sizeof(buf));
+
+    switch (op)
+    {
+    case OP_REGISTER:
+        header->type = MSG_REQUEST_CREATE_SEEDER;
+        header->bodySize = sizeof(PeerInfo);
+        peer_info(peer, body);
+        break;
+    case OP_PARTICIPATE:
+    {
+        PeerWithFileID *req = body;
+        header->type = MSG_REQUEST_PARTICIPATE_SEED_BY_FILEID;
+        header->bodySize = sizeof(*req);
+        peer_info(peer, &req->singleSeeder);
+        req->fileID = fileID;
+        break;
+    }
+    case OP_LOOKUP:
+    {
+        SeederListRequest *req = body;
+        header->type = MSG_REQUEST_SEEDER_BY_FILEID;
+        header->bodySize = sizeof(*req);
+        req->fileID = fileID;
+        req->maxPeers = LOADGEN_LOOKUP_PEERS;
+        req->flags = SEEDER_REQUEST_COMPACT;
+        break;
+    }
+    case OP_CATALOG:
+    {
+        CatalogPageRequest *req = body;
+        header->type = MSG_REQUEST_ALL_AVAILABLE_SEED;
+        header->bodySize = sizeof(*req);
+        req->cursor = 0;
+        req->maxEntries = LOADGEN_CATALOG_PAGE;
+        break;
+    }
+    default:
+    {
+        AnnounceRequest *req = body;
+        header->type = MSG_REQUEST_ANNOUNCE;
+        header->bodySize = sizeof(*req);
+        peer_info(peer, &req->peer);
+        req->fileID = fileID;
+        req->event = ANNOUNCE_EVENT_STARTED;
+        req->left = 1024 * 1024;
+        break;
+    }
+    }
+
+    peer->op = op;
+    peer->due_ns = due_ns;
+    peer->state = op == OP_REGISTER ? REPLY_TEXT : REPLY_HEADER;
+    peer->have = 0;
+    peer->busy = 1;
+    size_t len = sizeof(TrackerMessageHeader) + (size_t)header->bodySize;
+    return write(peer->fd, buf, len) == (ssize_t)len ? 0 : -1; // the socket buffer is empty, one request in flight
+}
+
+static void finish_request(LoadThread *t, LoadPeer *peer, int error)
+{
+    OpStats *stats = &t->stats[peer->op];
+    histogram_record(&stats->latency, now_ns() - peer->due_ns);
+    if (error)
+        stats->errors++;
+    if (peer->op == OP_REGISTER && !error)
+        peer->registered = 1;
+    peer->busy = 0;
+}
+
+static int is_error_reply(TrackerMessageType type)
+{
+    return type == MSG_RESPOND_ERROR || type == MSG_ACK_FILEHASH_BLOCKED || type == MSG_ACK_IP_BLOCKED ||
+           type == MSG_ACK_WRONG_SHARD;
+}
+
+/*
+@brief Feeds received bytes to the reply parser of peer
+@return 1 when the reply is complete, 0 when more bytes are needed, -1 when the stream makes no sense
+*/
+static int consume_reply(LoadThread *t, LoadPeer *peer, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        switch (peer->state)
+        {
+        case REPLY_TEXT:
+            if (data[len - 1] == '\n')
+            {
+                // register answers with text, any other request only does so when it failed
+                finish_request(t, peer, peer->op != OP_REGISTER || strstr(data, "No space") != NULL);
+                return 1;
+            }
+            return 0;
+        case REPLY_HEADER:
+        {
+            size_t take = sizeof(peer->header) - peer->have;
+            if (take > len)
+                take = len;
+            memcpy((char *)&peer->header + peer->have, data, take);
+            peer->have += take;
+            data += take;
+            len -= take;
+            if (peer->have < sizeof(peer->header))
+                return 0;
+            if ((unsigned)peer->header.type > MSG_ACK_WRONG_SHARD || peer->header.bodySize < 0 ||
+                peer->header.bodySize > LOADGEN_BODY_MAX)
+            {
+                // a text answer where a header was expected
+                peer->state = REPLY_TEXT;
+                if (memchr(&peer->header, '\n', sizeof(peer->header)) || (len > 0 && data[len - 1] == '\n'))
+                {
+                    finish_request(t, peer, 1);
+                    return 1;
+                }
+                break;
+            }
+            peer->body_left = (size_t)peer->header.bodySize;
+            peer->state = REPLY_BODY;
+            break;
+        }
+        case REPLY_BODY:
+        {
+            size_t take = peer->body_left < len ? peer->body_left : len;
+            peer->body_left -= take;
+            data += take;
+            len -= take;
+            break;
+        }
+        }
+
+        if (peer->state == REPLY_BODY && peer->body_left == 0)
+        {
+            finish_request(t, peer, is_error_reply(peer->header.type));
+            return len == 0 ? 1 : -1; // nothing may follow, we only had one request in flight
+        }
+    }
+    return 0;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Worker threads
+   -------------------------------------------------------------------------- */
+static int open_peer(LoadThread *t, size_t index)
+{
+    LoadPeer *peer = &t->peers[index];
+    peer->fd = connect_target(1);
+    peer->busy = 0;
+    peer->registered = 0;
+    if (peer->fd < 0)
+    {
+        t->connect_errors++;
+        return -1;
+    }
+    struct epoll_event ev = {.events = EPOLLIN, .data.u64 = index};
+    return epoll_ctl(t->epoll_fd, EPOLL_CTL_ADD, peer->fd, &ev);
+}
+
+/* A broken connection counts its request as an error, the peer reconnects and registers again */
+static void reset_peer(LoadThread *t, size_t index)
+{
+    LoadPeer *peer = &t->peers[index];
+    if (peer->busy)
+    {
+        t->stats[peer->op].errors++;
+        peer->busy = 0;
+    }
+    if (peer->fd >= 0)
+    {
+        epoll_ctl(t->epoll_fd, EPOLL_CTL_DEL, peer->fd, NULL);
+        close(peer->fd);
+    }
+    open_peer(t, index);
+}
+
+static void push_idle(LoadThread *t, size_t index)
+{
+    t->idle[(t->idle_head + t->idle_count++) % t->count] = index;
+}
+
+static size_t pop_idle(LoadThread *t)
+{
+    size_t index = t->idle[t->idle_head];
+    t->idle_head = (t->idle_head + 1) % t->count;
+    t->idle_count--;
+    return index;
+}
+
+/* Idle peer -> next request, due now (closed loop) or at the schedule (open loop) */
+static void start_request(LoadThread *t, size_t index, uint64_t due_ns)
+{
+    LoadPeer *peer = &t->peers[index];
+    if (peer->fd < 0 || send_request(t, peer, due_ns) < 0)
+        reset_peer(t, index);
+}
+
+static void *load_thread_main(void *arg)
+{
+    LoadThread *t = arg;
+    struct epoll_event events[256];
+    static __thread char scratch[64 * 1024];
+
+    for (size_t i = 0; i < t->count; i++)
+    {
+        open_peer(t, i);
+        if (t->interval_ns == 0)
+            start_request(t, i, now_ns());
+        else
+            push_idle(t, i);
+    }
+    t->next_due_ns = now_ns();
+
+    uint64_t drain_until = 0;
+    for (;;)
+    {
+        uint64_t now = now_ns();
+        if (stopping && drain_until == 0)
+            drain_until = now + LOADGEN_DRAIN_MS * 1000000ull;
+        if (drain_until && now >= drain_until)
+            break;
+
+        // Open loop: everything that is due goes out, on any idle peer
+        while (!stopping && t->interval_ns && t->next_due_ns <= now && t->idle_count > 0)
+        {
+            size_t index = pop_idle(t);
+            start_request(t, index, t->next_due_ns);
+            t->next_due_ns += t->interval_ns;
+        }
+
+        int timeout_ms = 10;
+        if (t->interval_ns && !stopping && t->idle_count > 0)
+            timeout_ms = t->next_due_ns > now ? (int)((t->next_due_ns - now) / 1000000) : 0;
+        int n = epoll_wait(t->epoll_fd, events, 256, timeout_ms);
+
+        size_t busy = 0;
+        for (int e = 0; e < n; e++)
+        {
+            size_t index = (size_t)events[e].data.u64;
+            LoadPeer *peer = &t->peers[index];
+            ssize_t got = read(peer->fd, scratch, sizeof(scratch) - 1);
+            if (got < 0 && (errno == EAGAIN || errno == EINTR))
+                continue;
+            if (got > 0)
+                scratch[got] = '\0'; // text replies are searched with strstr()
+            int done = got > 0 && peer->busy ? consume_reply(t, peer, scratch, (size_t)got) : -1;
+            if (done == 0)
+                continue;
+            if (done < 0)
+                reset_peer(t, index);
+
+            if (stopping)
+                continue;
+            if (t->interval_ns == 0)
+                start_request(t, index, now_ns());
+            else
+                push_idle(t, index);
+        }
+
+        if (stopping)
+        {
+            for (size_t i = 0; i < t->count; i++)
+                busy += t->peers[i].busy;
+            if (busy == 0)
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < t->count; i++)
+    {
+        if (t->peers[i].busy)
+            t->stats[t->peers[i].op].errors++; // never answered
+        if (t->peers[i].fd >= 0)
+            close(t->peers[i].fd);
+    }
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Report
+   -------------------------------------------------------------------------- */
+static void print_row(const char *name, const OpStats *stats, double seconds)
+{
+    const Histogram *h = &stats->latency;
+    printf("%-12s %10llu %11.1f %8llu %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, (unsigned long long)h->total,
+           (double)h->total / seconds, (unsigned long long)stats->errors, histogram_mean(h) / 1000.0,
+           histogram_quantile(h, 0.50) / 1000.0, histogram_quantile(h, 0.99) / 1000.0,
+           histogram_quantile(h, 0.999) / 1000.0, h->max / 1000.0);
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-h ip:port] [-c peers] [-t threads] [-d seconds] [-r requests_per_second] [-f files] [-m mix]\n"
+                    "  mix default: %s\n",
+            prog, LOADGEN_MIX_DEFAULT);
+}
+
+int main(int argc, char *argv[])
+{
+    char ip[SHARD_ADDR_MAX] = SERVER_IP;
+    int port = SERVER_PORT;
+    long peers = LOADGEN_PEERS_DEFAULT, threads = LOADGEN_THREADS_DEFAULT, seconds = LOADGEN_SECONDS_DEFAULT;
+    long files = LOADGEN_FILES_DEFAULT;
+    double rate = 0;
+    const char *mixText = LOADGEN_MIX_DEFAULT;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "h:c:t:d:r:f:m:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'h':
+            if (shard_parse_address(optarg, ip, sizeof(ip), &port) < 0)
+            {
+                fprintf(stderr, "-h expects ip:port, got %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'c':
+            peers = strtol(optarg, NULL, 10);
+            break;
+        case 't':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 'd':
+            seconds = strtol(optarg, NULL, 10);
+            break;
+        case 'r':
+            rate = strtod(optarg, NULL);
+            break;
+        case 'f':
+            files = strtol(optarg, NULL, 10);
+            break;
+        case 'm':
+            mixText = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (peers <= 0 || threads <= 0 || seconds <= 0 || files <= 0 || rate < 0 || parse_mix(mixText) < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads > peers)
+        threads = peers;
+    if (peers > 65535 - LOADGEN_PEER_PORT_BASE)
+    {
+        fprintf(stderr, "At most %d peers, their ports start at %d\n", 65535 - LOADGEN_PEER_PORT_BASE, LOADGEN_PEER_PORT_BASE);
+        return 1;
+    }
+
+    char portText[16];
+    struct addrinfo hints = {0}, *addr;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    snprintf(portText, sizeof(portText), "%d", port);
+    if (getaddrinfo(ip, portText, &hints, &addr) != 0)
+    {
+        fprintf(stderr, "Invalid tracker address %s\n", ip);
+        return 1;
+    }
+    memcpy(&target, addr->ai_addr, addr->ai_addrlen);
+    target_len = addr->ai_addrlen;
+    freeaddrinfo(addr);
+
+    // One descriptor per peer, plus a few
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)peers + 64)
+    {
+        limit.rlim_cur = limit.rlim_max < (rlim_t)peers + 64 ? limit.rlim_max : (rlim_t)peers + 64;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+
+    if (load_file_ids((size_t)files) < 0)
+        return 1;
+    printf("Tracker %s:%d, %ld peers on %ld threads, %zu files, %s for %lds, mix %s\n", ip, port, peers, threads,
+           file_count, rate > 0 ? "open loop" : "closed loop", seconds, mixText);
+
+    LoadThread *workers = calloc((size_t)threads, sizeof(LoadThread));
+    LoadPeer *peerList = calloc((size_t)peers, sizeof(LoadPeer));
+    size_t *idleList = calloc((size_t)peers, sizeof(size_t));
+    if (!workers || !peerList || !idleList)
+    {
+        perror("loadgen: calloc");
+        return 1;
+    }
+
+    uint64_t start = now_ns();
+    size_t first = 0;
+    for (long i = 0; i < threads; i++)
+    {
+        LoadThread *t = &workers[i];
+        size_t count = (size_t)(peers / threads + (i < peers % threads));
+        t->peers = peerList + first;
+        t->idle = idleList + first;
+        t->count = count;
+        t->rng = 0x9e3779b97f4a7c15ull * (uint64_t)(i + 1) ^ start;
+        t->interval_ns = rate > 0 ? (uint64_t)(1e9 * (double)threads / rate) : 0;
+        if (rate > 0 && t->interval_ns == 0)
+            t->interval_ns = 1;
+        for (size_t p = 0; p < count; p++)
+        {
+            t->peers[p].fd = -1;
+            snprintf(t->peers[p].port, sizeof(t->peers[p].port), "%zu", LOADGEN_PEER_PORT_BASE + first + p);
+        }
+        for (int op = 0; op < OP_COUNT; op++)
+            histogram_init(&t->stats[op].latency);
+        first += count;
+
+        t->epoll_fd = epoll_create1(0);
+        if (t->epoll_fd < 0 || pthread_create(&t->thread, NULL, load_thread_main, t) != 0)
+        {
+            perror("loadgen: thread");
+            return 1;
+        }
+    }
+
+    struct timespec pause = {seconds, 0};
+    while (nanosleep(&pause, &pause) < 0 && errno == EINTR && !stopping)
+        ;
+    stopping = 1;
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    OpStats total[OP_COUNT], all;
+    uint64_t connectErrors = 0;
+    memset(&all, 0, sizeof(all));
+    histogram_init(&all.latency);
+    for (int op = 0; op < OP_COUNT; op++)
+    {
+        memset(&total[op], 0, sizeof(total[op]));
+        histogram_init(&total[op].latency);
+    }
+    for (long i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        close(workers[i].epoll_fd);
+        connectErrors += workers[i].connect_errors;
+        for (int op = 0; op < OP_COUNT; op++)
+        {
+            histogram_merge(&total[op].latency, &workers[i].stats[op].latency);
+            total[op].errors += workers[i].stats[op].errors;
+        }
+    }
+
+    printf("\n%-12s %10s %11s %8s %9s %9s %9s %9s %9s\n", "request", "count", "req/s", "errors", "mean(us)", "p50(us)",
+           "p99(us)", "p99.9(us)", "max(us)");
+    for (int op = 0; op < OP_COUNT; op++)
+    {
+        if (total[op].latency.total == 0 && total[op].errors == 0)
+            continue;
+        print_row(op_names[op], &total[op], elapsed);
+        histogram_merge(&all.latency, &total[op].latency);
+        all.errors += total[op].errors;
+    }
+    print_row("all", &all, elapsed);
+    if (connectErrors)
+        printf("%llu connection(s) failed\n", (unsigned long long)connectErrors);
+
+    free(workers);
+    free(peerList);
+    free(idleList);
+    free(file_ids);
+    return all.errors > 0 || connectErrors > 0 ? 2 : 0;
+}
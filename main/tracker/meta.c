@@ -15,29 +15,13 @@ Generating the filepath for the metafile
 
 
 uint8_t* get_filehash_by_fileid(ssize_t fileID) {
-    static uint8_t hash[32]; // Static buffer to return
-    
-    // Generate metadata file path
-    char* filepath = build_metafile_path_by_fileid(fileID);
-    if (!filepath) return NULL;
-    
-    // Open metadata file
-    FILE* file = fopen(filepath, "rb");
-    free(filepath); // Free the filepath memory
-    
-    if (!file) return NULL;
-    
-    // Read metadata structure
-    FileMetadata metadata;
-    if (fread(&metadata, sizeof(FileMetadata), 1, file) != 1) {
-        fclose(file);
-        return NULL;
-    }
-    
-    // Copy file hash to our static buffer
-    memcpy(hash, metadata.fileHash, 32);
-    
-    fclose(file);
+    static __thread uint8_t hash[32]; // Per-thread buffer to return, workers look up hashes concurrently
+
+    // Served from the in-memory catalog, no file is opened on the request path
+    const CatalogEntry *entry = catalog_lookup(fileID);
+    if (!entry) return NULL;
+
+    memcpy(hash, entry->meta.fileHash, 32);
     return hash;
 }
 
@@ -47,7 +31,15 @@ char* build_metafile_path_by_fileid(ssize_t fileID)
     if (filename == NULL)
         return NULL;
 
-    snprintf(filename, 256, "%s/%s", RECORDS_FOLDER, get_meta_filename(fileID));
+    char *metaFilename = get_meta_filename(fileID);
+    if (metaFilename == NULL)
+    {
+        free(filename);
+        return NULL;
+    }
+
+    snprintf(filename, 256, "%s/%s", RECORDS_FOLDER, metaFilename);
+    free(metaFilename);
     return filename;
 }
 
@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "metrics.h"
+
+#define METRICS_LINE 64 // shards are cache line aligned, two cores never write the same line
+
+typedef struct MetricsShard
+{
+    uint64_t *counters;
+    Histogram **histograms;         // one per id, allocated on its first record
+    struct MetricsShard *next_free; // parked by an exiting thread, under registry_lock
+} MetricsShard;
+
+static const char *const *counter_names;
+static size_t counter_count;
+static const char *const *histogram_names;
+static size_t histogram_count;
+static uint64_t started_ns;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static MetricsShard *shards[METRICS_THREADS_MAX];
+static size_t shard_count; // atomic, shards[0..shard_count) are published
+static MetricsShard *free_shards;
+static pthread_key_t thread_key; // its destructor parks the shard of an exiting thread
+static __thread MetricsShard *local_shard;
+
+// Threads beyond METRICS_THREADS_MAX: atomic counters, histograms under shared_lock
+static MetricsShard shared_shard;
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *dump_path;
+static int dump_interval;
+
+typedef struct TextBuffer
+{
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} TextBuffer;
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static MetricsShard *shard_new(void)
+{
+    MetricsShard *shard = calloc(1, sizeof(MetricsShard));
+    size_t bytes = (counter_count * sizeof(uint64_t) + METRICS_LINE - 1) / METRICS_LINE * METRICS_LINE;
+    if (!shard)
+        return NULL;
+    shard->counters = aligned_alloc(METRICS_LINE, bytes ? bytes : METRICS_LINE);
+    shard->histograms = calloc(histogram_count ? histogram_count : 1, sizeof(Histogram *));
+    if (!shard->counters || !shard->histograms)
+    {
+        free(shard->counters);
+        free(shard->histograms);
+        free(shard);
+        return NULL;
+    }
+    memset(shard->counters, 0, bytes);
+    return shard;
+}
+
+/* Totals are kept: the next thread goes on counting in the same shard */
+static void shard_park(void *arg)
+{
+    MetricsShard *shard = arg;
+    pthread_mutex_lock(&registry_lock);
+    shard->next_free = free_shards;
+    free_shards = shard;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static MetricsShard *shard_get(void)
+{
+    MetricsShard *shard = local_shard;
+    if (shard)
+        return shard;
+
+    pthread_mutex_lock(&registry_lock);
+    shard = free_shards;
+    if (shard)
+        free_shards = shard->next_free;
+    else if (shard_count < METRICS_THREADS_MAX && (shard = shard_new()) != NULL)
+    {
+        shards[shard_count] = shard;
+        __atomic_store_n(&shard_count, shard_count + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (shard)
+        pthread_setspecific(thread_key, shard);
+    else
+        shard = &shared_shard;
+    local_shard = shard;
+    return shard;
+}
+
+static void append(TextBuffer *out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void append(TextBuffer *out, const char *format, ...)
+{
+    if (out->failed)
+        return;
+    for (;;)
+    {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(out->data + out->len, out->cap - out->len, format, args);
+        va_end(args);
+        if (n < 0)
+        {
+            out->failed = 1;
+            return;
+        }
+        if ((size_t)n < out->cap - out->len)
+        {
+            out->len += (size_t)n;
+            return;
+        }
+
+        size_t cap = out->cap ? out->cap * 2 : 4096;
+        while (cap - out->len <= (size_t)n)
+            cap *= 2;
+        char *data = realloc(out->data, cap);
+        if (!data)
+        {
+            out->failed = 1;
+            return;
+        }
+        out->data = data;
+        out->cap = cap;
+    }
+}
+
+static uint64_t counter_total(size_t counter, size_t live)
+{
+    uint64_t total = __atomic_load_n(&shared_shard.counters[counter], __ATOMIC_RELAXED);
+    for (size_t s = 0; s < live; s++)
+        total += __atomic_load_n(&shards[s]->counters[counter], __ATOMIC_RELAXED);
+    return total;
+}
+
+static void histogram_total(size_t histogram, size_t live, Histogram *into)
+{
+    histogram_init(into);
+    pthread_mutex_lock(&shared_lock);
+    if (shared_shard.histograms[histogram])
+        histogram_merge(into, shared_shard.histograms[histogram]);
+    pthread_mutex_unlock(&shared_lock);
+
+    for (size_t s = 0; s < live; s++)
+    {
+        const Histogram *part = __atomic_load_n(&shards[s]->histograms[histogram], __ATOMIC_ACQUIRE);
+        if (part)
+            histogram_merge(into, part);
+    }
+}
+
+static char *snapshot(int json)
+{
+    Histogram *merged = malloc(sizeof(Histogram));
+    if (!merged)
+        return NULL;
+
+    TextBuffer out = {0};
+    size_t live = __atomic_load_n(&shard_count, __ATOMIC_ACQUIRE);
+    double uptime = (double)(metrics_now_ns() - started_ns) / 1e9;
+    if (json)
+        append(&out, "{\"uptime_s\":%.1f,\"counters\":{", uptime);
+    else
+        append(&out, "%-28s %.1f s\n", "uptime", uptime);
+
+    const char *separator = "";
+    for (size_t c = 0; c < counter_count; c++)
+    {
+        if (!counter_names[c])
+            continue;
+        if (json)
+            append(&out, "%s\"%s\":%" PRIu64, separator, counter_names[c], counter_total(c, live));
+        else
+            append(&out, "%-28s %" PRIu64 "\n", counter_names[c], counter_total(c, live));
+        separator = ",";
+    }
+
+    if (json)
+        append(&out, "},\"latency_ns\":{");
+    else
+        append(&out, "\n%-28s %10s %10s %10s %10s %10s %10s\n", "latency (us)", "count", "mean", "p50", "p99", "p99.9", "max");
+
+    separator = "";
+    for (size_t h = 0; h < histogram_count; h++)
+    {
+        if (!histogram_names[h])
+            continue;
+        histogram_total(h, live, merged);
+        if (merged->total == 0)
+            continue;
+
+        if (json)
+            append(&out, "%s\"%s\":{\"count\":%" PRIu64 ",\"mean\":%.0f,\"p50\":%" PRIu64 ",\"p90\":%" PRIu64
+                         ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64 ",\"max\":%" PRIu64 "}",
+                   separator, histogram_names[h], merged->total, histogram_mean(merged),
+                   histogram_quantile(merged, 0.50), histogram_quantile(merged, 0.90),
+                   histogram_quantile(merged, 0.99), histogram_quantile(merged, 0.999), merged->max);
+        else
+            append(&out, "%-28s %10" PRIu64 " %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                   histogram_names[h], merged->total, histogram_mean(merged) / 1e3,
+                   histogram_quantile(merged, 0.50) / 1e3, histogram_quantile(merged, 0.99) / 1e3,
+                   histogram_quantile(merged, 0.999) / 1e3, merged->max / 1e3);
+        separator = ",";
+    }
+    if (json)
+        append(&out, "}}\n");
+    free(merged);
+
+    if (out.failed)
+    {
+        free(out.data);
+        return NULL;
+    }
+    return out.data;
+}
+
+static void *dump_main(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        sleep((unsigned int)dump_interval);
+        if (metrics_dump(dump_path) < 0)
+            perror("metrics: dump");
+    }
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int metrics_init(const char *const *counterNames, size_t counters,
+                 const char *const *histogramNames, size_t histograms)
+{
+    counter_names = counterNames;
+    counter_count = counters;
+    histogram_names = histogramNames;
+    histogram_count = histograms;
+    started_ns = metrics_now_ns();
+
+    shared_shard.counters = calloc(counters ? counters : 1, sizeof(uint64_t));
+    shared_shard.histograms = calloc(histograms ? histograms : 1, sizeof(Histogram *));
+    if (!shared_shard.counters || !shared_shard.histograms || pthread_key_create(&thread_key, shard_park) != 0)
+    {
+        counter_count = histogram_count = 0; // recording stays a no-op
+        return -1;
+    }
+    return 0;
+}
+
+void metrics_add(size_t counter, uint64_t n)
+{
+    if (counter >= counter_count)
+        return;
+
+    MetricsShard *shard = shard_get();
+    if (shard == &shared_shard)
+        __atomic_fetch_add(&shard->counters[counter], n, __ATOMIC_RELAXED);
+    else // only this thread writes it, no locked instruction needed
+        __atomic_store_n(&shard->counters[counter], shard->counters[counter] + n, __ATOMIC_RELAXED);
+}
+
+void metrics_record(size_t histogram, uint64_t ns)
+{
+    if (histogram >= histogram_count || !histogram_names[histogram])
+        return;
+
+    MetricsShard *shard = shard_get();
+    int shared = shard == &shared_shard;
+    if (shared)
+        pthread_mutex_lock(&shared_lock);
+
+    Histogram *h = shard->histograms[histogram];
+    if (!h && (h = malloc(sizeof(Histogram))) != NULL)
+    {
+        histogram_init(h);
+        __atomic_store_n(&shard->histograms[histogram], h, __ATOMIC_RELEASE);
+    }
+    if (h)
+        histogram_record(h, ns);
+
+    if (shared)
+        pthread_mutex_unlock(&shared_lock);
+}
+
+uint64_t metrics_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+char *metrics_json(void)
+{
+    return snapshot(1);
+}
+
+char *metrics_text(void)
+{
+    return snapshot(0);
+}
+
+int metrics_dump(const char *path)
+{
+    size_t len = strlen(path);
+    char *text = snapshot(len >= 5 && strcmp(path + len - 5, ".json") == 0);
+    if (!text)
+        return -1;
+
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    int rc = fp && fputs(text, fp) >= 0 ? 0 : -1;
+    if (fp && fclose(fp) != 0)
+        rc = -1;
+    if (rc == 0 && rename(tmp, path) < 0)
+        rc = -1;
+    if (rc < 0)
+        unlink(tmp);
+    free(text);
+    return rc;
+}
+
+int metrics_start_dump(const char *path, int interval)
+{
+    if (interval <= 0)
+        return -1;
+    dump_path = path;
+    dump_interval = interval;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, dump_main, NULL) != 0)
+        return -1;
+    pthread_detach(thread);
+    return 0;
+}
@@ -4,40 +4,44 @@
 #include <ctype.h>
 #include "parser.h"
 
-#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
-#define MAX_BLOCKED_FILEHASHES 1024
-#define MAX_BLOCKED_IPS 1024
-#define MAX_BLOCKED_BY_REGION 1024
-
-
-char *region_prefix[] = {
-    "36.", // china
-    "5.",  // russia
-    "185." // iran
-};
+#include <unistd.h>
+#include <pthread.h>
+#include "policy.h"
 
 char *region_name[] = {
     "CHINA",
     "RUSSIA",
     "IRAN"};
-// block filehash to specific region (for leeching)
-// 1. Leecher - request_seeder_by_fileID() -> We will simply return an empty list of seeders
-BlockFileToRegion list_blocked_filehash_to_region[2048]; // blocks filehash to specific region (for leeching)
-int list_blocked_filehash_to_region_count = 0;
-
-// block filehash from seeding and leeching
-// 1. Seeder - request_participate_seed_by_fileID() : if the metafile hash shares the same filehash, tracker will drop connection
-// 2. Leecher - request_seeder_by_fileID() : if the metafile hash shares the same filehash, tracker will drop connection
-uint8_t list_blocked_filehash[MAX_BLOCKED_FILEHASHES][32];
-int list_blocked_filehash_count = 0;
-
-// block ip from using 2 methods 
-// 1. Leecher request_seeder_by_fileID() -> We will simply return an empty list of seeders
-// 2. Seeder - request_participate_seed_by_fileID() -> We will drop the connection
-char list_blocked_ip[MAX_BLOCKED_IPS][64]; 
-int list_blocked_ip_count = 0;
+
+/*
+The rules themselves live in policy.c, the functions below edit them and print the result.
+execute_ast() publishes the edited rules once the whole command ran.
+
+block filehash to specific region (for leeching)
+1. Leecher - request_seeder_by_fileID() -> We will simply return an empty list of seeders
+
+block filehash from seeding and leeching
+1. Seeder - request_participate_seed_by_fileID() : if the metafile hash shares the same filehash, tracker will drop connection
+2. Leecher - request_seeder_by_fileID() : if the metafile hash shares the same filehash, tracker will drop connection
+
+block ip from using 2 methods
+1. Leecher request_seeder_by_fileID() -> We will simply return an empty list of seeders
+2. Seeder - request_participate_seed_by_fileID() -> We will drop the connection
+*/
+
+// Where the command functions print: stdout / stderr, or the admin connection during execute_ast()
+static __thread FILE *command_out;
+static __thread FILE *command_err;
+#define COMMAND_OUT (command_out ? command_out : stdout)
+#define COMMAND_ERR (command_err ? command_err : stderr)
+
+#define PARSE_ARENA_SIZE 65536 // per line of a rules file, far more than RULE_LINE_MAX needs
+#define RULE_LINE_MAX 1024
+
+// One command at a time, whether it comes from the CLI or the admin socket
+static pthread_mutex_t command_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /* Helper functions*/
 
@@ -45,11 +49,11 @@ void print_hash_hex(const uint8_t hash[32])
 {
     if (!hash)
     {
-        fputs("(null)", stdout);
+        fputs("(null)", COMMAND_OUT);
         return;
     }
     for (int i = 0; i < 32; ++i)
-        printf("%02x", hash[i]);
+        fprintf(COMMAND_OUT, "%02x", hash[i]);
 }
 
 int hash_equal(const uint8_t a[32], const uint8_t b[32])
@@ -57,169 +61,222 @@ int hash_equal(const uint8_t a[32], const uint8_t b[32])
     return memcmp(a, b, 32) == 0;
 }
 
-void block_ip(const char *ip)
+static void print_numbered_hash(const uint8_t hash[32], void *arg)
 {
-    for (int i = 0; i < list_blocked_ip_count; ++i)
-        if (strcmp(list_blocked_ip[i], ip) == 0)
-            return;
+    int *printed = arg;
+    fprintf(COMMAND_OUT, "%d. ", ++*printed);
+    print_hash_hex(hash);
+    fprintf(COMMAND_OUT, "\n");
+}
 
-    if (list_blocked_ip_count >= MAX_BLOCKED_IPS)
-        return;
-    strncpy(list_blocked_ip[list_blocked_ip_count++], ip, 63);
+static void print_numbered_ip(const char *ip, void *arg)
+{
+    int *printed = arg;
+    fprintf(COMMAND_OUT, "%d. %s\n", ++*printed, ip);
 }
 
-void allow_ip(const char *ip)
+static void count_hash(const uint8_t hash[32], void *arg)
 {
-    for (int i = 0; i < list_blocked_ip_count; ++i)
-        if (strcmp(list_blocked_ip[i], ip) == 0)
-        {
-            list_blocked_ip[i][0] =
-                list_blocked_ip[--list_blocked_ip_count][0];
-            strcpy(list_blocked_ip[i], list_blocked_ip[list_blocked_ip_count]);
-            return;
-        }
+    (void)hash;
+    ++*(int *)arg;
 }
 
-/* Parser functions*/
-void block_file_by_region(const uint8_t hash[32], Region region)
+static int region_rule_count(Region region)
 {
-    /* Check if it is already present */
-    for (int i = 0; i < list_blocked_filehash_to_region_count; ++i)
-        if (list_blocked_filehash_to_region[i].region == region &&
-            hash_equal(list_blocked_filehash_to_region[i].filehash, hash))
-        {
-            printf("\n--- Block filehash for region: %s ---\n", region_name[region]);
-            printf("Hash already exists:\n");
-            printf("1. ");
-            print_hash_hex(hash);
-            printf("\nTotal blocked filehash for region %s : %d\n", region_name[region], list_blocked_filehash_to_region_count);
-            printf("\n---- End of list ----\n\n");
-            return;
-        }
+    int count = 0;
+    policy_for_each_file_in_region(region, count_hash, &count);
+    return count;
+}
 
-    if (list_blocked_filehash_to_region_count >= 2048)
+int block_ip(const char *ip)
+{
+    if (policy_block_ip(ip) < 0)
     {
-        fprintf(stderr, "⚠ list_blocked_filehash_to_region full (2048)\n");
-        return;
+        fprintf(COMMAND_ERR, "[BLOCK_IP] not an IP address → %s\n", ip);
+        return -1;
     }
+    return 0;
+}
 
-    list_blocked_filehash_to_region[list_blocked_filehash_to_region_count].region = region;
-    memcpy(list_blocked_filehash_to_region[list_blocked_filehash_to_region_count].filehash,
-           hash, 32);
-    list_blocked_filehash_to_region_count++;
+int allow_ip(const char *ip)
+{
+    if (policy_allow_ip(ip) < 0)
+    {
+        fprintf(COMMAND_ERR, "[ALLOW_IP] not an IP address → %s\n", ip);
+        return -1;
+    }
+    return 0;
+}
 
-    printf("\n--- Added filehash into [blocked list by filehash for %s] ---\n\n", region_name[region]);
+/* Parser functions*/
+int block_file_by_region(const uint8_t hash[32], Region region)
+{
+    int added = policy_block_file_in_region(hash, region);
+    if (added < 0)
+    {
+        fprintf(COMMAND_ERR, "⚠ out of memory, filehash not blocked for region %s\n", region_name[region]);
+        return -1;
+    }
+    if (added == 0)
+    {
+        fprintf(COMMAND_OUT, "\n--- Block filehash for region: %s ---\n", region_name[region]);
+        fprintf(COMMAND_OUT, "Hash already exists:\n");
+        fprintf(COMMAND_OUT, "1. ");
+        print_hash_hex(hash);
+        fprintf(COMMAND_OUT, "\nTotal blocked filehash for region %s : %d\n", region_name[region], region_rule_count(region));
+        fprintf(COMMAND_OUT, "\n---- End of list ----\n\n");
+        return 0;
+    }
+
+    fprintf(COMMAND_OUT, "\n--- Added filehash into [blocked list by filehash for %s] ---\n\n", region_name[region]);
     print_hash_hex(hash);
-    printf("\n\nTotal blocked filehash for region %s : %d\n", region_name[region], list_blocked_filehash_to_region_count);
-    printf("\n---- End of list ----\n\n");
+    fprintf(COMMAND_OUT, "\n\nTotal blocked filehash for region %s : %d\n", region_name[region], region_rule_count(region));
+    fprintf(COMMAND_OUT, "\n---- End of list ----\n\n");
+    return 0;
 }
 
-void allow_file_by_region(const uint8_t hash[32], Region region)
+int allow_file_by_region(const uint8_t hash[32], Region region)
 {
-    for (int i = 0; i < list_blocked_filehash_to_region_count; ++i)
-        if (list_blocked_filehash_to_region[i].region == region &&
-            hash_equal(list_blocked_filehash_to_region[i].filehash, hash))
-        {
-            list_blocked_filehash_to_region[i] =
-                list_blocked_filehash_to_region[--list_blocked_filehash_to_region_count];
-
-            printf("\n--- Allow filehash from region: %s ---\n", region_name[region]);
-            printf("Removed:\n1. ");
-            print_hash_hex(hash);
-            printf("\nRemaining blocked filehash for region %s : %d\n", region_name[region], list_blocked_filehash_to_region_count);
-            printf("\n---- End of list ----\n\n");
-            return;
-        }
+    int removed = policy_allow_file_in_region(hash, region);
+    if (removed < 0)
+    {
+        fprintf(COMMAND_ERR, "⚠ out of memory, filehash not allowed for region %s\n", region_name[region]);
+        return -1;
+    }
+    if (removed > 0)
+    {
+        fprintf(COMMAND_OUT, "\n--- Allow filehash from region: %s ---\n", region_name[region]);
+        fprintf(COMMAND_OUT, "Removed:\n1. ");
+        print_hash_hex(hash);
+        fprintf(COMMAND_OUT, "\nRemaining blocked filehash for region %s : %d\n", region_name[region], region_rule_count(region));
+        fprintf(COMMAND_OUT, "\n---- End of list ----\n\n");
+        return 0;
+    }
 
-    printf("\n--- Allow filehash from region: %s ---\n", region_name[region]);
-    printf("Hash not found.\n");
-    printf("\n---- End of list ----\n\n");
+    fprintf(COMMAND_OUT, "\n--- Allow filehash from region: %s ---\n", region_name[region]);
+    fprintf(COMMAND_OUT, "Hash not found.\n");
+    fprintf(COMMAND_OUT, "\n---- End of list ----\n\n");
+    return 0;
 }
-void block_file(const uint8_t hash[32])
+int block_file(const uint8_t hash[32])
 {
+    int added = policy_block_file(hash);
+    if (added < 0)
+    {
+        fprintf(COMMAND_ERR, "⚠ out of memory, filehash not blocked\n");
+        return -1;
+    }
+    if (added == 0)
+    {
+        fprintf(COMMAND_OUT, "[BLOCK_FILE] already exists → ");
+        print_hash_hex(hash);
+        fputc('\n', COMMAND_OUT);
+        return 0;
+    }
 
-    // check if the filehash is already in the list - othewrise it becomes buggy since we only remove once
-    for (int i = 0; i < list_blocked_filehash_count; ++i)
-        if (hash_equal(list_blocked_filehash[i], hash))
-        {
-            printf("[BLOCK_FILE] already exists → ");
-            print_hash_hex(hash);
-            putchar('\n');
-            return;
-        }
-
-    memcpy(list_blocked_filehash[list_blocked_filehash_count++], hash, 32);
-    printf("\n--- Add new filehash into the blocked list by filehash ---\n");
+    fprintf(COMMAND_OUT, "\n--- Add new filehash into the blocked list by filehash ---\n");
     print_hash_hex(hash);
-    printf("into the blocked list\n Total files blocked by filehash : ");
-    printf("  (total %d)\n", list_blocked_filehash_count);
-    printf("\n--- End of list ---\n");
+    fprintf(COMMAND_OUT, "into the blocked list\n Total files blocked by filehash : ");
+    fprintf(COMMAND_OUT, "  (total %zu)\n", policy_file_count());
+    fprintf(COMMAND_OUT, "\n--- End of list ---\n");
+    return 0;
 }
 
-void allow_file(const uint8_t hash[32])
+int allow_file(const uint8_t hash[32])
 {
-    printf("\n--- Allow filehash from the blocked list by filehash ---\n");
-    for (int i = 0; i < list_blocked_filehash_count; ++i)
-        if (hash_equal(list_blocked_filehash[i], hash))
-        {
-            memcpy(list_blocked_filehash[i],
-                   list_blocked_filehash[--list_blocked_filehash_count], 32);
-
-            printf("Removed filehash from blocked list - ");
-            print_hash_hex(hash);
-            printf("\nUpdated count inside blocked list by filehash (total %d)\n", list_blocked_filehash_count);
-            printf("\n--- End of list ---\n\n");
-            return;
-        }
+    fprintf(COMMAND_OUT, "\n--- Allow filehash from the blocked list by filehash ---\n");
+    int removed = policy_allow_file(hash);
+    if (removed < 0)
+    {
+        fprintf(COMMAND_ERR, "⚠ out of memory, filehash not allowed\n");
+        return -1;
+    }
+    if (removed > 0)
+    {
+        fprintf(COMMAND_OUT, "Removed filehash from blocked list - ");
+        print_hash_hex(hash);
+        fprintf(COMMAND_OUT, "\nUpdated count inside blocked list by filehash (total %zu)\n", policy_file_count());
+        fprintf(COMMAND_OUT, "\n--- End of list ---\n\n");
+        return 0;
+    }
 
-    printf("[ALLOW_FILE] hash not found → ");
+    fprintf(COMMAND_OUT, "[ALLOW_FILE] hash not found → ");
     print_hash_hex(hash);
-    printf("\n--- End of list ---\n");
+    fprintf(COMMAND_OUT, "\n--- End of list ---\n");
+    return 0;
 }
 
 void get_blocked_file()
 {
-    puts("BLOCKED BY FILEHASH LIST : \n");
+    fprintf(COMMAND_OUT, "BLOCKED BY FILEHASH LIST : \n\n");
 
-    for (int i = 0; i < list_blocked_filehash_count; i++)
-    {
-        printf("%d. ", i + 1);
-        print_hash_hex(list_blocked_filehash[i]);
-        printf("\n");
-    }
-    printf("\n--- End of list ---\n\n");
+    int printed = 0;
+    policy_for_each_file(print_numbered_hash, &printed);
+    fprintf(COMMAND_OUT, "\n--- End of list ---\n\n");
 }
 
 void get_blocked_filehash_by_region(Region region)
 {
-    printf("--- Blocked filehash for region :  %s---\n", region_name[region]);
+    fprintf(COMMAND_OUT, "--- Blocked filehash for region :  %s---\n", region_name[region]);
 
     int printed = 0;
-    for (int i = 0; i < list_blocked_filehash_to_region_count; i++)
-    {
-        if (list_blocked_filehash_to_region[i].region != region)
-            continue;
-
-        printf("%d. ", ++printed);
-        print_hash_hex(list_blocked_filehash_to_region[i].filehash);
-        printf("\n");
-    }
-    printf("Total blocked filehash for region %s : %d\n---- End of list ----\n\n", region_name[region], printed);
+    policy_for_each_file_in_region(region, print_numbered_hash, &printed);
+    fprintf(COMMAND_OUT, "Total blocked filehash for region %s : %d\n---- End of list ----\n\n", region_name[region], printed);
 }
 
 void get_blocked_peer()
 {
-    puts("[GET_BLOCKED_PEER]");
+    fprintf(COMMAND_OUT, "[GET_BLOCKED_PEER]\n");
 
-    for (int i = 0; i < list_blocked_ip_count; i++)
-    {
-        printf("%d. %s\n", i + 1, list_blocked_ip[i]);
-    }
+    int printed = 0;
+    policy_for_each_ip(print_numbered_ip, &printed);
+}
+
+/*
+Parse allocations. The batch loader parses hundreds of thousands of lines, it points parse_arena
+at a buffer that is reset for every line, tokens and nodes are then bumped off it and never freed.
+Everywhere else they come from malloc and free_ast() releases them.
+*/
+typedef struct
+{
+    char *base;
+    size_t used;
+    size_t size;
+} ParseArena;
+
+static __thread ParseArena *parse_arena;
+
+static void *parse_alloc(size_t size)
+{
+    if (!parse_arena)
+        return malloc(size);
+
+    size = (size + 15) & ~(size_t)15;
+    if (parse_arena->used + size > parse_arena->size)
+        return NULL;
+    void *p = parse_arena->base + parse_arena->used;
+    parse_arena->used += size;
+    return p;
+}
+
+static char *parse_strdup(const char *value)
+{
+    size_t len = strlen(value) + 1;
+    char *copy = parse_alloc(len);
+    if (copy)
+        memcpy(copy, value, len);
+    return copy;
+}
+
+static void parse_free(void *p)
+{
+    if (!parse_arena)
+        free(p);
 }
 
 ASTNode *create_node(ASTNodeType type, int sub, const char *value)
 {
-    ASTNode *node = malloc(sizeof *node);
+    ASTNode *node = parse_alloc(sizeof *node);
     if (!node)
     {
         perror("malloc");
@@ -244,7 +301,7 @@ ASTNode *create_node(ASTNodeType type, int sub, const char *value)
         break;
     }
 
-    node->value = value ? strdup(value) : NULL;
+    node->value = value ? parse_strdup(value) : NULL;
     node->function = NULL;
     node->left = node->right = node->next = NULL;
     return node;
@@ -252,8 +309,8 @@ ASTNode *create_node(ASTNodeType type, int sub, const char *value)
 
 void free_ast(ASTNode *node)
 {
-    if (!node)
-        return;
+    if (!node || parse_arena)
+        return; // arena nodes go away with the arena
     free_ast(node->left);
     free_ast(node->right);
     free_ast(node->next);
@@ -300,8 +357,10 @@ char *next_token(Tokenizer *t)
     }
 
     size_t len = t->pos - start;
-    char *token = (char *)malloc(len + 1);
-    strncpy(token, t->input + start, len);
+    char *token = parse_alloc(len + 1);
+    if (!token)
+        return NULL;
+    memcpy(token, t->input + start, len);
     token[len] = '\0';
     return token;
 }
@@ -326,15 +385,51 @@ ASTNode *parse_command(const char *command)
         action = ACTION_ALLOW;
     else if (!strcasecmp(tok, "GET"))
         action = ACTION_GET;
+    else if (!strcasecmp(tok, "LOAD"))
+        action = ACTION_LOAD;
+    else if (!strcasecmp(tok, "STATS"))
+        action = ACTION_STATS;
     else
     {
-        free(tok);
+        parse_free(tok);
         return NULL;
     }
-    free(tok);
+    parse_free(tok);
 
     ASTNode *root = create_node(AST_ACTION, action, NULL);
 
+    /* LOAD [RULES] <path> : the rules file becomes the root's value */
+    if (action == ACTION_LOAD)
+    {
+        tok = next_token(&t);
+        if (tok && !strcasecmp(tok, "RULES"))
+        {
+            parse_free(tok);
+            tok = next_token(&t);
+        }
+        if (!tok)
+        {
+            free_ast(root);
+            return NULL;
+        }
+        root->value = tok;
+        return root;
+    }
+
+    /* STATS [JSON] : the format becomes the root's value */
+    if (action == ACTION_STATS)
+    {
+        tok = next_token(&t);
+        if (tok && strcasecmp(tok, "JSON") != 0)
+        {
+            parse_free(tok);
+            free_ast(root);
+            return NULL;
+        }
+        root->value = tok;
+        return root;
+    }
+
     /* consume optional word “BLOCKED” after GET */
     if (action == ACTION_GET)
     {
@@ -342,7 +437,7 @@ ASTNode *parse_command(const char *command)
         tok = next_token(&t);
         if (tok && strcasecmp(tok, "BLOCKED") != 0)
             t.pos = save;
-        free(tok);
+        parse_free(tok);
     }
 
     /* ---------- SUBJECT ------------------------------------------ */
@@ -358,7 +453,7 @@ ASTNode *parse_command(const char *command)
     {
         SubjectType subject = SUBJECT_CONNECTION;
         SourceDestType src_type = !strcasecmp(tok, "IP") ? SOURCE_IP : SOURCE_REGION;
-        free(tok);
+        parse_free(tok);
 
         char *val = next_token(&t); /* concrete addr */
         if (!val)
@@ -371,7 +466,7 @@ ASTNode *parse_command(const char *command)
         root->left = subj;
         ASTNode *src = create_node(AST_SOURCE, src_type, val);
         subj->left = src;
-        free(val);
+        parse_free(val);
         return root; /* → done */
     }
 
@@ -386,11 +481,11 @@ ASTNode *parse_command(const char *command)
         subject = SUBJECT_CONNECTION;
     else
     {
-        free(tok);
+        parse_free(tok);
         free_ast(root);
         return NULL;
     }
-    free(tok);
+    parse_free(tok);
 
     ASTNode *subj = create_node(AST_SUBJECT, subject, NULL);
     root->left = subj;
@@ -414,14 +509,14 @@ ASTNode *parse_command(const char *command)
         {
             t.pos = save;
         }
-        free(tok);
+        parse_free(tok);
 
         /* optional “TO IP|REGION value” */
         save = t.pos;
         tok = next_token(&t);
         if (tok && !strcasecmp(tok, "TO"))
         {
-            free(tok);
+            parse_free(tok);
             tok = next_token(&t); /* qualifier */
             if (!tok)
                 goto fail;
@@ -433,7 +528,7 @@ ASTNode *parse_command(const char *command)
                 sd = SOURCE_REGION;
             else
                 goto fail;
-            free(tok);
+            parse_free(tok);
 
             tok = next_token(&t); /* value */
             if (!tok)
@@ -448,7 +543,7 @@ ASTNode *parse_command(const char *command)
         else if (tok)
         {
             t.pos = save;
-            free(tok);
+            parse_free(tok);
         }
     }
     /* ---------- CONNECTION subject branch ------------------------ */
@@ -459,7 +554,7 @@ ASTNode *parse_command(const char *command)
         tok = next_token(&t);
         if (tok && !strcasecmp(tok, "FROM"))
         {
-            free(tok);
+            parse_free(tok);
             tok = next_token(&t); /* qualifier */
             if (!tok)
                 goto fail;
@@ -471,7 +566,7 @@ ASTNode *parse_command(const char *command)
                 sd = SOURCE_REGION;
             else
                 goto fail;
-            free(tok);
+            parse_free(tok);
 
             tok = next_token(&t); /* value */
             if (!tok)
@@ -483,14 +578,14 @@ ASTNode *parse_command(const char *command)
         else if (tok)
         {
             t.pos = save;
-            free(tok);
+            parse_free(tok);
         }
     }
 
     return root;
 
 fail:
-    free(tok);
+    parse_free(tok);
     free_ast(root);
     return NULL;
 }
@@ -505,6 +600,10 @@ static const char *action_str(ActionType a)
         return "ALLOW";
     case ACTION_GET:
         return "GET";
+    case ACTION_LOAD:
+        return "LOAD";
+    case ACTION_STATS:
+        return "STATS";
     default:
         return "?";
     }
@@ -551,6 +650,17 @@ int parse_region(const char *s, Region *out)
     return 1;
 }
 
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
 int parse_hash(const char *hex, uint8_t out[32])
 /* 64‑char hex → 32‑byte array ; returns 1 on success */
 {
@@ -558,21 +668,136 @@ int parse_hash(const char *hex, uint8_t out[32])
         return 0;
     for (int i = 0; i < 32; i++)
     {
-        unsigned v;
-        if (sscanf(hex + 2 * i, "%2x", &v) != 1)
+        int hi = hex_nibble(hex[2 * i]), lo = hex_nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
             return 0;
-        out[i] = (uint8_t)v;
+        out[i] = (uint8_t)(hi << 4 | lo);
     }
     return 1;
 }
+
+/*
+Applies one BLOCK / ALLOW rule straight to the policy, without printing anything (batch loader).
+Returns 1 when the rules changed, 0 when they already were that way, -1 when it is not a valid rule
+*/
+static int apply_rule(const ASTNode *root)
+{
+    if (!root || root->type != AST_ACTION || !root->left)
+        return -1;
+    ActionType act = root->subtype.action;
+    if (act != ACTION_BLOCK && act != ACTION_ALLOW)
+        return -1;
+
+    const ASTNode *subj = root->left;
+    const ASTNode *first = subj->left;
+
+    if (subj->subtype.subject == SUBJECT_CONNECTION)
+    {
+        if (!first || first->type != AST_SOURCE || first->subtype.source_dest != SOURCE_IP)
+            return -1;
+        return act == ACTION_BLOCK ? policy_block_ip(first->value) : policy_allow_ip(first->value);
+    }
+
+    const ASTNode *param = first && first->type == AST_PARAMETERS ? first : NULL;
+    const ASTNode *dest = param ? param->next : first;
+    uint8_t hash[32];
+    if (!param || !parse_hash(param->value, hash))
+        return -1;
+
+    if (dest && dest->type == AST_DESTINATION && dest->subtype.source_dest == SOURCE_REGION)
+    {
+        Region r;
+        if (!parse_region(dest->value, &r))
+            return -1;
+        return act == ACTION_BLOCK ? policy_block_file_in_region(hash, r) : policy_allow_file_in_region(hash, r);
+    }
+    return act == ACTION_BLOCK ? policy_block_file(hash) : policy_allow_file(hash);
+}
+
+/*
+Reads a rules file, one command per line ('#' comments), through the arena parse path.
+Only BLOCK / ALLOW lines are applied, the caller publishes once for the whole file. Returns -1 if it cannot be opened
+*/
+static int load_rules_locked(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(COMMAND_ERR, "[LOAD] cannot open %s\n", path);
+        return -1;
+    }
+
+    ParseArena arena = {.base = malloc(PARSE_ARENA_SIZE), .size = PARSE_ARENA_SIZE};
+    if (!arena.base)
+    {
+        fclose(fp);
+        return -1;
+    }
+    char line[RULE_LINE_MAX];
+    size_t lineno = 0, changed = 0, unchanged = 0, invalid = 0;
+
+    parse_arena = &arena;
+    while (fgets(line, sizeof(line), fp))
+    {
+        lineno++;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[strspn(line, " \t")] == '\0')
+            continue;
+
+        arena.used = 0;
+        int rc = apply_rule(parse_command(line));
+        if (rc > 0)
+            changed++;
+        else if (rc == 0)
+            unchanged++;
+        else if (invalid++ < 10)
+            fprintf(COMMAND_ERR, "[LOAD] %s:%zu: not a BLOCK / ALLOW rule\n", path, lineno);
+    }
+    parse_arena = NULL;
+    free(arena.base);
+    fclose(fp);
+
+    fprintf(COMMAND_OUT, "[LOAD] %s: %zu rule(s) applied, %zu already in place, %zu invalid line(s)\n",
+            path, changed, unchanged, invalid);
+    return 0;
+}
+
+int load_rules_file(const char *path)
+{
+    pthread_mutex_lock(&command_lock);
+    int rc = load_rules_locked(path);
+    policy_publish(); // one snapshot for the whole file
+    pthread_mutex_unlock(&command_lock);
+    return rc;
+}
 /* ===================================================================
    execute_ast – walks AST and calls the right helper functions
    =================================================================== */
-void execute_ast(ASTNode *node, int sock, void *ctx)
+static const char *execute_node(ASTNode *node, int sock, void *ctx)
 {
     if (!node)
-        return;
+        return NULL;
+
+    if (node->type == AST_ACTION && node->subtype.action == ACTION_LOAD)
+        return load_rules_locked(node->value) < 0 ? "cannot read the rules file" : NULL;
+
+    if (node->type == AST_ACTION && node->subtype.action == ACTION_STATS)
+    {
+        char *stats = node->value ? metrics_json() : metrics_text();
+        if (!stats)
+        {
+            fprintf(COMMAND_ERR, "[STATS] out of memory\n");
+            return "out of memory";
+        }
+        fputs(stats, COMMAND_OUT);
+        free(stats);
+        return NULL;
+    }
 
+    const char *error = NULL;
     if (node->type == AST_ACTION)
     {
         ActionType act = node->subtype.action;
@@ -596,37 +821,27 @@ void execute_ast(ASTNode *node, int sock, void *ctx)
 
             uint8_t hash[32] = {0};
             int have_hash = param && parse_hash(param->value, hash);
-
-            if (act == ACTION_BLOCK)
+            int by_region = dest && dest->subtype.source_dest == SOURCE_REGION;
+            Region r;
+
+            if (by_region && !parse_region(dest->value, &r))
+                error = "unknown region";
+            else if ((act == ACTION_BLOCK || act == ACTION_ALLOW) && !have_hash)
+                error = "not a filehash (64 hex digits)";
+            else if (act == ACTION_BLOCK)
             {
-                if (dest && dest->subtype.source_dest == SOURCE_REGION)
-                {
-                    Region r;
-                    if (have_hash && parse_region(dest->value, &r))
-                        block_file_by_region(hash, r);
-                }
-                else if (have_hash)
-                    block_file(hash);
+                if ((by_region ? block_file_by_region(hash, r) : block_file(hash)) < 0)
+                    error = "out of memory";
             }
             else if (act == ACTION_ALLOW)
             {
-                if (dest && dest->subtype.source_dest == SOURCE_REGION)
-                {
-                    Region r;
-                    if (have_hash && parse_region(dest->value, &r))
-                        allow_file_by_region(hash, r);
-                }
-                else if (have_hash)
-                    allow_file(hash);
+                if ((by_region ? allow_file_by_region(hash, r) : allow_file(hash)) < 0)
+                    error = "out of memory";
             }
             else if (act == ACTION_GET)
             {
-                if (dest && dest->subtype.source_dest == SOURCE_REGION)
-                {
-                    Region r;
-                    if (parse_region(dest->value, &r))
-                        get_blocked_filehash_by_region(r);
-                }
+                if (by_region)
+                    get_blocked_filehash_by_region(r);
                 else
                     get_blocked_file();
             }
@@ -639,10 +854,10 @@ void execute_ast(ASTNode *node, int sock, void *ctx)
             if (src && src->type == AST_SOURCE &&
                 src->subtype.source_dest == SOURCE_IP)
             {
-                if (act == ACTION_BLOCK)
-                    block_ip(src->value);
-                else if (act == ACTION_ALLOW)
-                    allow_ip(src->value);
+                if (act == ACTION_BLOCK && block_ip(src->value) < 0)
+                    error = "not an IP address";
+                else if (act == ACTION_ALLOW && allow_ip(src->value) < 0)
+                    error = "not an IP address";
                 else if (act == ACTION_GET)
                     get_blocked_peer();
             }
@@ -650,21 +865,53 @@ void execute_ast(ASTNode *node, int sock, void *ctx)
                      src->subtype.source_dest == SOURCE_REGION)
             {
                 Region r;
-                if (parse_region(src->value, &r))
-                {
-                    if (act == ACTION_GET)
-                        get_blocked_peer();
-                }
+                if (!parse_region(src->value, &r))
+                    error = "unknown region";
+                else if (act == ACTION_GET)
+                    get_blocked_peer();
             }
             else if (act == ACTION_GET)
                 get_blocked_peer();
         }
     }
+    if (error)
+        return error;
 
     /* recurse */
-    execute_ast(node->left, sock, ctx);
-    execute_ast(node->right, sock, ctx);
-    execute_ast(node->next, sock, ctx);
+    if ((error = execute_node(node->left, sock, ctx)))
+        return error;
+    if ((error = execute_node(node->right, sock, ctx)))
+        return error;
+    return execute_node(node->next, sock, ctx);
+}
+
+/*
+Runs one parsed command. With sock >= 0 its output goes to that socket (admin connection),
+otherwise to stdout. The edited rules are published as a new snapshot once the command is done,
+request handlers see the whole command applied, or none of it.
+Returns NULL, or the reason the command failed (the admin channel answers "ERR <reason>")
+*/
+const char *execute_ast(ASTNode *node, int sock, void *ctx)
+{
+    pthread_mutex_lock(&command_lock);
+
+    FILE *out = NULL;
+    int fd = sock >= 0 ? dup(sock) : -1;
+    if (fd >= 0 && !(out = fdopen(fd, "w")))
+        close(fd);
+    command_out = out;
+    command_err = out;
+
+    const char *error = execute_node(node, sock, ctx);
+    policy_publish();
+
+    command_out = NULL;
+    command_err = NULL;
+    if (out)
+        fclose(out);
+
+    pthread_mutex_unlock(&command_lock);
+    return error;
 }
 
 // Unit testing, Comment out when not in use please
@@ -4,34 +4,16 @@
 #include <stdint.h>
 #include "tracker.h"
 
-#define MAX_BLOCKED_FILEHASHES 1024
-#define MAX_BLOCKED_IPS 1024
-#define MAX_BLOCKED_BY_REGION 1024
-
 typedef enum
 {
     CHINA,
     RUSSIA,
-    IRAN
+    IRAN,
+    REGION_COUNT
 } Region;
 
-typedef struct
-{
-    Region region;
-    uint8_t filehash[32];
-} BlockFileToRegion;
-
-extern char *region_prefix[];
 extern char *region_name[];
 
-/* Global tracking arrays */
-extern BlockFileToRegion list_blocked_filehash_to_region[2048]; 
-extern int list_blocked_filehash_to_region_count;
-extern uint8_t list_blocked_filehash[MAX_BLOCKED_FILEHASHES][32];
-extern int list_blocked_filehash_count;
-extern char list_blocked_ip[MAX_BLOCKED_IPS][64]; 
-extern int list_blocked_ip_count;
-
 typedef enum
 {
     AST_ACTION,     /* BLOCK / ALLOW  / GET           */
@@ -45,7 +27,9 @@ typedef enum
 {
     ACTION_BLOCK,
     ACTION_ALLOW,
-    ACTION_GET
+    ACTION_GET,
+    ACTION_LOAD, /* LOAD [RULES] <path> : bulk load of a rules file */
+    ACTION_STATS /* STATS [JSON] : counters and latencies (metrics.h)  */
 } ActionType;
 
 typedef enum
@@ -80,13 +64,13 @@ int hash_equal(const uint8_t a[32], const uint8_t b[32]);
 int parse_region(const char *s, Region *out);
 int parse_hash(const char *hex, uint8_t out[32]);
 
-/* Action functions */
-void block_ip(const char *ip);
-void allow_ip(const char *ip);
-void block_file_by_region(const uint8_t hash[32], Region region);
-void allow_file_by_region(const uint8_t hash[32], Region region);
-void block_file(const uint8_t hash[32]);
-void allow_file(const uint8_t hash[32]);
+/* Action functions, 0 when applied (or already in place), -1 on a bad IP / no memory */
+int block_ip(const char *ip);
+int allow_ip(const char *ip);
+int block_file_by_region(const uint8_t hash[32], Region region);
+int allow_file_by_region(const uint8_t hash[32], Region region);
+int block_file(const uint8_t hash[32]);
+int allow_file(const uint8_t hash[32]);
 
 /* Query functions */
 void get_blocked_file(void);
@@ -97,6 +81,9 @@ void get_blocked_peer(void);
 ASTNode *create_node(ASTNodeType type, int subtype, const char *value);
 void free_ast(ASTNode *node);
 ASTNode *parse_command(const char *command);
-void execute_ast(ASTNode *node, int client_socket, void *ctx);
+/* Runs a parsed command. Returns NULL when it succeeded, otherwise why it failed (a static string) */
+const char *execute_ast(ASTNode *node, int client_socket, void *ctx);
+/* Applies every BLOCK / ALLOW line of a rules file and publishes them as one snapshot. -1 if it cannot be read */
+int load_rules_file(const char *path);
 
 #endif /* PARSER_H */
\ No newline at end of file
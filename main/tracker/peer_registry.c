@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include "peer_registry.h"
+#include "journal.h"
+
+/*
+Layout
+    pages[]  - PeerEntry storage, PEER_PAGE_SIZE entries per page, allocated on demand and never moved.
+               slot n lives at pages[n / PEER_PAGE_SIZE][n % PEER_PAGE_SIZE], slot 0 is never used.
+    table[]  - open addressing index: (hash, slot) pairs, slot 0 = empty bucket.
+    free_slots - slots released by peer_registry_remove(), reused before growing.
+*/
+
+#define PEER_PAGE_SHIFT 12
+#define PEER_PAGE_SIZE (1u << PEER_PAGE_SHIFT)
+#define PEER_REGISTRY_MAX_PAGES 65536 // 268M peers, the page table itself is only 512 KB
+#define PEER_TABLE_MIN_SIZE 1024
+
+typedef struct
+{
+    uint32_t hash;
+    uint32_t slot; // 0 = empty
+} PeerBucket;
+
+static pthread_rwlock_t registry_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static PeerEntry *pages[PEER_REGISTRY_MAX_PAGES];
+static uint32_t next_slot = 1; // first never used slot
+
+static uint32_t *free_slots;
+static size_t free_count;
+static size_t free_cap;
+
+static PeerBucket *table;
+static size_t table_mask; // table size - 1, size is a power of two
+static size_t peer_count;
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint32_t peer_key_hash(const PeerKey *key)
+{
+    // FNV-1a over the identity, then a murmur style finalizer to spread low bits
+    uint64_t h = 1469598103934665603ULL;
+    h = (h ^ key->family) * 1099511628211ULL;
+    for (int i = 0; i < 16; i++)
+        h = (h ^ key->addr[i]) * 1099511628211ULL;
+    h = (h ^ (key->port & 0xff)) * 1099511628211ULL;
+    h = (h ^ (key->port >> 8)) * 1099511628211ULL;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+static int peer_key_equal(const PeerKey *a, const PeerKey *b)
+{
+    return a->family == b->family &&
+           a->port == b->port &&
+           memcmp(a->addr, b->addr, sizeof(a->addr)) == 0;
+}
+
+static PeerEntry *slot_entry(uint32_t slot)
+{
+    PeerEntry *page = pages[slot >> PEER_PAGE_SHIFT];
+    return page ? &page[slot & (PEER_PAGE_SIZE - 1)] : NULL;
+}
+
+static PeerHandle make_handle(uint32_t slot, const PeerEntry *entry)
+{
+    return ((PeerHandle)entry->generation << 32) | slot;
+}
+
+/* Resolve a handle to its live entry, NULL if the peer is gone. Caller holds registry_lock */
+static PeerEntry *handle_entry(PeerHandle handle)
+{
+    uint32_t slot = (uint32_t)handle;
+    uint32_t generation = (uint32_t)(handle >> 32);
+    if (slot == 0 || slot >= next_slot)
+        return NULL;
+
+    PeerEntry *entry = slot_entry(slot);
+    if (!entry || !entry->in_use || entry->generation != generation)
+        return NULL;
+    return entry;
+}
+
+/* Returns the bucket index holding key, or the empty bucket where it would go */
+static size_t table_probe(const PeerKey *key, uint32_t hash, int *found)
+{
+    size_t i = hash & table_mask;
+    while (table[i].slot != 0)
+    {
+        if (table[i].hash == hash && peer_key_equal(&slot_entry(table[i].slot)->key, key))
+        {
+            *found = 1;
+            return i;
+        }
+        i = (i + 1) & table_mask;
+    }
+    *found = 0;
+    return i;
+}
+
+static int table_resize(size_t new_size)
+{
+    PeerBucket *new_table = calloc(new_size, sizeof(PeerBucket));
+    if (!new_table)
+        return -1;
+
+    size_t new_mask = new_size - 1;
+    for (size_t i = 0; table && i <= table_mask; i++)
+    {
+        if (table[i].slot == 0)
+            continue;
+        size_t j = table[i].hash & new_mask;
+        while (new_table[j].slot != 0)
+            j = (j + 1) & new_mask;
+        new_table[j] = table[i];
+    }
+
+    free(table);
+    table = new_table;
+    table_mask = new_mask;
+    return 0;
+}
+
+static uint32_t allocate_slot(void)
+{
+    if (free_count > 0)
+        return free_slots[--free_count];
+
+    uint32_t slot = next_slot;
+    uint32_t page = slot >> PEER_PAGE_SHIFT;
+    if (page >= PEER_REGISTRY_MAX_PAGES)
+        return 0;
+    if (!pages[page])
+    {
+        pages[page] = calloc(PEER_PAGE_SIZE, sizeof(PeerEntry));
+        if (!pages[page])
+            return 0;
+    }
+    next_slot++;
+    return slot;
+}
+
+static void release_slot(uint32_t slot)
+{
+    if (free_count == free_cap)
+    {
+        size_t new_cap = free_cap ? free_cap * 2 : 1024;
+        uint32_t *grown = realloc(free_slots, new_cap * sizeof(uint32_t));
+        if (!grown)
+            return; // slot leaks, the registry stays correct
+        free_slots = grown;
+        free_cap = new_cap;
+    }
+    free_slots[free_count++] = slot;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Public API
+   -------------------------------------------------------------------------- */
+void peer_registry_init(void)
+{
+    pthread_rwlock_wrlock(&registry_lock);
+    if (!table && table_resize(PEER_TABLE_MIN_SIZE) < 0)
+        perror("peer_registry_init");
+    pthread_rwlock_unlock(&registry_lock);
+}
+
+int peer_key_from_info(const PeerInfo *info, PeerKey *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    char *end = NULL;
+    long port = strtol(info->port, &end, 10);
+    if (end == info->port || port < 0 || port > 65535)
+        return -1;
+    out->port = (uint16_t)port;
+
+    if (inet_pton(AF_INET, info->ip_address, out->addr) == 1)
+    {
+        out->family = AF_INET;
+        return 0;
+    }
+    if (inet_pton(AF_INET6, info->ip_address, out->addr) == 1)
+    {
+        out->family = AF_INET6;
+        return 0;
+    }
+    return -1;
+}
+
+void peer_key_to_info(const PeerKey *key, PeerInfo *out)
+{
+    memset(out, 0, sizeof(*out));
+    inet_ntop(key->family, key->addr, out->ip_address, sizeof(out->ip_address));
+    snprintf(out->port, sizeof(out->port), "%u", key->port);
+}
+
+size_t peer_key_to_compact(const PeerKey *key, uint8_t *out)
+{
+    size_t addr_len = key->family == AF_INET6 ? 16 : 4;
+    uint16_t port = htons(key->port);
+    memcpy(out, key->addr, addr_len);
+    memcpy(out + addr_len, &port, sizeof(port));
+    return addr_len + sizeof(port);
+}
+
+PeerHandle peer_registry_find(const PeerKey *key)
+{
+    uint32_t hash = peer_key_hash(key);
+    PeerHandle handle = PEER_HANDLE_NONE;
+
+    pthread_rwlock_rdlock(&registry_lock);
+    if (table)
+    {
+        int found;
+        size_t i = table_probe(key, hash, &found);
+        if (found)
+            handle = make_handle(table[i].slot, slot_entry(table[i].slot));
+    }
+    pthread_rwlock_unlock(&registry_lock);
+    return handle;
+}
+
+PeerHandle peer_registry_insert(const PeerKey *key, int *created)
+{
+    uint32_t hash = peer_key_hash(key);
+    PeerHandle handle = PEER_HANDLE_NONE;
+    if (created)
+        *created = 0;
+
+    pthread_rwlock_wrlock(&registry_lock);
+    if (!table && table_resize(PEER_TABLE_MIN_SIZE) < 0)
+        goto done;
+
+    int found;
+    size_t i = table_probe(key, hash, &found);
+    if (found)
+    {
+        handle = make_handle(table[i].slot, slot_entry(table[i].slot));
+        goto done;
+    }
+
+    // keep the load factor under 70%, probe sequences stay short
+    if ((peer_count + 1) * 10 > (table_mask + 1) * 7)
+    {
+        if (table_resize((table_mask + 1) * 2) < 0)
+            goto done;
+        i = table_probe(key, hash, &found);
+    }
+
+    uint32_t slot = allocate_slot();
+    if (slot == 0)
+        goto done;
+
+    PeerEntry *entry = slot_entry(slot);
+    entry->key = *key;
+    entry->in_use = 1;
+
+    table[i].hash = hash;
+    table[i].slot = slot;
+    peer_count++;
+
+    handle = make_handle(slot, entry);
+    if (created)
+        *created = 1;
+    journal_register(handle, key); // logged under the lock, before anyone can use the handle
+
+done:
+    pthread_rwlock_unlock(&registry_lock);
+    return handle;
+}
+
+int peer_registry_remove(PeerHandle handle)
+{
+    int result = -1;
+    pthread_rwlock_wrlock(&registry_lock);
+
+    PeerEntry *entry = handle_entry(handle);
+    if (!entry)
+        goto done;
+
+    int found;
+    size_t i = table_probe(&entry->key, peer_key_hash(&entry->key), &found);
+    if (!found)
+        goto done;
+
+    // Backward shift delete: pull later members of the probe run into the hole, no tombstones
+    size_t j = i;
+    while (1)
+    {
+        j = (j + 1) & table_mask;
+        if (table[j].slot == 0)
+            break;
+        size_t home = table[j].hash & table_mask;
+        int movable = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable)
+        {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i].slot = 0;
+    table[i].hash = 0;
+
+    journal_unregister(handle);
+    entry->in_use = 0;
+    entry->generation++;
+    release_slot((uint32_t)handle);
+    peer_count--;
+    result = 0;
+
+done:
+    pthread_rwlock_unlock(&registry_lock);
+    return result;
+}
+
+int peer_registry_get(PeerHandle handle, PeerKey *out)
+{
+    int result = -1;
+    pthread_rwlock_rdlock(&registry_lock);
+    PeerEntry *entry = handle_entry(handle);
+    if (entry)
+    {
+        *out = entry->key;
+        result = 0;
+    }
+    pthread_rwlock_unlock(&registry_lock);
+    return result;
+}
+
+size_t peer_registry_count(void)
+{
+    pthread_rwlock_rdlock(&registry_lock);
+    size_t count = peer_count;
+    pthread_rwlock_unlock(&registry_lock);
+    return count;
+}
+
+void peer_registry_for_each(void (*fn)(PeerHandle handle, const PeerKey *key, void *arg), void *arg)
+{
+    pthread_rwlock_rdlock(&registry_lock);
+    for (uint32_t slot = 1; slot < next_slot; slot++)
+    {
+        PeerEntry *entry = slot_entry(slot);
+        if (entry && entry->in_use)
+            fn(make_handle(slot, entry), &entry->key, arg);
+    }
+    pthread_rwlock_unlock(&registry_lock);
+}
@@ -0,0 +1,59 @@
+#ifndef PEER_REGISTRY_H
+#define PEER_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "peerCommunication.h" // PeerInfo
+
+/*
+@brief Registry of every peer that registered with the tracker (MSG_REQUEST_CREATE_SEEDER)
+
+Peers are identified by their binary (address, port), not by the text in PeerInfo.
+    - open addressing hash table (linear probing, backward shift delete) -> O(1) find/insert/delete
+    - entries live in fixed size pages that never move, so entry pointers stay valid
+    - handles carry a generation, a handle kept after the peer was deleted simply stops resolving
+There is no fixed ceiling, the table doubles when it gets 70% full.
+All functions are thread safe (one internal rwlock).
+*/
+
+typedef uint64_t PeerHandle; // (generation << 32) | slot, 0 is never a valid handle
+#define PEER_HANDLE_NONE 0
+
+typedef struct PeerKey
+{
+    uint8_t family;   // AF_INET or AF_INET6
+    uint8_t addr[16]; // IPv4 uses the first 4 bytes, the rest stays zero
+    uint16_t port;    // host byte order
+} PeerKey;
+
+typedef struct PeerEntry
+{
+    PeerKey key;
+    uint32_t generation; // bumped on delete so old handles stop matching
+    uint32_t in_use;
+} PeerEntry;
+
+void peer_registry_init(void);
+
+/* Text PeerInfo ("127.0.0.1", "6000") -> binary key. Returns 0 on success, -1 if the address is not numeric */
+int peer_key_from_info(const PeerInfo *info, PeerKey *out);
+/* Binary key -> text PeerInfo, the format we send to leechers */
+void peer_key_to_info(const PeerKey *key, PeerInfo *out);
+/* Binary key -> compact wire form (address + port, network byte order). Returns the bytes written */
+#define PEER_COMPACT_V4_SIZE 6
+#define PEER_COMPACT_V6_SIZE 18
+size_t peer_key_to_compact(const PeerKey *key, uint8_t *out);
+
+PeerHandle peer_registry_find(const PeerKey *key);
+/* Returns the handle of the peer, inserting it when new. *created is set to 1 if it was inserted */
+PeerHandle peer_registry_insert(const PeerKey *key, int *created);
+/* Returns 0 when removed, -1 when the handle was already stale */
+int peer_registry_remove(PeerHandle handle);
+/* Copies the key of a live handle. Returns 0 on success, -1 when the handle is stale */
+int peer_registry_get(PeerHandle handle, PeerKey *out);
+size_t peer_registry_count(void);
+/* Calls fn for every registered peer, under the registry read lock (fn must not call back into the registry) */
+void peer_registry_for_each(void (*fn)(PeerHandle handle, const PeerKey *key, void *arg), void *arg);
+
+#endif // PEER_REGISTRY_H
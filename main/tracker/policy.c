@@ -0,0 +1,587 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include "policy.h"
+
+/*
+Keys
+    blocked_ips          17 bytes: address family, then the address (IPv4 in the first 4 bytes)
+    blocked_files        32 bytes: the filehash
+    blocked_region_files 33 bytes: the region, then the filehash. The region takes one byte (also in
+                         policy.snap), the rule functions refuse regions past POLICY_REGION_MAX
+Sets use linear probing, a removal shifts the rest of the run back so no tombstones build up.
+*/
+
+#define POLICY_IP_KEY 17
+#define POLICY_FILE_KEY 32
+#define POLICY_REGION_FILE_KEY 33
+#define POLICY_SET_MIN_SIZE 64
+
+static PolicySnapshot master = {
+    .blocked_ips = {.key_size = POLICY_IP_KEY},
+    .blocked_files = {.key_size = POLICY_FILE_KEY},
+    .blocked_region_files = {.key_size = POLICY_REGION_FILE_KEY},
+};
+static int master_dirty = 1;       // master differs from the published snapshot
+static PolicySnapshot *published;   // atomic, NULL until the first publish
+static uint64_t last_generation;
+
+// Grace periods: a reader slot holds the period the reader last saw, 0 while it is offline
+static uint64_t grace_period = 1;               // atomic
+static uint64_t reader_period[POLICY_MAX_READERS]; // atomic
+static int reader_count;                        // atomic
+static __thread int reader_slot = -1;
+
+static char *snapshot_path; // policy_open(), NULL = rules are not saved
+
+/* --------------------------------------------------------------------------
+   🔹 Hash set
+   -------------------------------------------------------------------------- */
+static size_t key_hash(const uint8_t *key, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ key[i]) * 0x100000001b3ull;
+    h ^= h >> 29;
+    return (size_t)h;
+}
+
+static uint8_t *set_key(const PolicySet *set, size_t i)
+{
+    return set->keys + i * set->key_size;
+}
+
+static int set_contains(const PolicySet *set, const uint8_t *key)
+{
+    if (set->count == 0)
+        return 0;
+    for (size_t i = key_hash(key, set->key_size) & set->mask; set->used[i]; i = (i + 1) & set->mask)
+        if (memcmp(set_key(set, i), key, set->key_size) == 0)
+            return 1;
+    return 0;
+}
+
+/* Adds key to the bucket array without checking for duplicates or room */
+static void set_place(PolicySet *set, const uint8_t *key)
+{
+    size_t i = key_hash(key, set->key_size) & set->mask;
+    while (set->used[i])
+        i = (i + 1) & set->mask;
+    set->used[i] = 1;
+    memcpy(set_key(set, i), key, set->key_size);
+}
+
+static int set_resize(PolicySet *set, size_t size)
+{
+    PolicySet grown = {.key_size = set->key_size, .mask = size - 1, .count = set->count};
+    grown.keys = malloc(size * set->key_size);
+    grown.used = calloc(size, 1);
+    if (!grown.keys || !grown.used)
+    {
+        free(grown.keys);
+        free(grown.used);
+        return -1;
+    }
+
+    if (set->used)
+        for (size_t i = 0; i <= set->mask; i++)
+            if (set->used[i])
+                set_place(&grown, set_key(set, i));
+
+    free(set->keys);
+    free(set->used);
+    *set = grown;
+    return 0;
+}
+
+/* 1 if added, 0 if already there, -1 out of memory */
+static int set_insert(PolicySet *set, const uint8_t *key)
+{
+    if (set_contains(set, key))
+        return 0;
+
+    size_t size = set->used ? set->mask + 1 : 0;
+    if ((set->count + 1) * 10 > size * 7 &&
+        set_resize(set, size ? size * 2 : POLICY_SET_MIN_SIZE) < 0)
+        return -1;
+
+    set_place(set, key);
+    set->count++;
+    return 1;
+}
+
+/* Sizes the table for count more keys, so a bulk insert does not rehash on the way */
+static int set_reserve(PolicySet *set, size_t count)
+{
+    size_t need = (set->count + count) * 10 / 7 + 1;
+    size_t size = set->used ? set->mask + 1 : POLICY_SET_MIN_SIZE;
+    while (size < need)
+        size *= 2;
+    if (set->used && size == set->mask + 1)
+        return 0;
+    return set_resize(set, size);
+}
+
+/* 1 if removed, 0 if it was not there */
+static int set_remove(PolicySet *set, const uint8_t *key)
+{
+    if (set->count == 0)
+        return 0;
+
+    size_t i = key_hash(key, set->key_size) & set->mask;
+    while (set->used[i] && memcmp(set_key(set, i), key, set->key_size) != 0)
+        i = (i + 1) & set->mask;
+    if (!set->used[i])
+        return 0;
+
+    // Backward shift: move later members of the run into the hole when their home allows it
+    size_t hole = i;
+    for (size_t j = (i + 1) & set->mask; set->used[j]; j = (j + 1) & set->mask)
+    {
+        size_t home = key_hash(set_key(set, j), set->key_size) & set->mask;
+        if (((j - home) & set->mask) >= ((j - hole) & set->mask))
+        {
+            memcpy(set_key(set, hole), set_key(set, j), set->key_size);
+            hole = j;
+        }
+    }
+    set->used[hole] = 0;
+    set->count--;
+    return 1;
+}
+
+static int set_clone(PolicySet *dst, const PolicySet *src)
+{
+    *dst = (PolicySet){.key_size = src->key_size};
+    if (!src->used)
+        return 0;
+
+    size_t size = src->mask + 1;
+    dst->keys = malloc(size * src->key_size);
+    dst->used = malloc(size);
+    if (!dst->keys || !dst->used)
+    {
+        free(dst->keys);
+        free(dst->used);
+        *dst = (PolicySet){.key_size = src->key_size};
+        return -1;
+    }
+    memcpy(dst->keys, src->keys, size * src->key_size);
+    memcpy(dst->used, src->used, size);
+    dst->mask = src->mask;
+    dst->count = src->count;
+    return 0;
+}
+
+static void set_free(PolicySet *set)
+{
+    free(set->keys);
+    free(set->used);
+}
+
+static void snapshot_free(PolicySnapshot *snapshot)
+{
+    if (!snapshot)
+        return;
+    set_free(&snapshot->blocked_ips);
+    set_free(&snapshot->blocked_files);
+    set_free(&snapshot->blocked_region_files);
+    free(snapshot);
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Keys
+   -------------------------------------------------------------------------- */
+/* "1.2.3.4" / "::1" -> binary key, returns 0 when the text is not an address */
+static int ip_key(const char *ip, uint8_t key[POLICY_IP_KEY])
+{
+    memset(key, 0, POLICY_IP_KEY);
+    if (!ip)
+        return 0;
+    if (inet_pton(AF_INET, ip, key + 1) == 1)
+    {
+        key[0] = AF_INET;
+        return 1;
+    }
+    if (inet_pton(AF_INET6, ip, key + 1) == 1)
+    {
+        key[0] = AF_INET6;
+        return 1;
+    }
+    return 0;
+}
+
+/* -1 when region does not fit the key byte, two regions must never share a key */
+static int region_file_key(int region, const uint8_t hash[32], uint8_t key[POLICY_REGION_FILE_KEY])
+{
+    if (region < 0 || region > POLICY_REGION_MAX)
+        return -1;
+    key[0] = (uint8_t)region;
+    memcpy(key + 1, hash, 32);
+    return 0;
+}
+
+static int mark_dirty(int changed)
+{
+    if (changed > 0)
+        master_dirty = 1;
+    return changed;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Master rules
+   -------------------------------------------------------------------------- */
+int policy_block_ip(const char *ip)
+{
+    uint8_t key[POLICY_IP_KEY];
+    if (!ip_key(ip, key))
+        return -1;
+    return mark_dirty(set_insert(&master.blocked_ips, key));
+}
+
+int policy_allow_ip(const char *ip)
+{
+    uint8_t key[POLICY_IP_KEY];
+    if (!ip_key(ip, key))
+        return -1;
+    return mark_dirty(set_remove(&master.blocked_ips, key));
+}
+
+int policy_block_file(const uint8_t hash[32])
+{
+    return mark_dirty(set_insert(&master.blocked_files, hash));
+}
+
+int policy_allow_file(const uint8_t hash[32])
+{
+    return mark_dirty(set_remove(&master.blocked_files, hash));
+}
+
+int policy_block_file_in_region(const uint8_t hash[32], int region)
+{
+    uint8_t key[POLICY_REGION_FILE_KEY];
+    if (region_file_key(region, hash, key) < 0)
+        return -1;
+    return mark_dirty(set_insert(&master.blocked_region_files, key));
+}
+
+int policy_allow_file_in_region(const uint8_t hash[32], int region)
+{
+    uint8_t key[POLICY_REGION_FILE_KEY];
+    if (region_file_key(region, hash, key) < 0)
+        return -1;
+    return mark_dirty(set_remove(&master.blocked_region_files, key));
+}
+
+void policy_for_each_ip(void (*fn)(const char *ip, void *arg), void *arg)
+{
+    const PolicySet *set = &master.blocked_ips;
+    if (!set->used)
+        return;
+    for (size_t i = 0; i <= set->mask; i++)
+    {
+        if (!set->used[i])
+            continue;
+        const uint8_t *key = set_key(set, i);
+        char text[INET6_ADDRSTRLEN];
+        if (inet_ntop(key[0], key + 1, text, sizeof(text)))
+            fn(text, arg);
+    }
+}
+
+void policy_for_each_file(void (*fn)(const uint8_t hash[32], void *arg), void *arg)
+{
+    const PolicySet *set = &master.blocked_files;
+    if (!set->used)
+        return;
+    for (size_t i = 0; i <= set->mask; i++)
+        if (set->used[i])
+            fn(set_key(set, i), arg);
+}
+
+void policy_for_each_file_in_region(int region, void (*fn)(const uint8_t hash[32], void *arg), void *arg)
+{
+    const PolicySet *set = &master.blocked_region_files;
+    if (!set->used || region < 0 || region > POLICY_REGION_MAX)
+        return;
+    for (size_t i = 0; i <= set->mask; i++)
+        if (set->used[i] && set_key(set, i)[0] == (uint8_t)region)
+            fn(set_key(set, i) + 1, arg);
+}
+
+size_t policy_ip_count(void)
+{
+    return master.blocked_ips.count;
+}
+
+size_t policy_file_count(void)
+{
+    return master.blocked_files.count;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Persistence
+   -------------------------------------------------------------------------- */
+static uint64_t checksum_update(uint64_t h, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ data[i]) * 0x100000001b3ull;
+    return h;
+}
+
+static int write_set(FILE *fp, const PolicySet *set, uint64_t *checksum)
+{
+    if (!set->used)
+        return 0;
+    for (size_t i = 0; i <= set->mask; i++)
+    {
+        if (!set->used[i])
+            continue;
+        *checksum = checksum_update(*checksum, set_key(set, i), set->key_size);
+        if (fwrite(set_key(set, i), set->key_size, 1, fp) != 1)
+            return -1;
+    }
+    return 0;
+}
+
+/* Writes the master rules to snapshot_path: into a side file, synced, then renamed over the old one */
+static int save_rules(uint64_t generation)
+{
+    char tmpPath[4096];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", snapshot_path);
+    FILE *fp = fopen(tmpPath, "wb");
+    if (!fp)
+    {
+        perror("policy: save");
+        return -1;
+    }
+
+    PolicyFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, POLICY_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = POLICY_SNAPSHOT_VERSION;
+    header.generation = generation;
+    header.ipCount = master.blocked_ips.count;
+    header.fileCount = master.blocked_files.count;
+    header.regionFileCount = master.blocked_region_files.count;
+    header.checksum = 0xcbf29ce484222325ull;
+
+    // header first as a placeholder, rewritten once the checksum is known
+    int failed = fwrite(&header, sizeof(header), 1, fp) != 1 ||
+                 write_set(fp, &master.blocked_ips, &header.checksum) < 0 ||
+                 write_set(fp, &master.blocked_files, &header.checksum) < 0 ||
+                 write_set(fp, &master.blocked_region_files, &header.checksum) < 0 ||
+                 fseek(fp, 0, SEEK_SET) < 0 ||
+                 fwrite(&header, sizeof(header), 1, fp) != 1 ||
+                 fflush(fp) != 0 || fsync(fileno(fp)) < 0;
+    if (fclose(fp) != 0)
+        failed = 1;
+    if (failed || rename(tmpPath, snapshot_path) < 0)
+    {
+        perror("policy: save");
+        unlink(tmpPath);
+        return -1;
+    }
+
+    int dirFd = open(".", O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0)
+    {
+        fsync(dirFd); // make the rename durable
+        close(dirFd);
+    }
+    return 0;
+}
+
+static int read_set(const uint8_t **p, uint64_t count, PolicySet *set)
+{
+    if (set_reserve(set, count) < 0)
+        return -1;
+    for (uint64_t i = 0; i < count; i++, *p += set->key_size)
+        if (set_insert(set, *p) < 0)
+            return -1;
+    return 0;
+}
+
+/* Reads path into the (empty) master sets. Returns rules loaded, 0 when there is no file, -1 on a bad file */
+static long load_rules(const char *path, uint64_t *generation)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+
+    PolicyFileHeader header;
+    uint8_t *keys = NULL;
+    long loaded = -1;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, POLICY_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != POLICY_SNAPSHOT_VERSION)
+        goto done;
+
+    uint64_t bytes = header.ipCount * POLICY_IP_KEY + header.fileCount * POLICY_FILE_KEY +
+                     header.regionFileCount * POLICY_REGION_FILE_KEY;
+    keys = malloc(bytes ? bytes : 1);
+    if (!keys || (bytes && fread(keys, bytes, 1, fp) != 1) ||
+        checksum_update(0xcbf29ce484222325ull, keys, bytes) != header.checksum)
+        goto done;
+
+    const uint8_t *p = keys;
+    if (read_set(&p, header.ipCount, &master.blocked_ips) < 0 ||
+        read_set(&p, header.fileCount, &master.blocked_files) < 0 ||
+        read_set(&p, header.regionFileCount, &master.blocked_region_files) < 0)
+        goto done;
+
+    *generation = header.generation;
+    loaded = (long)(header.ipCount + header.fileCount + header.regionFileCount);
+
+done:
+    free(keys);
+    fclose(fp);
+    return loaded;
+}
+
+int policy_open(const char *path)
+{
+    uint64_t generation = 0;
+    long loaded = load_rules(path, &generation);
+    if (loaded < 0)
+    {
+        fprintf(stderr, "policy: %s is damaged, starting without saved rules\n", path);
+        set_free(&master.blocked_ips);
+        set_free(&master.blocked_files);
+        set_free(&master.blocked_region_files);
+        master.blocked_ips = (PolicySet){.key_size = POLICY_IP_KEY};
+        master.blocked_files = (PolicySet){.key_size = POLICY_FILE_KEY};
+        master.blocked_region_files = (PolicySet){.key_size = POLICY_REGION_FILE_KEY};
+        loaded = 0;
+    }
+
+    if (generation > last_generation)
+        last_generation = generation; // generations keep growing across restarts
+    master_dirty = 1;
+    policy_publish();
+
+    snapshot_path = strdup(path);
+    if (loaded > 0)
+        printf("Loaded %ld policy rule(s) from %s\n", loaded, path);
+    return (int)loaded;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Readers
+   -------------------------------------------------------------------------- */
+void policy_reader_online(void)
+{
+    if (reader_slot < 0)
+    {
+        int slot = __atomic_fetch_add(&reader_count, 1, __ATOMIC_SEQ_CST);
+        if (slot >= POLICY_MAX_READERS)
+        {
+            fprintf(stderr, "policy: more than %d reader threads\n", POLICY_MAX_READERS);
+            abort();
+        }
+        reader_slot = slot;
+    }
+    policy_reader_quiescent();
+}
+
+void policy_reader_offline(void)
+{
+    if (reader_slot >= 0)
+        __atomic_store_n(&reader_period[reader_slot], 0, __ATOMIC_SEQ_CST);
+}
+
+void policy_reader_quiescent(void)
+{
+    if (reader_slot >= 0)
+        __atomic_store_n(&reader_period[reader_slot], __atomic_load_n(&grace_period, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+/* Returns once no reader can still hold a snapshot published before the call */
+static void wait_for_readers(void)
+{
+    uint64_t period = __atomic_add_fetch(&grace_period, 1, __ATOMIC_SEQ_CST);
+    int count = __atomic_load_n(&reader_count, __ATOMIC_SEQ_CST);
+    if (count > POLICY_MAX_READERS)
+        count = POLICY_MAX_READERS;
+
+    for (int i = 0; i < count; i++)
+    {
+        for (;;)
+        {
+            uint64_t seen = __atomic_load_n(&reader_period[i], __ATOMIC_SEQ_CST);
+            if (seen == 0 || seen >= period)
+                break; // offline, or went through a quiescent point after the swap
+            sched_yield();
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Snapshot
+   -------------------------------------------------------------------------- */
+void policy_publish(void)
+{
+    PolicySnapshot *old = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+    if (!master_dirty && old)
+        return;
+
+    PolicySnapshot *snapshot = calloc(1, sizeof(*snapshot));
+    if (!snapshot ||
+        set_clone(&snapshot->blocked_ips, &master.blocked_ips) < 0 ||
+        set_clone(&snapshot->blocked_files, &master.blocked_files) < 0 ||
+        set_clone(&snapshot->blocked_region_files, &master.blocked_region_files) < 0)
+    {
+        fprintf(stderr, "policy: out of memory, keeping the previous rules\n");
+        snapshot_free(snapshot);
+        return;
+    }
+    snapshot->generation = ++last_generation;
+
+    __atomic_store_n(&published, snapshot, __ATOMIC_SEQ_CST);
+    master_dirty = 0;
+    if (snapshot_path)
+        save_rules(snapshot->generation);
+
+    if (old)
+    {
+        wait_for_readers();
+        snapshot_free(old);
+    }
+}
+
+uint64_t policy_generation(void)
+{
+    const PolicySnapshot *snapshot = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+    return snapshot ? snapshot->generation : 0;
+}
+
+int policy_ip_blocked(const char *ip)
+{
+    const PolicySnapshot *snapshot = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+    uint8_t key[POLICY_IP_KEY];
+    if (!snapshot || snapshot->blocked_ips.count == 0 || !ip_key(ip, key))
+        return 0;
+    return set_contains(&snapshot->blocked_ips, key);
+}
+
+int policy_file_blocked(const uint8_t hash[32])
+{
+    const PolicySnapshot *snapshot = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+    if (!snapshot || !hash)
+        return 0;
+    return set_contains(&snapshot->blocked_files, hash);
+}
+
+int policy_file_blocked_in_region(int region, const uint8_t hash[32])
+{
+    const PolicySnapshot *snapshot = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+    uint8_t key[POLICY_REGION_FILE_KEY];
+    if (!snapshot || !hash || snapshot->blocked_region_files.count == 0 || region_file_key(region, hash, key) < 0)
+        return 0;
+    return set_contains(&snapshot->blocked_region_files, key);
+}
@@ -0,0 +1,103 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+@brief Compiled block rules, O(1) checks whatever the number of rules
+
+The admin side (parser.c) edits the master rule sets, policy_publish() then compiles them
+into an immutable PolicySnapshot and swaps it in with one atomic store:
+    - blocked IPs        hash set of binary addresses (family + 16 bytes)
+    - blocked filehashes hash set of 32 byte hashes
+    - region rules       hash set of (region, filehash)
+Request handlers only read the current snapshot, they never see a half applied command.
+There is no cap on the number of rules.
+
+Snapshots are reclaimed RCU style (quiescent state based), readers take no lock:
+    - a reader thread is online while it may hold a snapshot pointer, offline while it blocks
+      (workers go offline around epoll_wait)
+    - policy_publish() swaps the pointer, then waits until every online reader went through
+      an offline / quiescent point before it frees the previous snapshot
+A thread must never call policy_publish() while it is online itself.
+
+Master sets are only touched by the thread running admin commands, callers serialize them.
+*/
+
+#define POLICY_MAX_READERS 256
+#define POLICY_REGION_MAX 255 // region rules key the region on one byte
+
+#define POLICY_SNAPSHOT_FILE "policy.snap"
+#define POLICY_SNAPSHOT_MAGIC "BMPOLICY"
+#define POLICY_SNAPSHOT_VERSION 1
+
+/*
+@brief Rules saved on disk, so a restart does not replay text commands
+The header is followed by the keys of each set, packed: ipCount * 17, fileCount * 32, regionFileCount * 33 bytes
+*/
+typedef struct PolicyFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t generation;
+    uint64_t ipCount;
+    uint64_t fileCount;
+    uint64_t regionFileCount;
+    uint64_t checksum; // FNV-1a of the packed keys
+} PolicyFileHeader;
+
+typedef struct PolicySet
+{
+    size_t key_size;
+    size_t mask;  // size - 1, size is a power of two (0 when never allocated)
+    size_t count;
+    uint8_t *keys; // (mask + 1) * key_size
+    uint8_t *used; // 1 per bucket
+} PolicySet;
+
+typedef struct PolicySnapshot
+{
+    uint64_t generation; // bumped on every publish
+    PolicySet blocked_ips;
+    PolicySet blocked_files;
+    PolicySet blocked_region_files;
+} PolicySnapshot;
+
+/* Master rule edits. Return 1 when the rule set changed, 0 when it did not, -1 on a bad IP / region past POLICY_REGION_MAX / no memory */
+int policy_block_ip(const char *ip);
+int policy_allow_ip(const char *ip);
+int policy_block_file(const uint8_t hash[32]);
+int policy_allow_file(const uint8_t hash[32]);
+int policy_block_file_in_region(const uint8_t hash[32], int region);
+int policy_allow_file_in_region(const uint8_t hash[32], int region);
+
+/* Iterate the master rules, for the GET commands */
+void policy_for_each_ip(void (*fn)(const char *ip, void *arg), void *arg);
+void policy_for_each_file(void (*fn)(const uint8_t hash[32], void *arg), void *arg);
+void policy_for_each_file_in_region(int region, void (*fn)(const uint8_t hash[32], void *arg), void *arg);
+size_t policy_ip_count(void);
+size_t policy_file_count(void);
+
+/*
+Loads the rules saved at path, if the file exists, and publishes them.
+From then on every publish rewrites the file (written aside, then renamed over it). Returns rules loaded or -1
+*/
+int policy_open(const char *path);
+
+/* Compiles the master rules into a new snapshot and publishes it, no-op when nothing changed */
+void policy_publish(void);
+uint64_t policy_generation(void);
+
+/* Reader side of the snapshot reclamation, see above. The first policy_reader_online() registers the thread */
+void policy_reader_online(void);
+void policy_reader_offline(void);
+void policy_reader_quiescent(void);
+
+/* Hot path checks against the published snapshot, the caller must be online */
+int policy_ip_blocked(const char *ip);
+int policy_file_blocked(const uint8_t hash[32]);
+int policy_file_blocked_in_region(int region, const uint8_t hash[32]);
+
+#endif // POLICY_H
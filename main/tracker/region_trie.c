@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include "region_trie.h"
+#include "parser.h" // Region, parse_region
+
+/*
+Layout
+    nodes[0]  IPv4 root, nodes[1] IPv6 root
+    a node is 256 entries, indexed by the next address byte
+    entry.child  node holding the next byte (0 = none, the roots are never children)
+    entry.region region of the longest range covering this byte so far (-1 = none), entry.length its prefix
+A /n range is stored in the node of byte n / 8, expanded over every entry its n % 8 leading bits cover.
+*/
+
+#define REGION_TRIE_V4_ROOT 0
+#define REGION_TRIE_V6_ROOT 1
+
+typedef struct
+{
+    uint32_t child;
+    int16_t region;
+    uint8_t length;
+} RegionTrieEntry;
+
+typedef RegionTrieEntry RegionTrieNode[256];
+
+static RegionTrieNode *nodes;
+static uint32_t node_count;
+static uint32_t node_capacity;
+
+// Used when there is no regions.csv, same blocks the tracker always had
+static const char *default_ranges[] = {
+    "36.0.0.0/8,CHINA",
+    "5.0.0.0/8,RUSSIA",
+    "185.0.0.0/8,IRAN",
+    NULL};
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint32_t node_new(void)
+{
+    if (node_count == node_capacity)
+    {
+        uint32_t capacity = node_capacity ? node_capacity * 2 : 16;
+        RegionTrieNode *grown = realloc(nodes, capacity * sizeof(RegionTrieNode));
+        if (!grown)
+            return 0;
+        nodes = grown;
+        node_capacity = capacity;
+    }
+    for (int i = 0; i < 256; i++)
+        nodes[node_count][i] = (RegionTrieEntry){.child = 0, .region = -1, .length = 0};
+    return node_count++;
+}
+
+static int trie_insert(uint32_t root, const uint8_t *addr, int length, int region)
+{
+    uint32_t node = root;
+    int level = 0;
+    for (; length > 8 * (level + 1); level++)
+    {
+        RegionTrieEntry *entry = &nodes[node][addr[level]];
+        if (!entry->child)
+        {
+            uint32_t child = node_new(); // may move nodes, look the entry up again
+            if (!child)
+                return -1;
+            nodes[node][addr[level]].child = child;
+        }
+        node = nodes[node][addr[level]].child;
+    }
+
+    int bits = length - 8 * level; // 0..8 leading bits of this byte belong to the range
+    int span = 1 << (8 - bits);
+    int first = bits ? addr[level] & (0xff << (8 - bits)) & 0xff : 0;
+    for (int i = first; i < first + span; i++)
+    {
+        RegionTrieEntry *entry = &nodes[node][i];
+        if (entry->region < 0 || entry->length <= length)
+        {
+            entry->region = (int16_t)region;
+            entry->length = (uint8_t)length;
+        }
+    }
+    return 0;
+}
+
+static int trie_lookup(uint32_t root, const uint8_t *addr, int bytes)
+{
+    int region = -1;
+    uint32_t node = root;
+    for (int level = 0; level < bytes; level++)
+    {
+        const RegionTrieEntry *entry = &nodes[node][addr[level]];
+        if (entry->region >= 0)
+            region = entry->region; // deeper entries always come from longer prefixes
+        if (!entry->child)
+            break;
+        node = entry->child;
+    }
+    return region;
+}
+
+/* "36.0.0.0/8,CHINA" -> trie. Returns 1 if added, 0 for a blank or comment line, -1 when malformed */
+static int add_range(const char *line, int lineno)
+{
+    char text[256];
+    strncpy(text, line, sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+
+    char *hash = strchr(text, '#');
+    if (hash)
+        *hash = '\0';
+    char *cidr = text;
+    while (isspace((unsigned char)*cidr))
+        cidr++;
+    if (*cidr == '\0')
+        return 0;
+
+    char *name = strchr(cidr, ',');
+    if (!name)
+        goto bad;
+    *name++ = '\0';
+    while (isspace((unsigned char)*name))
+        name++;
+    for (char *end = name + strlen(name); end > name && isspace((unsigned char)end[-1]);)
+        *--end = '\0';
+    for (char *end = cidr + strlen(cidr); end > cidr && isspace((unsigned char)end[-1]);)
+        *--end = '\0';
+
+    Region region;
+    if (!parse_region(name, &region))
+    {
+        fprintf(stderr, "regions line %d: unknown region \"%s\"\n", lineno, name);
+        return -1;
+    }
+
+    char *slash = strchr(cidr, '/');
+    if (slash)
+        *slash++ = '\0';
+
+    uint8_t addr[16] = {0};
+    uint32_t root;
+    int max;
+    if (inet_pton(AF_INET, cidr, addr) == 1)
+    {
+        root = REGION_TRIE_V4_ROOT;
+        max = 32;
+    }
+    else if (inet_pton(AF_INET6, cidr, addr) == 1)
+    {
+        root = REGION_TRIE_V6_ROOT;
+        max = 128;
+    }
+    else
+        goto bad;
+
+    int length = max;
+    if (slash)
+    {
+        char *end;
+        long n = strtol(slash, &end, 10);
+        if (*slash == '\0' || *end != '\0' || n < 0 || n > max)
+            goto bad;
+        length = (int)n;
+    }
+
+    if (trie_insert(root, addr, length, region) < 0)
+    {
+        fprintf(stderr, "regions line %d: out of memory\n", lineno);
+        return -1;
+    }
+    return 1;
+
+bad:
+    fprintf(stderr, "regions line %d: expected \"cidr,REGION\"\n", lineno);
+    return -1;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int region_trie_load(const char *path)
+{
+    free(nodes);
+    nodes = NULL;
+    node_count = node_capacity = 0;
+    if (node_new() != REGION_TRIE_V4_ROOT || node_new() != REGION_TRIE_V6_ROOT)
+        return -1;
+
+    int loaded = 0;
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        printf("No %s, using the built in region ranges\n", path);
+        for (int i = 0; default_ranges[i]; i++)
+            loaded += add_range(default_ranges[i], i + 1) > 0;
+        return loaded;
+    }
+
+    char line[256];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), fp))
+        loaded += add_range(line, ++lineno) > 0;
+    fclose(fp);
+
+    printf("Loaded %d region range(s) from %s (%u trie nodes)\n", loaded, path, node_count);
+    return loaded;
+}
+
+int region_of_ip(const char *ip)
+{
+    if (!nodes || !ip)
+        return -1;
+
+    uint8_t addr[16];
+    if (inet_pton(AF_INET, ip, addr) == 1)
+        return trie_lookup(REGION_TRIE_V4_ROOT, addr, 4);
+    if (inet_pton(AF_INET6, ip, addr) != 1)
+        return -1;
+
+    static const uint8_t v4_mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    if (memcmp(addr, v4_mapped, sizeof(v4_mapped)) == 0)
+        return trie_lookup(REGION_TRIE_V4_ROOT, addr + 12, 4);
+    return trie_lookup(REGION_TRIE_V6_ROOT, addr, 16);
+}
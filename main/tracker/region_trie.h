@@ -0,0 +1,25 @@
+#ifndef REGION_TRIE_H
+#define REGION_TRIE_H
+
+/*
+@brief IP -> region lookup, longest prefix match over CIDR blocks
+
+The ranges come from a local CSV file, one "cidr,REGION" per line, '#' starts a comment:
+    36.0.0.0/8,CHINA
+    2001:db8::/32,IRAN
+IPv4 and IPv6 blocks live in two multibit tries with one byte per level (256 way nodes),
+a lookup reads at most 4 nodes for IPv4 and 16 for IPv6, whatever the number of ranges.
+A longer prefix always wins over a shorter one, so "5.0.0.0/8" no longer matches "50.1.2.3".
+IPv4-mapped IPv6 addresses (::ffff:a.b.c.d) are looked up as IPv4.
+
+region_trie_load() runs once at start up, lookups afterwards are read only and need no lock.
+*/
+
+#define REGION_TRIE_FILE "regions.csv"
+
+/* Loads the ranges of path, falls back to the built in ranges when the file does not exist. Returns ranges loaded or -1 */
+int region_trie_load(const char *path);
+/* Region (parser.h Region) of the textual address ip, -1 when it is in no range */
+int region_of_ip(const char *ip);
+
+#endif // REGION_TRIE_H
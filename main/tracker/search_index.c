@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "search_index.h"
+#include "database.h"
+#include "logger.h"
+
+/*
+Layout
+    doc_ids[] - document number -> fileID, documents are numbered in catalog version order
+    table[]   - open addressing map trigram -> Posting, trigram 0 = empty bucket
+                (a trigram key is 3 non zero bytes, so it is never 0)
+    Posting   - the documents whose padded, lowercased name contains the trigram, ascending
+A query intersects the posting lists of its trigrams and walks the result in document order,
+it stops as soon as it has enough verified hits.
+*/
+
+#define SEARCH_PAD '\x01' // start marker, cannot appear in a filename
+#define SEARCH_TABLE_MIN_SIZE 4096
+#define SEARCH_CATCHUP_BATCH 1024
+
+typedef struct
+{
+    uint32_t trigram;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *ids;
+} Posting;
+
+typedef struct
+{
+    const Posting *posting;
+    uint32_t pos;
+} PostingCursor;
+
+enum
+{
+    MATCH_PREFIX,
+    MATCH_INSIDE // contains the query, but not at the start
+};
+
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static Posting *table;
+static size_t table_mask; // table size - 1, size is a power of two
+static size_t posting_count;
+static ssize_t *doc_ids;
+static uint32_t doc_count;
+static uint32_t doc_capacity;
+static size_t indexed_version; // catalog version the index is up to date with
+static int index_built;        // atomic
+static int index_behind;       // atomic, the last catch up ran out of memory, the next query retries it
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint32_t trigram_key(const char *p)
+{
+    return ((uint32_t)(uint8_t)p[0] << 16) | ((uint32_t)(uint8_t)p[1] << 8) | (uint8_t)p[2];
+}
+
+static size_t trigram_bucket(uint32_t trigram)
+{
+    uint32_t h = trigram * 0x9e3779b1u;
+    return (h ^ (h >> 15)) & table_mask;
+}
+
+/* Lowercases up to SEARCH_QUERY_MAX - 1 bytes of src, returns the length */
+static size_t normalize(const char *src, char *dst)
+{
+    size_t len = 0;
+    while (len < SEARCH_QUERY_MAX - 1 && src[len])
+    {
+        dst[len] = (char)tolower((unsigned char)src[len]);
+        len++;
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+static Posting *posting_find(uint32_t trigram)
+{
+    if (!table)
+        return NULL;
+    for (size_t i = trigram_bucket(trigram);; i = (i + 1) & table_mask)
+    {
+        if (table[i].trigram == trigram)
+            return &table[i];
+        if (table[i].trigram == 0)
+            return NULL;
+    }
+}
+
+static int table_grow(void)
+{
+    size_t old_size = table ? table_mask + 1 : 0;
+    Posting *old = table;
+    size_t size = old_size ? old_size * 2 : SEARCH_TABLE_MIN_SIZE;
+
+    Posting *grown = calloc(size, sizeof(Posting));
+    if (!grown)
+        return -1;
+    table = grown;
+    table_mask = size - 1;
+
+    for (size_t i = 0; i < old_size; i++)
+    {
+        if (old[i].trigram == 0)
+            continue;
+        size_t b = trigram_bucket(old[i].trigram);
+        while (table[b].trigram != 0)
+            b = (b + 1) & table_mask;
+        table[b] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+/* Finds or creates the posting list of trigram. Caller holds the write lock */
+static Posting *posting_get(uint32_t trigram)
+{
+    Posting *posting = posting_find(trigram);
+    if (posting)
+        return posting;
+
+    if ((posting_count + 1) * 10 > (table ? table_mask + 1 : 0) * 7 && table_grow() < 0)
+        return NULL;
+
+    size_t b = trigram_bucket(trigram);
+    while (table[b].trigram != 0)
+        b = (b + 1) & table_mask;
+    table[b].trigram = trigram;
+    posting_count++;
+    return &table[b];
+}
+
+/* Takes doc back out of the posting lists of the first `done` trigrams of padded (it is last in each) */
+static void unindex_name(const char *padded, size_t done, uint32_t doc)
+{
+    for (size_t i = 0; i < done; i++)
+    {
+        Posting *posting = posting_find(trigram_key(padded + i));
+        if (posting && posting->count && posting->ids[posting->count - 1] == doc)
+            posting->count--;
+    }
+}
+
+/* Adds one document. Returns 0, -1 out of memory: nothing of the document is left in the index */
+static int index_name(ssize_t fileID, const char *filename)
+{
+    if (doc_count == doc_capacity)
+    {
+        uint32_t capacity = doc_capacity ? doc_capacity * 2 : 1024;
+        ssize_t *ids = realloc(doc_ids, capacity * sizeof(ssize_t));
+        if (!ids)
+            return -1;
+        doc_ids = ids;
+        doc_capacity = capacity;
+    }
+    uint32_t doc = doc_count++;
+    doc_ids[doc] = fileID;
+
+    char padded[SEARCH_QUERY_MAX + 2];
+    padded[0] = SEARCH_PAD;
+    padded[1] = SEARCH_PAD;
+    size_t len = normalize(filename, padded + 2) + 2;
+
+    size_t i;
+    for (i = 0; i + 3 <= len; i++)
+    {
+        Posting *posting = posting_get(trigram_key(padded + i));
+        if (!posting)
+            goto fail;
+        if (posting->count && posting->ids[posting->count - 1] == doc)
+            continue; // trigram repeats inside this name
+
+        if (posting->count == posting->capacity)
+        {
+            uint32_t capacity = posting->capacity ? posting->capacity * 2 : 4;
+            uint32_t *ids = realloc(posting->ids, capacity * sizeof(uint32_t));
+            if (!ids)
+                goto fail;
+            posting->ids = ids;
+            posting->capacity = capacity;
+        }
+        posting->ids[posting->count++] = doc;
+    }
+    return 0;
+
+fail:
+    unindex_name(padded, i, doc);
+    doc_count--;
+    return -1;
+}
+
+/*
+Indexes the catalog entries added after indexed_version. Caller holds the write lock.
+indexed_version never passes a document that could not be indexed: on out of memory the catch up
+stops there, the next refresh or query starts again from it. Returns 0, -1 when it stopped early
+*/
+static int catch_up_locked(void)
+{
+    FileEntry batch[SEARCH_CATCHUP_BATCH];
+    size_t catalogVersion = 0;
+
+    for (;;)
+    {
+        size_t n = catalog_changes_since(indexed_version, batch, SEARCH_CATCHUP_BATCH, &catalogVersion);
+        if (n == 0)
+            break;
+        for (size_t i = 0; i < n; i++)
+        {
+            const CatalogEntry *entry = catalog_lookup(batch[i].fileID);
+            if (entry && index_name(batch[i].fileID, entry->meta.filename) < 0)
+            {
+                LOG_WARN("Search index: out of memory at fileID %04zd, %zu file(s) not searchable yet",
+                         batch[i].fileID, catalogVersion - indexed_version);
+                __atomic_store_n(&index_behind, 1, __ATOMIC_RELAXED);
+                return -1;
+            }
+            indexed_version++;
+        }
+    }
+    __atomic_store_n(&index_behind, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/* Moves the cursor to the first document >= doc (galloping), returns 1 if it is doc */
+static int cursor_seek(PostingCursor *cursor, uint32_t doc)
+{
+    const uint32_t *ids = cursor->posting->ids;
+    uint32_t count = cursor->posting->count;
+    uint32_t lo = cursor->pos, step = 1;
+
+    while (lo + step < count && ids[lo + step] < doc)
+    {
+        lo += step;
+        step *= 2;
+    }
+    uint32_t hi = lo + step < count ? lo + step : count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ids[mid] < doc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    cursor->pos = lo;
+    return lo < count && ids[lo] == doc;
+}
+
+static int posting_smaller(const void *a, const void *b)
+{
+    const Posting *pa = *(const Posting *const *)a;
+    const Posting *pb = *(const Posting *const *)b;
+    return (pa->count > pb->count) - (pa->count < pb->count);
+}
+
+/*
+Walks the documents present in every list, in order, and appends the fileIDs whose name matches
+the query the way `match` asks for. Stops once out holds max fileIDs. Caller holds the read lock
+*/
+static size_t scan_matches(const Posting **lists, size_t nlists, const char *q, int match,
+                           ssize_t *out, size_t count, size_t max)
+{
+    PostingCursor cursors[SEARCH_QUERY_MAX + 2];
+    qsort(lists, nlists, sizeof(*lists), posting_smaller); // drive with the rarest list
+    for (size_t i = 0; i < nlists; i++)
+    {
+        cursors[i].posting = lists[i];
+        cursors[i].pos = 0;
+    }
+
+    const Posting *driver = lists[0];
+    for (uint32_t i = 0; i < driver->count && count < max; i++)
+    {
+        uint32_t doc = driver->ids[i];
+        size_t k = 1;
+        while (k < nlists && cursor_seek(&cursors[k], doc))
+            k++;
+        if (k < nlists)
+            continue;
+
+        const CatalogEntry *entry = catalog_lookup(doc_ids[doc]);
+        if (!entry)
+            continue;
+
+        // all trigrams present does not mean the query is, confirm on the name
+        char name[SEARCH_QUERY_MAX];
+        normalize(entry->meta.filename, name);
+        const char *at = strstr(name, q);
+        if (!at || (match == MATCH_PREFIX) != (at == name))
+            continue;
+        out[count++] = doc_ids[doc];
+    }
+    return count;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+void search_index_refresh(void)
+{
+    if (!__atomic_load_n(&index_built, __ATOMIC_ACQUIRE))
+        return;
+    pthread_rwlock_wrlock(&index_lock);
+    catch_up_locked();
+    pthread_rwlock_unlock(&index_lock);
+}
+
+size_t search_index_query(const char *query, ssize_t *out, size_t max)
+{
+    char q[SEARCH_QUERY_MAX];
+    size_t qlen = normalize(query, q);
+    if (qlen == 0 || max == 0)
+        return 0;
+
+    if (!__atomic_load_n(&index_built, __ATOMIC_ACQUIRE) || __atomic_load_n(&index_behind, __ATOMIC_RELAXED))
+    {
+        pthread_rwlock_wrlock(&index_lock);
+        if (!index_built || index_behind)
+        {
+            catch_up_locked(); // still behind on failure, searches see the files indexed so far
+            __atomic_store_n(&index_built, 1, __ATOMIC_RELEASE);
+        }
+        pthread_rwlock_unlock(&index_lock);
+    }
+
+    if (max > SEARCH_RESULTS_MAX)
+        max = SEARCH_RESULTS_MAX;
+    size_t count = 0;
+
+    pthread_rwlock_rdlock(&index_lock);
+
+    // Prefix lists: the padded trigrams a name starting with the query must contain
+    char start[4] = {SEARCH_PAD, SEARCH_PAD, q[0], qlen >= 2 ? q[1] : '\0'};
+    const Posting *lists[SEARCH_QUERY_MAX + 2];
+    size_t nlists = 0;
+    int missing = 0;
+
+    const Posting *posting = posting_find(trigram_key(start));
+    if (posting)
+        lists[nlists++] = posting;
+    else
+        missing = 1;
+    if (qlen >= 2)
+    {
+        posting = posting_find(trigram_key(start + 1));
+        if (posting)
+            lists[nlists++] = posting;
+        else
+            missing = 1;
+    }
+
+    // Substring lists: every trigram of the query
+    const Posting *inner[SEARCH_QUERY_MAX];
+    size_t ninner = 0;
+    for (size_t i = 0; i + 3 <= qlen; i++)
+    {
+        posting = posting_find(trigram_key(q + i));
+        if (!posting)
+        {
+            ninner = 0;
+            missing = 2; // no name contains the query at all
+            break;
+        }
+        inner[ninner++] = posting;
+    }
+
+    // 1) names starting with the query, 2) names containing it further in, older files first in both
+    if (missing == 0)
+    {
+        memcpy(lists + nlists, inner, ninner * sizeof(*inner));
+        count = scan_matches(lists, nlists + ninner, q, MATCH_PREFIX, out, count, max);
+    }
+    if (ninner && count < max)
+        count = scan_matches(inner, ninner, q, MATCH_INSIDE, out, count, max);
+
+    pthread_rwlock_unlock(&index_lock);
+    return count;
+}
@@ -0,0 +1,32 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+@brief Filename search over the catalog, backed by a trigram index
+
+Every FileMetadata.filename is lowercased and split into 3 byte windows (trigrams),
+each trigram keeps a posting list of the fileIDs whose name contains it.
+Names are padded with two start markers, so 1 and 2 character queries become prefix lookups.
+    - a query intersects the posting lists of its trigrams, rarest first, and confirms each hit on the name
+    - names starting with the query come first, then names containing it, older files first within each
+    - the walk stops as soon as enough hits are found, a broad query costs no more than a narrow one
+
+The index is built from the catalog on the first search and follows it by catalog version
+(catalog_changes_since), add_new_file() calls search_index_refresh() so new names are searchable at once.
+A name that cannot be indexed (out of memory) is retried by the next refresh or search, never skipped.
+All functions are thread safe.
+*/
+
+#define SEARCH_QUERY_MAX 128     // bytes of query, same as FileMetadata.filename
+#define SEARCH_RESULTS_DEFAULT 16
+#define SEARCH_RESULTS_MAX 256
+
+/* Indexes every catalog entry added since the last call (no-op until the first search built the index) */
+void search_index_refresh(void);
+/* Copies the fileIDs of the best matches for query into out, best first. Returns how many */
+size_t search_index_query(const char *query, ssize_t *out, size_t max);
+
+#endif // SEARCH_INDEX_H
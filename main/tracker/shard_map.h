@@ -0,0 +1,62 @@
+#ifndef SHARD_MAP_H
+#define SHARD_MAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+@brief Which tracker process owns a fileID, when the catalog and the swarms are split across several
+
+The shard file lists one tracker per line as ip:port (IPv6 as [addr]:port), '#' starts a comment.
+Trackers and peers load the same file, every one of them computes the same owner for a fileID.
+
+Consistent hashing: every tracker puts SHARD_VNODES points on a 64 bit ring, at the hash of its
+"ip:port#n". A fileID belongs to the first point at or after the fileID's hash. Points only depend on
+the tracker's address, so the order of the lines does not matter.
+
+The list is fixed for the lifetime of the catalogs: a tracker only allocates fileIDs it owns and catalog
+entries never move between trackers, so after adding or removing a tracker the files on the arcs that
+changed hands would be looked up on a tracker that does not hold them, and their IDs handed out again.
+Each tracker records the list next to its catalog (catalog_check_shards()) and refuses to start with another one.
+*/
+
+#define SHARD_MAX 64
+#define SHARD_VNODES 128 // points per tracker, evens out the share each tracker gets
+#define SHARD_ADDR_MAX 64
+
+typedef struct TrackerShard
+{
+    char ip[SHARD_ADDR_MAX];
+    int port;
+} TrackerShard;
+
+typedef struct ShardPoint
+{
+    uint64_t hash;
+    uint32_t shard; // index into ShardMap.shards
+} ShardPoint;
+
+typedef struct ShardMap
+{
+    TrackerShard shards[SHARD_MAX];
+    size_t count; // 0 = not sharded, one tracker owns everything
+    ShardPoint *ring; // count * SHARD_VNODES points, sorted by hash
+    size_t points;
+} ShardMap;
+
+/* Reads path into map. Returns the number of trackers, -1 when the file cannot be read or a line is bad */
+int shard_map_load(ShardMap *map, const char *path);
+void shard_map_free(ShardMap *map);
+/* Index of the tracker owning fileID, 0 when the map is empty */
+size_t shard_for_file(const ShardMap *map, ssize_t fileID);
+/* Same ring for other keys, e.g. the fileHash of a file that has no fileID yet */
+size_t shard_for_key(const ShardMap *map, uint64_t key);
+/* The trackers as sorted "ip:port\n" lines, the same text whatever the order of the file. Returns its length, -1 when it does not fit */
+int shard_map_describe(const ShardMap *map, char *out, size_t size);
+/* Index of the tracker listening on ip:port, -1 when it is not in the map */
+int shard_find(const ShardMap *map, const char *ip, int port);
+/* "ip:port" text -> ip and port. Returns 0, -1 when malformed */
+int shard_parse_address(const char *text, char *ip, size_t ip_size, int *port);
+
+#endif // SHARD_MAP_H
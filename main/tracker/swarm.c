@@ -0,0 +1,712 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "swarm.h"
+#include "journal.h"
+
+#define SWARM_MIN_CAPACITY 4
+#define SWARM_MAP_MIN_SIZE 64
+
+typedef struct SwarmShard
+{
+    pthread_rwlock_t lock; // guards every swarm whose fileID falls in this shard
+    Swarm **map;           // open addressing fileID -> Swarm, NULL = empty bucket
+    size_t map_mask;
+    size_t swarm_count;
+    TimerWheel expiry; // one deadline per membership of this shard, 1 tick = 1 second
+} SwarmShard;
+
+static SwarmShard swarm_shards[SWARM_SHARDS];
+#define SWARM_SHARD(fileID) (&swarm_shards[(size_t)(fileID) % SWARM_SHARDS])
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint64_t swarm_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec;
+}
+
+static uint32_t mix64(uint64_t x)
+{
+    // splitmix64 finalizer, handles and fileIDs are sequential so the low bits need spreading
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return (uint32_t)x;
+}
+
+/* fileIDs are spread over shards by fileID % SWARM_SHARDS, drop those bits before hashing inside a shard */
+static size_t map_home(ssize_t fileID, size_t mask)
+{
+    return mix64((uint64_t)fileID / SWARM_SHARDS) & mask;
+}
+
+/* ---- 🔹 Member index (inside one peer set) ---- */
+
+/* Returns the bucket holding peer, or the empty bucket where it would go. The set must have an index */
+static size_t index_probe(const PeerSet *set, PeerHandle peer, int *found)
+{
+    size_t i = mix64(peer) & set->index_mask;
+    while (set->index[i] != 0)
+    {
+        if (set->members[set->index[i] - 1] == peer)
+        {
+            *found = 1;
+            return i;
+        }
+        i = (i + 1) & set->index_mask;
+    }
+    *found = 0;
+    return i;
+}
+
+static int index_rebuild(PeerSet *set, uint32_t size)
+{
+    uint32_t *index = calloc(size, sizeof(uint32_t));
+    if (!index)
+        return -1;
+
+    free(set->index);
+    set->index = index;
+    set->index_mask = size - 1;
+    for (uint32_t pos = 0; pos < set->count; pos++)
+    {
+        size_t i = mix64(set->members[pos]) & set->index_mask;
+        while (index[i] != 0)
+            i = (i + 1) & set->index_mask;
+        index[i] = pos + 1;
+    }
+    return 0;
+}
+
+/* Backward shift delete, no tombstones so probe runs never get longer over time */
+static void index_delete(PeerSet *set, size_t i)
+{
+    size_t j = i;
+    while (1)
+    {
+        j = (j + 1) & set->index_mask;
+        if (set->index[j] == 0)
+            break;
+        size_t home = mix64(set->members[set->index[j] - 1]) & set->index_mask;
+        int movable = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable)
+        {
+            set->index[i] = set->index[j];
+            i = j;
+        }
+    }
+    set->index[i] = 0;
+}
+
+/* Position of peer in the set, -1 when it is not a member */
+static ssize_t set_find(const PeerSet *set, PeerHandle peer, size_t *bucket)
+{
+    if (set->count == 0)
+        return -1;
+    int found;
+    size_t i = index_probe(set, peer, &found);
+    if (!found)
+        return -1;
+    if (bucket)
+        *bucket = i;
+    return set->index[i] - 1;
+}
+
+/* Doubles the dense arrays and the index together (the index stays at most 50% full) */
+static int set_grow(PeerSet *set)
+{
+    uint32_t new_capacity = set->capacity ? set->capacity * 2 : SWARM_MIN_CAPACITY;
+    PeerHandle *members = realloc(set->members, new_capacity * sizeof(PeerHandle));
+    if (members)
+        set->members = members;
+    SwarmMembership **memberships = realloc(set->memberships, new_capacity * sizeof(SwarmMembership *));
+    if (memberships)
+        set->memberships = memberships;
+    if (!members || !memberships || index_rebuild(set, new_capacity * 2) < 0)
+        return -1;
+    set->capacity = new_capacity;
+    return 0;
+}
+
+/* An empty set gives its arrays back, a swarm that only holds counters stays small */
+static void set_release(PeerSet *set)
+{
+    free(set->members);
+    free(set->memberships);
+    free(set->index);
+    memset(set, 0, sizeof(*set));
+}
+
+static Swarm *swarm_create(ssize_t fileID)
+{
+    Swarm *swarm = calloc(1, sizeof(Swarm));
+    if (swarm)
+        swarm->fileID = fileID;
+    return swarm;
+}
+
+static void swarm_free(Swarm *swarm)
+{
+    for (int role = 0; role < SWARM_ROLES; role++)
+        set_release(&swarm->peers[role]);
+    free(swarm);
+}
+
+/* A swarm is kept while it has members or counters */
+static int swarm_unused(Swarm *swarm)
+{
+    return swarm->peers[SWARM_SEEDER].count == 0 && swarm->peers[SWARM_LEECHER].count == 0 &&
+           __atomic_load_n(&swarm->counters.completed, __ATOMIC_RELAXED) == 0 &&
+           __atomic_load_n(&swarm->counters.uploaded, __ATOMIC_RELAXED) == 0 &&
+           __atomic_load_n(&swarm->counters.downloaded, __ATOMIC_RELAXED) == 0;
+}
+
+/* ---- 🔹 fileID -> Swarm map (inside one shard) ---- */
+
+static size_t map_probe(const SwarmShard *shard, ssize_t fileID, int *found)
+{
+    size_t i = map_home(fileID, shard->map_mask);
+    while (shard->map[i] != NULL)
+    {
+        if (shard->map[i]->fileID == fileID)
+        {
+            *found = 1;
+            return i;
+        }
+        i = (i + 1) & shard->map_mask;
+    }
+    *found = 0;
+    return i;
+}
+
+static Swarm *map_find(const SwarmShard *shard, ssize_t fileID)
+{
+    int found;
+    size_t i = map_probe(shard, fileID, &found);
+    return found ? shard->map[i] : NULL;
+}
+
+static int map_resize(SwarmShard *shard, size_t new_size)
+{
+    Swarm **map = calloc(new_size, sizeof(Swarm *));
+    if (!map)
+        return -1;
+
+    size_t new_mask = new_size - 1;
+    for (size_t i = 0; shard->map && i <= shard->map_mask; i++)
+    {
+        if (!shard->map[i])
+            continue;
+        size_t j = map_home(shard->map[i]->fileID, new_mask);
+        while (map[j] != NULL)
+            j = (j + 1) & new_mask;
+        map[j] = shard->map[i];
+    }
+
+    free(shard->map);
+    shard->map = map;
+    shard->map_mask = new_mask;
+    return 0;
+}
+
+static void map_delete(SwarmShard *shard, size_t i)
+{
+    size_t j = i;
+    while (1)
+    {
+        j = (j + 1) & shard->map_mask;
+        if (shard->map[j] == NULL)
+            break;
+        size_t home = map_home(shard->map[j]->fileID, shard->map_mask);
+        int movable = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable)
+        {
+            shard->map[i] = shard->map[j];
+            i = j;
+        }
+    }
+    shard->map[i] = NULL;
+    shard->swarm_count--;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Public API
+   -------------------------------------------------------------------------- */
+void swarm_init(void)
+{
+    uint64_t now = swarm_clock();
+    for (int i = 0; i < SWARM_SHARDS; i++)
+    {
+        pthread_rwlock_init(&swarm_shards[i].lock, NULL);
+        timer_wheel_init(&swarm_shards[i].expiry, now);
+        if (map_resize(&swarm_shards[i], SWARM_MAP_MIN_SIZE) < 0)
+            perror("swarm_init");
+    }
+}
+
+/* Caller holds the shard write lock. Finds the swarm of fileID, creating it when create is set */
+static Swarm *swarm_get_locked(SwarmShard *shard, ssize_t fileID, int create)
+{
+    int found;
+    size_t slot = map_probe(shard, fileID, &found);
+    if (found)
+        return shard->map[slot];
+    if (!create)
+        return NULL;
+
+    if ((shard->swarm_count + 1) * 10 > (shard->map_mask + 1) * 7)
+    {
+        if (map_resize(shard, (shard->map_mask + 1) * 2) < 0)
+            return NULL;
+        slot = map_probe(shard, fileID, &found);
+    }
+    Swarm *swarm = swarm_create(fileID);
+    if (!swarm)
+        return NULL;
+    shard->map[slot] = swarm;
+    shard->swarm_count++;
+    return swarm;
+}
+
+/* Caller holds the shard write lock. Frees the swarm once nothing is left in it */
+static void swarm_drop_if_unused(SwarmShard *shard, Swarm *swarm)
+{
+    if (!swarm_unused(swarm))
+        return;
+    int found;
+    size_t slot = map_probe(shard, swarm->fileID, &found);
+    if (found)
+    {
+        map_delete(shard, slot);
+        swarm_free(swarm);
+    }
+}
+
+/* Caller holds the shard write lock. Takes the peer out of one role of the swarm, 0 when removed, -1 when it was not there */
+static int set_remove_locked(Swarm *swarm, SwarmRole role, PeerHandle peer)
+{
+    PeerSet *set = &swarm->peers[role];
+    size_t i;
+    ssize_t found = set_find(set, peer, &i);
+    if (found < 0)
+        return -1;
+
+    // Swap the last member into the hole so the array stays dense, then fix its index entry
+    uint32_t pos = (uint32_t)found;
+    SwarmMembership *membership = set->memberships[pos];
+    index_delete(set, i);
+    uint32_t last = set->count - 1;
+    if (pos != last)
+    {
+        int dummy;
+        PeerHandle moved = set->members[last];
+        size_t j = index_probe(set, moved, &dummy);
+        set->members[pos] = moved;
+        set->memberships[pos] = set->memberships[last];
+        set->index[j] = pos + 1;
+    }
+    set->count--;
+
+    timer_wheel_cancel(&membership->timer);
+    free(membership);
+    if (set->count == 0)
+        set_release(set);
+    return 0;
+}
+
+/* Caller holds the shard write lock. Same results as swarm_add() for the given role */
+static int swarm_add_locked(SwarmShard *shard, ssize_t fileID, PeerHandle peer, SwarmRole role, uint64_t expires)
+{
+    // 1) Find the swarm of this file, create it on the first peer
+    Swarm *swarm = swarm_get_locked(shard, fileID, 1);
+    if (!swarm)
+        return -1;
+
+    // 2) O(1) membership check, a re-announce only pushes the deadline back
+    PeerSet *set = &swarm->peers[role];
+    ssize_t pos = set_find(set, peer, NULL);
+    if (pos >= 0)
+    {
+        timer_wheel_schedule(&shard->expiry, &set->memberships[pos]->timer, expires);
+        return 1; // already present
+    }
+
+    SwarmMembership *membership = calloc(1, sizeof(SwarmMembership));
+    if (!membership)
+        goto fail;
+    membership->fileID = fileID;
+    membership->peer = peer;
+    membership->role = role;
+
+    // 3) Grow the dense array and its index together
+    if (set->count == set->capacity && set_grow(set) < 0)
+    {
+        free(membership);
+        goto fail;
+    }
+
+    int found;
+    size_t i = index_probe(set, peer, &found);
+    set->members[set->count] = peer;
+    set->memberships[set->count] = membership;
+    set->index[i] = ++set->count;
+    timer_wheel_schedule(&shard->expiry, &membership->timer, expires);
+
+    // 4) One role per peer: the latest announce wins
+    set_remove_locked(swarm, role == SWARM_SEEDER ? SWARM_LEECHER : SWARM_SEEDER, peer);
+    return 0;
+
+fail:
+    swarm_drop_if_unused(shard, swarm);
+    return -1;
+}
+
+/* Caller holds the shard write lock */
+static int swarm_remove_locked(SwarmShard *shard, ssize_t fileID, PeerHandle peer, SwarmRole role)
+{
+    Swarm *swarm = swarm_get_locked(shard, fileID, 0);
+    if (!swarm || set_remove_locked(swarm, role, peer) < 0)
+        return -1;
+    swarm_drop_if_unused(shard, swarm);
+    return 0;
+}
+
+/* Caller holds the shard lock (read or write) */
+static size_t swarm_collect_locked(SwarmShard *shard, ssize_t fileID, PeerHandle *out, size_t max)
+{
+    // Hot files have far more members than one reply carries, start every copy at a
+    // different offset so requesters are spread over the whole swarm
+    static __thread uint32_t rotation;
+
+    Swarm *swarm = map_find(shard, fileID);
+    if (!swarm || max == 0)
+        return 0;
+
+    const PeerSet *set = &swarm->peers[SWARM_SEEDER];
+    size_t n = set->count < max ? set->count : max;
+    size_t start = set->count > max ? rotation++ % set->count : 0;
+    size_t first = set->count - start < n ? set->count - start : n;
+    memcpy(out, set->members + start, first * sizeof(PeerHandle));
+    memcpy(out + first, set->members, (n - first) * sizeof(PeerHandle));
+    return n;
+}
+
+/* Caller holds the shard lock (read or write) */
+static void swarm_stats_locked(SwarmShard *shard, ssize_t fileID, SwarmStats *out)
+{
+    memset(out, 0, sizeof(*out));
+    Swarm *swarm = map_find(shard, fileID);
+    if (!swarm)
+        return;
+    out->seeders = swarm->peers[SWARM_SEEDER].count;
+    out->leechers = swarm->peers[SWARM_LEECHER].count;
+    out->completed = __atomic_load_n(&swarm->counters.completed, __ATOMIC_RELAXED);
+    out->uploaded = __atomic_load_n(&swarm->counters.uploaded, __ATOMIC_RELAXED);
+    out->downloaded = __atomic_load_n(&swarm->counters.downloaded, __ATOMIC_RELAXED);
+}
+
+int swarm_add(ssize_t fileID, PeerHandle peer, uint64_t ttl)
+{
+    uint64_t expires = swarm_clock() + ttl;
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_wrlock(&shard->lock);
+    int result = swarm_add_locked(shard, fileID, peer, SWARM_SEEDER, expires);
+    if (result >= 0)
+        journal_join(fileID, peer, SWARM_SEEDER, ttl);
+    pthread_rwlock_unlock(&shard->lock);
+    return result;
+}
+
+int swarm_remove(ssize_t fileID, PeerHandle peer)
+{
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_wrlock(&shard->lock);
+    int result = swarm_remove_locked(shard, fileID, peer, SWARM_SEEDER);
+    if (result == 0)
+        journal_leave(fileID, peer, SWARM_SEEDER);
+    pthread_rwlock_unlock(&shard->lock);
+    return result;
+}
+
+int swarm_add_leecher(ssize_t fileID, PeerHandle peer, uint64_t ttl)
+{
+    uint64_t expires = swarm_clock() + ttl;
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_wrlock(&shard->lock);
+    int result = swarm_add_locked(shard, fileID, peer, SWARM_LEECHER, expires);
+    if (result >= 0)
+        journal_join(fileID, peer, SWARM_LEECHER, ttl);
+    pthread_rwlock_unlock(&shard->lock);
+    return result;
+}
+
+int swarm_remove_leecher(ssize_t fileID, PeerHandle peer)
+{
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_wrlock(&shard->lock);
+    int result = swarm_remove_locked(shard, fileID, peer, SWARM_LEECHER);
+    if (result == 0)
+        journal_leave(fileID, peer, SWARM_LEECHER);
+    pthread_rwlock_unlock(&shard->lock);
+    return result;
+}
+
+int swarm_complete(ssize_t fileID, PeerHandle peer)
+{
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_wrlock(&shard->lock);
+    Swarm *swarm = swarm_get_locked(shard, fileID, 1);
+    if (swarm)
+    {
+        // also counted when the leecher membership already expired during a long download
+        if (set_remove_locked(swarm, SWARM_LEECHER, peer) == 0)
+            journal_leave(fileID, peer, SWARM_LEECHER);
+        __atomic_add_fetch(&swarm->counters.completed, 1, __ATOMIC_RELAXED);
+        journal_counters(fileID, &swarm->counters);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return swarm ? 0 : -1;
+}
+
+int swarm_record_transfer(ssize_t fileID, uint64_t uploaded, uint64_t downloaded)
+{
+    if (uploaded == 0 && downloaded == 0)
+        return 0;
+    SwarmShard *shard = SWARM_SHARD(fileID);
+
+    // Common case, the swarm exists: counters are atomics, the read lock is enough
+    pthread_rwlock_rdlock(&shard->lock);
+    Swarm *swarm = map_find(shard, fileID);
+    if (swarm)
+    {
+        __atomic_add_fetch(&swarm->counters.uploaded, uploaded, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&swarm->counters.downloaded, downloaded, __ATOMIC_RELAXED);
+        journal_counters(fileID, &swarm->counters);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    if (swarm)
+        return 0;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    swarm = swarm_get_locked(shard, fileID, 1);
+    if (swarm)
+    {
+        __atomic_add_fetch(&swarm->counters.uploaded, uploaded, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&swarm->counters.downloaded, downloaded, __ATOMIC_RELAXED);
+        journal_counters(fileID, &swarm->counters);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return swarm ? 0 : -1;
+}
+
+size_t swarm_collect(ssize_t fileID, PeerHandle *out, size_t max)
+{
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_rdlock(&shard->lock);
+    size_t copied = swarm_collect_locked(shard, fileID, out, max);
+    pthread_rwlock_unlock(&shard->lock);
+    return copied;
+}
+
+size_t swarm_size(ssize_t fileID)
+{
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_rdlock(&shard->lock);
+    Swarm *swarm = map_find(shard, fileID);
+    size_t count = swarm ? swarm->peers[SWARM_SEEDER].count : 0;
+    pthread_rwlock_unlock(&shard->lock);
+    return count;
+}
+
+void swarm_stats(ssize_t fileID, SwarmStats *out)
+{
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_rdlock(&shard->lock);
+    swarm_stats_locked(shard, fileID, out);
+    pthread_rwlock_unlock(&shard->lock);
+}
+
+size_t swarm_expire(void)
+{
+    uint64_t now = swarm_clock();
+    size_t dropped = 0;
+
+    for (int s = 0; s < SWARM_SHARDS; s++)
+    {
+        SwarmShard *shard = &swarm_shards[s];
+        pthread_rwlock_wrlock(&shard->lock);
+
+        // Every membership whose slot came due is handed back in one list
+        TimerEntry *entry = timer_wheel_advance(&shard->expiry, now);
+        while (entry)
+        {
+            TimerEntry *next = entry->next;
+            SwarmMembership *membership = (SwarmMembership *)entry;
+            if (swarm_remove_locked(shard, membership->fileID, membership->peer, membership->role) == 0)
+                dropped++;
+            entry = next;
+        }
+
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    return dropped;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Batches
+   -------------------------------------------------------------------------- */
+/*
+@brief Positions of fileIDs grouped by shard (a counting sort on the shard number), so a batch
+       walks every shard once. Returns NULL when out of memory, the caller then keeps the batch order
+*/
+static size_t *order_by_shard(const ssize_t *fileIDs, size_t count)
+{
+    size_t *order = malloc(count * sizeof(size_t));
+    if (!order)
+        return NULL;
+
+    size_t next[SWARM_SHARDS + 1] = {0};
+    for (size_t i = 0; i < count; i++)
+        next[(size_t)fileIDs[i] % SWARM_SHARDS + 1]++;
+    for (int s = 1; s <= SWARM_SHARDS; s++)
+        next[s] += next[s - 1];
+    for (size_t i = 0; i < count; i++)
+        order[next[(size_t)fileIDs[i] % SWARM_SHARDS]++] = i;
+    return order;
+}
+
+/* Locks shard unless it is the one already held, releasing the previous one */
+static SwarmShard *switch_shard(SwarmShard *held, SwarmShard *shard, int write)
+{
+    if (held == shard)
+        return shard;
+    if (held)
+        pthread_rwlock_unlock(&held->lock);
+    if (write)
+        pthread_rwlock_wrlock(&shard->lock);
+    else
+        pthread_rwlock_rdlock(&shard->lock);
+    return shard;
+}
+
+void swarm_add_batch(const ssize_t *fileIDs, size_t count, PeerHandle peer, uint64_t ttl, int *results)
+{
+    uint64_t expires = swarm_clock() + ttl;
+    size_t *order = order_by_shard(fileIDs, count);
+    SwarmShard *held = NULL;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        size_t i = order ? order[k] : k;
+        held = switch_shard(held, SWARM_SHARD(fileIDs[i]), 1);
+        results[i] = swarm_add_locked(held, fileIDs[i], peer, SWARM_SEEDER, expires);
+        if (results[i] >= 0)
+            journal_join(fileIDs[i], peer, SWARM_SEEDER, ttl);
+    }
+
+    if (held)
+        pthread_rwlock_unlock(&held->lock);
+    free(order);
+}
+
+void swarm_collect_batch(const ssize_t *fileIDs, size_t count, PeerHandle *out, size_t max_each, size_t *found)
+{
+    size_t *order = order_by_shard(fileIDs, count);
+    SwarmShard *held = NULL;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        size_t i = order ? order[k] : k;
+        held = switch_shard(held, SWARM_SHARD(fileIDs[i]), 0);
+        found[i] = swarm_collect_locked(held, fileIDs[i], out + i * max_each, max_each);
+    }
+
+    if (held)
+        pthread_rwlock_unlock(&held->lock);
+    free(order);
+}
+
+void swarm_stats_batch(const ssize_t *fileIDs, size_t count, SwarmStats *out)
+{
+    size_t *order = order_by_shard(fileIDs, count);
+    SwarmShard *held = NULL;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        size_t i = order ? order[k] : k;
+        held = switch_shard(held, SWARM_SHARD(fileIDs[i]), 0);
+        swarm_stats_locked(held, fileIDs[i], &out[i]);
+    }
+
+    if (held)
+        pthread_rwlock_unlock(&held->lock);
+    free(order);
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Persistence
+   -------------------------------------------------------------------------- */
+void swarm_for_each(SwarmMemberFn member, SwarmCountersFn counters, void *arg)
+{
+    for (int s = 0; s < SWARM_SHARDS; s++)
+    {
+        SwarmShard *shard = &swarm_shards[s];
+        pthread_rwlock_rdlock(&shard->lock);
+        uint64_t now = swarm_clock();
+
+        for (size_t i = 0; i <= shard->map_mask; i++)
+        {
+            const Swarm *swarm = shard->map[i];
+            if (!swarm)
+                continue;
+            for (int role = 0; role < SWARM_ROLES; role++)
+            {
+                const PeerSet *set = &swarm->peers[role];
+                for (uint32_t k = 0; k < set->count; k++)
+                {
+                    uint64_t expires = set->memberships[k]->timer.expires;
+                    member(swarm->fileID, set->members[k], (SwarmRole)role, expires > now ? expires - now : 0, arg);
+                }
+            }
+
+            SwarmCounters copy;
+            copy.completed = __atomic_load_n(&swarm->counters.completed, __ATOMIC_RELAXED);
+            copy.uploaded = __atomic_load_n(&swarm->counters.uploaded, __ATOMIC_RELAXED);
+            copy.downloaded = __atomic_load_n(&swarm->counters.downloaded, __ATOMIC_RELAXED);
+            if (copy.completed || copy.uploaded || copy.downloaded)
+                counters(swarm->fileID, &copy, arg);
+        }
+        pthread_rwlock_unlock(&shard->lock);
+    }
+}
+
+static void counter_raise(uint64_t *counter, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(counter, __ATOMIC_RELAXED);
+    while (current < value &&
+           !__atomic_compare_exchange_n(counter, &current, value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+int swarm_restore_counters(ssize_t fileID, const SwarmCounters *counters)
+{
+    SwarmShard *shard = SWARM_SHARD(fileID);
+    pthread_rwlock_wrlock(&shard->lock);
+    Swarm *swarm = swarm_get_locked(shard, fileID, 1);
+    if (swarm)
+    {
+        counter_raise(&swarm->counters.completed, counters->completed);
+        counter_raise(&swarm->counters.uploaded, counters->uploaded);
+        counter_raise(&swarm->counters.downloaded, counters->downloaded);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return swarm ? 0 : -1;
+}
@@ -0,0 +1,126 @@
+#ifndef SWARM_H
+#define SWARM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "peer_registry.h" // PeerHandle
+#include "timer_wheel.h"
+
+/*
+@brief Per-file swarms: the peers seeding and leeching each fileID, and the file's counters
+
+Replaces the old file_to_seeders[MAX_FILES][MAX_SEEDERS_PER_FILE] matrix.
+    - swarms are split over SWARM_SHARDS shards by fileID, one rwlock per shard
+    - every shard maps fileID -> Swarm with an open addressing table
+    - a Swarm keeps one PeerSet per role: a dense array (cheap to copy out) plus a hash index over it,
+      so membership checks, insert and delete are O(1) even for files with 10k+ peers.
+      A peer holds at most one role per file, its latest announce decides which
+    - every membership has a deadline in its shard's timer wheel, a peer that stops re-announcing
+      is dropped by swarm_expire() once its ttl runs out
+    - SwarmCounters (completions, transfer totals) are updated with atomics: a transfer report only
+      takes the shard read lock, reports for files of the same shard never wait for each other
+Memory is proportional to the number of (file, peer) memberships, plus one small Swarm for every file
+that has counters. There is no file or peer ceiling.
+All functions are thread safe.
+*/
+
+#define SWARM_SHARDS 64 // swarm state is split by fileID % SWARM_SHARDS, one lock per shard
+
+typedef enum
+{
+    SWARM_SEEDER = 0,
+    SWARM_LEECHER = 1,
+    SWARM_ROLES
+} SwarmRole;
+
+typedef struct SwarmMembership
+{
+    TimerEntry timer; // must stay first, the wheel hands back TimerEntry pointers
+    ssize_t fileID;
+    PeerHandle peer;
+    SwarmRole role;
+} SwarmMembership;
+
+typedef struct PeerSet
+{
+    PeerHandle *members;           // dense, order is not meaningful. NULL while the set is empty
+    SwarmMembership **memberships; // parallel to members, holds the expiry timer
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *index;     // open addressing over members, value = position + 1, 0 = empty bucket
+    uint32_t index_mask; // index size - 1
+} PeerSet;
+
+typedef struct SwarmCounters
+{
+    uint64_t completed;  // leechers that finished the file
+    uint64_t uploaded;   // bytes peers reported sending
+    uint64_t downloaded; // bytes peers reported receiving
+} SwarmCounters;
+
+typedef struct Swarm
+{
+    ssize_t fileID;
+    PeerSet peers[SWARM_ROLES];
+    SwarmCounters counters; // __atomic access only
+} Swarm;
+
+/* What a scrape reports for one file */
+typedef struct SwarmStats
+{
+    size_t seeders;
+    size_t leechers;
+    uint64_t completed;
+    uint64_t uploaded;
+    uint64_t downloaded;
+} SwarmStats;
+
+void swarm_init(void);
+
+/*
+Adds the seeder, or refreshes its deadline when it re-announces. The membership expires ttl seconds from now.
+A leecher of the file becomes a seeder (without counting a completion).
+Returns 0 when added, 1 when the peer was already seeding (deadline refreshed), -1 when out of memory
+*/
+int swarm_add(ssize_t fileID, PeerHandle peer, uint64_t ttl);
+/* Returns 0 when removed, -1 when the peer was not seeding */
+int swarm_remove(ssize_t fileID, PeerHandle peer);
+/* Copies up to max seeders of the swarm into out, returns how many were copied */
+size_t swarm_collect(ssize_t fileID, PeerHandle *out, size_t max);
+/* Number of seeders */
+size_t swarm_size(ssize_t fileID);
+/* Drops every membership whose deadline passed. Returns how many were dropped */
+size_t swarm_expire(void);
+
+/* Same as swarm_add() / swarm_remove() for the leecher role */
+int swarm_add_leecher(ssize_t fileID, PeerHandle peer, uint64_t ttl);
+int swarm_remove_leecher(ssize_t fileID, PeerHandle peer);
+/* The leecher finished the file: it leaves the leechers and the file's completed counter goes up by one.
+   It only becomes a seeder when it participates. Returns 0, -1 when out of memory */
+int swarm_complete(ssize_t fileID, PeerHandle peer);
+/* Adds to the file's transfer totals. Returns 0, -1 when out of memory */
+int swarm_record_transfer(ssize_t fileID, uint64_t uploaded, uint64_t downloaded);
+void swarm_stats(ssize_t fileID, SwarmStats *out);
+
+/*
+Batched forms for requests carrying many fileIDs. The fileIDs are visited shard by shard,
+so every shard lock is taken once per batch instead of once per file. Results are in batch order.
+*/
+/* results[i] is what swarm_add(fileIDs[i], peer, ttl) returns */
+void swarm_add_batch(const ssize_t *fileIDs, size_t count, PeerHandle peer, uint64_t ttl, int *results);
+/* Up to max_each seeders of fileIDs[i] go to out[i * max_each ...], found[i] says how many */
+void swarm_collect_batch(const ssize_t *fileIDs, size_t count, PeerHandle *out, size_t max_each, size_t *found);
+void swarm_stats_batch(const ssize_t *fileIDs, size_t count, SwarmStats *out);
+
+/*
+Persistence (journal.h). swarm_for_each() visits every membership with the seconds it has left,
+and the counters of every swarm, one shard at a time under its read lock.
+swarm_restore_counters() raises the file's counters to at least the given values.
+*/
+typedef void (*SwarmMemberFn)(ssize_t fileID, PeerHandle peer, SwarmRole role, uint64_t ttl, void *arg);
+typedef void (*SwarmCountersFn)(ssize_t fileID, const SwarmCounters *counters, void *arg);
+void swarm_for_each(SwarmMemberFn member, SwarmCountersFn counters, void *arg);
+int swarm_restore_counters(ssize_t fileID, const SwarmCounters *counters);
+
+#endif // SWARM_H
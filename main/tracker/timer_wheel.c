@@ -0,0 +1,106 @@
+#include <string.h>
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * TIMER_WHEEL_BITS)
+
+static void slot_link(TimerEntry **head, TimerEntry *entry)
+{
+    entry->next = *head;
+    if (*head)
+        (*head)->pprev = &entry->next;
+    *head = entry;
+    entry->pprev = head;
+}
+
+/*
+File the entry in the lowest level where expires and current only differ in that level's digit
+(or below). The digit of expires is then strictly ahead of current's, so the slot is reached
+before the wheel wraps.
+*/
+static void wheel_insert(TimerWheel *wheel, TimerEntry *entry)
+{
+    uint64_t expires = entry->expires;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           (expires >> LEVEL_SHIFT(level + 1)) != (wheel->current >> LEVEL_SHIFT(level + 1)))
+        level++;
+
+    size_t slot = (expires >> LEVEL_SHIFT(level)) & SLOT_MASK;
+    slot_link(&wheel->slots[level][slot], entry);
+}
+
+/* Re-file every entry of one slot, they land in lower levels now that the wheel moved */
+static void wheel_cascade(TimerWheel *wheel, int level)
+{
+    size_t slot = (wheel->current >> LEVEL_SHIFT(level)) & SLOT_MASK;
+    TimerEntry *entry = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+
+    while (entry)
+    {
+        TimerEntry *next = entry->next;
+        wheel_insert(wheel, entry);
+        entry = next;
+    }
+}
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->current = now;
+}
+
+void timer_wheel_cancel(TimerEntry *entry)
+{
+    if (!entry->pprev)
+        return;
+    *entry->pprev = entry->next;
+    if (entry->next)
+        entry->next->pprev = entry->pprev;
+    entry->next = NULL;
+    entry->pprev = NULL;
+}
+
+void timer_wheel_schedule(TimerWheel *wheel, TimerEntry *entry, uint64_t expires)
+{
+    timer_wheel_cancel(entry);
+
+    if (expires <= wheel->current)
+        expires = wheel->current + 1;
+    if (expires - wheel->current > TIMER_WHEEL_MAX_DELAY)
+        expires = wheel->current + TIMER_WHEEL_MAX_DELAY;
+
+    entry->expires = expires;
+    wheel_insert(wheel, entry);
+}
+
+TimerEntry *timer_wheel_advance(TimerWheel *wheel, uint64_t now)
+{
+    TimerEntry *expired = NULL;
+
+    while (wheel->current < now)
+    {
+        wheel->current++;
+
+        // Find how many lower wheels wrapped, cascade from the highest one down
+        int top = 0;
+        while (top < TIMER_WHEEL_LEVELS - 1 &&
+               (wheel->current & ((1ULL << LEVEL_SHIFT(top + 1)) - 1)) == 0)
+            top++;
+        for (int level = top; level > 0; level--)
+            wheel_cascade(wheel, level);
+
+        // Everything left in this level 0 slot is due now, move the whole list at once
+        TimerEntry **head = &wheel->slots[0][wheel->current & SLOT_MASK];
+        while (*head)
+        {
+            TimerEntry *entry = *head;
+            *head = entry->next;
+            entry->pprev = NULL;
+            entry->next = expired;
+            expired = entry;
+        }
+    }
+    return expired;
+}
@@ -0,0 +1,47 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+@brief Hierarchical timer wheel, O(1) schedule / cancel, expiry in bulk
+
+TIMER_WHEEL_LEVELS wheels of TIMER_WHEEL_SLOTS slots each. Level 0 slots are one tick wide,
+level 1 slots are 64 ticks wide, and so on. A timer is filed in the lowest level whose slot still
+separates it from "now". When the lower wheels wrap, the next slot of the level above is cascaded down.
+Expiring N timers costs O(N) plus one slot per tick, no matter how many timers are pending.
+
+Entries are intrusive: embed a TimerEntry in the object that needs a deadline.
+The wheel does no locking, the owner serializes access (swarm.c uses the shard lock).
+*/
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4 // 64^4 ticks, with 1 s ticks that is ~194 days
+#define TIMER_WHEEL_MAX_DELAY (((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+typedef struct TimerEntry
+{
+    struct TimerEntry *next;
+    struct TimerEntry **pprev; // NULL when not scheduled
+    uint64_t expires;          // tick
+} TimerEntry;
+
+typedef struct TimerWheel
+{
+    uint64_t current; // every tick <= current has been processed
+    TimerEntry *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now);
+/* (Re)schedules entry to fire at tick expires, a deadline in the past fires on the next advance */
+void timer_wheel_schedule(TimerWheel *wheel, TimerEntry *entry, uint64_t expires);
+void timer_wheel_cancel(TimerEntry *entry);
+/*
+Processes every tick up to now. Expired entries are unlinked and returned as a list chained by next.
+The caller owns them afterwards.
+*/
+TimerEntry *timer_wheel_advance(TimerWheel *wheel, uint64_t now);
+
+#endif // TIMER_WHEEL_H
@@ -1,13 +1,15 @@
+#define _GNU_SOURCE // accept4()
 #include "tracker.h"
 #include "parser.h"
+#include "policy.h"
+#include "region_trie.h"
+#include "admin.h"
+#include "decision_cache.h"
+#include "udp_tracker.h"
+#include "journal.h"
 #include "meta.h"
 #define BUFFER_SIZE (1024 * 5)
-#define SERVER_PORT 5555
-#define SERVER_IP "127.0.0.1"
 
-#define MAX_FILES 10000
-#define MAX_SEEDERS_PER_FILE 64
-#define MAX_SEEDERS 1000
 
 /*
 *@brief General architecture of the tracker:
@@ -21,20 +23,75 @@ When you first launch the tracker, it will have a CLI
     1. You can enter command mode and CRUD the rules of the tracker
     2. Start listening for peers and WORK
 
+Once listening, the tracker runs one epoll event loop per worker thread (./tracker -w N).
+Every worker has its own SO_REUSEPORT listening socket, the kernel balances new peers across them.
+Every accepted socket gets its own TrackerConnection with a small FSM and its own
+read/write buffers, so one peer idling in its CLI never blocks the rest of the swarm.
+
+Shared state and its locks:
+    peer registry   -> internal rwlock (peer_registry.c), peers are referenced by PeerHandle
+    swarms          -> one rwlock per fileID % SWARM_SHARDS (swarm.c),
+                       requests for different files almost never touch the same lock
+
+Seeder liveness: every participate ACK carries the announce interval (-i). A seeder that misses
+TRACKER_ANNOUNCE_MISSES announces is dropped by the reaper thread (tracker_reaper_main()).
+Announces and seeder lookups are also served over UDP on the same port by the threads
+of udp_tracker.c (-u), against the same registry, swarms and policy.
+With -s the fileIDs are split over several tracker processes by consistent hashing (shard_map.h),
+each one holds the catalog and swarms of its own fileIDs and redirects the rest (MSG_ACK_WRONG_SHARD).
+The shard list is fixed for the lifetime of the catalogs (recorded in catalog.shards, checked at startup).
+Registry and swarm changes are logged to swarm.wal (journal.c, group commit every -j ms, 0 = off)
+and compacted into swarm.snap, a restarted tracker reloads both before it accepts peers.
+Counters and per-request latency histograms (metrics.h) answer MSG_REQUEST_STATS and the STATS admin command,
+and are dumped to tracker.metrics.json every -M seconds.
+
 @note - We integrated our parser in this function tracker_command_mode()
       - Explaination of our Policy will be in our parser files. Please take a look :)
 */
 
-static PeerInfo list_seeders[MAX_SEEDERS];
-static PeerInfo *file_to_seeders[MAX_FILES][MAX_SEEDERS_PER_FILE];
-
 /* --------------------------------------------------------------------------
    🔹 Global Variables
    -------------------------------------------------------------------------- */
 static TrackerContext *ctx;
-static TrackerMessageHeader *header;
-static TrackerMessageBody *body;
-static int listen_socketfd; // Global variable to hold the listening socket
+static volatile int tracker_running = 1; // cleared when a worker hits a fatal error
+
+static const char *const tracker_counter_names[TRACKER_COUNTER_COUNT] = {
+    [METRIC_ACCEPTS] = "accepts",
+    [METRIC_CLOSES] = "closes",
+    [METRIC_BYTES_IN] = "bytes_in",
+    [METRIC_BYTES_OUT] = "bytes_out",
+    [METRIC_REQUESTS] = "requests",
+    [METRIC_BAD_HEADERS] = "bad_headers",
+    [METRIC_IP_BLOCKED] = "ip_blocked",
+    [METRIC_FILEHASH_BLOCKED] = "filehash_blocked",
+    [METRIC_REGION_BLOCKED] = "region_blocked",
+    [METRIC_WRONG_SHARD] = "wrong_shard",
+    [METRIC_UDP_PACKETS_IN] = "udp_packets_in",
+    [METRIC_UDP_PACKETS_OUT] = "udp_packets_out",
+    [METRIC_JOURNAL_BYTES] = "journal_bytes",
+};
+
+// Only the requests are timed, an ACK type never reaches the handler
+static const char *const tracker_timer_names[TRACKER_TIMER_COUNT] = {
+    [MSG_REQUEST_ALL_AVAILABLE_SEED] = "request_catalog",
+    [MSG_REQUEST_META_DATA] = "request_metadata",
+    [MSG_REQUEST_SEEDER_BY_FILEID] = "request_seeders",
+    [MSG_REQUEST_CREATE_SEEDER] = "request_create_seeder",
+    [MSG_REQUEST_DELETE_SEEDER] = "request_delete_seeder",
+    [MSG_REQUEST_CREATE_NEW_SEED] = "request_create_new_seed",
+    [MSG_REQUEST_PARTICIPATE_SEED_BY_FILEID] = "request_participate",
+    [MSG_REQUEST_UNPARTICIPATE_SEED] = "request_unparticipate",
+    [MSG_REQUEST_SEARCH] = "request_search",
+    [MSG_REQUEST_PARTICIPATE_BATCH] = "request_participate_batch",
+    [MSG_REQUEST_SEEDER_BATCH] = "request_seeder_batch",
+    [MSG_REQUEST_SCRAPE] = "request_scrape",
+    [MSG_REQUEST_ANNOUNCE] = "request_announce",
+    [MSG_REQUEST_STATS] = "request_stats",
+    [TIMER_JOURNAL_COMMIT] = "journal_commit",
+    [TIMER_JOURNAL_SNAPSHOT] = "journal_snapshot",
+    [TIMER_CATALOG_APPEND] = "catalog_append",
+    [TIMER_UDP_REQUEST] = "udp_request",
+};
 
 // Forward declarations for any missing functions
 void exit_success(void)
@@ -49,8 +106,60 @@ void exit_success(void)
 /* Initialization functions */
 void init_seeders(void)
 {
-    memset(list_seeders, 0, sizeof(list_seeders));
-    memset(file_to_seeders, 0, sizeof(file_to_seeders));
+    peer_registry_init();
+    swarm_init();
+    catalog_load(); // meta.log is read once here, requests are served from memory
+}
+
+/* fileID comes straight off the wire */
+static int valid_fileID(ssize_t fileID)
+{
+    return fileID >= 0;
+}
+
+/* Swarms and their counters are only created for files of this tracker's catalog,
+   an arbitrary fileID must not allocate anything */
+int tracker_has_file(ssize_t fileID)
+{
+    return valid_fileID(fileID) && catalog_lookup(fileID) != NULL;
+}
+
+int tracker_owns_file(ssize_t fileID, TrackerShard *owner)
+{
+    if (ctx->shards.count == 0)
+        return 1;
+    size_t shard = shard_for_file(&ctx->shards, fileID);
+    if (owner)
+        *owner = ctx->shards.shards[shard];
+    return shard == (size_t)ctx->shard_self;
+}
+
+static int owns_file(ssize_t fileID)
+{
+    return tracker_owns_file(fileID, NULL);
+}
+
+/* Sends MSG_ACK_WRONG_SHARD when another tracker owns fileID. Returns 1 when the request was answered */
+static int reply_wrong_shard(TrackerConnection *conn, ssize_t fileID)
+{
+    TrackerShard owner;
+    if (!valid_fileID(fileID) || tracker_owns_file(fileID, &owner))
+        return 0;
+
+    metrics_add(METRIC_WRONG_SHARD, 1);
+    PeerWithFileID redirect;
+    memset(&redirect, 0, sizeof(redirect));
+    strncpy(redirect.singleSeeder.ip_address, owner.ip, sizeof(redirect.singleSeeder.ip_address) - 1);
+    snprintf(redirect.singleSeeder.port, sizeof(redirect.singleSeeder.port), "%d", owner.port);
+    redirect.fileID = fileID;
+
+    TrackerMessageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = MSG_ACK_WRONG_SHARD;
+    header.bodySize = sizeof(redirect);
+    conn_write(conn, &header, sizeof(header));
+    conn_write(conn, &redirect, sizeof(redirect));
+    return 1;
 }
 
 int setup_server(void)
@@ -64,8 +173,10 @@ int setup_server(void)
 
     int optval = 1;
     setsockopt(listen_socketfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    // every worker binds its own socket to the same port, the kernel load-balances accepts
+    setsockopt(listen_socketfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
 
-    struct hostent *server = gethostbyname(SERVER_IP);
+    struct hostent *server = gethostbyname(ctx->listen_ip);
     if (!server)
     {
         fprintf(stderr, "ERROR, no such host\n");
@@ -77,7 +188,7 @@ int setup_server(void)
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
     memcpy(&serv_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-    serv_addr.sin_port = htons(SERVER_PORT);
+    serv_addr.sin_port = htons(ctx->listen_port);
 
     if (bind(listen_socketfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0)
     {
@@ -86,191 +197,277 @@ int setup_server(void)
         exit(EXIT_FAILURE);
     }
 
-    if (listen(listen_socketfd, 10) < 0)
+    if (conn_set_nonblocking(listen_socketfd) < 0)
+    {
+        perror("ERROR setting listen socket non-blocking");
+        ctx->current_state = Tracker_FSM_ERROR;
+        exit(EXIT_FAILURE);
+    }
+
+    if (listen(listen_socketfd, TRACKER_LISTEN_BACKLOG) < 0)
     {
         perror("ERROR on listen");
         ctx->current_state = Tracker_FSM_ERROR;
         exit(EXIT_FAILURE);
     }
 
-    printf("✅ Tracker listening on %s:%d\n", SERVER_IP, SERVER_PORT);
+    printf("✅ Tracker listening on %s:%d\n", ctx->listen_ip, ctx->listen_port);
     return listen_socketfd;
 }
 
 /* Peer management functions
     this is used when we are trying to register a peer, or when a non-registered peer request to seed
+    Peers are looked up by their binary (address, port) in the peer registry, O(1) instead of a scan.
+    @return PEER_HANDLE_NONE when the peer is unknown (or its address is not numeric)
 */
-PeerInfo *find_peer(const PeerInfo *p)
+PeerHandle find_peer(const PeerInfo *p)
 {
-    for (int i = 0; i < MAX_SEEDERS; i++)
-    {
-        if (strcmp(list_seeders[i].ip_address, p->ip_address) == 0 &&
-            strcmp(list_seeders[i].port, p->port) == 0)
-        {
-            return &list_seeders[i];
-        }
-    }
-    return NULL;
+    PeerKey key;
+    if (peer_key_from_info(p, &key) < 0)
+        return PEER_HANDLE_NONE;
+    return peer_registry_find(&key);
 }
 
-PeerInfo *add_peer(const PeerInfo *p)
+PeerHandle add_peer(const PeerInfo *p, int *created)
 {
-    // 1) Look for a free slot in list_seeders
-    for (int i = 0; i < MAX_SEEDERS; i++)
-    {
-        // A "free" slot can be identified by empty ip_address or some "inactive" marker
-        if (list_seeders[i].ip_address[0] == '\0')
-        {
-            // Found an empty slot, fill it
-            strcpy(list_seeders[i].ip_address, p->ip_address);
-            strcpy(list_seeders[i].port, p->port);
-            return &list_seeders[i];
-        }
-    }
-
-    // If we reach here, no free slot was found
-    return NULL;
+    PeerKey key;
+    if (created)
+        *created = 0;
+    if (peer_key_from_info(p, &key) < 0)
+        return PEER_HANDLE_NONE;
+    return peer_registry_insert(&key, created);
 }
 /*
 The functions below will be called by the event manager
 @note events are triggered by the peer via a network call
 */
 
-int add_seeder_to_file(ssize_t fileID, PeerInfo *p)
+/*
+@brief Adds (or re-announces) a seeder of fileID. The membership lives for TRACKER_ANNOUNCE_MISSES
+       announce intervals, every re-announce restarts that countdown.
+@return 0 added, 1 already seeding this file (deadline refreshed), -1 fileID not in the catalog or out of memory
+*/
+static uint64_t seeder_ttl(void)
 {
-    // First, check if already present
-    for (int i = 0; i < MAX_SEEDERS_PER_FILE; i++)
-    {
-        if (file_to_seeders[fileID][i] == p)
-        {
-            // It's already in the list for this file
-            return 1; // some code meaning "already present"
-        }
-    }
+    return (uint64_t)ctx->announce_interval * TRACKER_ANNOUNCE_MISSES;
+}
 
-    // Not found, so find a free slot
-    for (int i = 0; i < MAX_SEEDERS_PER_FILE; i++)
+int add_seeder_to_file(ssize_t fileID, PeerHandle p)
+{
+    if (!tracker_has_file(fileID))
+        return -1;
+    return swarm_add(fileID, p, seeder_ttl());
+}
+
+/*
+@brief One announce, from TCP (MSG_REQUEST_ANNOUNCE) or UDP: the peer joins fileID's swarm as a leecher
+       while left > 0 and as a seeder once left == 0, and its transfer is added to the file's counters.
+@return 0 joined (or completed), 1 refreshed, 2 left the swarm (stopped), -1 fileID not in the catalog or out of memory
+*/
+int tracker_announce(ssize_t fileID, PeerHandle p, AnnounceEvent event, uint64_t uploaded, uint64_t downloaded, uint64_t left)
+{
+    if (!tracker_has_file(fileID))
+        return -1;
+    if (swarm_record_transfer(fileID, uploaded, downloaded) < 0)
+        return -1;
+
+    if (event == ANNOUNCE_EVENT_STOPPED)
     {
-        if (file_to_seeders[fileID][i] == NULL)
-        {
-            file_to_seeders[fileID][i] = p;
-            return 0; // success
-        }
+        swarm_remove(fileID, p);
+        swarm_remove_leecher(fileID, p);
+        return 2;
     }
+    if (event == ANNOUNCE_EVENT_COMPLETED)
+        return swarm_complete(fileID, p); // seeding is a separate participate, the peer may not serve the file
+    if (left > 0)
+        return swarm_add_leecher(fileID, p, seeder_ttl());
+    return swarm_add(fileID, p, seeder_ttl());
+}
+
+/* Every participate ACK tells the seeder when to announce again */
+static void send_participate_ack(TrackerConnection *conn)
+{
+    TrackerMessageHeader ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.type = MSG_ACK_PARTICIPATE_SEED_BY_FILEID;
+    ack.bodySize = sizeof(ParticipateAck);
+
+    ParticipateAck body;
+    body.announceInterval = ctx->announce_interval;
+
+    conn_write(conn, &ack, sizeof(ack));
+    conn_write(conn, &body, sizeof(body));
+}
 
-    // No space available
-    return -1;
+/* Same shape as the other handlers' errors: MSG_RESPOND_ERROR with a text body */
+static void send_error_text(TrackerConnection *conn, const char *text)
+{
+    TrackerMessageHeader ackHeader;
+    TrackerMessageBody ackBody;
+
+    ackHeader.type = MSG_RESPOND_ERROR;
+    ackHeader.bodySize = sizeof(ackBody.raw);
+    memset(ackBody.raw, 0, sizeof(ackBody.raw));
+    strncpy(ackBody.raw, text, sizeof(ackBody.raw) - 1);
+    conn_write(conn, &ackHeader, sizeof(TrackerMessageHeader));
+    conn_write(conn, &ackBody, sizeof(ackBody.raw));
 }
 
-void handle_create_seeder(int client_socket, const PeerInfo *p)
+void handle_create_seeder(TrackerConnection *conn, const PeerInfo *p)
 {
-    // 1) Check if peer already in master array
-    PeerInfo *existing = find_peer(p);
-    if (existing)
+    // 1) Look the peer up and insert it in one step
+    int created = 0;
+    PeerHandle handle = add_peer(p, &created);
+    if (handle == PEER_HANDLE_NONE)
     {
-        // It's already known
-        printf("Peer already in list: %s:%s\n", p->ip_address, p->port);
-        char resp[] = "Seeder already registered in master array.\n";
-        write(client_socket, resp, strlen(resp));
+        // Address is not numeric or the registry could not grow
+        char resp[] = "No space in the master seeder list.\n";
+        conn_write(conn, resp, strlen(resp));
         return;
     }
 
-    // 2) If not found, add to master list
-    PeerInfo *newPeer = add_peer(p);
-    if (!newPeer)
+    if (!created)
     {
-        // Master array is full
-        char resp[] = "No space in the master seeder list.\n";
-        write(client_socket, resp, strlen(resp));
+        // It's already known
+        LOG_DEBUG("Peer already in list: %s:%s", p->ip_address, p->port);
+        char resp[] = "Seeder already registered in master array.\n";
+        conn_write(conn, resp, strlen(resp));
         return;
     }
 
     // 3) Respond success to client
-    printf("New seeder added to master array: %s:%s\n",
-           newPeer->ip_address, newPeer->port);
+    LOG_DEBUG("New seeder added to master array: %s:%s", p->ip_address, p->port);
 
     char resp[] = "New seeder registered in master array.\n";
-    write(client_socket, resp, strlen(resp));
+    conn_write(conn, resp, strlen(resp));
 }
 
-void handle_request_all_available_files(int client_socket)
+void handle_request_all_available_files(TrackerConnection *conn)
 {
     size_t fileCount = 0; // placeholder
     FileEntry *fileList = load_file_entries(&fileCount);
-    printf("fileCount: %zd\n", fileCount);
-    printf("\nAvailable Files:\n");
-    printf("---------------------------\n");
-
+    LOG_DEBUG("Available files: %zu", fileCount);
     for (size_t i = 0; i < fileCount; i++)
-    {
-        printf("index i : %ld", i);
-        printf("File ID: %04zd, Total Bytes: %zd, Meta File: %s\n", fileList[i].fileID, fileList[i].totalBytes, fileList[i].metaFilename);
-    }
+        LOG_DEBUG("File ID: %04zd, Total Bytes: %zd, Meta File: %s", fileList[i].fileID, fileList[i].totalBytes, fileList[i].metaFilename);
 
     if (!fileList || fileCount == 0)
     {
         char error_msg[] = "No available files.\n";
-        write(client_socket, error_msg, strlen(error_msg));
+        conn_write(conn, error_msg, strlen(error_msg));
+        free(fileList); // an empty catalog still returns a buffer
         return;
     }
-    printf("Sending fileCount: %zu\n", fileCount);
-    write(client_socket, &fileCount, sizeof(fileCount));
+    conn_write(conn, &fileCount, sizeof(fileCount));
 
     size_t total_bytes = fileCount * sizeof(FileEntry);
-    write(client_socket, fileList, total_bytes);
+    conn_write(conn, fileList, total_bytes);
 
     free(fileList);
 }
 
-void handle_create_new_seed(int client_socket, const FileMetadata *meta)
+/**
+ * @brief Sends one page of the catalog: the entries added after version cursor
+ *
+ * Only the requested page is copied, a peer that keeps its catalog cached
+ * asks with its last cursor and receives nothing but the new files.
+ */
+void handle_request_catalog_page(TrackerConnection *conn, ssize_t cursor, ssize_t maxEntries)
+{
+    if (cursor < 0)
+        cursor = 0;
+    if (maxEntries <= 0)
+        maxEntries = CATALOG_PAGE_DEFAULT;
+    if (maxEntries > CATALOG_PAGE_MAX)
+        maxEntries = CATALOG_PAGE_MAX;
+
+    FileEntry *entries = malloc((size_t)maxEntries * sizeof(FileEntry));
+    if (!entries)
+    {
+        send_error_text(conn, "Tracker out of memory.\n");
+        return;
+    }
+
+    size_t catalogVersion = 0;
+    size_t count = catalog_changes_since((size_t)cursor, entries, (size_t)maxEntries, &catalogVersion);
+
+    CatalogPageHeader page;
+    page.count = (ssize_t)count;
+    page.nextCursor = cursor + (ssize_t)count;
+    page.catalogVersion = (ssize_t)catalogVersion;
+
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_CATALOG_PAGE;
+    ackHeader.bodySize = sizeof(page) + count * sizeof(FileEntry);
+
+    conn_write(conn, &ackHeader, sizeof(ackHeader));
+    conn_write(conn, &page, sizeof(page));
+    if (count)
+        conn_write(conn, entries, count * sizeof(FileEntry));
+    free(entries);
+}
+
+/**
+ * @brief Answers a filename search with the best matching fileIDs
+ *
+ * Served from the trigram index (search_index.h), the catalog itself is never transferred.
+ */
+void handle_request_search(TrackerConnection *conn, const SearchRequest *req)
+{
+    char query[SEARCH_QUERY_MAX];
+    memcpy(query, req->query, sizeof(query));
+    query[sizeof(query) - 1] = '\0';
+
+    ssize_t maxResults = req->maxResults;
+    if (maxResults <= 0)
+        maxResults = SEARCH_RESULTS_DEFAULT;
+    if (maxResults > SEARCH_RESULTS_MAX)
+        maxResults = SEARCH_RESULTS_MAX;
+
+    ssize_t fileIDs[SEARCH_RESULTS_MAX];
+    ssize_t count = (ssize_t)search_index_query(query, fileIDs, (size_t)maxResults);
+
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_SEARCH;
+    ackHeader.bodySize = sizeof(count) + count * sizeof(ssize_t);
+
+    conn_write(conn, &ackHeader, sizeof(ackHeader));
+    conn_write(conn, &count, sizeof(count));
+    if (count)
+        conn_write(conn, fileIDs, count * sizeof(ssize_t));
+}
+
+void handle_create_new_seed(TrackerConnection *conn, const FileMetadata *meta)
 {
-    // Step 1: Generate a new fileID and write .meta to disk
+    // Step 1: Generate a new fileID, identical content (same fileHash) gets its existing fileID back
     ssize_t fileID = add_new_file(meta);
     if (fileID < 0)
     {
         char err[] = "Failed to create new file entry.\n";
-        write(client_socket, err, strlen(err));
+        conn_write(conn, err, strlen(err));
         return;
     }
 
     // Step 2: Print info
-    printf("\n📦 New Seed Created:\n");
-    printf(" • Filename    : %s\n", meta->filename); // original filename from client
-    printf(" • Total Chunks: %zd\n", meta->totalChunk);
-    printf(" • Total Bytes : %zd\n", meta->totalByte);
-    printf(" • fileID      : %zd\n", fileID);
-    printf(" • File Hash   : ");
-    for (int i = 0; i < 32; i++)
-        printf("%02x", meta->fileHash[i]);
-    printf("\n");
-
-    // Check if socket is still valid before sending
-    int error = 0;
-    socklen_t len = sizeof(error);
-    int retval = getsockopt(client_socket, SOL_SOCKET, SO_ERROR, &error, &len);
-
-    if (retval != 0 || error != 0)
-    {
-        printf("Socket error detected before sending ACK (error=%d)\n", error);
-        // Socket is no longer valid
-        ctx->current_state = Tracker_FSM_LISTENING_PEER;
-        return;
+    LOG_INFO("📦 New seed fileID=%zd: %s, %zd chunks, %zd bytes", // filename as sent by the client
+             fileID, meta->filename, meta->totalChunk, meta->totalByte);
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG))
+    {
+        char hex[2 * sizeof(meta->fileHash) + 1];
+        for (size_t i = 0; i < sizeof(meta->fileHash); i++)
+            snprintf(hex + 2 * i, 3, "%02x", meta->fileHash[i]);
+        LOG_DEBUG("fileID=%zd hash %s", fileID, hex);
     }
 
-    printf("Socket is valid, preparing to send ACK\n");
-
     // Step 3: Acknowledge with new fileID
     TrackerMessageHeader ack_header;
     memset(&ack_header, 0, sizeof(ack_header));
     ack_header.type = MSG_ACK_CREATE_NEW_SEED;
     ack_header.bodySize = sizeof(ssize_t);
 
-    printf("sending ack ");
-    printf("ctx->client_socket: %d\n", ctx->client_socket);
-    printf("Sending ACK header: type=%d, bodySize=%zd\n", ack_header.type, ack_header.bodySize);
-    write(ctx->client_socket, &ack_header, sizeof(ack_header));
-    write(ctx->client_socket, &fileID, sizeof(ssize_t)); // send full TrackerMessageBody
-    printf("done  - sending ack \n\n ");
+    conn_write(conn, &ack_header, sizeof(ack_header));
+    conn_write(conn, &fileID, sizeof(ssize_t));
 }
 
 /*
@@ -279,23 +476,10 @@ Our goal for this project is to implement some level of policy and censorship in
 */
 int is_ip_blocked(const char *ip_address)
 {
-    /*
-    we have to check the char list_ip_blocked[1024][64]
-    if it is inside list_ip_blocked then we return 1
-    else we return 0
-    */
-    printf("ip_address: %s\n", ip_address);
-
     if (ip_address == NULL || *ip_address == '\0')
         return 0; // treat NULL/empty as “not blocked”
 
-    for (int i = 0; i < list_blocked_ip_count; ++i)
-    {
-        if (strcmp(list_blocked_ip[i], ip_address) == 0)
-            return 1;
-    }
-
-    return 0;
+    return policy_ip_blocked(ip_address); // hash set lookup in the published rules
 }
 
 int is_filehash_blocked(const uint8_t *filehash)
@@ -303,41 +487,80 @@ int is_filehash_blocked(const uint8_t *filehash)
     if (filehash == NULL) // defensive
         return 0;
 
-    for (int i = 0; i < list_blocked_filehash_count; ++i)
-    {
-        if (memcmp(list_blocked_filehash[i], filehash, 32) == 0)
-            return 1; // exact 32‑byte match -> its inside block list
-    }
-    return 0; // its not blocked
+    return policy_file_blocked(filehash); // exact 32‑byte match -> its inside block list
 }
 
 int is_peer_blockfiletoregion_blocked(const PeerInfo *peer,
                                       const uint8_t *filehash)
 {
     /*
-    Iterate through the list_blocked_filehash_to_region[i]
-    if peer ip matches the prefix of the rule inside the list_blocked
-        -> We will check the filehash
+    Find the region of the peer ip (longest prefix match in the region trie),
+    then look up (region, filehash) in the published rules
     */
     if (peer == NULL || filehash == NULL)
         return 0;
 
-    for (int i = 0; i < list_blocked_filehash_to_region_count; ++i)
-    {
-        BlockFileToRegion *rule = &list_blocked_filehash_to_region[i];
+    int region = region_of_ip(peer->ip_address);
+    if (region < 0)
+        return 0; // not in any region
 
-        char *prefix = region_prefix[rule->region];
-        size_t prefix_len = strlen(prefix);
+    return policy_file_blocked_in_region(region, filehash);
+}
 
-        if (strncmp(peer->ip_address, prefix, prefix_len) != 0)
-            continue; // peer is not in this region
+static PolicyDecision count_policy_decision(PolicyDecision decision)
+{
+    if (decision == POLICY_IP_BLOCKED)
+        metrics_add(METRIC_IP_BLOCKED, 1);
+    else if (decision == POLICY_FILEHASH_BLOCKED)
+        metrics_add(METRIC_FILEHASH_BLOCKED, 1);
+    else if (decision == POLICY_REGION_BLOCKED)
+        metrics_add(METRIC_REGION_BLOCKED, 1);
+    return decision;
+}
 
-        /* --- File‑hash check -------------------------------------------- */
-        if (memcmp(rule->filehash, filehash, 32) == 0)
-            return 1; // region matches AND hash matches block block
-    }
+/*
+@brief Runs the three policy checks for (ip, client, fileID), or reuses the cached answer
+ip is the address the IP rules are checked against, client the connection whose region counts.
+The generation is read before the checks: a decision computed while the rules change is
+stored under the older generation and simply misses next time.
+*/
+PolicyDecision evaluate_policy(const char *ip, const PeerInfo *client, ssize_t fileID)
+{
+    uint64_t generation = policy_generation();
+    int cached = decision_cache_get(ip, client->ip_address, fileID, generation);
+    if (cached >= 0)
+        return count_policy_decision((PolicyDecision)cached);
+
+    PolicyDecision decision = POLICY_ALLOW;
+    uint8_t *seed_hash = NULL;
+    if (is_ip_blocked(ip) > 0)
+        decision = POLICY_IP_BLOCKED;
+    else if ((seed_hash = get_filehash_by_fileid(fileID)) == NULL)
+        return POLICY_ALLOW; // unknown fileID, not cached: it may be registered later
+    else if (is_filehash_blocked(seed_hash) > 0)
+        decision = POLICY_FILEHASH_BLOCKED;
+    else if (is_peer_blockfiletoregion_blocked(client, seed_hash) > 0)
+        decision = POLICY_REGION_BLOCKED;
+
+    decision_cache_put(ip, client->ip_address, fileID, generation, decision);
+    return count_policy_decision(decision);
+}
 
-    return 0; // not blocked
+/* Sends the ACK of a filehash / region block, returns 1 if it did (the request is over) */
+static int reply_file_blocked(TrackerConnection *conn, PolicyDecision decision)
+{
+    if (decision == POLICY_FILEHASH_BLOCKED)
+        LOG_INFO("Rejected %s:%s, filehash is blocked", conn->client_peer.ip_address, conn->client_peer.port);
+    else if (decision == POLICY_REGION_BLOCKED)
+        LOG_INFO("Rejected %s:%s, region is blocked for this file", conn->client_peer.ip_address, conn->client_peer.port);
+    else
+        return 0;
+
+    TrackerMessageHeader ackHeader;
+    ackHeader.bodySize = 0;
+    ackHeader.type = MSG_ACK_FILEHASH_BLOCKED;
+    conn_write(conn, &ackHeader, sizeof(TrackerMessageHeader));
+    return 1;
 }
 
 /**
@@ -353,7 +576,7 @@ int is_peer_blockfiletoregion_blocked(const PeerInfo *peer,
  * 
  * If all checks pass, the peer is added to the file's seeder list.
  *
- * @param client_socket      Socket for communication with the requesting peer
+ * @param conn               Connection of the requesting peer
  * @param peerWithFileID     Structure containing peer information and the requested fileID
  *
  * Responses:
@@ -363,348 +586,654 @@ int is_peer_blockfiletoregion_blocked(const PeerInfo *peer,
  * - MSG_ACK_PARTICIPATE_SEED_BY_FILEID: On successful participation
  * - Text messages: For already participating or no space available cases
  */
-void handle_request_participate_by_fileID(int client_socket, const PeerWithFileID *peerWithFileID)
+void handle_request_participate_by_fileID(TrackerConnection *conn, const PeerWithFileID *peerWithFileID)
 {
+    if (reply_wrong_shard(conn, peerWithFileID->fileID))
+        return;
 
-    // Peer must not be in the blocked list to contine this control flow
-    int ip_block_flag = is_ip_blocked(peerWithFileID->singleSeeder.ip_address); // if flag > 0, it means the fileHash is blocked
+    // Peer must not be in the blocked list to contine this control flow, the file checks follow the registration check
+    PolicyDecision decision = evaluate_policy(peerWithFileID->singleSeeder.ip_address, &conn->client_peer, peerWithFileID->fileID);
 
-    if (ip_block_flag > 0)
+    if (decision == POLICY_IP_BLOCKED)
     {
         // Peer must call "create_seeder" first
-        printf("Peer is inside the blocked list ");
+        LOG_INFO("Rejected %s:%s, IP is blocked", conn->client_peer.ip_address, conn->client_peer.port);
 
         TrackerMessageHeader ackHeader;
 
         ackHeader.bodySize = 0;
         ackHeader.type = MSG_ACK_IP_BLOCKED;
 
-        write(client_socket, &ackHeader, sizeof(TrackerMessageHeader));
+        conn_write(conn, &ackHeader, sizeof(TrackerMessageHeader));
         return;
     }
 
     // Peer must be registered in the master list as a seeder
-    PeerInfo *existingPeer = find_peer(&peerWithFileID->singleSeeder);
-    if (!existingPeer)
+    PeerHandle existingPeer = find_peer(&peerWithFileID->singleSeeder);
+    if (existingPeer == PEER_HANDLE_NONE)
     {
         // Peer must call "create_seeder" first
-        printf("Peer not in master list, requester must register seeder first.\n%s\n %s\n %zd", peerWithFileID->singleSeeder.ip_address, peerWithFileID->singleSeeder.port, peerWithFileID->fileID);
+        LOG_INFO("Peer %s:%s not in master list, it must register as a seeder before fileID=%zd",
+                 peerWithFileID->singleSeeder.ip_address, peerWithFileID->singleSeeder.port, peerWithFileID->fileID);
 
         TrackerMessageHeader ackHeader;
         TrackerMessageBody ackBody;
 
         ackHeader.bodySize = sizeof(ackBody.raw);
+        memset(ackBody.raw, 0, sizeof(ackBody.raw));
         ackHeader.type = MSG_RESPOND_ERROR;
         strcpy(ackBody.raw, "You must register as a seeder first.\n");
-        write(client_socket, &ackHeader, sizeof(TrackerMessageHeader));
-        write(client_socket, &ackBody, sizeof(ackBody));
+        conn_write(conn, &ackHeader, sizeof(TrackerMessageHeader));
+        conn_write(conn, &ackBody, sizeof(ackBody.raw));
         return;
     }
 
-    // This is the fileHash of the seed, we will use this to check if it is blocked
-    uint8_t *seed_hash = get_filehash_by_fileid(peerWithFileID->fileID);
+    // Filehash blocked, globally or for the requester's region
+    if (reply_file_blocked(conn, decision))
+        return;
 
-    int filehash_flag = is_filehash_blocked(seed_hash);
-    int region_filehash_flag = is_peer_blockfiletoregion_blocked(&(ctx->client_peer), seed_hash);
+    // control flow will not reach here - we will return early if either filehash or peer is blocked
+    // 2) Add the peer to file_to_seeders
+    ssize_t fileID = peerWithFileID->fileID;
+    if (!tracker_has_file(fileID))
+    {
+        send_error_text(conn, "Unknown fileID.\n");
+        return;
+    }
+    int addResult = add_seeder_to_file(fileID, existingPeer);
+    if (addResult == 0)
+    {
+        // 0 means success
+        LOG_DEBUG("Peer %s:%s added as seeder for fileID=%zd",
+                  peerWithFileID->singleSeeder.ip_address, peerWithFileID->singleSeeder.port, fileID);
 
-    if (filehash_flag > 0)
+        send_participate_ack(conn);
+    }
+    else if (addResult == 1)
+    {
+        // 1 means "already present", this is a re-announce and its deadline was pushed back
+        send_participate_ack(conn);
+    }
+    else
     {
-        printf("Seed filehash is blocked. We reject the request ");
+        // -1 means a bad fileID or the swarm could not grow
+        LOG_WARN("Could not add seeder to fileID=%zd", fileID);
+        const char *fail_msg = "No space in this file's seeder list.\n";
+        conn_write(conn, fail_msg, strlen(fail_msg));
+    }
+}
 
-        TrackerMessageHeader ackHeader;
+/*
+@brief A seeder stops seeding one file. Its membership and expiry timer are dropped right away
+*/
+void handle_request_unparticipate_by_fileID(TrackerConnection *conn, const PeerWithFileID *peerWithFileID)
+{
+    if (reply_wrong_shard(conn, peerWithFileID->fileID))
+        return;
+    PeerHandle existingPeer = find_peer(&peerWithFileID->singleSeeder);
+    ssize_t fileID = peerWithFileID->fileID;
 
-        ackHeader.type = MSG_ACK_FILEHASH_BLOCKED;
-        write(client_socket, &ackHeader, sizeof(TrackerMessageHeader));
+    if (existingPeer == PEER_HANDLE_NONE || !valid_fileID(fileID) || swarm_remove(fileID, existingPeer) < 0)
+    {
+        send_error_text(conn, "Not participating in this file.\n");
         return;
     }
 
-    if (region_filehash_flag > 0)
-    {
-        printf("Requester region has been blocked from seeding this file ");
-        TrackerMessageHeader ackHeader;
+    LOG_DEBUG("Peer %s:%s stopped seeding fileID=%zd",
+              peerWithFileID->singleSeeder.ip_address, peerWithFileID->singleSeeder.port, fileID);
 
-        ackHeader.type = MSG_ACK_FILEHASH_BLOCKED;
-        write(client_socket, &ackHeader, sizeof(TrackerMessageHeader));
+    TrackerMessageHeader ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.type = MSG_ACK_UNPARTICIPATE_SEED;
+    conn_write(conn, &ack, sizeof(ack));
+}
 
+/*
+@brief A seeder leaves the tracker. It is removed from the peer registry, so every swarm membership
+       it still holds stops resolving at once and is reclaimed when its timer fires.
+*/
+void handle_delete_seeder(TrackerConnection *conn, const PeerInfo *p)
+{
+    PeerHandle existingPeer = find_peer(p);
+    if (existingPeer == PEER_HANDLE_NONE || peer_registry_remove(existingPeer) < 0)
+    {
+        send_error_text(conn, "Seeder is not registered.\n");
         return;
     }
 
-    // control flow will not reach here - we will return early if either filehash or peer is blocked
-    // 2) Add the peer to file_to_seeders
-    ssize_t fileID = peerWithFileID->fileID;
-    int addResult = add_seeder_to_file(fileID, existingPeer);
-    if (addResult == 0)
-    {
-        // 0 means success
-        printf("Peer %s:%s added as seeder for fileID=%zd\n",
-               existingPeer->ip_address, existingPeer->port, fileID);
+    LOG_DEBUG("Seeder removed from master array: %s:%s", p->ip_address, p->port);
 
-        // Optionally send a short ACK message or
-        // a formal TrackerMessage with MSG_ACK_PARTICIPATE_SEED_BY_FILEID
-        TrackerMessageHeader ack;
-        memset(&ack, 0, sizeof(ack));
-        ack.type = MSG_ACK_PARTICIPATE_SEED_BY_FILEID;
-        ack.bodySize = 0; // no body or you can send a short text
+    TrackerMessageHeader ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.type = MSG_ACK_DELETE_SEEDER;
+    conn_write(conn, &ack, sizeof(ack));
+}
 
-        write(client_socket, &ack, sizeof(ack));
-    }
-    else if (addResult == 1)
+/* Queues the compact peers: all IPv4 peers (6 bytes each), then all IPv6 peers (18 bytes each) */
+static int write_compact_peers(TrackerConnection *conn, const PeerKey *keys, size_t count)
+{
+    // IPv4 section first, then IPv6, so the reader knows every entry size up front
+    for (int v6 = 0; v6 <= 1; v6++)
     {
-        // 1 means "already present"
-        printf("Peer %s:%s is already seeding fileID=%zd\n",
-               existingPeer->ip_address, existingPeer->port, fileID);
-
-        const char *already_msg = "Already participating in this file.\n";
-        write(client_socket, already_msg, strlen(already_msg));
+        for (size_t i = 0; i < count; i++)
+        {
+            if ((keys[i].family == AF_INET6) != v6)
+                continue;
+            uint8_t entry[PEER_COMPACT_V6_SIZE];
+            size_t len = peer_key_to_compact(&keys[i], entry);
+            if (conn_write(conn, entry, len) < 0)
+                return -1;
+        }
     }
-    else
+    return 0;
+}
+
+/*
+@brief Queues a MSG_ACK_SEEDER_BY_FILEID_COMPACT reply: CompactPeerListHeader, then the compact peers
+@return 0 on success, -1 if the reply could not be queued
+*/
+static int write_compact_seeder_list(TrackerConnection *conn, const PeerKey *keys, size_t count)
+{
+    CompactPeerListHeader list = {0, 0};
+    for (size_t i = 0; i < count; i++)
     {
-        // -1 means no space
-        fprintf(stderr, "No space to add seeder in fileID=%zd\n", fileID);
-        const char *fail_msg = "No space in this file's seeder list.\n";
-        write(client_socket, fail_msg, strlen(fail_msg));
+        if (keys[i].family == AF_INET6)
+            list.count_v6++;
+        else
+            list.count_v4++;
     }
+
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_SEEDER_BY_FILEID_COMPACT;
+    ackHeader.bodySize = sizeof(list) + list.count_v4 * PEER_COMPACT_V4_SIZE + list.count_v6 * PEER_COMPACT_V6_SIZE;
+
+    if (conn_write(conn, &ackHeader, sizeof(ackHeader)) < 0 ||
+        conn_write(conn, &list, sizeof(list)) < 0)
+        return -1;
+    return write_compact_peers(conn, keys, count);
 }
 
-void handle_request_seeder_by_fileID(int client_socket, ssize_t fileID)
+void handle_request_seeder_by_fileID(TrackerConnection *conn, ssize_t fileID, ssize_t maxPeers, ssize_t flags)
 {
+    if (reply_wrong_shard(conn, fileID))
+        return;
 
     // Peer must not be in the blocked list to contine this control flow
-    int ip_block_flag = is_ip_blocked(ctx->client_peer.ip_address); // if flag > 0, it means the fileHash is blocked
+    PolicyDecision decision = evaluate_policy(conn->client_peer.ip_address, &conn->client_peer, fileID);
 
-    if (ip_block_flag > 0)
+    if (decision == POLICY_IP_BLOCKED)
     {
         // Peer must call "create_seeder" first
-        printf("Peer is inside the blocked list ");
+        LOG_INFO("Rejected %s:%s, IP is blocked", conn->client_peer.ip_address, conn->client_peer.port);
 
         TrackerMessageHeader ackHeader;
 
         ackHeader.bodySize = 0;
         ackHeader.type = MSG_ACK_IP_BLOCKED;
 
-        write(client_socket, &ackHeader, sizeof(TrackerMessageHeader));
+        conn_write(conn, &ackHeader, sizeof(TrackerMessageHeader));
         return;
     }
 
-    // This is the fileHash of the seed, we will use this to check if it is blocked
-    uint8_t *seed_hash = get_filehash_by_fileid(fileID);
+    // Filehash blocked, globally or for the requester's region
+    if (reply_file_blocked(conn, decision))
+        return;
 
-    int filehash_flag = is_filehash_blocked(seed_hash);
-    int region_filehash_flag = is_peer_blockfiletoregion_blocked(&(ctx->client_peer), seed_hash);
+    size_t limit = maxPeers <= 0 ? SEEDERS_PER_REPLY_DEFAULT : (size_t)maxPeers;
+    if (limit > SEEDERS_PER_REPLY_MAX)
+        limit = SEEDERS_PER_REPLY_MAX;
 
-    if (filehash_flag > 0)
+    // 1) Copy the member handles out, only this file's shard is locked and only for the copy
+    PeerHandle *handles = malloc(limit * sizeof(PeerHandle));
+    PeerKey *keys = malloc(limit * sizeof(PeerKey));
+    if (!handles || !keys)
     {
-        printf("Seed filehash is blocked. We reject the request ");
+        free(handles);
+        free(keys);
+        LOG_ERROR("allocating seeder reply: %s", strerror(errno));
+        conn->state = Conn_FSM_CLOSING;
+        return;
+    }
 
+    size_t found = valid_fileID(fileID) ? swarm_collect(fileID, handles, limit) : 0;
+    ssize_t count = 0;
+    for (size_t i = 0; i < found; i++)
+    {
+        // a handle whose peer has been removed no longer resolves and is skipped
+        if (peer_registry_get(handles[i], &keys[count]) == 0)
+            count++;
+    }
+
+    int failed;
+    if (flags & SEEDER_REQUEST_COMPACT)
+    {
+        failed = write_compact_seeder_list(conn, keys, (size_t)count) < 0;
+    }
+    else
+    {
+        // 2) Length-prefixed reply: header, count, then the peers streamed straight into the write buffer
         TrackerMessageHeader ackHeader;
+        memset(&ackHeader, 0, sizeof(ackHeader));
+        ackHeader.type = MSG_ACK_SEEDER_BY_FILEID;
+        ackHeader.bodySize = sizeof(ssize_t) + count * sizeof(PeerInfo);
+
+        failed = conn_write(conn, &ackHeader, sizeof(ackHeader)) < 0 ||
+                 conn_write(conn, &count, sizeof(count)) < 0;
+        for (ssize_t i = 0; !failed && i < count; i++)
+        {
+            // Format the binary identity back into the PeerInfo leechers expect
+            PeerInfo peer;
+            peer_key_to_info(&keys[i], &peer);
+            failed = conn_write(conn, &peer, sizeof(peer)) < 0;
+        }
+    }
+    free(handles);
+    free(keys);
 
-        ackHeader.type = MSG_ACK_FILEHASH_BLOCKED;
-        write(client_socket, &ackHeader, sizeof(TrackerMessageHeader));
+    if (failed)
+    {
+        LOG_ERROR("queueing MSG_ACK_SEEDER_BY_FILEID: %s", strerror(errno));
+        conn->state = Conn_FSM_CLOSING;
         return;
     }
 
-    if (region_filehash_flag > 0)
+    LOG_DEBUG("Sent %zd seeders for fileID=%zd", count, fileID);
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Batched requests
+   -------------------------------------------------------------------------- */
+static void send_ip_blocked(TrackerConnection *conn)
+{
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_IP_BLOCKED;
+    conn_write(conn, &ackHeader, sizeof(ackHeader));
+}
+
+static int32_t batch_status(PolicyDecision decision)
+{
+    if (decision == POLICY_IP_BLOCKED)
+        return BATCH_STATUS_IP_BLOCKED;
+    if (decision == POLICY_FILEHASH_BLOCKED || decision == POLICY_REGION_BLOCKED)
+        return BATCH_STATUS_FILEHASH_BLOCKED;
+    return BATCH_STATUS_OK;
+}
+
+static int32_t batch_file_status(const char *ip, const PeerInfo *client, ssize_t fileID)
+{
+    if (!valid_fileID(fileID))
+        return BATCH_STATUS_FAILED;
+    if (!owns_file(fileID))
     {
-        printf("Requester region has been blocked from seeding this file ");
-        TrackerMessageHeader ackHeader;
+        metrics_add(METRIC_WRONG_SHARD, 1);
+        return BATCH_STATUS_WRONG_SHARD;
+    }
+    if (!tracker_has_file(fileID))
+        return BATCH_STATUS_FAILED;
+    return batch_status(evaluate_policy(ip, client, fileID));
+}
 
-        ackHeader.type = MSG_ACK_FILEHASH_BLOCKED;
-        write(client_socket, &ackHeader, sizeof(TrackerMessageHeader));
+/*
+@brief Participates in every file of the batch at once.
+The policy is checked per file (mostly decision cache hits), then every allowed file joins its
+swarm in one swarm_add_batch() call: each swarm shard is locked once for the whole batch.
+*/
+void handle_request_participate_batch(TrackerConnection *conn, const BatchParticipateRequest *req, const ssize_t *fileIDs)
+{
+    size_t count = (size_t)req->count;
+    if (is_ip_blocked(req->seeder.ip_address) > 0)
+    {
+        send_ip_blocked(conn);
+        return;
+    }
 
+    PeerHandle seeder = find_peer(&req->seeder);
+    if (seeder == PEER_HANDLE_NONE)
+    {
+        send_error_text(conn, "You must register as a seeder first.\n");
         return;
     }
 
-    // 1) Gather seeders in a local array
-    PeerInfo seederList[MAX_SEEDERS_PER_FILE];
-    memset(seederList, 0, sizeof(seederList));
+    int32_t status[BATCH_FILES_MAX];
+    ssize_t allowed[BATCH_FILES_MAX];
+    size_t position[BATCH_FILES_MAX]; // allowed[j] is fileIDs[position[j]]
+    int results[BATCH_FILES_MAX];
+    size_t allowed_count = 0;
 
-    size_t count = 0;
-    for (int i = 0; i < MAX_SEEDERS_PER_FILE; i++)
+    for (size_t i = 0; i < count; i++)
     {
-        PeerInfo *p = file_to_seeders[fileID][i];
-        if (p != NULL)
+        status[i] = batch_file_status(req->seeder.ip_address, &conn->client_peer, fileIDs[i]);
+        if (status[i] == BATCH_STATUS_OK)
         {
-            // Copy the actual PeerInfo struct
-            seederList[count] = *p;
-            count++;
-            if (count >= MAX_SEEDERS_PER_FILE)
-                break;
+            allowed[allowed_count] = fileIDs[i];
+            position[allowed_count++] = i;
         }
     }
 
-    // 2) Create a response message
+    swarm_add_batch(allowed, allowed_count, seeder, seeder_ttl(), results);
+    size_t joined = 0;
+    for (size_t j = 0; j < allowed_count; j++)
+    {
+        if (results[j] < 0)
+            status[position[j]] = BATCH_STATUS_FAILED;
+        else
+            joined++;
+    }
+
     TrackerMessageHeader ackHeader;
     memset(&ackHeader, 0, sizeof(ackHeader));
-    ackHeader.type = MSG_ACK_SEEDER_BY_FILEID;
-    // The body will be `count` PeerInfo structs
-    ackHeader.bodySize = count * sizeof(PeerInfo);
+    ackHeader.type = MSG_ACK_PARTICIPATE_BATCH;
+    ackHeader.bodySize = sizeof(BatchParticipateAck) + count * sizeof(int32_t);
+    BatchParticipateAck ack = {(ssize_t)count, ctx->announce_interval};
+
+    conn_write(conn, &ackHeader, sizeof(ackHeader));
+    conn_write(conn, &ack, sizeof(ack));
+    conn_write(conn, status, count * sizeof(int32_t));
 
-    // 3) Send the header
-    ssize_t written = write(client_socket, &ackHeader, sizeof(ackHeader));
-    if (written < 0)
+    LOG_DEBUG("Peer %s:%s participates in %zu of %zu files", req->seeder.ip_address, req->seeder.port, joined, count);
+}
+
+/*
+@brief Seeder lists of many files in one reply (always compact).
+The members of every allowed file are copied out with one swarm_collect_batch() call.
+*/
+void handle_request_seeder_batch(TrackerConnection *conn, const BatchSeederRequest *req, const ssize_t *fileIDs)
+{
+    size_t count = (size_t)req->count;
+    if (is_ip_blocked(conn->client_peer.ip_address) > 0)
     {
-        ctx->current_state = Tracker_FSM_ERROR;
-        perror("ERROR writing MSG_ACK_SEEDER_BY_FILEID header");
+        send_ip_blocked(conn);
         return;
     }
 
-    // 4) Send the body (the array of PeerInfo)
-    if (count > 0)
+    size_t limit = req->maxPeers <= 0 ? SEEDERS_PER_REPLY_DEFAULT : (size_t)req->maxPeers;
+    if (limit > SEEDERS_PER_REPLY_MAX)
+        limit = SEEDERS_PER_REPLY_MAX;
+    if (count > 0 && limit > BATCH_SEEDERS_MAX / count)
+        limit = BATCH_SEEDERS_MAX / count;
+
+    int32_t status[BATCH_FILES_MAX];
+    ssize_t allowed[BATCH_FILES_MAX];
+    size_t found[BATCH_FILES_MAX];
+    size_t allowed_count = 0;
+    for (size_t i = 0; i < count; i++)
     {
-        written = write(client_socket, seederList, ackHeader.bodySize);
-        if (written < 0)
+        status[i] = batch_file_status(conn->client_peer.ip_address, &conn->client_peer, fileIDs[i]);
+        if (status[i] == BATCH_STATUS_OK)
+            allowed[allowed_count++] = fileIDs[i];
+    }
+
+    PeerHandle *handles = malloc((allowed_count * limit + 1) * sizeof(PeerHandle));
+    PeerKey *keys = malloc((allowed_count * limit + 1) * sizeof(PeerKey));
+    if (!handles || !keys)
+    {
+        free(handles);
+        free(keys);
+        LOG_ERROR("allocating seeder batch reply: %s", strerror(errno));
+        conn->state = Conn_FSM_CLOSING;
+        return;
+    }
+
+    // 1) Copy every swarm out shard by shard, then resolve the handles (stale ones are skipped)
+    swarm_collect_batch(allowed, allowed_count, handles, limit, found);
+    ssize_t bodySize = sizeof(ssize_t) + count * sizeof(BatchSeederEntry);
+    for (size_t j = 0; j < allowed_count; j++)
+    {
+        PeerKey *fileKeys = keys + j * limit;
+        size_t resolved = 0;
+        for (size_t k = 0; k < found[j]; k++)
         {
-            ctx->current_state = Tracker_FSM_ERROR;
-            perror("ERROR writing MSG_ACK_SEEDER_BY_FILEID body");
-            return;
+            if (peer_registry_get(handles[j * limit + k], &fileKeys[resolved]) == 0)
+            {
+                bodySize += fileKeys[resolved].family == AF_INET6 ? PEER_COMPACT_V6_SIZE : PEER_COMPACT_V4_SIZE;
+                resolved++;
+            }
         }
+        found[j] = resolved;
     }
 
-    printf("Sent %zd seeders for fileID=%zd\n", count, fileID);
-    ctx->current_state = Tracker_FSM_LISTENING_EVENT;
-}
+    // 2) ssize_t count, then per file its entry and its compact peers
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_SEEDER_BATCH;
+    ackHeader.bodySize = bodySize;
+    ssize_t replyCount = (ssize_t)count;
+    int failed = conn_write(conn, &ackHeader, sizeof(ackHeader)) < 0 ||
+                 conn_write(conn, &replyCount, sizeof(replyCount)) < 0;
 
-void handle_request_metadata(int client_socket, const RequestMetadataBody *req)
-{
-    char filepath[512];
-    snprintf(filepath, sizeof(filepath), "./records/%s", req->metaFilename);
-    printf("filepath: %s", filepath);
-    FileMetadata meta;
-    if (load_single_metadata(filepath, &meta) != 0)
+    for (size_t i = 0, j = 0; !failed && i < count; i++)
     {
-        TrackerMessageHeader errHeader = {MSG_RESPOND_ERROR, 0};
-        write(client_socket, &errHeader, sizeof(errHeader));
-        return;
+        BatchSeederEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.fileID = fileIDs[i];
+        entry.status = status[i];
+        const PeerKey *fileKeys = NULL;
+        size_t peers = 0;
+        if (status[i] == BATCH_STATUS_OK)
+        {
+            fileKeys = keys + j * limit;
+            peers = found[j++];
+        }
+        for (size_t k = 0; k < peers; k++)
+        {
+            if (fileKeys[k].family == AF_INET6)
+                entry.count_v6++;
+            else
+                entry.count_v4++;
+        }
+        failed = conn_write(conn, &entry, sizeof(entry)) < 0 ||
+                 write_compact_peers(conn, fileKeys, peers) < 0;
     }
+    free(handles);
+    free(keys);
 
-    TrackerMessageHeader respHeader;
-    respHeader.type = MSG_REQUEST_META_DATA;
-    respHeader.bodySize = sizeof(FileMetadata);
-
-    write(client_socket, &respHeader, sizeof(respHeader));
-    write(client_socket, &meta, sizeof(meta));
+    if (failed)
+    {
+        LOG_ERROR("queueing MSG_ACK_SEEDER_BATCH: %s", strerror(errno));
+        conn->state = Conn_FSM_CLOSING;
+        return;
+    }
 
-    printf("✅ Sent metadata for file: %s\n", req->metaFilename);
+    LOG_DEBUG("Sent seeders of %zu files", count);
 }
 
-/**
- * @brief Reads a message header from the client connection
- *
- * Reads a TrackerMessageHeader structure from the current client socket and
- * stores it in the global 'header' variable. This function handles various
- * connection states and error conditions including:
- * - Connection resets
- * - Client disconnections
- * - Incomplete reads
- *
- * On error conditions, this function will update the FSM state appropriately
- * to either listen for new peers or enter the error state.
- *
- * @return int 1 if an error or special case occurred (caller should return early),
- *             0 on successful read
- */
-int read_header()
+/* Swarm counters of many files (seeders, leechers, completions, transfer totals), read in one pass over the shards */
+void handle_request_scrape(TrackerConnection *conn, const ssize_t *fileIDs, size_t count)
 {
-    printf("Waiting for request...\n");
+    if (is_ip_blocked(conn->client_peer.ip_address) > 0)
+    {
+        send_ip_blocked(conn);
+        return;
+    }
 
-    ssize_t bytes_read = read(ctx->client_socket, header, sizeof(TrackerMessageHeader));
+    SwarmStats stats[BATCH_FILES_MAX];
+    swarm_stats_batch(fileIDs, count, stats);
 
-    printf("Header read result: %zd bytes (expected %zu)\n", bytes_read, sizeof(TrackerMessageHeader));
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_SCRAPE;
+    ackHeader.bodySize = sizeof(ssize_t) + count * sizeof(ScrapeEntry);
+    ssize_t replyCount = (ssize_t)count;
+    conn_write(conn, &ackHeader, sizeof(ackHeader));
+    conn_write(conn, &replyCount, sizeof(replyCount));
 
-    // IMPORTANT: Only check errno if bytes_read < 0
-    if (bytes_read < 0)
+    for (size_t i = 0; i < count; i++)
     {
-        printf("ERROR: Header read failed (bytes_read = %zd)\n", bytes_read);
-        if (errno == ECONNRESET)
+        ScrapeEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.fileID = fileIDs[i];
+        if (valid_fileID(fileIDs[i]) && owns_file(fileIDs[i]))
         {
-            printf("Detected ECONNRESET: Peer disconnected abruptly.\n");
-            ctx->current_state = Tracker_FSM_LISTENING_PEER;
-            return 1;
+            entry.seeders = (ssize_t)stats[i].seeders;
+            entry.leechers = (ssize_t)stats[i].leechers;
+            entry.completed = (ssize_t)stats[i].completed;
+            entry.uploaded = (ssize_t)stats[i].uploaded;
+            entry.downloaded = (ssize_t)stats[i].downloaded;
         }
-        else
-        {
-            printf("Socket error: %s (errno=%d)\n", strerror(errno), errno);
-            ctx->current_state = Tracker_FSM_ERROR;
-            return 1;
-        }
-        return 1;
+        conn_write(conn, &entry, sizeof(entry));
     }
+}
 
-    if (bytes_read == 0)
+/*
+@brief A peer reports its state in one file's swarm: leeching, seeding, finished or gone,
+       and how many bytes it moved since its last announce
+*/
+void handle_request_announce(TrackerConnection *conn, const AnnounceRequest *req)
+{
+    if (reply_wrong_shard(conn, req->fileID))
+        return;
+    PolicyDecision decision = evaluate_policy(req->peer.ip_address, &conn->client_peer, req->fileID);
+    if (decision == POLICY_IP_BLOCKED)
     {
-        printf("Graceful disconnection: Client closed connection (bytes_read = 0)\n");
-        ctx->current_state = Tracker_FSM_LISTENING_PEER;
-        return 1;
+        send_ip_blocked(conn);
+        return;
+    }
+    if (reply_file_blocked(conn, decision))
+        return;
+    if (!tracker_has_file(req->fileID))
+    {
+        send_error_text(conn, "Unknown fileID.\n");
+        return;
     }
 
-    if (bytes_read < sizeof(TrackerMessageHeader))
+    PeerHandle peer = add_peer(&req->peer, NULL);
+    int result = -1;
+    if (peer != PEER_HANDLE_NONE)
+        result = tracker_announce(req->fileID, peer, (AnnounceEvent)req->event,
+                                  req->uploaded > 0 ? (uint64_t)req->uploaded : 0,
+                                  req->downloaded > 0 ? (uint64_t)req->downloaded : 0,
+                                  req->left > 0 ? (uint64_t)req->left : 0);
+    if (result < 0)
     {
-        printf("WARNING: Incomplete header read! Got %zd of %zu bytes\n",
-               bytes_read, sizeof(TrackerMessageHeader));
-        ctx->current_state = Tracker_FSM_ERROR;
-        return 1;
+        send_error_text(conn, "Announce failed.\n");
+        return;
     }
 
-    // Print header contents for debugging
-    printf("Header read successfully: Type=%d, BodySize=%zd\n",
-           header->type, header->bodySize);
+    SwarmStats stats;
+    swarm_stats(req->fileID, &stats);
+    AnnounceAck ack = {ctx->announce_interval, (ssize_t)stats.seeders, (ssize_t)stats.leechers};
 
-    return 0;
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_ANNOUNCE;
+    ackHeader.bodySize = sizeof(ack);
+    conn_write(conn, &ackHeader, sizeof(ackHeader));
+    conn_write(conn, &ack, sizeof(ack));
+
+    LOG_DEBUG("Announce from %s:%s for fileID=%zd (event %zd, left %zd)",
+              req->peer.ip_address, req->peer.port, req->fileID, req->event, req->left);
+}
+
+/* Counters and latency percentiles of this tracker as JSON, see the Metrics section of tracker.h */
+void handle_request_stats(TrackerConnection *conn)
+{
+    char *json = metrics_json();
+    if (!json)
+    {
+        char err[] = "Metrics unavailable.\n";
+        conn_write(conn, err, strlen(err));
+        return;
+    }
+
+    TrackerMessageHeader ackHeader;
+    memset(&ackHeader, 0, sizeof(ackHeader));
+    ackHeader.type = MSG_ACK_STATS;
+    ackHeader.bodySize = (ssize_t)strlen(json);
+    conn_write(conn, &ackHeader, sizeof(ackHeader));
+    conn_write(conn, json, strlen(json));
+    free(json);
+}
+
+void handle_request_metadata(TrackerConnection *conn, const RequestMetadataBody *req)
+{
+    // Served from the in-memory catalog, the .meta file is not reopened
+    char metaFilename[sizeof(req->metaFilename)];
+    memcpy(metaFilename, req->metaFilename, sizeof(metaFilename));
+    metaFilename[sizeof(metaFilename) - 1] = '\0';
+
+    const CatalogEntry *entry = catalog_lookup_by_metafilename(metaFilename);
+    if (!entry)
+    {
+        TrackerMessageHeader errHeader = {MSG_RESPOND_ERROR, 0};
+        conn_write(conn, &errHeader, sizeof(errHeader));
+        return;
+    }
+
+    TrackerMessageHeader respHeader;
+    respHeader.type = MSG_REQUEST_META_DATA;
+    respHeader.bodySize = sizeof(FileMetadata);
+
+    conn_write(conn, &respHeader, sizeof(respHeader));
+    conn_write(conn, &entry->meta, sizeof(entry->meta));
+
+    LOG_DEBUG("Sent metadata for file: %s", metaFilename);
 }
 
 /**
- * @brief Reads a message body from the client connection
- *
- * After the header has been read successfully, this function reads the message body
- * based on the bodySize specified in the header. The data is stored in the global
- * 'body' variable. This function:
- * - Detects client disconnection during body transmission
- * - Handles connection reset errors
+ * @brief Reads a message header out of the connection's read buffer
  *
- * On error conditions, this function will update the FSM state appropriately
- * to either listen for new peers or enter the error state.
+ * Copies a TrackerMessageHeader from conn->rbuf at *offset into conn->header.
+ * The socket itself was already drained by conn_fill(), so this never blocks.
+ * A header announcing a body larger than TrackerMessageBody is a protocol error,
+ * the connection is moved to CLOSING instead of letting it overflow our buffers.
  *
- * @return int 1 if an error or special case occurred (caller should return early),
+ * @return int 1 if the header is incomplete or invalid (caller should stop parsing),
  *             0 on successful read
  */
-int read_body()
+static int is_batch_message(TrackerMessageType type)
 {
-    if (header->bodySize > 0)
-    {
-        size_t total_bytes_read = 0;
-        char *buffer_position = (char *)body; // Cast to char* for pointer arithmetic
+    return type == MSG_REQUEST_PARTICIPATE_BATCH || type == MSG_REQUEST_SEEDER_BATCH || type == MSG_REQUEST_SCRAPE;
+}
 
-        // Keep reading until we have all the bytes or encounter an error
-        while (total_bytes_read < header->bodySize)
-        {
-            ssize_t bytes_read = read(ctx->client_socket,
-                                      buffer_position + total_bytes_read,
-                                      header->bodySize - total_bytes_read);
+int read_header(TrackerConnection *conn, size_t *offset)
+{
+    if (conn->rlen - *offset < sizeof(TrackerMessageHeader))
+        return 1; // wait for more bytes
 
-            if (bytes_read < 0)
-            {
-                if (errno == ECONNRESET)
-                {
-                    printf("Peer disconnected abruptly (Connection reset).\n");
-                    ctx->current_state = Tracker_FSM_LISTENING_PEER;
-                    return 1;
-                }
-                perror("ERROR reading body");
-                ctx->current_state = Tracker_FSM_ERROR;
-                return 1;
-            }
+    memcpy(&conn->header, conn->rbuf + *offset, sizeof(TrackerMessageHeader));
+    *offset += sizeof(TrackerMessageHeader);
 
-            if (bytes_read == 0)
-            {
-                printf("Client disconnected during body read.\n");
-                ctx->current_state = Tracker_FSM_LISTENING_PEER;
-                return 1;
-            }
+    // Batched requests carry their fileIDs after the fixed body, everything else fits the union
+    ssize_t maxBody = is_batch_message(conn->header.type) ? (ssize_t)BATCH_BODY_MAX : (ssize_t)sizeof(TrackerMessageBody);
+    if (conn->header.bodySize < 0 || conn->header.bodySize > maxBody)
+    {
+        LOG_WARN("Invalid bodySize %zd from %s:%s, closing connection",
+                 conn->header.bodySize, conn->client_peer.ip_address, conn->client_peer.port);
+        metrics_add(METRIC_BAD_HEADERS, 1);
+        conn->state = Conn_FSM_CLOSING;
+        return 1;
+    }
+
+    LOG_DEBUG("Header read successfully: Type=%d, BodySize=%zd", conn->header.type, conn->header.bodySize);
+    conn->state = Conn_FSM_READ_BODY;
+    return 0;
+}
+
+/**
+ * @brief Reads a message body out of the connection's read buffer
+ *
+ * After the header has been read successfully, this function copies bodySize bytes
+ * from conn->rbuf into the caller's TrackerMessageBody. If the body has not fully
+ * arrived yet we simply keep the connection in READ_BODY and try again on the next
+ * EPOLLIN, partial messages never stall the event loop.
+ *
+ * @return int 1 if the body is still incomplete (caller should stop parsing),
+ *             0 on successful read
+ */
+int read_body(TrackerConnection *conn, size_t *offset, TrackerMessageBody *body)
+{
+    size_t body_size = (size_t)conn->header.bodySize;
+    if (conn->rlen - *offset < body_size)
+        return 1; // wait for more bytes
 
-            total_bytes_read += bytes_read;
-        }
-    }
+    memset(body, 0, sizeof(TrackerMessageBody));
+    memcpy(body, conn->rbuf + *offset, body_size < sizeof(TrackerMessageBody) ? body_size : sizeof(TrackerMessageBody));
+    conn->payload = conn->rbuf + *offset;
+    *offset += body_size;
 
+    conn->state = Conn_FSM_HANDLE_EVENT;
     return 0; // Success
 }
 
@@ -715,40 +1244,47 @@ int read_body()
  * message types. It:
  * - Validates appropriate body sizes for each event type
  * - Routes the request to specialized handler functions
- * - Updates the FSM state after handling
+ * - Updates the connection FSM state after handling
  * - Reports errors for invalid or unimplemented event types
  *
- * Most handlers will transition the FSM back to the listening state
- * after completing their work, but may transition to error state
- * if validation fails.
+ * Most handlers leave the connection ready for its next header.
+ * A malformed request only closes that one connection, never the tracker.
  *
+ * @param conn  The connection the request arrived on
+ * @param body  The decoded message body
  * @param event The event type mapped from the received message header
  */
-void tracker_event_handler(FSM_TRACKER_EVENT event)
+void tracker_event_handler(TrackerConnection *conn, const TrackerMessageBody *body, FSM_TRACKER_EVENT event)
 {
+    const TrackerMessageHeader *header = &conn->header;
+    conn->state = Conn_FSM_READ_HEADER;
 
-    /* Read Header and Body was handled in tracker_listening_event() */
     switch (event)
     {
     case FSM_EVENT_REQUEST_CREATE_SEEDER:
         if (header->bodySize == sizeof(PeerInfo))
         {
-            handle_create_seeder(ctx->client_socket, &(body->singleSeeder));
-            ctx->current_state = Tracker_FSM_LISTENING_EVENT;
+            handle_create_seeder(conn, &(body->singleSeeder));
         }
         else
         {
             char err[] = "Invalid body size for CREATE_SEEDER.\n";
-            ctx->current_state = Tracker_FSM_ERROR;
-            write(ctx->client_socket, err, strlen(err));
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
         }
 
         break;
 
     case FSM_EVENT_REQUEST_ALL_AVAILABLE_SEED:
-        printf("requesting all seed");
-        handle_request_all_available_files(ctx->client_socket);
-        ctx->current_state = Tracker_FSM_LISTENING_EVENT;
+        if (header->bodySize == sizeof(CatalogPageRequest))
+        {
+            handle_request_catalog_page(conn, body->catalogPage.cursor, body->catalogPage.maxEntries);
+        }
+        else
+        {
+            // older peers send no body and get the whole catalog
+            handle_request_all_available_files(conn);
+        }
 
         break;
 
@@ -756,132 +1292,418 @@ void tracker_event_handler(FSM_TRACKER_EVENT event)
 
         if (header->bodySize == sizeof(FileMetadata))
         {
-            handle_create_new_seed(ctx->client_socket, &(body->fileMetadata));
-            ctx->current_state = Tracker_FSM_LISTENING_EVENT;
+            handle_create_new_seed(conn, &(body->fileMetadata));
         }
         else
         {
-            printf("invalid body size for CREATE_NEW_SEED.\n");
+            LOG_WARN("Invalid body size for CREATE_NEW_SEED from %s:%s", conn->client_peer.ip_address, conn->client_peer.port);
             char err[] = "Invalid body size for CREATE_NEW_SEED.\n";
-            write(ctx->client_socket, err, strlen(err));
-            ctx->current_state = Tracker_FSM_ERROR;
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
         }
         break;
 
     case FSM_EVENT_REQUEST_PARTICIPATE_SEED_BY_FILEID:
 
         // edit this to use the blocked list
-        handle_request_participate_by_fileID(ctx->client_socket, &(body->peerWithFileID));
-        ctx->current_state = Tracker_FSM_LISTENING_EVENT;
+        handle_request_participate_by_fileID(conn, &(body->peerWithFileID));
+        break;
+
+    case FSM_EVENT_REQUEST_UNPARTICIPATE_SEED:
+        if (header->bodySize == sizeof(PeerWithFileID))
+        {
+            handle_request_unparticipate_by_fileID(conn, &(body->peerWithFileID));
+        }
+        else
+        {
+            char err[] = "Invalid body size for UNPARTICIPATE_SEED.\n";
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
+        }
+        break;
+
+    case FSM_EVENT_REQUEST_DELETE_SEEDER:
+        if (header->bodySize == sizeof(PeerInfo))
+        {
+            handle_delete_seeder(conn, &(body->singleSeeder));
+        }
+        else
+        {
+            char err[] = "Invalid body size for DELETE_SEEDER.\n";
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
+        }
         break;
 
     case FSM_EVENT_REQUEST_SEEDER_BY_FILEID:
-        // edit this to use the blocked list
-        handle_request_seeder_by_fileID(ctx->client_socket, body->fileID);
+        if (header->bodySize == sizeof(SeederListRequest))
+        {
+            handle_request_seeder_by_fileID(conn, body->seederRequest.fileID, body->seederRequest.maxPeers, body->seederRequest.flags);
+        }
+        else if (header->bodySize == offsetof(SeederListRequest, flags))
+        {
+            // fileID + maxPeers, full PeerInfo reply
+            handle_request_seeder_by_fileID(conn, body->seederRequest.fileID, body->seederRequest.maxPeers, 0);
+        }
+        else if (header->bodySize == sizeof(ssize_t))
+        {
+            // older peers only send the fileID
+            handle_request_seeder_by_fileID(conn, body->fileID, SEEDERS_PER_REPLY_DEFAULT, 0);
+        }
+        else
+        {
+            char err[] = "Invalid body size for REQUEST_SEEDER_BY_FILEID.\n";
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
+        }
+        break;
+
+    case FSM_EVENT_REQUEST_SEARCH:
+        if (header->bodySize == sizeof(SearchRequest))
+        {
+            handle_request_search(conn, &(body->search));
+        }
+        else
+        {
+            char err[] = "Invalid body size for REQUEST_SEARCH.\n";
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
+        }
+        break;
+
+    case FSM_EVENT_REQUEST_ANNOUNCE:
+        if (header->bodySize == sizeof(AnnounceRequest))
+        {
+            handle_request_announce(conn, &(body->announce));
+        }
+        else
+        {
+            char err[] = "Invalid body size for REQUEST_ANNOUNCE.\n";
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
+        }
+        break;
+
+    case FSM_EVENT_REQUEST_PARTICIPATE_BATCH:
+    case FSM_EVENT_REQUEST_SEEDER_BATCH:
+    case FSM_EVENT_REQUEST_SCRAPE:
+    {
+        size_t head = event == FSM_EVENT_REQUEST_PARTICIPATE_BATCH ? sizeof(BatchParticipateRequest)
+                      : event == FSM_EVENT_REQUEST_SEEDER_BATCH    ? sizeof(BatchSeederRequest)
+                                                                   : sizeof(ScrapeRequest);
+        ssize_t count = event == FSM_EVENT_REQUEST_PARTICIPATE_BATCH ? body->participateBatch.count
+                        : event == FSM_EVENT_REQUEST_SEEDER_BATCH    ? body->seederBatch.count
+                                                                     : body->scrape.count;
+        if ((size_t)header->bodySize < head || count < 0 || count > BATCH_FILES_MAX ||
+            (size_t)header->bodySize != head + (size_t)count * sizeof(ssize_t))
+        {
+            char err[] = "Invalid body size for batched request.\n";
+            conn_write(conn, err, strlen(err));
+            conn->state = Conn_FSM_CLOSING;
+            break;
+        }
+
+        // The fileIDs follow the fixed part in the read buffer, copied out for alignment
+        ssize_t fileIDs[BATCH_FILES_MAX];
+        memcpy(fileIDs, conn->payload + head, (size_t)count * sizeof(ssize_t));
+        if (event == FSM_EVENT_REQUEST_PARTICIPATE_BATCH)
+            handle_request_participate_batch(conn, &body->participateBatch, fileIDs);
+        else if (event == FSM_EVENT_REQUEST_SEEDER_BATCH)
+            handle_request_seeder_batch(conn, &body->seederBatch, fileIDs);
+        else
+            handle_request_scrape(conn, fileIDs, (size_t)count);
+        break;
+    }
+
+    case FSM_EVENT_REQUEST_STATS:
+        handle_request_stats(conn);
         break;
 
     case FSM_EVENT_REQUEST_META_DATA:
 
         if (header->bodySize == sizeof(RequestMetadataBody))
         {
-            handle_request_metadata(ctx->client_socket, &(body->requestMetaData));
-            ctx->current_state = Tracker_FSM_LISTENING_EVENT;
+            handle_request_metadata(conn, &(body->requestMetaData));
         }
         else
         {
             char err[] = "Invalid body size for REQUEST_META_DATA.\n";
-            write(ctx->client_socket, err, strlen(err));
+            conn_write(conn, err, strlen(err));
         }
         break;
 
     default:
     {
         char error_msg[] = "Unknown or unimplemented FSM event.\n";
-        write(ctx->client_socket, error_msg, strlen(error_msg));
-        fprintf(stderr, "⚠️ Unknown FSM event: %d\n", event);
+        conn_write(conn, error_msg, strlen(error_msg));
+        LOG_WARN("Unknown FSM event: %d", event);
         break;
     }
     }
 }
 
 /**
- * @brief Accepts new peer connections and initializes the communication context
+ * @brief Accepts every pending peer connection on the listening socket
  *
  * This function:
- * - Accepts incoming connections on the listen socket
+ * - Accepts incoming connections until the (non-blocking) backlog is empty
  * - Extracts the client's IP address and port
- * - Creates a PeerInfo structure for the client
- * - Stores connection information in the tracker context
- * - Transitions the FSM to the listening event state
+ * - Creates a TrackerConnection holding the client's PeerInfo and buffers
+ * - Registers the socket with epoll so the event loop can serve it
  *
- * If accepting a connection fails, transitions to the error state.
+ * A failed accept() for one peer (e.g. out of fds) is logged and skipped,
+ * it never takes the tracker down.
  */
-void tracker_listening_peer()
+void tracker_accept_peers(TrackerWorker *worker)
 {
-    struct sockaddr_in client_addr;
-    socklen_t client_addr_length = sizeof(client_addr);
-
-    int client_socket = accept(listen_socketfd,
-                               (struct sockaddr *)&client_addr,
-                               &client_addr_length);
-    if (client_socket < 0)
+    while (1)
     {
-        perror("ERROR accepting connection");
-        ctx->current_state = Tracker_FSM_ERROR;
-        return;
+        struct sockaddr_in client_addr;
+        socklen_t client_addr_length = sizeof(client_addr);
+
+        int client_socket = accept4(worker->listen_socket,
+                                    (struct sockaddr *)&client_addr,
+                                    &client_addr_length,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                LOG_ERROR("accepting connection: %s", strerror(errno));
+            return;
+        }
+
+        // ✅ Extract IP and port
+        char client_ip[INET_ADDRSTRLEN];
+        int client_port = ntohs(client_addr.sin_port); // convert from network to host byte order
+
+        inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
+
+        PeerInfo peer;
+        memset(&peer, 0, sizeof(peer));
+        strncpy(peer.ip_address, client_ip, sizeof(peer.ip_address) - 1);
+        snprintf(peer.port, sizeof(peer.port), "%d", client_port);
+
+        int optval = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+
+        TrackerConnection *conn = conn_create(client_socket, worker, &peer);
+        if (!conn)
+        {
+            close(client_socket);
+            continue;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = conn;
+        if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0)
+        {
+            LOG_ERROR("registering peer with epoll: %s", strerror(errno));
+            close(client_socket);
+            conn_destroy(conn);
+            continue;
+        }
+
+        worker->open_connections++;
+        metrics_add(METRIC_ACCEPTS, 1);
+        LOG_DEBUG("[worker %d] New connection established from %s:%s", worker->id, peer.ip_address, peer.port);
     }
+}
 
-    // ✅ Extract IP and port
-    char client_ip[INET_ADDRSTRLEN];
-    int client_port = ntohs(client_addr.sin_port); // convert from network to host byte order
+/* Arm or disarm EPOLLOUT depending on whether the connection still has queued bytes */
+static void tracker_update_interest(TrackerConnection *conn)
+{
+    size_t queued = conn->wlen - conn->wpos;
+    int want_write = queued > 0;
+    // Backpressure: a peer that does not read its replies is not read either
+    int want_read = queued < CONN_WBUF_HIGH;
+    if (want_write == conn->want_write && want_read == conn->want_read)
+        return;
 
-    inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = (want_read ? EPOLLIN | EPOLLRDHUP : 0) | (want_write ? EPOLLOUT : 0);
+    ev.data.ptr = conn;
+    if (epoll_ctl(conn->worker->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) == 0)
+    {
+        conn->want_write = want_write;
+        conn->want_read = want_read;
+    }
+}
 
-    printf("✅ New connection established from %s:%d\n", client_ip, client_port);
+/**
+ * @brief Runs a connection's FSM over every complete message in its read buffer
+ *
+ * READ_HEADER -> READ_BODY -> HANDLE_EVENT, repeated while full messages are buffered.
+ * Peers may pipeline several requests, each one is answered in order.
+ */
+static void tracker_process_connection(TrackerConnection *conn)
+{
+    size_t offset = 0;
+    TrackerMessageBody body;
 
-    // Optional: store into PeerInfo struct
-    PeerInfo peer;
-    strncpy(peer.ip_address, client_ip, sizeof(peer.ip_address));
-    snprintf(peer.port, sizeof(peer.port), "%d", client_port);
-    printf("peer: %s:%s\n", peer.ip_address, peer.port);
+    while (conn->state != Conn_FSM_CLOSING)
+    {
+        if (conn->state == Conn_FSM_READ_HEADER)
+        {
+            // Replies are backed up: leave the next requests buffered until the peer reads
+            if (conn->wlen - conn->wpos >= CONN_WBUF_HIGH)
+                break;
+            if (read_header(conn, &offset) == 1)
+                break;
+        }
+        else if (conn->state == Conn_FSM_READ_BODY)
+        {
+            if (read_body(conn, &offset, &body) == 1)
+                break;
+        }
+        else if (conn->state == Conn_FSM_HANDLE_EVENT)
+        {
+            FSM_TRACKER_EVENT event = map_msg_type_to_fsm_event(conn->header.type);
+            LOG_DEBUG("FSM_TRACKER_EVENT: %d", event);
+            uint64_t started = metrics_now_ns();
+            tracker_event_handler(conn, &body, event);
+            metrics_record((size_t)conn->header.type, metrics_now_ns() - started);
+            metrics_add(METRIC_REQUESTS, 1);
+        }
+    }
 
-    ctx->client_socket = client_socket;
-    ctx->client_peer = peer;
-    ctx->current_state = Tracker_FSM_LISTENING_EVENT;
+    conn_consume(conn, offset);
 }
 
 /**
- * @brief Reads and processes incoming messages from a connected peer
+ * @brief One round of a worker's event loop
  *
- * This function coordinates the message reading process by:
- * 1. Reading the message header (through read_header())
- * 2. Reading the message body (through read_body())
- * 3. Transitioning to the event handling state if both reads succeed
+ * The worker's epoll instance watches its listening socket and every peer it accepted.
+ * - listening socket readable -> accept every pending peer
+ * - peer readable             -> buffer the bytes, handle each complete message
+ * - peer writable             -> flush its queued replies
+ * - hang up / error           -> close only that peer
  *
- * If either read operation reports an error or special condition,
- * this function returns early, preserving the state transition 
- * that was set by the read function.
+ * @return 0 to keep going, 1 when epoll itself failed
  */
-void tracker_listening_event()
+int tracker_worker_poll(TrackerWorker *worker)
 {
+    struct epoll_event events[TRACKER_MAX_EPOLL_EVENTS];
 
-    // 1) Read header
-    if (read_header() == 1)
+    // Offline while blocked: policy updates do not wait for an idle worker
+    policy_reader_offline();
+    int ready = epoll_wait(worker->epoll_fd, events, TRACKER_MAX_EPOLL_EVENTS, -1);
+    policy_reader_online();
+    if (ready < 0)
     {
-        printf("ending read_header()");
-        // there was some special case and we should stop this function and move to the next state.
-        return;
+        if (errno == EINTR)
+            return 0;
+        LOG_ERROR("epoll_wait: %s", strerror(errno));
+        return 1;
     }
 
-    if (read_body() == 1)
+    for (int i = 0; i < ready; i++)
     {
-        // there was some special case and we should stop this function and move to the next state.
-        printf("read_body() ==1 ");
-        return;
+        TrackerConnection *conn = events[i].data.ptr;
+        uint32_t flags = events[i].events;
+
+        // The listening socket is registered with a NULL pointer
+        if (conn == NULL)
+        {
+            tracker_accept_peers(worker);
+            continue;
+        }
+
+        if (flags & EPOLLERR)
+        {
+            tracker_close_peer(conn);
+            continue;
+        }
+
+        if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+        {
+            int rc = conn_fill(conn);
+            if (conn->rlen > 0)
+                tracker_process_connection(conn);
+
+            if (rc == 0 || rc == -1)
+            {
+                // Peer went away, answer what we already parsed and stop reading
+                if (rc == -1)
+                    LOG_DEBUG("Peer %s:%s disconnected abruptly", conn->client_peer.ip_address, conn->client_peer.port);
+                conn->state = Conn_FSM_CLOSING;
+            }
+        }
+
+        int flushed = conn_flush(conn);
+        // Requests held back by a backed up write buffer, the flush made room for them
+        while (flushed >= 0 && conn->rlen > 0 && conn->state != Conn_FSM_CLOSING &&
+               conn->wlen - conn->wpos < CONN_WBUF_HIGH)
+        {
+            size_t buffered = conn->rlen;
+            tracker_process_connection(conn);
+            flushed = conn_flush(conn);
+            if (conn->rlen == buffered)
+                break; // only part of a message left
+        }
+        if (flushed < 0 || (conn->state == Conn_FSM_CLOSING && flushed == 1))
+        {
+            tracker_close_peer(conn);
+            continue;
+        }
+
+        tracker_update_interest(conn);
+    }
+    return 0;
+}
+
+/* Thread entry for workers 1..N-1 */
+void *tracker_worker_main(void *arg)
+{
+    TrackerWorker *worker = arg;
+    while (tracker_running)
+    {
+        if (tracker_worker_poll(worker) == 1)
+        {
+            LOG_ERROR("Worker %d stopped", worker->id);
+            tracker_running = 0;
+        }
+    }
+    policy_reader_offline();
+    return NULL;
+}
+
+/*
+@brief Expires seeders that stopped announcing. Ticks once per second, the timer wheels
+       hand back every due membership in bulk so a tick costs O(expired), not O(members).
+*/
+void *tracker_reaper_main(void *arg)
+{
+    (void)arg;
+    while (tracker_running)
+    {
+        sleep(1);
+        size_t dropped = swarm_expire();
+        if (dropped > 0)
+            LOG_INFO("Expired %zu stale seeder membership(s)", dropped);
     }
+    return NULL;
+}
 
-    ctx->current_state = Tracker_FSM_HANDLE_EVENT;
+/**
+ * @brief The tracker's event loop on the main thread
+ *
+ * The main thread doubles as worker 0, the other workers were started by
+ * tracker_set_up_listening(). Only a failure of epoll moves the tracker FSM to the error state.
+ */
+void tracker_listening_peer()
+{
+    if (!tracker_running || tracker_worker_poll(&ctx->workers[0]) == 1)
+    {
+        policy_reader_offline();
+        ctx->current_state = Tracker_FSM_ERROR;
+    }
 }
+
 /**
  * @brief Maps protocol message types to internal FSM event types
  *
@@ -908,10 +1730,14 @@ FSM_TRACKER_EVENT map_msg_type_to_fsm_event(TrackerMessageType type)
         return FSM_EVENT_REQUEST_SEEDER_BY_FILEID;
     case MSG_REQUEST_CREATE_SEEDER:
         return FSM_EVENT_REQUEST_CREATE_SEEDER;
+    case MSG_REQUEST_DELETE_SEEDER:
+        return FSM_EVENT_REQUEST_DELETE_SEEDER;
     case MSG_REQUEST_CREATE_NEW_SEED:
         return FSM_EVENT_REQUEST_CREATE_NEW_SEED;
     case MSG_REQUEST_PARTICIPATE_SEED_BY_FILEID:
         return FSM_EVENT_REQUEST_PARTICIPATE_SEED_BY_FILEID;
+    case MSG_REQUEST_UNPARTICIPATE_SEED:
+        return FSM_EVENT_REQUEST_UNPARTICIPATE_SEED;
     case MSG_ACK_CREATE_NEW_SEED:
         return FSM_EVENT_ACK_CREATE_NEW_SEED;
     case MSG_ACK_PARTICIPATE_SEED_BY_FILEID:
@@ -920,6 +1746,18 @@ FSM_TRACKER_EVENT map_msg_type_to_fsm_event(TrackerMessageType type)
         return FSM_EVENT_ACK_SEEDER_BY_FILEID;
     case MSG_RESPOND_ERROR:
         return FSM_EVENT_RESPOND_ERROR;
+    case MSG_REQUEST_SEARCH:
+        return FSM_EVENT_REQUEST_SEARCH;
+    case MSG_REQUEST_PARTICIPATE_BATCH:
+        return FSM_EVENT_REQUEST_PARTICIPATE_BATCH;
+    case MSG_REQUEST_SEEDER_BATCH:
+        return FSM_EVENT_REQUEST_SEEDER_BATCH;
+    case MSG_REQUEST_SCRAPE:
+        return FSM_EVENT_REQUEST_SCRAPE;
+    case MSG_REQUEST_ANNOUNCE:
+        return FSM_EVENT_REQUEST_ANNOUNCE;
+    case MSG_REQUEST_STATS:
+        return FSM_EVENT_REQUEST_STATS;
     default:
         return FSM_EVENT_NULL;
     }
@@ -930,10 +1768,10 @@ FSM_TRACKER_EVENT map_msg_type_to_fsm_event(TrackerMessageType type)
  * This function implements the core state machine logic of the tracker by:
  * 1. Examining the current state (ctx->current_state)
  * 2. Calling the appropriate handler function for that state
- * 
- * For the HANDLE_EVENT state, it additionally:
- * - Maps the message type to a corresponding FSM event
- * - Passes the event to the event handler
+ *
+ * The LISTENING_PEER state runs one round of the epoll event loop.
+ * Reading and handling peer messages is done per connection inside that loop
+ * (see tracker_process_connection()), not by this global FSM.
  *
  * Each handler function is responsible for processing its state and
  * transitioning to the next appropriate state.
@@ -954,16 +1792,6 @@ void tracker_fsm_handler()
     case Tracker_FSM_LISTENING_PEER:
         tracker_listening_peer();
         break;
-    case Tracker_FSM_LISTENING_EVENT:
-        tracker_listening_event();
-        break;
-    case Tracker_FSM_HANDLE_EVENT:
-    {
-        FSM_TRACKER_EVENT event = map_msg_type_to_fsm_event(header->type);
-        printf("FSM_TRACKER_EVENT: %d\n", event);
-        tracker_event_handler(event);
-        break;
-    }
     case Tracker_FSM_ERROR:
         tracker_error_handler();
         break;
@@ -983,17 +1811,113 @@ void tracker_error_handler()
     printf("FSM Reached error ");
     ctx->current_state = Tracker_FSM_CLOSING;
 }
+/* Every peer holds a socket, so lift the soft fd limit up to the hard limit */
+static void raise_fd_limit(void)
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/* Listening socket + epoll instance for one worker, returns 0 on success */
+static int tracker_setup_worker(TrackerWorker *worker, int id)
+{
+    memset(worker, 0, sizeof(*worker));
+    worker->id = id;
+    worker->listen_socket = setup_server();
+
+    worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epoll_fd < 0)
+    {
+        perror("ERROR creating epoll instance");
+        return -1;
+    }
+
+    // The listening socket is the only registration with a NULL pointer
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->listen_socket, &ev) < 0)
+    {
+        perror("ERROR registering listen socket with epoll");
+        return -1;
+    }
+    return 0;
+}
+
 void tracker_set_up_listening()
 {
     init_seeders();
-    listen_socketfd = setup_server();
-    ctx->listen_socket = listen_socketfd;
+    raise_fd_limit();
+
+    // Swarms of the last run come back before the first peer is accepted
+    if (ctx->journal_commit_ms > 0 && journal_open(ctx->journal_commit_ms) < 0)
+        fprintf(stderr, "Swarm journal not opened, swarms are kept in memory only\n");
+
+    ctx->workers = calloc(ctx->worker_count, sizeof(TrackerWorker));
+    if (!ctx->workers)
+    {
+        perror("ERROR allocating workers");
+        ctx->current_state = Tracker_FSM_ERROR;
+        return;
+    }
+
+    for (int i = 0; i < ctx->worker_count; i++)
+    {
+        if (tracker_setup_worker(&ctx->workers[i], i) < 0)
+        {
+            ctx->current_state = Tracker_FSM_ERROR;
+            return;
+        }
+    }
+
+    // Policy commands keep working while serving, not fatal if the socket cannot be created.
+    // Started before the other threads, admin_start() briefly changes the umask
+    admin_start(ctx->admin_socket);
+
+    if (udp_tracker_start(ctx->listen_ip, ctx->listen_port, ctx->udp_workers, ctx->announce_interval) < 0)
+        fprintf(stderr, "UDP tracker not started, serving TCP only\n");
+
+    if (ctx->metrics_interval > 0 && metrics_start_dump(ctx->metrics_file, ctx->metrics_interval) < 0)
+        fprintf(stderr, "Metrics dump not started\n");
+
+    // worker 0 is the main thread, see tracker_listening_peer()
+    for (int i = 1; i < ctx->worker_count; i++)
+    {
+        if (pthread_create(&ctx->workers[i].thread, NULL, tracker_worker_main, &ctx->workers[i]) != 0)
+        {
+            perror("ERROR starting worker thread");
+            ctx->current_state = Tracker_FSM_ERROR;
+            return;
+        }
+    }
+
+    if (pthread_create(&ctx->reaper_thread, NULL, tracker_reaper_main, NULL) != 0)
+    {
+        perror("ERROR starting reaper thread");
+        ctx->current_state = Tracker_FSM_ERROR;
+        return;
+    }
+
+    printf("✅ Tracker serving with %d worker(s), announce interval %ds\n", ctx->worker_count, ctx->announce_interval);
     ctx->current_state = Tracker_FSM_LISTENING_PEER;
 }
 void tracker_closing()
 {
     printf("FSM Reached closing");
-    tracker_close_peer();
+    tracker_running = 0;
+    journal_flush();
+    for (int i = 0; ctx->workers && i < ctx->worker_count; i++)
+    {
+        if (ctx->workers[i].epoll_fd > 0)
+            close(ctx->workers[i].epoll_fd);
+        if (ctx->workers[i].listen_socket > 0)
+            close(ctx->workers[i].listen_socket);
+    }
 
     ctx->current_state = Tracker_FSM_CLEANUP;
 
@@ -1002,30 +1926,23 @@ void tracker_closing()
 
 void tracker_cleanup()
 {
+    free(ctx->workers);
     free(ctx);
-    free(header);
-    free(body);
     ctx = NULL;
-    header = NULL;
-    body = NULL;
     printf("FSM Reached cleanup");
     return;
 }
 
 void tracker_init()
 {
-    // Allocate memory for the global structures
-    header = malloc(sizeof(TrackerMessageHeader));
-    body = malloc(sizeof(TrackerMessageBody));
-
-    if (header)
-    {
-        memset(header, 0, sizeof(TrackerMessageHeader));
-    }
-    if (body)
-    {
-        memset(body, 0, sizeof(TrackerMessageBody));
-    }
+    // Message buffers are per connection now (TrackerConnection), nothing global to allocate
+    if (region_trie_load(ctx->region_file) < 0)
+        fprintf(stderr, "Region ranges not loaded, region rules will not match\n");
+
+    // Rules saved by the last run, then the rules file given with -p on top
+    policy_open(POLICY_SNAPSHOT_FILE);
+    if (ctx->rules_file && load_rules_file(ctx->rules_file) < 0)
+        fprintf(stderr, "Rules file %s not loaded\n", ctx->rules_file);
     ctx->current_state = TRACKER_FSM_COMMAND_MODE;
 }
 
@@ -1100,7 +2017,9 @@ void tracker_command_mode()
                 break;
             }
 
-            execute_ast(ast, -1, NULL);
+            const char *error = execute_ast(ast, -1, NULL);
+            if (error)
+                printf("Command failed: %s\n", error);
             free_ast(ast);
             break;
         }
@@ -1113,13 +2032,18 @@ void tracker_command_mode()
     free(input);
 }
 
-void tracker_close_peer()
+void tracker_close_peer(TrackerConnection *conn)
 {
-    if (ctx->client_socket >= 0)
-    {
-        close(ctx->client_socket);
-    }
-    ctx->current_state = Tracker_FSM_LISTENING_PEER;
+    if (!conn)
+        return;
+
+    TrackerWorker *worker = conn->worker;
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn_destroy(conn);
+    metrics_add(METRIC_CLOSES, 1);
+    if (worker->open_connections > 0)
+        worker->open_connections--;
 }
 
 /* Main function 
@@ -1127,6 +2051,7 @@ void tracker_close_peer()
  *
  * This function:
  * 1. Allocates and initializes the global tracker context
+ *    - ./tracker -w N serves peers with N worker threads (default 1, 0 = one per CPU)
  * 2. Calls the initialization function to set up the tracker
  * 3. Enters the main FSM loop that drives the tracker's operation
  * 4. Continues processing until the FSM reaches the closing state
@@ -1138,12 +2063,128 @@ void tracker_close_peer()
  *
  * @return 0 on successful execution
  */
-int main(void)
+int main(int argc, char *argv[])
 {
     ctx = malloc(sizeof(TrackerContext));
-    if (ctx)
+    if (!ctx)
+    {
+        perror("Failed to allocate tracker context");
+        return 1;
+    }
+    memset(ctx, 0, sizeof(TrackerContext));
+    ctx->worker_count = 1;
+    ctx->udp_workers = 1;
+    ctx->announce_interval = TRACKER_ANNOUNCE_INTERVAL_DEFAULT;
+    ctx->region_file = REGION_TRIE_FILE;
+    ctx->admin_socket = ADMIN_SOCKET_FILE;
+    ctx->journal_commit_ms = JOURNAL_COMMIT_MS_DEFAULT;
+    ctx->metrics_interval = TRACKER_METRICS_INTERVAL_DEFAULT;
+    ctx->metrics_file = TRACKER_METRICS_FILE;
+    strcpy(ctx->listen_ip, SERVER_IP);
+    ctx->listen_port = SERVER_PORT;
+
+    int log_level = LOG_LEVEL_INFO;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:u:i:r:a:p:j:l:s:M:m:L:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'w':
+            ctx->worker_count = atoi(optarg);
+            if (ctx->worker_count <= 0)
+                ctx->worker_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if (ctx->worker_count > TRACKER_MAX_WORKERS)
+                ctx->worker_count = TRACKER_MAX_WORKERS;
+            break;
+        case 'u':
+            ctx->udp_workers = atoi(optarg);
+            if (ctx->udp_workers < 0)
+                ctx->udp_workers = 0;
+            if (ctx->udp_workers > UDP_MAX_WORKERS)
+                ctx->udp_workers = UDP_MAX_WORKERS;
+            break;
+        case 'i':
+            ctx->announce_interval = atoi(optarg);
+            if (ctx->announce_interval <= 0)
+                ctx->announce_interval = TRACKER_ANNOUNCE_INTERVAL_DEFAULT;
+            break;
+        case 'r':
+            ctx->region_file = optarg;
+            break;
+        case 'a':
+            ctx->admin_socket = optarg;
+            break;
+        case 'p':
+            ctx->rules_file = optarg;
+            break;
+        case 'l':
+            if (shard_parse_address(optarg, ctx->listen_ip, sizeof(ctx->listen_ip), &ctx->listen_port) < 0)
+            {
+                fprintf(stderr, "-l expects ip:port, got %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            ctx->shard_file = optarg;
+            break;
+        case 'j':
+            ctx->journal_commit_ms = atoi(optarg);
+            if (ctx->journal_commit_ms < 0)
+                ctx->journal_commit_ms = 0;
+            break;
+        case 'M':
+            ctx->metrics_interval = atoi(optarg);
+            if (ctx->metrics_interval < 0)
+                ctx->metrics_interval = 0;
+            break;
+        case 'm':
+            ctx->metrics_file = optarg;
+            break;
+        case 'L':
+            log_level = logger_parse_level(optarg);
+            if (log_level < 0)
+            {
+                fprintf(stderr, "-L expects debug, info, warn or error, got %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-w workers] [-u udp_workers] [-i announce_interval_seconds] [-r regions.csv] [-a admin_socket] [-p rules_file] [-j journal_commit_ms] [-l ip:port] [-s shards_file] [-M metrics_interval_seconds] [-m metrics_file] [-L log_level]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (metrics_init(tracker_counter_names, TRACKER_COUNTER_COUNT, tracker_timer_names, TRACKER_TIMER_COUNT) < 0)
+        fprintf(stderr, "Metrics not set up, nothing will be counted\n");
+    if (logger_init(NULL, log_level) < 0)
+        fprintf(stderr, "Log drain thread not started, lines are written as they are logged\n");
+
+    if (ctx->shard_file)
+    {
+        // Every tracker of the deployment loads the same file, we must be one of them
+        if (shard_map_load(&ctx->shards, ctx->shard_file) <= 0)
+        {
+            fprintf(stderr, "Shard file %s not loaded\n", ctx->shard_file);
+            return 1;
+        }
+        ctx->shard_self = shard_find(&ctx->shards, ctx->listen_ip, ctx->listen_port);
+        if (ctx->shard_self < 0)
+        {
+            fprintf(stderr, "%s:%d is not listed in %s\n", ctx->listen_ip, ctx->listen_port, ctx->shard_file);
+            return 1;
+        }
+        catalog_set_owner(owns_file);
+        printf("Shard %d of %zu, fileIDs split by consistent hashing\n", ctx->shard_self + 1, ctx->shards.count);
+    }
+
+    // The catalog only holds the fileIDs this tracker owned when it was built, the shard list cannot change under it
+    char shards[SHARD_MAX * (SHARD_ADDR_MAX + 16)];
+    if (shard_map_describe(&ctx->shards, shards, sizeof(shards)) < 0 || catalog_check_shards(shards) < 0)
     {
-        memset(ctx, 0, sizeof(TrackerContext));
+        fprintf(stderr, "The catalog was built for another shard list (%s), catalog entries do not move between trackers.\n"
+                        "Start with the same shard list, or with a new catalog in another directory\n",
+                CATALOG_SHARDS_FILE);
+        return 1;
     }
 
     tracker_init();
@@ -9,13 +9,24 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <pthread.h>
 #include "database.h"
 #include "tracker.h"
 #include "meta.h"
 #include "peerCommunication.h"
 #include "seed.h"
+#include "peer_registry.h"
+#include "swarm.h"
+#include "search_index.h"
+#include "shard_map.h"
+#include "metrics.h"
+#include "logger.h"
 // Forward declaration for FileMetadata from database.h
 typedef struct FileMetadata FileMetadata;
 
@@ -26,9 +37,24 @@ typedef struct FileMetadata FileMetadata;
 #define SERVER_PORT 5555
 #define SERVER_IP "127.0.0.1"
 
-#define MAX_FILES 10000
-#define MAX_SEEDERS_PER_FILE 64
-#define MAX_SEEDERS 1000
+#define SEEDERS_PER_REPLY_DEFAULT 64 // MSG_ACK_SEEDER_BY_FILEID size when the requester does not ask for a count
+#define SEEDERS_PER_REPLY_MAX 2048   // hard cap, bounds what one reply adds to a connection's write buffer
+#define CATALOG_PAGE_DEFAULT 256     // MSG_ACK_CATALOG_PAGE size when the requester does not ask for a count
+#define CATALOG_PAGE_MAX 1024        // 272 KB of FileEntry per reply at most
+#define BATCH_FILES_MAX 1024         // fileIDs per batched request
+#define BATCH_SEEDERS_MAX 8192       // peers in one MSG_ACK_SEEDER_BATCH, shared by its files
+
+#define TRACKER_LISTEN_BACKLOG 4096 // pending accept() queue for bursts of announces
+#define TRACKER_MAX_EPOLL_EVENTS 256 // events handled per epoll_wait() call
+#define CONN_READ_CHUNK 4096         // bytes pulled per read() on a connection
+#define CONN_READ_BUDGET (64 * 1024)  // bytes read from one peer per wakeup, the other peers get their turn
+#define CONN_WBUF_HIGH (1024 * 1024)  // queued reply bytes past which a peer's requests wait (EPOLLIN off)
+#define CONN_WBUF_MAX (16 * 1024 * 1024) // queued reply bytes past which the peer is dropped
+
+#define TRACKER_MAX_WORKERS 64 // upper bound for -w
+
+#define TRACKER_ANNOUNCE_INTERVAL_DEFAULT 300 // seconds between seeder re-announces, override with -i
+#define TRACKER_ANNOUNCE_MISSES 2             // a seeder is dropped after missing this many announces
 
 /* --------------------------------------------------------------------------
    🔹 Message Types
@@ -48,9 +74,28 @@ typedef enum
     MSG_ACK_SEEDER_BY_FILEID,
     MSG_RESPOND_ERROR,
     MSG_ACK_FILEHASH_BLOCKED,
-    MSG_ACK_IP_BLOCKED
+    MSG_ACK_IP_BLOCKED,
+    MSG_ACK_SEEDER_BY_FILEID_COMPACT,
+    MSG_ACK_UNPARTICIPATE_SEED,
+    MSG_ACK_DELETE_SEEDER,
+    MSG_ACK_CATALOG_PAGE,
+    MSG_REQUEST_SEARCH,
+    MSG_ACK_SEARCH,
+    MSG_REQUEST_PARTICIPATE_BATCH,
+    MSG_ACK_PARTICIPATE_BATCH,
+    MSG_REQUEST_SEEDER_BATCH,
+    MSG_ACK_SEEDER_BATCH,
+    MSG_REQUEST_SCRAPE,
+    MSG_ACK_SCRAPE,
+    MSG_REQUEST_ANNOUNCE,
+    MSG_ACK_ANNOUNCE,
+    MSG_ACK_WRONG_SHARD,
+    MSG_REQUEST_STATS,
+    MSG_ACK_STATS
 } TrackerMessageType;
 
+#define TRACKER_MESSAGE_TYPES (MSG_ACK_STATS + 1)
+
 /* --------------------------------------------------------------------------
    🔹 FSM States and Events
    -------------------------------------------------------------------------- */
@@ -58,14 +103,24 @@ typedef enum TrackerFSMState {
     Tracker_FSM_INIT = 0,
     TRACKER_FSM_COMMAND_MODE,
     TRACKER_FSM_SET_UP_LISTENING,
-    Tracker_FSM_LISTENING_PEER,
-    Tracker_FSM_LISTENING_EVENT,
-    Tracker_FSM_HANDLE_EVENT,
+    Tracker_FSM_LISTENING_PEER, // epoll event loop, serves every peer connection
     Tracker_FSM_ERROR,
     Tracker_FSM_CLEANUP,
     Tracker_FSM_CLOSING
 } TrackerFSMState;
 
+/*
+Every peer connection runs its own small FSM inside the event loop.
+READ_HEADER -> READ_BODY -> HANDLE_EVENT -> READ_HEADER ...
+CLOSING means we stop reading, flush whatever is left in the write buffer and close.
+*/
+typedef enum ConnFSMState {
+    Conn_FSM_READ_HEADER = 0,
+    Conn_FSM_READ_BODY,
+    Conn_FSM_HANDLE_EVENT,
+    Conn_FSM_CLOSING
+} ConnFSMState;
+
 typedef enum FSM_TRACKER_EVENT {
     FSM_EVENT_REQUEST_ALL_AVAILABLE_SEED = 0,
     FSM_EVENT_REQUEST_META_DATA,
@@ -79,20 +134,93 @@ typedef enum FSM_TRACKER_EVENT {
     FSM_EVENT_ACK_PARTICIPATE_SEED_BY_FILEID,
     FSM_EVENT_ACK_SEEDER_BY_FILEID,
     FSM_EVENT_RESPOND_ERROR,
+    FSM_EVENT_REQUEST_SEARCH,
+    FSM_EVENT_REQUEST_PARTICIPATE_BATCH,
+    FSM_EVENT_REQUEST_SEEDER_BATCH,
+    FSM_EVENT_REQUEST_SCRAPE,
+    FSM_EVENT_REQUEST_ANNOUNCE,
+    FSM_EVENT_REQUEST_STATS,
     FSM_EVENT_NULL
 } FSM_TRACKER_EVENT;
 
+/* --------------------------------------------------------------------------
+   🔹 Metrics (metrics.h)
+   -------------------------------------------------------------------------- */
+/*
+@brief What the tracker counts and times
+
+Snapshots go out as the reply to MSG_REQUEST_STATS, the STATS admin command and the -M dump file.
+MSG_REQUEST_STATS has no body, MSG_ACK_STATS carries bodySize bytes of JSON (metrics_json(), no '\0').
+Latency histogram ids: one per TrackerMessageType, the handler time of that request
+(body parsed to reply queued), followed by the TrackerTimer ids.
+*/
+typedef enum
+{
+    METRIC_ACCEPTS = 0,
+    METRIC_CLOSES,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_REQUESTS,
+    METRIC_BAD_HEADERS,      // invalid bodySize, the connection is closed
+    METRIC_IP_BLOCKED,       // policy rejections, TCP and UDP
+    METRIC_FILEHASH_BLOCKED,
+    METRIC_REGION_BLOCKED,
+    METRIC_WRONG_SHARD,      // requests about a fileID another tracker owns (-s)
+    METRIC_UDP_PACKETS_IN,
+    METRIC_UDP_PACKETS_OUT,
+    METRIC_JOURNAL_BYTES,
+    TRACKER_COUNTER_COUNT
+} TrackerCounter;
+
+typedef enum
+{
+    TIMER_JOURNAL_COMMIT = TRACKER_MESSAGE_TYPES, // swarm.wal write + fdatasync of one group commit
+    TIMER_JOURNAL_SNAPSHOT,                       // swarm.snap rewrite
+    TIMER_CATALOG_APPEND,                         // catalog segment write of a new file
+    TIMER_UDP_REQUEST,                            // one datagram, parsed to reply built
+    TRACKER_TIMER_COUNT
+} TrackerTimer;
+
+#define TRACKER_METRICS_FILE "tracker.metrics.json"
+#define TRACKER_METRICS_INTERVAL_DEFAULT 10 // seconds, -M
+
 /* --------------------------------------------------------------------------
    🔹 Structures and Types
    -------------------------------------------------------------------------- */
 /*
 We need to use the TrackerFSMState enum to track the current state of the tracker and trigger the correct function
 */
+/*
+@brief One event loop thread.
+Every worker owns its own SO_REUSEPORT listening socket and epoll instance,
+the kernel spreads new connections across them. A connection never moves between workers.
+*/
+typedef struct TrackerWorker {
+    int id;
+    pthread_t thread;
+    int listen_socket;
+    int epoll_fd;
+    size_t open_connections;
+} TrackerWorker;
+
 typedef struct {
     enum TrackerFSMState current_state;
-    int listen_socket;
-    int client_socket;
-    PeerInfo client_peer;    
+    int worker_count;      // -w N, worker 0 runs on the main thread
+    int udp_workers;       // -u N, threads serving the UDP announce protocol (udp_tracker.h), 0 = TCP only
+    TrackerWorker *workers;
+    int announce_interval; // -i N seconds, sent to seeders in every participate ACK
+    const char *region_file; // -r path, CIDR ranges of the regions (region_trie.h)
+    const char *admin_socket; // -a path, Unix socket taking policy commands while serving (admin.h)
+    const char *rules_file;   // -p path, BLOCK / ALLOW rules loaded at start up (LOAD RULES at runtime)
+    char listen_ip[SHARD_ADDR_MAX]; // -l ip:port, TCP and UDP address (SERVER_IP:SERVER_PORT by default)
+    int listen_port;
+    const char *shard_file;   // -s path, the trackers sharing the fileIDs (shard_map.h), NULL = not sharded
+    ShardMap shards;
+    int shard_self;           // our index in shards
+    int journal_commit_ms;    // -j N, group commit window of the swarm journal (journal.h), 0 = swarms are not saved
+    int metrics_interval;     // -M N seconds between two dumps of the metrics to metrics_file, 0 = no dump
+    const char *metrics_file; // -m path, JSON when it ends in .json, text otherwise
+    pthread_t reaper_thread;
 } TrackerContext;
 
 typedef struct TrackerMessageHeader
@@ -107,18 +235,209 @@ typedef struct PeerWithFileID
     ssize_t fileID;
 } PeerWithFileID;
 
+/*
+@brief Sharded deployment (-s shards.conf): every tracker process owns the fileIDs that shard_for_file() maps to it,
+their catalog entries and their swarms. New files get a fileID this tracker owns.
+A request about a fileID owned by another tracker is answered with MSG_ACK_WRONG_SHARD, the body is a
+PeerWithFileID: the owning tracker's address (ip, port as text) and the fileID. Registration, catalog
+listings and searches are per tracker, peers send them to every tracker of the shard file.
+*/
+
 typedef struct
 {
     char metaFilename[256]; // or whatever size you use
 } RequestMetadataBody;
 
+/*
+@brief Body of MSG_REQUEST_SEEDER_BY_FILEID: "give me up to maxPeers seeders of fileID"
+A body holding only the fileID, or fileID + maxPeers, is still accepted (flags = 0).
+
+Without SEEDER_REQUEST_COMPACT the reply MSG_ACK_SEEDER_BY_FILEID is variable length:
+    header.bodySize = sizeof(ssize_t) + count * sizeof(PeerInfo)
+    body            = ssize_t count, then count PeerInfo
+
+With SEEDER_REQUEST_COMPACT the reply is MSG_ACK_SEEDER_BY_FILEID_COMPACT:
+    body = CompactPeerListHeader, count_v4 * 6 bytes (IPv4 + port), count_v6 * 18 bytes (IPv6 + port)
+    addresses and ports are in network byte order, 64 peers fit in ~400 bytes instead of 5 KB
+*/
+#define SEEDER_REQUEST_COMPACT 0x1
+
+typedef struct SeederListRequest
+{
+    ssize_t fileID;
+    ssize_t maxPeers; // <= 0 means SEEDERS_PER_REPLY_DEFAULT, clamped to SEEDERS_PER_REPLY_MAX
+    ssize_t flags;    // SEEDER_REQUEST_*
+} SeederListRequest;
+
+/*
+@brief Body of MSG_ACK_PARTICIPATE_SEED_BY_FILEID
+The seeder must send MSG_REQUEST_PARTICIPATE_SEED_BY_FILEID again every announceInterval seconds,
+otherwise it is dropped from the swarm after TRACKER_ANNOUNCE_MISSES intervals.
+*/
+typedef struct ParticipateAck
+{
+    ssize_t announceInterval;
+} ParticipateAck;
+
+/*
+@brief Body of MSG_REQUEST_ALL_AVAILABLE_SEED for a paginated / delta listing
+Every catalog entry has a version (1, 2, 3... in the order files were added).
+The reply MSG_ACK_CATALOG_PAGE carries the entries after version cursor, oldest first:
+    body = CatalogPageHeader, then count * FileEntry
+Send nextCursor back to get the next page. Once nextCursor == catalogVersion the listing is complete,
+a peer that keeps the catalog cached later asks with that cursor and only receives new files.
+An empty body still gets the old reply: size_t fileCount, then every FileEntry.
+*/
+typedef struct CatalogPageRequest
+{
+    ssize_t cursor;     // last version the requester has, 0 for the first page
+    ssize_t maxEntries; // <= 0 means CATALOG_PAGE_DEFAULT, clamped to CATALOG_PAGE_MAX
+} CatalogPageRequest;
+
+typedef struct CatalogPageHeader
+{
+    ssize_t count;
+    ssize_t nextCursor;     // cursor + count
+    ssize_t catalogVersion; // latest version on the tracker
+} CatalogPageHeader;
+
+/*
+@brief Body of MSG_REQUEST_SEARCH: "which files have query in their name"
+Matching is case insensitive, a query of 1 or 2 characters only matches name prefixes.
+The reply MSG_ACK_SEARCH is ssize_t count, then count fileIDs, best match first
+(names starting with the query, then names containing it).
+*/
+typedef struct SearchRequest
+{
+    char query[SEARCH_QUERY_MAX]; // NUL terminated unless it fills the array
+    ssize_t maxResults;           // <= 0 means SEARCH_RESULTS_DEFAULT, clamped to SEARCH_RESULTS_MAX
+} SearchRequest;
+
+typedef struct CompactPeerListHeader
+{
+    uint32_t count_v4;
+    uint32_t count_v6;
+} CompactPeerListHeader;
+
+/*
+@brief Batched requests: one message, up to BATCH_FILES_MAX fileIDs, one reply.
+Every body is a fixed header followed by count ssize_t fileIDs, the reply keeps the request order.
+
+MSG_REQUEST_PARTICIPATE_BATCH -> BatchParticipateRequest, fileIDs
+    The seeder must be registered. Reply MSG_ACK_PARTICIPATE_BATCH: BatchParticipateAck, count * int32_t BatchStatus
+MSG_REQUEST_SEEDER_BATCH -> BatchSeederRequest, fileIDs
+    Reply MSG_ACK_SEEDER_BATCH: ssize_t count, then per file a BatchSeederEntry followed by its
+    compact peers (count_v4 * 6 bytes, then count_v6 * 18 bytes, like MSG_ACK_SEEDER_BY_FILEID_COMPACT).
+    The files share BATCH_SEEDERS_MAX peers, each gets at most BATCH_SEEDERS_MAX / count.
+MSG_REQUEST_SCRAPE -> ScrapeRequest, fileIDs
+    Reply MSG_ACK_SCRAPE: ssize_t count, then count ScrapeEntry
+A blocked requester IP gets MSG_ACK_IP_BLOCKED for the whole batch.
+A sharded tracker answers BATCH_STATUS_WRONG_SHARD for the files it does not own, and an empty
+ScrapeEntry in a scrape.
+*/
+typedef enum
+{
+    BATCH_STATUS_OK = 0,
+    BATCH_STATUS_IP_BLOCKED,
+    BATCH_STATUS_FILEHASH_BLOCKED, // globally or for the requester's region
+    BATCH_STATUS_FAILED,           // fileID not in the catalog or out of memory
+    BATCH_STATUS_WRONG_SHARD       // another tracker owns the file (-s), see MSG_ACK_WRONG_SHARD
+} BatchStatus;
+
+typedef struct BatchParticipateRequest
+{
+    PeerInfo seeder;
+    ssize_t count;
+} BatchParticipateRequest;
+
+typedef struct BatchParticipateAck
+{
+    ssize_t count;
+    ssize_t announceInterval; // as in ParticipateAck
+} BatchParticipateAck;
+
+typedef struct BatchSeederRequest
+{
+    ssize_t count;
+    ssize_t maxPeers; // per file, <= 0 means SEEDERS_PER_REPLY_DEFAULT
+} BatchSeederRequest;
+
+typedef struct BatchSeederEntry
+{
+    ssize_t fileID;
+    int32_t status; // BatchStatus, a blocked file has no peers
+    uint32_t count_v4;
+    uint32_t count_v6;
+    uint32_t reserved;
+} BatchSeederEntry;
+
+typedef struct ScrapeRequest
+{
+    ssize_t count;
+} ScrapeRequest;
+
+typedef struct ScrapeEntry
+{
+    ssize_t fileID;
+    ssize_t seeders;
+    ssize_t leechers;
+    ssize_t completed;  // leechers that finished the file
+    ssize_t uploaded;   // bytes, as reported in announces
+    ssize_t downloaded; // bytes, as reported in announces
+} ScrapeEntry;
+
+/*
+@brief Body of MSG_REQUEST_ANNOUNCE: where a peer stands in a file's swarm
+    left > 0  -> the peer is leeching fileID
+    left == 0 -> the peer is seeding it (same as a participate)
+    event ANNOUNCE_EVENT_COMPLETED counts a finished download and ends the leeching,
+    the peer seeds once it participates. ANNOUNCE_EVENT_STOPPED leaves the swarm
+uploaded / downloaded are the bytes moved since the peer's previous announce of this file,
+they go into the file's transfer totals. The peer is registered if it is not yet.
+The reply MSG_ACK_ANNOUNCE is an AnnounceAck. Blocks answer like a participate.
+*/
+typedef enum
+{
+    ANNOUNCE_EVENT_NONE = 0,
+    ANNOUNCE_EVENT_COMPLETED,
+    ANNOUNCE_EVENT_STARTED,
+    ANNOUNCE_EVENT_STOPPED
+} AnnounceEvent;
+
+typedef struct AnnounceRequest
+{
+    PeerInfo peer;
+    ssize_t fileID;
+    ssize_t event; // AnnounceEvent
+    ssize_t uploaded;
+    ssize_t downloaded;
+    ssize_t left;
+} AnnounceRequest;
+
+typedef struct AnnounceAck
+{
+    ssize_t announceInterval;
+    ssize_t seeders;
+    ssize_t leechers;
+} AnnounceAck;
+
+#define BATCH_BODY_MAX (sizeof(BatchParticipateRequest) + BATCH_FILES_MAX * sizeof(ssize_t))
+// A read buffer never holds more than one wakeup's bytes on top of an incomplete message
+#define CONN_RBUF_MAX (CONN_READ_BUDGET + sizeof(TrackerMessageHeader) + BATCH_BODY_MAX)
+
 typedef union
 {
     PeerInfo singleSeeder;     // For REGISTER / UNREGISTER
-    PeerInfo seederList[64];   // For returning a list of seeders
     FileMetadata fileMetadata; // For CREATE_NEW_SEED
     ssize_t fileID;            // For simple queries
     PeerWithFileID peerWithFileID;
+    SeederListRequest seederRequest; // For REQUEST_SEEDER_BY_FILEID
+    CatalogPageRequest catalogPage;  // For REQUEST_ALL_AVAILABLE_SEED with a cursor
+    SearchRequest search;            // For REQUEST_SEARCH
+    BatchParticipateRequest participateBatch; // Fixed part of the batched requests,
+    BatchSeederRequest seederBatch;           // their fileIDs are read from TrackerConnection.payload
+    ScrapeRequest scrape;
+    AnnounceRequest announce; // For REQUEST_ANNOUNCE
     RequestMetadataBody requestMetaData; //
     char raw[512];                       // fallback
 } TrackerMessageBody;
@@ -129,23 +448,62 @@ typedef struct
     TrackerMessageBody body;
 } TrackerMessage;
 
+/*
+@brief One accepted peer socket.
+The event loop owns these, the handlers only ever see the connection they are serving.
+Reads are buffered until a full header + body is available, replies are queued in
+wbuf and flushed when the socket is writable, so a slow peer never blocks the others.
+*/
+typedef struct TrackerConnection
+{
+    int fd;
+    TrackerWorker *worker; // event loop that owns this socket
+    PeerInfo client_peer; // address we accepted the socket from
+    ConnFSMState state;
+    TrackerMessageHeader header; // header of the message currently being read
+    const char *payload;         // its body inside rbuf, valid while the message is handled
+
+    char *rbuf; // bytes received but not yet consumed
+    size_t rlen;
+    size_t rcap;
+
+    char *wbuf; // bytes queued for the peer
+    size_t wlen;
+    size_t wpos;
+    size_t wcap;
+    int want_write; // EPOLLOUT currently armed
+    int want_read;  // EPOLLIN currently armed, off while more than CONN_WBUF_HIGH bytes wait for the peer
+} TrackerConnection;
+
 /* --------------------------------------------------------------------------
    🔹 Function Declarations
    -------------------------------------------------------------------------- */
 // Core tracker functions
 void tracker_init(void);
-void tracker_event_handler(FSM_TRACKER_EVENT event);
+void tracker_event_handler(TrackerConnection *conn, const TrackerMessageBody *body, FSM_TRACKER_EVENT event);
 void tracker_set_up_listening();
 void tracker_command_mode();
 void tracker_listening_peer(void);
-void tracker_listening_event(void);
+int tracker_worker_poll(TrackerWorker *worker);
+void *tracker_worker_main(void *arg);
+void *tracker_reaper_main(void *arg);
 void tracker_fsm_handler(void);
 void tracker_error_handler(void);
 void tracker_closing(void);
 void tracker_cleanup(void);
-void tracker_close_peer(void);
-int read_header(void);
-int read_body(void);
+void tracker_accept_peers(TrackerWorker *worker);
+void tracker_close_peer(TrackerConnection *conn);
+int read_header(TrackerConnection *conn, size_t *offset);
+int read_body(TrackerConnection *conn, size_t *offset, TrackerMessageBody *body);
+
+// Connection buffer functions (connection.c)
+TrackerConnection *conn_create(int fd, TrackerWorker *worker, const PeerInfo *peer);
+void conn_destroy(TrackerConnection *conn);
+int conn_fill(TrackerConnection *conn);
+void conn_consume(TrackerConnection *conn, size_t nbytes);
+int conn_write(TrackerConnection *conn, const void *data, size_t len);
+int conn_flush(TrackerConnection *conn);
+int conn_set_nonblocking(int fd);
 
 // Utility functions
 void init_seeders(void);
@@ -154,18 +512,40 @@ FSM_TRACKER_EVENT map_msg_type_to_fsm_event(TrackerMessageType type);
 void exit_success(void);
 
 // Peer management functions
-PeerInfo *find_peer(const PeerInfo *p);
-PeerInfo *add_peer(const PeerInfo *p);
-void remove_peer(PeerInfo *p);
-int add_seeder_to_file(ssize_t fileID, PeerInfo *p);
-int remove_seeder_from_file(ssize_t fileID, PeerInfo *p);
+PeerHandle find_peer(const PeerInfo *p);
+PeerHandle add_peer(const PeerInfo *p, int *created);
+int add_seeder_to_file(ssize_t fileID, PeerHandle p);
+int tracker_announce(ssize_t fileID, PeerHandle p, AnnounceEvent event, uint64_t uploaded, uint64_t downloaded, uint64_t left);
+
+/* What the policy says about a peer and a file, one of the block ACKs or allowed */
+typedef enum
+{
+    POLICY_ALLOW,
+    POLICY_IP_BLOCKED,
+    POLICY_FILEHASH_BLOCKED,
+    POLICY_REGION_BLOCKED
+} PolicyDecision;
+PolicyDecision evaluate_policy(const char *ip, const PeerInfo *client, ssize_t fileID);
+/* 1 when this tracker owns fileID (always when not sharded). The owner's address goes to owner when given */
+int tracker_owns_file(ssize_t fileID, TrackerShard *owner);
+/* 1 when fileID is in this tracker's catalog, only those files get swarms */
+int tracker_has_file(ssize_t fileID);
 
 // Request handler functions
-void handle_create_seeder(int client_socket, const PeerInfo *p);
-void handle_create_new_seed(int client_socket, const FileMetadata *meta);
-void handle_request_all_available_files(int client_socket);
-void handle_request_participate_by_fileID(int client_socket, const PeerWithFileID *peerWithFileID);
-void handle_request_seeder_by_fileID(int client_socket, ssize_t fileID);
-void handle_request_metadata(int client_socket, const RequestMetadataBody *req);
+void handle_create_seeder(TrackerConnection *conn, const PeerInfo *p);
+void handle_create_new_seed(TrackerConnection *conn, const FileMetadata *meta);
+void handle_request_all_available_files(TrackerConnection *conn);
+void handle_request_catalog_page(TrackerConnection *conn, ssize_t cursor, ssize_t maxEntries);
+void handle_request_search(TrackerConnection *conn, const SearchRequest *req);
+void handle_request_participate_by_fileID(TrackerConnection *conn, const PeerWithFileID *peerWithFileID);
+void handle_request_seeder_by_fileID(TrackerConnection *conn, ssize_t fileID, ssize_t maxPeers, ssize_t flags);
+void handle_request_metadata(TrackerConnection *conn, const RequestMetadataBody *req);
+void handle_request_unparticipate_by_fileID(TrackerConnection *conn, const PeerWithFileID *peerWithFileID);
+void handle_delete_seeder(TrackerConnection *conn, const PeerInfo *p);
+void handle_request_participate_batch(TrackerConnection *conn, const BatchParticipateRequest *req, const ssize_t *fileIDs);
+void handle_request_seeder_batch(TrackerConnection *conn, const BatchSeederRequest *req, const ssize_t *fileIDs);
+void handle_request_scrape(TrackerConnection *conn, const ssize_t *fileIDs, size_t count);
+void handle_request_announce(TrackerConnection *conn, const AnnounceRequest *req);
+void handle_request_stats(TrackerConnection *conn);
 
 #endif // TRACKER_H
\ No newline at end of file
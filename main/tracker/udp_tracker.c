@@ -0,0 +1,488 @@
+#define _GNU_SOURCE // recvmmsg(), sendmmsg()
+#include <endian.h>
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "tracker.h"
+#include "policy.h"
+#include "peer_registry.h"
+#include "swarm.h"
+#include "udp_tracker.h"
+
+#define UDP_CONNECT_SIZE 16
+#define UDP_ANNOUNCE_SIZE 28
+#define UDP_ANNOUNCE_STATS_SIZE 52 // with downloaded, left, uploaded
+#define UDP_SEEDERS_SIZE 28
+#define UDP_REQUEST_MAX 512 // longer datagrams are not ours, they are truncated and dropped
+#define UDP_SEEDERS_MAX ((UDP_PACKET_MAX - 16) / PEER_COMPACT_V4_SIZE)
+
+typedef struct
+{
+    int socket;
+    pthread_t thread;
+} UdpWorker;
+
+static uint8_t connection_key[16]; // SipHash key, random per tracker run
+static int announce_interval;
+
+/* --------------------------------------------------------------------------
+   🔹 Helpers
+   -------------------------------------------------------------------------- */
+static uint64_t get_u64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return be64toh(v);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohl(v);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohs(v);
+}
+
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    v = htobe64(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    v = htonl(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+#define ROTL64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND(v0, v1, v2, v3)                                                        \
+    do                                                                                  \
+    {                                                                                   \
+        v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32);                   \
+        v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2;                                        \
+        v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0;                                        \
+        v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32);                   \
+    } while (0)
+
+/* SipHash-2-4 of data under connection_key */
+static uint64_t siphash24(const uint8_t *data, size_t len)
+{
+    uint64_t k0, k1;
+    memcpy(&k0, connection_key, 8);
+    memcpy(&k1, connection_key + 8, 8);
+    k0 = le64toh(k0);
+    k1 = le64toh(k1);
+
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+
+    size_t full = len & ~(size_t)7;
+    for (size_t i = 0; i < full; i += 8)
+    {
+        uint64_t m;
+        memcpy(&m, data + i, 8);
+        m = le64toh(m);
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    uint64_t last = (uint64_t)len << 56;
+    for (size_t i = full; i < len; i++)
+        last |= (uint64_t)data[i] << (8 * (i - full));
+    v3 ^= last;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++)
+        SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/* Binary sender address, port in host byte order. Returns -1 for anything but IPv4 / IPv6 */
+static int key_from_sockaddr(const struct sockaddr_storage *from, PeerKey *key)
+{
+    memset(key, 0, sizeof(*key));
+    if (from->ss_family == AF_INET)
+    {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)from;
+        key->family = AF_INET;
+        memcpy(key->addr, &in->sin_addr, 4);
+        key->port = ntohs(in->sin_port);
+        return 0;
+    }
+    if (from->ss_family == AF_INET6)
+    {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)from;
+        key->family = AF_INET6;
+        memcpy(key->addr, &in6->sin6_addr, 16);
+        key->port = ntohs(in6->sin6_port);
+        return 0;
+    }
+    return -1;
+}
+
+/* The ID handed to this sender address in the given epoch */
+static uint64_t connection_id(const PeerKey *sender, uint64_t epoch)
+{
+    uint8_t msg[1 + 16 + 2 + 8];
+    msg[0] = sender->family;
+    memcpy(msg + 1, sender->addr, 16);
+    memcpy(msg + 17, &sender->port, 2);
+    memcpy(msg + 19, &epoch, 8);
+    return siphash24(msg, sizeof(msg));
+}
+
+static int connection_id_valid(const PeerKey *sender, uint64_t id, uint64_t epoch)
+{
+    return id == connection_id(sender, epoch) || id == connection_id(sender, epoch - 1);
+}
+
+static size_t write_error(uint8_t *out, uint32_t transactionId, const char *text)
+{
+    size_t len = strlen(text);
+    put_u32(out, UDP_ACTION_ERROR);
+    put_u32(out + 4, transactionId);
+    memcpy(out + 8, text, len);
+    return 8 + len;
+}
+
+/* Error text for a policy decision, NULL when the peer is allowed */
+static const char *policy_error(PolicyDecision decision)
+{
+    switch (decision)
+    {
+    case POLICY_IP_BLOCKED:
+        return "IP blocked";
+    case POLICY_FILEHASH_BLOCKED:
+        return "filehash blocked";
+    case POLICY_REGION_BLOCKED:
+        return "filehash blocked in your region";
+    default:
+        return NULL;
+    }
+}
+
+/* Error naming the tracker that owns fileID, 0 when this tracker owns it */
+static size_t wrong_shard_error(uint8_t *out, uint32_t transactionId, ssize_t fileID)
+{
+    TrackerShard owner;
+    if (tracker_owns_file(fileID, &owner))
+        return 0;
+    char text[SHARD_ADDR_MAX + 48];
+    snprintf(text, sizeof(text), "wrong shard %s:%d", owner.ip, owner.port);
+    return write_error(out, transactionId, text);
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Requests
+   -------------------------------------------------------------------------- */
+static size_t handle_announce(const PeerKey *sender, const uint8_t *req, size_t len, uint8_t *out)
+{
+    uint32_t transactionId = get_u32(req + 12);
+    ssize_t fileID = (ssize_t)get_u64(req + 16);
+    uint16_t event = get_u16(req + 26);
+    uint64_t downloaded = 0, left = 0, uploaded = 0;
+    if (len >= UDP_ANNOUNCE_STATS_SIZE)
+    {
+        downloaded = get_u64(req + 28);
+        left = get_u64(req + 36);
+        uploaded = get_u64(req + 44);
+    }
+
+    // The announced port is the peer's listening port, the address is where the packet came from
+    PeerKey peer = *sender;
+    peer.port = get_u16(req + 24);
+
+    size_t redirect = wrong_shard_error(out, transactionId, fileID);
+    if (redirect)
+        return redirect;
+
+    PeerInfo info;
+    peer_key_to_info(&peer, &info);
+    const char *blocked = policy_error(evaluate_policy(info.ip_address, &info, fileID));
+    if (blocked)
+        return write_error(out, transactionId, blocked);
+    if (!tracker_has_file(fileID))
+        return write_error(out, transactionId, "unknown file");
+
+    // A stop from an unknown peer has nothing to remove, it is not registered for it
+    PeerHandle handle = event == ANNOUNCE_EVENT_STOPPED ? peer_registry_find(&peer) : peer_registry_insert(&peer, NULL);
+    if (handle == PEER_HANDLE_NONE ? event != ANNOUNCE_EVENT_STOPPED
+                                   : tracker_announce(fileID, handle, (AnnounceEvent)event, uploaded, downloaded, left) < 0)
+        return write_error(out, transactionId, "announce failed");
+
+    SwarmStats stats;
+    swarm_stats(fileID, &stats);
+    put_u32(out, UDP_ACTION_ANNOUNCE);
+    put_u32(out + 4, transactionId);
+    put_u32(out + 8, (uint32_t)announce_interval);
+    put_u32(out + 12, (uint32_t)stats.seeders);
+    put_u32(out + 16, (uint32_t)stats.leechers);
+    return 20;
+}
+
+static size_t handle_seeders(const PeerKey *sender, const uint8_t *req, uint8_t *out)
+{
+    uint32_t transactionId = get_u32(req + 12);
+    ssize_t fileID = (ssize_t)get_u64(req + 16);
+    uint32_t maxPeers = get_u32(req + 24);
+
+    size_t redirect = wrong_shard_error(out, transactionId, fileID);
+    if (redirect)
+        return redirect;
+
+    PeerInfo info;
+    peer_key_to_info(sender, &info);
+    const char *blocked = policy_error(evaluate_policy(info.ip_address, &info, fileID));
+    if (blocked)
+        return write_error(out, transactionId, blocked);
+
+    // As many peers as fit in one datagram, up to 239 when they are all IPv4
+    size_t limit = UDP_SEEDERS_MAX;
+    if (maxPeers > 0 && maxPeers < limit)
+        limit = maxPeers;
+
+    PeerHandle handles[UDP_SEEDERS_MAX];
+    PeerKey keys[UDP_SEEDERS_MAX];
+    size_t found = fileID >= 0 ? swarm_collect(fileID, handles, limit) : 0;
+    size_t count = 0, bytes = 16;
+    for (size_t i = 0; i < found; i++)
+    {
+        if (peer_registry_get(handles[i], &keys[count]) < 0)
+            continue; // peer removed since
+        size_t size = keys[count].family == AF_INET6 ? PEER_COMPACT_V6_SIZE : PEER_COMPACT_V4_SIZE;
+        if (bytes + size > UDP_PACKET_MAX)
+            break;
+        bytes += size;
+        count++;
+    }
+
+    // IPv4 section first, then IPv6, same order as MSG_ACK_SEEDER_BY_FILEID_COMPACT
+    size_t len = 16;
+    uint32_t counts[2] = {0, 0};
+    for (int v6 = 0; v6 <= 1; v6++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if ((keys[i].family == AF_INET6) != v6)
+                continue;
+            len += peer_key_to_compact(&keys[i], out + len);
+            counts[v6]++;
+        }
+    }
+
+    put_u32(out, UDP_ACTION_SEEDERS);
+    put_u32(out + 4, transactionId);
+    put_u32(out + 8, counts[0]);
+    put_u32(out + 12, counts[1]);
+    return len;
+}
+
+/* Builds the reply to one datagram into out. Returns its length, 0 to send nothing */
+static size_t handle_datagram(const struct sockaddr_storage *from, const uint8_t *req, size_t len, uint8_t *out, uint64_t epoch)
+{
+    PeerKey sender;
+    if (len < UDP_CONNECT_SIZE || key_from_sockaddr(from, &sender) < 0)
+        return 0;
+
+    uint32_t action = get_u32(req + 8);
+    uint32_t transactionId = get_u32(req + 12);
+
+    if (action == UDP_ACTION_CONNECT)
+    {
+        if (get_u64(req) != UDP_PROTOCOL_ID)
+            return 0;
+        put_u32(out, UDP_ACTION_CONNECT);
+        put_u32(out + 4, transactionId);
+        put_u64(out + 8, connection_id(&sender, epoch));
+        return 16;
+    }
+
+    // Everything else must prove the sender received our connect reply at this address
+    if (!connection_id_valid(&sender, get_u64(req), epoch))
+        return write_error(out, transactionId, "invalid connection id");
+
+    if (action == UDP_ACTION_ANNOUNCE && len >= UDP_ANNOUNCE_SIZE)
+        return handle_announce(&sender, req, len, out);
+    if (action == UDP_ACTION_SEEDERS && len >= UDP_SEEDERS_SIZE)
+        return handle_seeders(&sender, req, out);
+    return write_error(out, transactionId, "unknown action");
+}
+
+/* --------------------------------------------------------------------------
+   🔹 Workers
+   -------------------------------------------------------------------------- */
+/*
+@brief One UDP worker: a batch in with recvmmsg(), every reply built in place, the batch out with sendmmsg()
+MSG_WAITFORONE blocks for the first datagram only, then takes whatever else is already queued.
+*/
+static void *udp_worker_main(void *arg)
+{
+    UdpWorker *worker = arg;
+
+    uint8_t (*requests)[UDP_REQUEST_MAX] = malloc(UDP_BATCH * sizeof(*requests));
+    uint8_t (*replies)[UDP_PACKET_MAX] = malloc(UDP_BATCH * sizeof(*replies));
+    struct sockaddr_storage peers[UDP_BATCH];
+    struct iovec request_iov[UDP_BATCH], reply_iov[UDP_BATCH];
+    struct mmsghdr in[UDP_BATCH], out[UDP_BATCH];
+
+    if (!requests || !replies)
+    {
+        perror("udp: malloc");
+        free(requests);
+        free(replies);
+        close(worker->socket);
+        return NULL;
+    }
+
+    for (int i = 0; i < UDP_BATCH; i++)
+    {
+        request_iov[i].iov_base = requests[i];
+        request_iov[i].iov_len = UDP_REQUEST_MAX;
+    }
+
+    for (;;)
+    {
+        memset(in, 0, sizeof(in));
+        for (int i = 0; i < UDP_BATCH; i++)
+        {
+            in[i].msg_hdr.msg_name = &peers[i];
+            in[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+            in[i].msg_hdr.msg_iov = &request_iov[i];
+            in[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // Offline while blocked, like the TCP workers in epoll_wait()
+        policy_reader_offline();
+        int received = recvmmsg(worker->socket, in, UDP_BATCH, MSG_WAITFORONE, NULL);
+        policy_reader_online();
+        if (received < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("udp: recvmmsg: %s", strerror(errno));
+            break;
+        }
+
+        uint64_t epoch = (uint64_t)time(NULL) / UDP_CONNECTION_ID_TTL;
+        int replies_ready = 0;
+        metrics_add(METRIC_UDP_PACKETS_IN, (uint64_t)received);
+        for (int i = 0; i < received; i++)
+        {
+            if (in[i].msg_hdr.msg_flags & MSG_TRUNC)
+                continue;
+            uint64_t started = metrics_now_ns();
+            size_t len = handle_datagram(&peers[i], requests[i], in[i].msg_len, replies[replies_ready], epoch);
+            metrics_record(TIMER_UDP_REQUEST, metrics_now_ns() - started);
+            if (len == 0)
+                continue;
+
+            reply_iov[replies_ready].iov_base = replies[replies_ready];
+            reply_iov[replies_ready].iov_len = len;
+            memset(&out[replies_ready], 0, sizeof(out[replies_ready]));
+            out[replies_ready].msg_hdr.msg_name = &peers[i];
+            out[replies_ready].msg_hdr.msg_namelen = in[i].msg_hdr.msg_namelen;
+            out[replies_ready].msg_hdr.msg_iov = &reply_iov[replies_ready];
+            out[replies_ready].msg_hdr.msg_iovlen = 1;
+            replies_ready++;
+        }
+
+        // A full socket buffer drops the rest of the batch, the peers retry like after any lost datagram
+        int sent = 0;
+        while (sent < replies_ready)
+        {
+            int n = sendmmsg(worker->socket, out + sent, (unsigned int)(replies_ready - sent), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            sent += n;
+        }
+        metrics_add(METRIC_UDP_PACKETS_OUT, (uint64_t)sent);
+    }
+
+    policy_reader_offline();
+    free(requests);
+    free(replies);
+    close(worker->socket);
+    return NULL;
+}
+
+static int udp_open_socket(const char *ip, int port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("udp: socket");
+        return -1;
+    }
+
+    int optval = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("udp: bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* --------------------------------------------------------------------------
+   🔹 API
+   -------------------------------------------------------------------------- */
+int udp_tracker_start(const char *ip, int port, int workers, int interval)
+{
+    if (workers <= 0)
+        return 0;
+    if (workers > UDP_MAX_WORKERS)
+        workers = UDP_MAX_WORKERS;
+    announce_interval = interval;
+
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || read(fd, connection_key, sizeof(connection_key)) != (ssize_t)sizeof(connection_key))
+    {
+        perror("udp: /dev/urandom");
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    close(fd);
+
+    static UdpWorker pool[UDP_MAX_WORKERS];
+    for (int i = 0; i < workers; i++)
+    {
+        pool[i].socket = udp_open_socket(ip, port);
+        if (pool[i].socket < 0)
+            return -1;
+        if (pthread_create(&pool[i].thread, NULL, udp_worker_main, &pool[i]) != 0)
+        {
+            perror("udp: pthread_create");
+            close(pool[i].socket);
+            return -1;
+        }
+        pthread_detach(pool[i].thread);
+    }
+
+    printf("✅ UDP tracker on %s:%d with %d worker(s)\n", ip, port, workers);
+    return 0;
+}
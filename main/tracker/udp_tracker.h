@@ -0,0 +1,51 @@
+#ifndef UDP_TRACKER_H
+#define UDP_TRACKER_H
+
+#include <stdint.h>
+
+/*
+@brief Connectionless tracker on UDP SERVER_PORT, next to the TCP one (BEP 15 style)
+
+Every field is big endian, packets have no padding.
+    connect     -> u64 protocolId (UDP_PROTOCOL_ID), u32 action 0, u32 transactionId
+                <- u32 action 0, u32 transactionId, u64 connectionId
+    announce    -> u64 connectionId, u32 action 1, u32 transactionId, i64 fileID, u16 port, u16 event,
+                   optionally u64 downloaded, u64 left, u64 uploaded
+                <- u32 action 1, u32 transactionId, u32 announceInterval, u32 seeders, u32 leechers
+    seeder list -> u64 connectionId, u32 action 2, u32 transactionId, i64 fileID, u32 maxPeers
+                <- u32 action 2, u32 transactionId, u32 countV4, u32 countV6,
+                   countV4 * (4 byte IPv4 + port), countV6 * (16 byte IPv6 + port)
+    error       <- u32 action 3, u32 transactionId, message text
+Announce registers the sender in fileID's swarm like MSG_REQUEST_ANNOUNCE (tracker.h): event is an
+AnnounceEvent, downloaded / uploaded are bytes since the previous announce. Without the optional
+fields it is a seeder announce (same as create seeder + participate over TCP).
+The address is always the packet's source address.
+
+Anti spoofing: a connection ID is a keyed hash (SipHash-2-4, random key per tracker run) of the
+sender's address, port and the current UDP_CONNECTION_ID_TTL second epoch. It only validates for the
+address it was sent to, so a forged source address never gets an announce accepted. IDs stay valid
+for the current and the previous epoch, then the peer connects again.
+
+Each UDP worker owns a SO_REUSEPORT socket and serves batches of UDP_BATCH datagrams with one
+recvmmsg() and one sendmmsg(). The policy checks are the same as for TCP (evaluate_policy()).
+*/
+
+#define UDP_PROTOCOL_ID 0x41727101980ULL
+#define UDP_CONNECTION_ID_TTL 60 // seconds per epoch
+#define UDP_BATCH 64             // datagrams per recvmmsg / sendmmsg
+#define UDP_PACKET_MAX 1452      // largest reply, fits an IPv6 datagram without fragmenting
+#define UDP_MAX_WORKERS 64
+
+enum
+{
+    UDP_ACTION_CONNECT = 0,
+    UDP_ACTION_ANNOUNCE = 1,
+    UDP_ACTION_SEEDERS = 2,
+    UDP_ACTION_ERROR = 3
+};
+
+/* Binds one socket per worker on ip:port and starts the worker threads, 0 workers disables UDP.
+   interval is the announce interval sent back to seeders. Returns 0, or -1 on error */
+int udp_tracker_start(const char *ip, int port, int workers, int interval);
+
+#endif // UDP_TRACKER_H
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include "journal.h"
+#include "peer_registry.h"
+#include "swarm.h"
+
+/*
+Replay of swarm.snap + swarm.wal (journal.c), run from main/tracker with `make -f MAKEFILE unit-test`.
+Writes the files by hand in a temporary directory, then checks what journal_open() restores:
+    - the snapshot, then the log of the same sequence on top of it
+    - a torn tail: replay stops at the first record failing its checksum, nothing after it is applied
+    - a log of another sequence is ignored (in a child process, the registry and swarms are process wide)
+    - after the restart, new changes are committed to a fresh log
+*/
+
+static int failures = 0;
+
+#define CHECK(cond)                                                       \
+    do                                                                    \
+    {                                                                     \
+        if (!(cond))                                                      \
+        {                                                                 \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+// Same FNV-1a as journal.c, over the record with the checksum zeroed
+static void seal(JournalRecord *record)
+{
+    record->checksum = 0;
+    const uint8_t *p = (const uint8_t *)record;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(*record); i++)
+        h = (h ^ p[i]) * 16777619u;
+    record->checksum = h;
+}
+
+static FILE *open_journal_file(const char *path, uint64_t seq)
+{
+    FILE *fp = fopen(path, "wb");
+    JournalFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.sequence = seq;
+    fwrite(&header, sizeof(header), 1, fp);
+    return fp;
+}
+
+static PeerKey make_key(const char *ip, uint16_t port)
+{
+    PeerKey key;
+    memset(&key, 0, sizeof(key));
+    key.family = AF_INET;
+    inet_pton(AF_INET, ip, key.addr);
+    key.port = port;
+    return key;
+}
+
+static void put_register(FILE *fp, PeerHandle handle, PeerKey key)
+{
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_REGISTER;
+    record.peer = handle;
+    record.key = key;
+    seal(&record);
+    fwrite(&record, sizeof(record), 1, fp);
+}
+
+static void put_member(FILE *fp, JournalRecordType type, PeerHandle handle, int64_t fileID, int64_t expires)
+{
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = type;
+    record.role = SWARM_SEEDER;
+    record.peer = handle;
+    record.member.fileID = fileID;
+    record.member.expires = expires;
+    seal(&record);
+    fwrite(&record, sizeof(record), 1, fp);
+}
+
+static void put_counters(FILE *fp, int64_t fileID, uint64_t completed)
+{
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_COUNTERS;
+    record.counters.fileID = fileID;
+    record.counters.completed = completed;
+    seal(&record);
+    fwrite(&record, sizeof(record), 1, fp);
+}
+
+/* Valid JournalRecords of path after its header, -1 when the header is not of sequence seq */
+static long count_records(const char *path, uint64_t seq, JournalRecordType type)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+    JournalFileHeader header;
+    long count = -1;
+    if (fread(&header, sizeof(header), 1, fp) == 1 && header.sequence == seq)
+    {
+        count = 0;
+        JournalRecord record;
+        while (fread(&record, sizeof(record), 1, fp) == 1)
+        {
+            uint32_t stored = record.checksum;
+            seal(&record);
+            if (record.checksum == stored && record.type == type)
+                count++;
+        }
+    }
+    fclose(fp);
+    return count;
+}
+
+/* Snapshot 3 with one member, log 2 written before it: only the snapshot comes back */
+static int stale_log_case(void)
+{
+    int64_t later = (int64_t)time(NULL) + 600;
+    FILE *snap = open_journal_file(JOURNAL_SNAPSHOT_FILE, 3);
+    put_register(snap, 100, make_key("10.0.0.1", 6000));
+    put_member(snap, JOURNAL_JOIN, 100, 5, later);
+    fclose(snap);
+    FILE *wal = open_journal_file(JOURNAL_WAL_FILE, 2);
+    put_register(wal, 200, make_key("10.0.0.2", 6001));
+    put_member(wal, JOURNAL_JOIN, 200, 5, later);
+    fclose(wal);
+
+    peer_registry_init();
+    swarm_init();
+    CHECK(journal_open(5) == 1);
+    CHECK(peer_registry_count() == 1);
+    CHECK(swarm_size(5) == 1);
+    return failures;
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/journal_unit_test.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) < 0)
+    {
+        perror("journal unit test: temporary directory");
+        return 1;
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+        _exit(stale_log_case() ? 1 : 0);
+    int status = 0;
+    waitpid(child, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    unlink(JOURNAL_SNAPSHOT_FILE);
+    unlink(JOURNAL_WAL_FILE);
+
+    int64_t later = (int64_t)time(NULL) + 600;
+    PeerKey a = make_key("10.0.0.1", 6000);
+    PeerKey b = make_key("10.0.0.2", 6001);
+    PeerKey c = make_key("10.0.0.3", 6002);
+
+    // Snapshot 7: peer 100 seeds file 5, which has 3 completions
+    FILE *snap = open_journal_file(JOURNAL_SNAPSHOT_FILE, 7);
+    put_register(snap, 100, a);
+    put_member(snap, JOURNAL_JOIN, 100, 5, later);
+    put_member(snap, JOURNAL_JOIN, 100, 6, later - 1200); // expired while the tracker was down
+    put_counters(snap, 5, 3);
+    fclose(snap);
+
+    // Log 7: peer 200 joins file 5, peer 100 leaves it, then a torn record and what followed it
+    FILE *wal = open_journal_file(JOURNAL_WAL_FILE, 7);
+    put_register(wal, 200, b);
+    put_member(wal, JOURNAL_JOIN, 200, 5, later);
+    put_member(wal, JOURNAL_LEAVE, 100, 5, 0);
+    JournalRecord torn;
+    memset(&torn, 0, sizeof(torn));
+    torn.type = JOURNAL_REGISTER;
+    torn.peer = 300;
+    torn.key = c;
+    seal(&torn);
+    torn.key.port ^= 1; // the crash cut the write short
+    fwrite(&torn, sizeof(torn), 1, wal);
+    put_member(wal, JOURNAL_JOIN, 100, 9, later); // never acknowledged, must not come back
+    fwrite(&torn, sizeof(torn) / 2, 1, wal);
+    fclose(wal);
+
+    peer_registry_init();
+    swarm_init();
+    long members = journal_open(5);
+
+    CHECK(members == 1);
+    CHECK(peer_registry_count() == 2);
+    CHECK(peer_registry_find(&c) == PEER_HANDLE_NONE);
+    CHECK(swarm_size(5) == 1);
+    CHECK(swarm_size(6) == 0);
+    CHECK(swarm_size(9) == 0);
+
+    PeerHandle seeders[4];
+    CHECK(swarm_collect(5, seeders, 4) == 1);
+    CHECK(seeders[0] == peer_registry_find(&b));
+
+    SwarmStats stats;
+    swarm_stats(5, &stats);
+    CHECK(stats.completed == 3);
+
+    // journal_open() compacted everything into snapshot 8 and started an empty log 8
+    CHECK(count_records(JOURNAL_SNAPSHOT_FILE, 8, JOURNAL_JOIN) == 1);
+    CHECK(count_records(JOURNAL_SNAPSHOT_FILE, 8, JOURNAL_REGISTER) == 2);
+    CHECK(count_records(JOURNAL_WAL_FILE, 8, JOURNAL_JOIN) == 0);
+
+    // New changes reach the log at the next commit
+    PeerHandle d = peer_registry_insert(&c, NULL);
+    CHECK(swarm_add(11, d, 600) == 0);
+    journal_flush();
+    CHECK(count_records(JOURNAL_WAL_FILE, 8, JOURNAL_REGISTER) == 1);
+    CHECK(count_records(JOURNAL_WAL_FILE, 8, JOURNAL_JOIN) == 1);
+
+    unlink(JOURNAL_SNAPSHOT_FILE);
+    unlink(JOURNAL_WAL_FILE);
+    rmdir(dir);
+
+    if (failures)
+    {
+        fprintf(stderr, "journal unit test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("journal unit test: ok\n");
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "peer_registry.h"
+#include "swarm.h"
+
+/*
+Peer registry (peer_registry.c) and swarms (swarm.c), run from main/tracker with `make -f MAKEFILE unit-test`.
+    - registry: insert / find / remove, growth far past the 70% load of the first table,
+      removals inside probe runs (backward shift) leave every other peer findable
+    - generation tagged handles: a handle stops resolving once its peer is removed, also after the slot is reused
+    - compact encoding: 6 bytes for IPv4, 18 for IPv6, address and port in network byte order
+    - swarms: add / remove / collect with thousands of peers in one file, files sharing a shard stay apart
+*/
+
+#define MANY_PEERS 20000 // the table starts at 1024 buckets, this forces several doublings
+
+static int failures = 0;
+
+#define CHECK(cond)                                                       \
+    do                                                                    \
+    {                                                                     \
+        if (!(cond))                                                      \
+        {                                                                 \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+static PeerKey make_key(int family, const char *ip, uint16_t port)
+{
+    PeerKey key;
+    memset(&key, 0, sizeof(key));
+    key.family = (uint8_t)family;
+    inet_pton(family, ip, key.addr);
+    key.port = port;
+    return key;
+}
+
+/* Peer n of the bulk tests: 10.x.y.z, the port differs too so neighbours only share part of the key */
+static PeerKey bulk_key(uint32_t n)
+{
+    PeerKey key;
+    memset(&key, 0, sizeof(key));
+    key.family = AF_INET;
+    key.addr[0] = 10;
+    key.addr[1] = (uint8_t)(n >> 16);
+    key.addr[2] = (uint8_t)(n >> 8);
+    key.addr[3] = (uint8_t)n;
+    key.port = (uint16_t)(6000 + n % 7);
+    return key;
+}
+
+static uint32_t bulk_number(const PeerKey *key)
+{
+    return (uint32_t)key->addr[1] << 16 | (uint32_t)key->addr[2] << 8 | key->addr[3];
+}
+
+static uint32_t handle_slot(PeerHandle handle)
+{
+    return (uint32_t)handle;
+}
+
+static void registry_basics(void)
+{
+    PeerKey a = make_key(AF_INET, "10.0.0.1", 6000);
+    PeerKey a_other_port = make_key(AF_INET, "10.0.0.1", 6001);
+    PeerKey b = make_key(AF_INET6, "2001:db8::1", 6000);
+
+    int created = 0;
+    PeerHandle ha = peer_registry_insert(&a, &created);
+    CHECK(ha != PEER_HANDLE_NONE && created == 1);
+    CHECK(peer_registry_insert(&a, &created) == ha && created == 0);
+    CHECK(peer_registry_find(&a) == ha);
+    CHECK(peer_registry_find(&a_other_port) == PEER_HANDLE_NONE);
+
+    PeerHandle hb = peer_registry_insert(&b, &created);
+    CHECK(hb != PEER_HANDLE_NONE && hb != ha && created == 1);
+    CHECK(peer_registry_count() == 2);
+
+    PeerKey out;
+    CHECK(peer_registry_get(hb, &out) == 0 && memcmp(&out, &b, sizeof(out)) == 0);
+
+    CHECK(peer_registry_remove(ha) == 0);
+    CHECK(peer_registry_find(&a) == PEER_HANDLE_NONE);
+    CHECK(peer_registry_count() == 1);
+    CHECK(peer_registry_remove(hb) == 0);
+    CHECK(peer_registry_count() == 0);
+}
+
+static void registry_stale_handles(void)
+{
+    PeerKey a = make_key(AF_INET, "10.0.1.1", 7000);
+    PeerKey b = make_key(AF_INET, "10.0.1.2", 7000);
+    PeerKey out;
+
+    PeerHandle ha = peer_registry_insert(&a, NULL);
+    CHECK(peer_registry_remove(ha) == 0);
+    CHECK(peer_registry_get(ha, &out) == -1);
+    CHECK(peer_registry_remove(ha) == -1); // a second remove of the same handle is refused
+
+    // b takes the freed slot, the old handle must not resolve to it
+    PeerHandle hb = peer_registry_insert(&b, NULL);
+    CHECK(handle_slot(hb) == handle_slot(ha));
+    CHECK(hb != ha);
+    CHECK(peer_registry_get(ha, &out) == -1);
+    CHECK(peer_registry_remove(ha) == -1);
+    CHECK(peer_registry_get(hb, &out) == 0 && memcmp(&out, &b, sizeof(out)) == 0);
+
+    // a registers again: a new handle, never the one it had before
+    PeerHandle ha2 = peer_registry_insert(&a, NULL);
+    CHECK(ha2 != ha && ha2 != hb);
+    CHECK(peer_registry_remove(hb) == 0 && peer_registry_remove(ha2) == 0);
+    CHECK(peer_registry_count() == 0);
+}
+
+static void registry_growth_and_removal(void)
+{
+    static PeerHandle handles[MANY_PEERS];
+    for (uint32_t n = 0; n < MANY_PEERS; n++)
+    {
+        PeerKey key = bulk_key(n);
+        handles[n] = peer_registry_insert(&key, NULL);
+    }
+    CHECK(peer_registry_count() == MANY_PEERS);
+
+    int lost = 0, duplicate = 0;
+    for (uint32_t n = 0; n < MANY_PEERS; n++)
+    {
+        PeerKey key = bulk_key(n);
+        lost += peer_registry_find(&key) != handles[n];
+        duplicate += n > 0 && handles[n] == handles[n - 1];
+    }
+    CHECK(lost == 0);
+    CHECK(duplicate == 0);
+
+    // Every third peer leaves: the survivors behind them in a probe run must still be found
+    for (uint32_t n = 0; n < MANY_PEERS; n += 3)
+        CHECK(peer_registry_remove(handles[n]) == 0);
+    lost = 0;
+    int ghosts = 0;
+    for (uint32_t n = 0; n < MANY_PEERS; n++)
+    {
+        PeerKey key = bulk_key(n);
+        PeerHandle found = peer_registry_find(&key);
+        if (n % 3 == 0)
+            ghosts += found != PEER_HANDLE_NONE;
+        else
+            lost += found != handles[n];
+    }
+    CHECK(lost == 0);
+    CHECK(ghosts == 0);
+    CHECK(peer_registry_count() == MANY_PEERS - (MANY_PEERS + 2) / 3);
+
+    for (uint32_t n = 1; n < MANY_PEERS; n++)
+        if (n % 3)
+            peer_registry_remove(handles[n]);
+    CHECK(peer_registry_count() == 0);
+}
+
+static void compact_encoding(void)
+{
+    uint8_t out[PEER_COMPACT_V6_SIZE + 1];
+
+    PeerKey v4 = make_key(AF_INET, "192.168.1.20", 6881);
+    memset(out, 0xee, sizeof(out));
+    CHECK(peer_key_to_compact(&v4, out) == PEER_COMPACT_V4_SIZE);
+    const uint8_t want_v4[PEER_COMPACT_V4_SIZE] = {192, 168, 1, 20, 0x1a, 0xe1};
+    CHECK(memcmp(out, want_v4, sizeof(want_v4)) == 0);
+    CHECK(out[PEER_COMPACT_V4_SIZE] == 0xee); // nothing written past the entry
+
+    PeerKey v6 = make_key(AF_INET6, "2001:db8::ff00:42:8329", 443);
+    memset(out, 0xee, sizeof(out));
+    CHECK(peer_key_to_compact(&v6, out) == PEER_COMPACT_V6_SIZE);
+    CHECK(memcmp(out, v6.addr, 16) == 0);
+    CHECK(out[16] == 0x01 && out[17] == 0xbb);
+    CHECK(out[PEER_COMPACT_V6_SIZE] == 0xee);
+
+    // Round trip: text -> key -> compact -> back to text
+    const char *texts[][2] = {{"127.0.0.1", "6000"}, {"10.255.0.1", "65535"}, {"::1", "1"}, {"fe80::1:2", "5555"}};
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+    {
+        PeerInfo info;
+        memset(&info, 0, sizeof(info));
+        strcpy(info.ip_address, texts[i][0]);
+        strcpy(info.port, texts[i][1]);
+
+        PeerKey key;
+        CHECK(peer_key_from_info(&info, &key) == 0);
+        size_t len = peer_key_to_compact(&key, out);
+        int family = len == PEER_COMPACT_V6_SIZE ? AF_INET6 : AF_INET;
+        CHECK(family == key.family);
+
+        char ip[INET6_ADDRSTRLEN];
+        uint16_t port;
+        memcpy(&port, out + len - 2, sizeof(port));
+        CHECK(inet_ntop(family, out, ip, sizeof(ip)) && strcmp(ip, texts[i][0]) == 0);
+        CHECK(ntohs(port) == (uint16_t)atoi(texts[i][1]));
+
+        PeerInfo back;
+        peer_key_to_info(&key, &back);
+        CHECK(strcmp(back.ip_address, texts[i][0]) == 0 && strcmp(back.port, texts[i][1]) == 0);
+    }
+
+    PeerInfo bad;
+    memset(&bad, 0, sizeof(bad));
+    strcpy(bad.ip_address, "tracker.example");
+    strcpy(bad.port, "6000");
+    PeerKey key;
+    CHECK(peer_key_from_info(&bad, &key) == -1);
+}
+
+static void swarm_members(void)
+{
+    enum
+    {
+        FILE_A = 3,
+        FILE_B = FILE_A + SWARM_SHARDS, // same shard as FILE_A
+        SWARM_PEERS = 5000
+    };
+    static PeerHandle handles[SWARM_PEERS];
+    static PeerHandle collected[SWARM_PEERS + 1];
+
+    for (uint32_t n = 0; n < SWARM_PEERS; n++)
+    {
+        PeerKey key = bulk_key(100000 + n);
+        handles[n] = peer_registry_insert(&key, NULL);
+        CHECK(swarm_add(FILE_A, handles[n], 600) == 0);
+    }
+    CHECK(swarm_add(FILE_A, handles[0], 600) == 1); // already seeding, only refreshed
+    CHECK(swarm_size(FILE_A) == SWARM_PEERS);
+    CHECK(swarm_size(FILE_B) == 0);
+
+    CHECK(swarm_add(FILE_B, handles[1], 600) == 0);
+    CHECK(swarm_size(FILE_B) == 1);
+
+    // Half the seeders leave, the other half must be collected exactly once each
+    for (uint32_t n = 0; n < SWARM_PEERS; n += 2)
+        CHECK(swarm_remove(FILE_A, handles[n]) == 0);
+    CHECK(swarm_remove(FILE_A, handles[0]) == -1);
+    CHECK(swarm_size(FILE_A) == SWARM_PEERS / 2);
+
+    size_t got = swarm_collect(FILE_A, collected, SWARM_PEERS + 1);
+    CHECK(got == SWARM_PEERS / 2);
+    static uint8_t seen[SWARM_PEERS];
+    int wrong = 0;
+    for (size_t i = 0; i < got; i++)
+    {
+        PeerKey key;
+        if (peer_registry_get(collected[i], &key) < 0)
+        {
+            wrong++;
+            continue;
+        }
+        uint32_t n = bulk_number(&key) - 100000;
+        wrong += n >= SWARM_PEERS || n % 2 == 0 || handles[n] != collected[i] || seen[n]++;
+    }
+    CHECK(wrong == 0);
+    CHECK(swarm_collect(FILE_A, collected, 10) == 10); // max is honoured
+
+    // A peer holds one role per file: announcing as a leecher takes it out of the seeders
+    CHECK(swarm_add_leecher(FILE_A, handles[1], 600) >= 0);
+    SwarmStats stats;
+    swarm_stats(FILE_A, &stats);
+    CHECK(stats.seeders == SWARM_PEERS / 2 - 1 && stats.leechers == 1);
+    CHECK(swarm_complete(FILE_A, handles[1]) == 0);
+    swarm_stats(FILE_A, &stats);
+    CHECK(stats.leechers == 0 && stats.completed == 1);
+
+    // FILE_B did not see any of it
+    CHECK(swarm_collect(FILE_B, collected, 4) == 1 && collected[0] == handles[1]);
+    swarm_stats(FILE_B, &stats);
+    CHECK(stats.seeders == 1 && stats.leechers == 0 && stats.completed == 0);
+}
+
+int main(void)
+{
+    peer_registry_init();
+    swarm_init();
+
+    registry_basics();
+    registry_stale_handles();
+    registry_growth_and_removal();
+    compact_encoding();
+    swarm_members();
+
+    if (failures)
+    {
+        fprintf(stderr, "registry unit test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("registry unit test: ok\n");
+    return 0;
+}